@@ -1223,6 +1223,7 @@ class ascii_protocol {
 class udp_server {
 public:
     static const size_t default_max_datagram_size = 1400;
+    static const size_t receive_batch_size = 16;
 private:
     std::optional<future<>> _task;
     sharded_cache& _cache;
@@ -1267,15 +1268,18 @@ class udp_server {
         {}
 
         future<> respond(udp_channel& chan) {
-            int i = 0;
-            return do_for_each(_out_bufs.begin(), _out_bufs.end(), [this, i, &chan] (packet& p) mutable {
+            std::vector<net::outgoing_datagram> batch;
+            batch.reserve(_out_bufs.size());
+            uint16_t i = 0;
+            for (auto& p : _out_bufs) {
                 header* out_hdr = p.prepend_header<header>(0);
                 out_hdr->_request_id = _request_id;
                 out_hdr->_sequence_number = i++;
                 out_hdr->_n = _out_bufs.size();
                 *out_hdr = hton(*out_hdr);
-                return chan.send(_src, std::move(p));
-            });
+                batch.push_back({_src, std::move(p)});
+            }
+            return chan.send_batch(std::move(batch));
         }
     };
 
@@ -1290,36 +1294,46 @@ class udp_server {
         _max_datagram_size = max_datagram_size;
     }
 
-    void start() {
-        _chan = make_bound_datagram_channel({_port});
-        // Run in the background.
-        _task = keep_doing([this] {
-            return _chan.receive().then([this](datagram dgram) {
-                packet& p = dgram.get_data();
-                if (p.len() < sizeof(header)) {
-                    // dropping invalid packet
-                    return make_ready_future<>();
-                }
+    future<> handle(datagram& dgram) {
+        packet& p = dgram.get_data();
+        if (p.len() < sizeof(header)) {
+            // dropping invalid packet
+            return make_ready_future<>();
+        }
 
-                header hdr = ntoh(*p.get_header<header>());
-                p.trim_front(sizeof(hdr));
+        header hdr = ntoh(*p.get_header<header>());
+        p.trim_front(sizeof(hdr));
 
-                auto request_id = hdr._request_id;
-                auto in = as_input_stream(std::move(p));
-                auto conn = make_lw_shared<connection>(dgram.get_src(), request_id, std::move(in),
-                    _max_datagram_size - sizeof(header), _cache, _system_stats);
+        auto request_id = hdr._request_id;
+        auto in = as_input_stream(std::move(p));
+        auto conn = make_lw_shared<connection>(dgram.get_src(), request_id, std::move(in),
+            _max_datagram_size - sizeof(header), _cache, _system_stats);
 
-                if (hdr._n != 1 || hdr._sequence_number != 0) {
-                    return conn->_out.write("CLIENT_ERROR only single-datagram requests supported\r\n").then([this, conn] {
-                        return conn->_out.flush().then([this, conn] {
-                            return conn->respond(_chan).then([conn] {});
-                        });
-                    });
-                }
+        if (hdr._n != 1 || hdr._sequence_number != 0) {
+            return conn->_out.write("CLIENT_ERROR only single-datagram requests supported\r\n").then([this, conn] {
+                return conn->_out.flush().then([this, conn] {
+                    return conn->respond(_chan).then([conn] {});
+                });
+            });
+        }
+
+        return conn->_proto.handle(conn->_in, conn->_out).then([this, conn]() mutable {
+            return conn->_out.flush().then([this, conn] {
+                return conn->respond(_chan).then([conn] {});
+            });
+        });
+    }
 
-                return conn->_proto.handle(conn->_in, conn->_out).then([this, conn]() mutable {
-                    return conn->_out.flush().then([this, conn] {
-                        return conn->respond(_chan).then([conn] {});
+    void start() {
+        _chan = make_bound_datagram_channel({_port});
+        // Multi-datagram responses go out in one GSO send when the kernel can
+        _chan.set_segmentation_offload(true);
+        // Run in the background.
+        _task = keep_doing([this] {
+            return _chan.receive_batch(receive_batch_size).then([this] (std::vector<datagram> batch) {
+                return do_with(std::move(batch), [this] (std::vector<datagram>& batch) {
+                    return do_for_each(batch, [this] (datagram& dgram) {
+                        return handle(dgram);
                     });
                 });
             });
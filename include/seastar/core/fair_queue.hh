@@ -32,7 +32,6 @@
 #include <cstdint>
 #include <functional>
 #include <optional>
-#include <queue>
 #include <fmt/ostream.h>
 
 namespace bi = boost::intrusive;
@@ -144,6 +143,18 @@ class fair_queue_entry {
 /// When the classes that lag behind start seeing requests, the fair queue will serve
 /// them first, until balance is restored. This balancing is expected to happen within
 /// a certain time window that obeys an exponential decay.
+///
+/// Classes with pending requests are kept in a calendar queue indexed by the
+/// cost they have accumulated, so picking the next class takes constant time
+/// regardless of how many classes are registered. Each bucket of the calendar
+/// covers a dispatch quantum worth of accumulated cost; a class keeps being
+/// dispatched until it has consumed its quantum, and classes that fall into the
+/// same bucket are served round-robin.
+///
+/// Classes can be put into groups, and groups into other groups. A group
+/// competes with its siblings by its own shares, and the capacity it wins is
+/// divided between its members by theirs. Classes that are not put into any
+/// group compete at the top level.
 class fair_queue {
 public:
     /// \brief Fair Queue configuration structure.
@@ -153,48 +164,55 @@ class fair_queue {
     struct config {
         sstring label = "";
         uint64_t forgiving_factor = 0;
+        /// How much accumulated cost (request capacity divided by the class
+        /// shares) a class may consume in one round before yielding to the
+        /// other classes. Rounded down to a power of two.
+        ///
+        /// The default of zero follows the average cost of the dispatched
+        /// requests, re-checked every 1024 dispatches, so that a class gets
+        /// about one request per round as it did before classes were kept
+        /// in a calendar. Larger values mean fewer calendar operations per
+        /// request at the cost of coarser interleaving between classes.
+        uint64_t dispatch_quantum = 0;
     };
 
     using class_id = unsigned int;
+    using group_id = unsigned int;
+    class priority_entry;
     class priority_class_data;
+    class priority_group_data;
     using capacity_t = fair_queue_entry::capacity_t;
     using signed_capacity_t = std::make_signed_t<capacity_t>;
 
 private:
     using clock_type = std::chrono::steady_clock;
-    using priority_class_ptr = priority_class_data*;
-    struct class_compare {
-        bool operator() (const priority_class_ptr& lhs, const priority_class_ptr & rhs) const noexcept;
-    };
 
-    class priority_queue : public std::priority_queue<priority_class_ptr, std::vector<priority_class_ptr>, class_compare> {
-        using super = std::priority_queue<priority_class_ptr, std::vector<priority_class_ptr>, class_compare>;
-    public:
-        void reserve(size_t len) {
-            c.reserve(len);
-        }
-
-        void assert_enough_capacity() const noexcept {
-            SEASTAR_ASSERT(c.size() < c.capacity());
-        }
-    };
+    static constexpr unsigned quantum_retune_period = 1024;
 
     config _config;
     fair_queue_ticket _resources_executing;
     fair_queue_ticket _resources_queued;
-    priority_queue _handles;
+    unsigned _quantum_shift = 0;
+    capacity_t _dispatched_cost = 0;
+    unsigned _dispatched_since_retune = 0;
+    // The implicit top-level group
+    std::unique_ptr<priority_group_data> _root;
     std::vector<std::unique_ptr<priority_class_data>> _priority_classes;
+    std::vector<std::unique_ptr<priority_group_data>> _priority_groups;
     size_t _nr_classes = 0;
-    capacity_t _last_accumulated = 0;
 
     // Total capacity of all requests waiting in the queue.
     capacity_t _queued_capacity = 0;
 
-    void push_priority_class(priority_class_data& pc) noexcept;
-    void push_priority_class_from_idle(priority_class_data& pc) noexcept;
-    void pop_priority_class(priority_class_data& pc) noexcept;
-    void plug_priority_class(priority_class_data& pc) noexcept;
-    void unplug_priority_class(priority_class_data& pc) noexcept;
+    capacity_t slot_of(const priority_entry& e) const noexcept;
+    priority_group_data& group_or_root(std::optional<group_id> g) noexcept;
+    fair_queue_entry* top(priority_group_data& g) noexcept;
+    capacity_t charge(priority_group_data& g, priority_entry& e, capacity_t cap) noexcept;
+    void maybe_retune_quantum(capacity_t req_cost) noexcept;
+    void push_priority_entry_from_idle(priority_entry& e) noexcept;
+    void detach_priority_entry(priority_entry& e) noexcept;
+    void plug_priority_entry(priority_entry& e) noexcept;
+    void unplug_priority_entry(priority_entry& e) noexcept;
 
 public:
     /// Constructs a fair queue with configuration parameters \c cfg.
@@ -209,7 +227,8 @@ class fair_queue {
     /// Registers a priority class against this fair queue.
     ///
     /// \param shares how many shares to create this class with
-    void register_priority_class(class_id c, uint32_t shares);
+    /// \param group the group to put the class into, top level if not set
+    void register_priority_class(class_id c, uint32_t shares, std::optional<group_id> group = std::nullopt);
 
     /// Unregister a priority class.
     ///
@@ -218,6 +237,25 @@ class fair_queue {
 
     void update_shares_for_class(class_id c, uint32_t new_shares);
 
+    /// Moves a priority class into another group.
+    ///
+    /// The class's pending requests move along with it. Its accumulated cost
+    /// is reset to the level of the new siblings.
+    void set_class_group(class_id c, std::optional<group_id> group);
+
+    /// Registers a group of priority classes against this fair queue.
+    ///
+    /// \param shares how many shares to create this group with
+    /// \param parent the group to nest this one into, top level if not set
+    void register_priority_group(group_id g, uint32_t shares, std::optional<group_id> parent = std::nullopt);
+
+    /// Unregister a group.
+    ///
+    /// It is illegal to unregister a group that still has classes or groups in it.
+    void unregister_priority_group(group_id g);
+
+    void update_shares_for_group(group_id g, uint32_t new_shares);
+
     /// \return how much resources (weight, size) are currently queued for all classes.
     fair_queue_ticket resources_currently_waiting() const;
 
@@ -233,6 +271,11 @@ class fair_queue {
     void plug_class(class_id c) noexcept;
     void unplug_class(class_id c) noexcept;
 
+    /// Stops (and resumes) dispatching from all classes in the group, like
+    /// \ref unplug_class (and \ref plug_class) does for a single class.
+    void plug_group(group_id g) noexcept;
+    void unplug_group(group_id g) noexcept;
+
     /// Notifies that ont request finished
     /// \param desc an instance of \c fair_queue_ticket structure describing the request that just finished.
     void notify_request_finished(fair_queue_entry::capacity_t cap) noexcept;
@@ -246,6 +289,7 @@ class fair_queue {
     capacity_t accumulated(class_id cid) const noexcept;
     capacity_t pure_accumulated(class_id cid) const noexcept;
     unsigned activations(class_id cid) const noexcept;
+    capacity_t group_accumulated(group_id gid) const noexcept;
 };
 /// @}
 
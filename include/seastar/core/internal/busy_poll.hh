@@ -0,0 +1,97 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*
+ * Copyright (C) 2026 ScyllaDB
+ */
+
+#pragma once
+
+#include <seastar/core/internal/pollable_fd.hh>
+#include <seastar/core/lowres_clock.hh>
+#include <seastar/util/noncopyable_function.hh>
+#include <boost/intrusive/list.hpp>
+#include <chrono>
+#include <vector>
+
+namespace seastar {
+
+namespace internal {
+
+// Sockets that busy-poll the NIC receive queue their packets arrive on.
+// Polling through any of them polls the whole queue, so the reactor only
+// polls one socket per queue, the queues being told apart by NAPI id.
+//
+// A socket is dropped from it by pollable_fd_state::forget(), when the
+// socket is closed.
+class busy_poll_sockets {
+public:
+    // Returns the NAPI id of the queue the socket's last packet came from,
+    // or 0 if it isn't known
+    using napi_id_func = noncopyable_function<unsigned (const pollable_fd_state&)>;
+private:
+    using fd_list = boost::intrusive::list<pollable_fd_state,
+        boost::intrusive::member_hook<pollable_fd_state, pollable_fd_state::busy_poll_hook_t, &pollable_fd_state::busy_poll_link>,
+        boost::intrusive::constant_time_size<false>>;
+
+    struct napi_queue {
+        unsigned napi_id;
+        fd_list fds;
+
+        explicit napi_queue(unsigned id) noexcept : napi_id(id) {}
+    };
+
+    static constexpr unsigned assign_batch = 64;
+    static constexpr std::chrono::milliseconds min_assign_period{1};
+    static constexpr std::chrono::milliseconds max_assign_period{1000};
+    static constexpr std::chrono::milliseconds recheck_period{100};
+    // Sockets tried per queue and poll until one has nothing queued
+    static constexpr unsigned max_peeks = 4;
+
+    napi_id_func _napi_id_of;
+    std::vector<napi_queue> _queues;
+    // The NAPI id is only known after the socket receives a packet. Some
+    // never get one (e.g. loopback), so they are checked less and less often
+    fd_list _unassigned;
+    lowres_clock::time_point _next_assign;
+    lowres_clock::duration _assign_period = min_assign_period;
+    lowres_clock::time_point _next_recheck;
+
+    void file(pollable_fd_state& fd, unsigned napi_id);
+    void assign();
+    void recheck();
+public:
+    // Asks the socket for SO_INCOMING_NAPI_ID
+    static unsigned socket_napi_id(const pollable_fd_state& fd) noexcept;
+
+    explicit busy_poll_sockets(napi_id_func napi_id_of = socket_napi_id);
+
+    void add(pollable_fd_state& fd);
+    void add(pollable_fd& fd) {
+        add(*fd._s);
+    }
+    bool poll(lowres_clock::time_point now);
+
+    // Sockets polled through the queue with the given NAPI id
+    size_t queued(unsigned napi_id) const;
+    // Sockets whose NAPI id isn't known yet
+    size_t unassigned() const;
+};
+
+}
+
+}
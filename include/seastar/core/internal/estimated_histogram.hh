@@ -281,6 +281,33 @@ class approximate_exponential_histogram {
         return Max; // overflowed value is in the requested quantile
     }
 
+    /*!
+     * \brief get an upper bound of a histogram quantile
+     *
+     * Unlike quantile(), which estimates the value with a bucket lower limit,
+     * this returns the upper limit of the bucket holding the value at the given
+     * quantile, so that at least that share of the values is known to be below
+     * it. This is what a controller keeping a quantile under a goal needs.
+     * Values past Max are reported as Max.
+     *
+     * It will return 0 if the histogram is empty.
+     */
+    uint64_t quantile_upper_bound(double quantile) const noexcept {
+        auto c = count();
+        if (!c) {
+            return 0;
+        }
+        auto rank = std::max<uint64_t>(std::ceil(c * std::clamp(quantile, 0.0, 1.0)), 1);
+        uint64_t elements = 0;
+        for (size_t i = 0; i < NUM_BUCKETS - 1; i++) {
+            elements += _buckets[i];
+            if (elements >= rank) {
+                return get_bucket_upper_limit(i);
+            }
+        }
+        return Max;
+    }
+
     /*!
      * \brief returns the mean histogram value (average of bucket offsets, weighted by count)
      * It will return 0 if the histogram is empty.
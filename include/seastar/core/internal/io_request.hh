@@ -46,6 +46,8 @@ class io_request {
     struct read_op {
         operation op;
         bool nowait_works;
+        // writes only: sync the file once the write completes
+        bool linked_fdatasync;
         int fd;
         uint64_t pos;
         char* addr;
@@ -54,6 +56,8 @@ class io_request {
     struct readv_op {
         operation op;
         bool nowait_works;
+        // writes only: sync the file once the write completes
+        bool linked_fdatasync;
         int fd;
         uint64_t pos;
         ::iovec* iovec;
@@ -199,11 +203,12 @@ class io_request {
         return req;
     }
 
-    static io_request make_write(int fd, uint64_t pos, const void* address, size_t size, bool nowait_works) {
+    static io_request make_write(int fd, uint64_t pos, const void* address, size_t size, bool nowait_works, bool linked_fdatasync = false) {
         io_request req;
         req._write = {
           .op = operation::write,
           .nowait_works = nowait_works,
+          .linked_fdatasync = linked_fdatasync,
           .fd = fd,
           .pos = pos,
           .addr = const_cast<char*>(reinterpret_cast<const char*>(address)),
@@ -212,11 +217,12 @@ class io_request {
         return req;
     }
 
-    static io_request make_writev(int fd, uint64_t pos, std::vector<iovec>& iov, bool nowait_works) {
+    static io_request make_writev(int fd, uint64_t pos, std::vector<iovec>& iov, bool nowait_works, bool linked_fdatasync = false) {
         io_request req;
         req._writev = {
           .op = operation::writev,
           .nowait_works = nowait_works,
+          .linked_fdatasync = linked_fdatasync,
           .fd = fd,
           .pos = pos,
           .iovec = iov.data(),
@@ -311,6 +317,20 @@ class io_request {
         }
     }
 
+    // A write that must be followed by an fdatasync() of its file before it
+    // is reported as complete. Backends that can't chain the two in the
+    // kernel never get such requests (see reactor_backend::can_link_fdatasync()).
+    bool linked_fdatasync() const {
+        switch (opcode()) {
+        case operation::write:
+            return _write.linked_fdatasync;
+        case operation::writev:
+            return _writev.linked_fdatasync;
+        default:
+            return false;
+        }
+    }
+
     sstring opname() const;
 
     // All operation variants are tagged unions with an operation as
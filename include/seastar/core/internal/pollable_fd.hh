@@ -27,6 +27,7 @@
 #include <seastar/util/modules.hh>
 #ifndef SEASTAR_MODULE
 #include <boost/intrusive_ptr.hpp>
+#include <boost/intrusive/list.hpp>
 #include <cstdint>
 #include <vector>
 #include <tuple>
@@ -45,6 +46,7 @@ SEASTAR_MODULE_EXPORT_END
 namespace internal {
 
 class buffer_allocator;
+class busy_poll_sockets;
 
 }
 
@@ -94,6 +96,8 @@ class pollable_fd_state {
     int events_requested = 0; // wanted by pollin/pollout promises
     int events_epoll = 0;     // installed in epoll
     int events_known = 0;     // returned from epoll
+    using busy_poll_hook_t = boost::intrusive::list_member_hook<boost::intrusive::link_mode<boost::intrusive::auto_unlink>>;
+    busy_poll_hook_t busy_poll_link; // see pollable_fd::enable_busy_poll()
 
     friend class reactor;
     friend class pollable_fd;
@@ -115,6 +119,8 @@ class pollable_fd_state {
     future<temporary_buffer<char>> recv_some(internal::buffer_allocator* ba);
     future<size_t> sendmsg(struct msghdr *msg);
     future<size_t> recvmsg(struct msghdr *msg);
+    future<size_t> sendmmsg(struct mmsghdr* msgs, unsigned vlen);
+    future<size_t> recvmmsg(struct mmsghdr* msgs, unsigned vlen);
     future<size_t> sendto(socket_address addr, const void* buf, size_t len);
     future<> poll_rdhup();
 
@@ -187,6 +193,14 @@ class pollable_fd {
     future<size_t> recvmsg(struct msghdr *msg) {
         return _s->recvmsg(msg);
     }
+    // Receives at least one and up to vlen messages, returns their number
+    future<size_t> recvmmsg(struct mmsghdr* msgs, unsigned vlen) {
+        return _s->recvmmsg(msgs, vlen);
+    }
+    // Sends up to vlen messages, returns the number of ones sent
+    future<size_t> sendmmsg(struct mmsghdr* msgs, unsigned vlen) {
+        return _s->sendmmsg(msgs, vlen);
+    }
     future<size_t> sendto(socket_address addr, const void* buf, size_t len) {
         return _s->sendto(addr, buf, len);
     }
@@ -200,6 +214,13 @@ class pollable_fd {
     future<> poll_rdhup() {
         return _s->poll_rdhup();
     }
+    /// Has the reactor busy-poll the NIC receive queue of the socket while it
+    /// polls for work, instead of waiting for the queue's interrupt.
+    ///
+    /// The socket must have SO_BUSY_POLL set, directly or inherited from the
+    /// listening socket it was accepted from. Sockets receiving from the same
+    /// queue (having the same NAPI id) are polled once for all of them.
+    void enable_busy_poll();
 protected:
     int get_fd() const { return _s->fd.get(); }
     void maybe_no_more_recv() { return _s->maybe_no_more_recv(); }
@@ -208,6 +229,7 @@ class pollable_fd {
     friend class readable_eventfd;
     friend class writeable_eventfd;
     friend class aio_storage_context;
+    friend class internal::busy_poll_sockets;
 private:
     pollable_fd_state_ptr _s;
 };
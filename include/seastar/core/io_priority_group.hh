@@ -0,0 +1,106 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*
+ * Copyright (C) 2025 ScyllaDB
+ */
+
+#pragma once
+
+#ifndef SEASTAR_MODULE
+#include <cstdint>
+#include <optional>
+#include <seastar/core/future.hh>
+#include <seastar/core/sstring.hh>
+#include <seastar/util/modules.hh>
+#endif
+
+namespace seastar {
+
+class scheduling_group;
+
+SEASTAR_MODULE_EXPORT_BEGIN
+
+/// \brief A node in the I/O scheduling hierarchy
+///
+/// Every \ref scheduling_group has its own I/O class, and by default all the
+/// classes compete for the disk at the same level, each getting capacity in
+/// proportion to its shares. An I/O priority group collects several classes
+/// (or other groups) under one node. The group competes with its siblings by
+/// its own shares, and the capacity it wins is divided between its members by
+/// theirs.
+///
+/// For example, a multi-tenant application can create a group per tenant and
+/// put each tenant's query, compaction and streaming scheduling groups into
+/// it. A tenant's background work then never eats into other tenants' share.
+class io_priority_group {
+    unsigned _id;
+
+    explicit io_priority_group(unsigned id) noexcept : _id(id) {}
+public:
+    unsigned id() const noexcept { return _id; }
+    bool operator==(const io_priority_group& o) const noexcept { return _id == o._id; }
+
+    /// Changes the number of shares the group competes with its siblings by.
+    ///
+    /// Unlike \ref scheduling_group::set_shares(), the change is applied on
+    /// all shards.
+    ///
+    /// \param shares number of shares allotted to the group. Use numbers
+    ///               in the 1-1000 range.
+    future<> set_shares(float shares) const noexcept;
+
+    /// \brief Limits the IO bandwidth of all the classes in the group altogether
+    ///
+    /// Like \ref scheduling_group::update_io_bandwidth(), the limit is not
+    /// shard-local, all shards together cannot consume more bytes-per-second.
+    /// Limits of the classes in the group apply as well.
+    ///
+    /// \param bandwidth the new bandwidth value in bytes/second
+    /// \return a future that is ready when the bandwidth update is applied
+    future<> update_io_bandwidth(uint64_t bandwidth) const noexcept;
+
+    friend future<io_priority_group> create_io_priority_group(sstring name, float shares, std::optional<io_priority_group> parent) noexcept;
+};
+
+/// Creates an I/O priority group on all shards.
+///
+/// \param name name of the group, used in the \c io_queue_group metrics
+/// \param shares number of shares the group competes with its siblings by.
+///               Use numbers in the 1-1000 range.
+/// \param parent the group to nest the new one into. If not set, the group
+///               competes at the top level, next to the classes that are not
+///               put into any group.
+/// \return a future with the new group
+future<io_priority_group> create_io_priority_group(sstring name, float shares, std::optional<io_priority_group> parent = std::nullopt) noexcept;
+
+/// Destroys an I/O priority group on all shards.
+///
+/// The group must be empty: scheduling groups and nested groups have to be
+/// moved out of it first. Otherwise the returned future fails.
+future<> destroy_io_priority_group(io_priority_group group) noexcept;
+
+/// Puts the I/O class of a scheduling group into an I/O priority group.
+///
+/// The class's requests are then scheduled against the other members of the
+/// group, and the group as a whole against its own siblings. Passing
+/// std::nullopt moves the class back to the top level.
+future<> set_io_priority_group(scheduling_group sg, std::optional<io_priority_group> group) noexcept;
+
+SEASTAR_MODULE_EXPORT_END
+
+}
@@ -25,6 +25,7 @@
 #include <boost/container/static_vector.hpp>
 #include <chrono>
 #include <memory>
+#include <optional>
 #include <vector>
 #include <sys/uio.h>
 #endif
@@ -52,8 +53,15 @@ const io_throttler& get_throttler(const io_queue& ioq, unsigned stream);
 SEASTAR_MODULE_EXPORT
 class io_intent;
 
+namespace metrics::internal {
+template <uint64_t Min, uint64_t Max, size_t Precision>
+class approximate_exponential_histogram;
+}
+
 namespace internal {
 class io_sink;
+// Request latencies in microseconds, 8us..67s, within 12.5%
+using io_latency_histogram = metrics::internal::approximate_exponential_histogram<8, 67108864, 8>;
 }
 
 using shard_id = unsigned;
@@ -80,10 +88,14 @@ class priority_class {
 class io_queue {
 public:
     class priority_class_data;
+    class priority_group_data;
     using clock_type = std::chrono::steady_clock;
 
 private:
     std::vector<std::unique_ptr<priority_class_data>> _priority_classes;
+    std::vector<std::unique_ptr<priority_group_data>> _priority_groups;
+    // Group each class is (to be) put into, indexed by class id
+    std::vector<std::optional<unsigned>> _class_groups;
     io_group_ptr _group;
     const unsigned _id;
     struct stream {
@@ -140,6 +152,8 @@ class io_queue {
     friend const io_throttler& internal::get_throttler(const io_queue& ioq, unsigned stream);
 
     priority_class_data& find_or_create_class(internal::priority_class pc);
+    std::optional<unsigned> class_group(internal::priority_class pc) const noexcept;
+    void unregister_group(unsigned id);
     future<size_t> queue_request(internal::priority_class pc, internal::io_direction_and_length dnl, internal::io_request req, io_intent* intent, iovec_keeper iovs) noexcept;
     future<size_t> queue_one_request(internal::priority_class pc, internal::io_direction_and_length dnl, internal::io_request req, io_intent* intent, iovec_keeper iovs) noexcept;
 
@@ -165,6 +179,26 @@ class io_queue {
     void update_flow_ratio() noexcept;
     void lower_stall_threshold() noexcept;
 
+    // Feedback for the group's rate controller, see io_group::rate_controller.
+    // Only maintained if config::adaptive_rate is set
+    std::unique_ptr<internal::io_latency_histogram> _completion_latencies;
+    uint64_t _throttled_polls = 0;
+    timer<lowres_clock> _rate_feedback_timer;
+
+    void account_latency(std::chrono::duration<double> lat) noexcept;
+    void report_rate_feedback() noexcept;
+
+    // Reads collected at the current poll to be merged, see config::merge_reads
+    static constexpr unsigned max_merged_reads = 16;
+    std::vector<queued_io_request*> _mergeable_reads;
+    struct {
+        uint64_t merged_reads = 0;
+        uint64_t ios = 0;
+        uint64_t saved_bytes = 0;
+    } _merge_stats;
+
+    void dispatch_merged_reads() noexcept;
+
     metrics::metric_groups _metric_groups;
 public:
 
@@ -196,6 +230,17 @@ class io_queue {
         double flow_ratio_backpressure_threshold = 1.1;
         std::chrono::milliseconds stall_threshold = std::chrono::milliseconds(100);
         std::chrono::microseconds tau = std::chrono::milliseconds(5);
+        // Scale the throttler rate at runtime so that the 99th percentile of
+        // the requests' execution latency stays within the latency goal
+        bool adaptive_rate = false;
+        double adaptive_rate_min_factor = 0.6;
+        double adaptive_rate_max_factor = 1.4;
+        std::chrono::milliseconds adaptive_rate_period = std::chrono::milliseconds(100);
+        unsigned adaptive_rate_window = 10;
+        uint64_t adaptive_rate_min_samples = 64;
+        // Submit reads of adjacent ranges of a file dispatched at
+        // the same poll as a single IO
+        bool merge_reads = false;
     };
 
     io_queue(io_group_ptr group, internal::io_sink& sink);
@@ -239,6 +284,15 @@ class io_queue {
     void throttle_priority_class(const priority_class_data& pc) noexcept;
     void unthrottle_priority_class(const priority_class_data& pc) noexcept;
 
+    // Groups of classes, see \ref io_priority_group
+    void create_priority_group(unsigned id, sstring name, uint32_t shares, std::optional<unsigned> parent);
+    void destroy_priority_group(unsigned id);
+    void update_shares_for_group(unsigned id, uint32_t new_shares);
+    future<> update_bandwidth_for_group(unsigned id, uint64_t new_bandwidth);
+    void set_class_group(internal::priority_class pc, std::optional<unsigned> group);
+    void throttle_priority_group(const priority_group_data& pg) noexcept;
+    void unthrottle_priority_group(const priority_group_data& pg) noexcept;
+
     struct request_limits {
         size_t max_read;
         size_t max_write;
@@ -393,6 +447,10 @@ class io_throttler {
     }
 
     const token_bucket_t& token_bucket() const noexcept { return _token_bucket; }
+
+    // The rate relative to the one configured from the disk model
+    double rate_factor() const noexcept { return double(_token_bucket.rate()) / fixed_point_factor; }
+    void set_rate_factor(double factor) noexcept { _token_bucket.update_rate(fixed_point_factor * factor); }
 };
 
 class io_group {
@@ -400,6 +458,7 @@ class io_group {
     explicit io_group(io_queue::config io_cfg, unsigned nr_queues);
     ~io_group();
     struct priority_class_data;
+    struct rate_controller;
 
     std::chrono::duration<double> io_latency_goal() const noexcept;
 
@@ -412,11 +471,18 @@ class io_group {
     size_t _max_request_length[2];
     boost::container::static_vector<io_throttler, 2> _fgs;
     std::vector<std::unique_ptr<priority_class_data>> _priority_classes;
+    // Bandwidth limits of class groups, indexed by group id
+    std::vector<std::unique_ptr<priority_class_data>> _priority_groups;
     util::spinlock _lock;
     const shard_id _allocated_on;
+    std::chrono::duration<double> _latency_goal;
+    std::unique_ptr<rate_controller> _rate_controller;
 
     static io_throttler::config configure_throttler(const io_queue::config& qcfg) noexcept;
     priority_class_data& find_or_create_class(internal::priority_class pc);
+    priority_class_data& find_or_create_group(unsigned id);
+    void release_group(unsigned id) noexcept;
+    void adjust_rate() noexcept;
 };
 
 inline const io_queue::config& io_queue::get_config() const noexcept {
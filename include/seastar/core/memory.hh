@@ -95,6 +95,8 @@ namespace seastar {
 /// recording the stacktrace of a sampled subset (or all) allocations. See:
 /// * \ref set_heap_profiling_sampling_rate()
 /// * \ref sampled_memory_profile()
+/// * \ref sampled_allocation_profile()
+/// * \ref pprof::add_heap_profile_routes(), serving the above in pprof format
 /// * \ref scoped_heap_profiling
 ///
 /// ### Abort on allocation failure
@@ -161,9 +163,13 @@ numa_layout merge(numa_layout one, numa_layout two);
 
 }
 
+// hugetlb_page_size: when non-zero (2MB or 1GB) and no hugetlbfs_path is given,
+// back the shard's memory with anonymous huge pages of that size (and 2MB
+// pages where 1GB ones do not fit), falling back to normal pages per region.
 internal::numa_layout configure(std::vector<resource::memory> m, bool mbind,
         bool transparent_hugepages,
-        std::optional<std::string> hugetlbfs_path = {});
+        std::optional<std::string> hugetlbfs_path = {},
+        size_t hugetlb_page_size = 0);
 
 void configure_minimal();
 
@@ -252,6 +258,53 @@ void set_reclaim_hook(
 
 /// \endcond
 
+/// \brief A size class of objects which the allocator may move.
+///
+/// Small objects of most size classes share spans (groups of pages), and a
+/// span can only be returned to the page allocator once all of its objects
+/// are freed, so a few long lived objects can pin many partially used spans.
+/// Objects allocated through a relocatable_class live in spans of their
+/// own, and \ref compact_relocatable() moves live objects out of sparsely
+/// used spans, calling the class' relocation function, so those spans can
+/// be freed.
+///
+/// A relocatable_class and its objects belong to the shard that created it.
+/// Objects must be freed on that shard, either with \ref free() or with
+/// plain ::free(), and they must all be freed before the class is destroyed.
+class relocatable_class {
+public:
+    /// Moves the object at \c from to \c to, a fresh allocation of the same
+    /// size, and updates all references to it. It must not throw, nor
+    /// allocate or free objects of this class. \c from is released when it
+    /// returns.
+    using relocate_fn = std::function<void (void* from, void* to)>;
+    struct impl;
+private:
+    impl* _impl;
+public:
+    /// \param object_size size of the objects, at most 16kB
+    /// \param relocate called to move an object during compaction
+    relocatable_class(size_t object_size, relocate_fn relocate);
+    ~relocatable_class();
+    relocatable_class(const relocatable_class&) = delete;
+    relocatable_class& operator=(const relocatable_class&) = delete;
+
+    /// Allocates an object; throws std::bad_alloc on failure.
+    void* allocate();
+    void free(void* obj) noexcept;
+    size_t object_size() const noexcept;
+};
+
+/// \brief Compacts the memory of this shard's relocatable classes.
+///
+/// Moves up to about \c max_relocations objects out of the most sparsely
+/// used spans of \ref relocatable_class objects, and frees the spans
+/// emptied this way. The reactor calls this periodically, see
+/// \ref reactor_options::memory_compaction_period_ms.
+///
+/// \return whether there is more work to do
+bool compact_relocatable(size_t max_relocations = 1000);
+
 SEASTAR_MODULE_EXPORT_BEGIN
 
 /// \brief Set the global state of the abort on allocation failure behavior.
@@ -297,16 +350,31 @@ class statistics {
     uint64_t _foreign_mallocs;
     uint64_t _foreign_frees;
     uint64_t _foreign_cross_frees;
+
+    uint64_t _cross_cpu_free_batches;
+    uint64_t _cross_cpu_batched_frees;
+
+    uint64_t _relocations;
+    uint64_t _compacted_memory;
+
+    size_t _hugetlb_2m_memory;
+    size_t _hugetlb_1g_memory;
 private:
     statistics(uint64_t mallocs, uint64_t frees, uint64_t cross_cpu_frees,
             uint64_t total_memory, uint64_t free_memory, uint64_t reclaims,
             uint64_t large_allocs, uint64_t failed_allocs,
-            uint64_t foreign_mallocs, uint64_t foreign_frees, uint64_t foreign_cross_frees)
+            uint64_t foreign_mallocs, uint64_t foreign_frees, uint64_t foreign_cross_frees,
+            uint64_t cross_cpu_free_batches, uint64_t cross_cpu_batched_frees,
+            uint64_t relocations, uint64_t compacted_memory,
+            size_t hugetlb_2m_memory, size_t hugetlb_1g_memory)
         : _mallocs(mallocs), _frees(frees), _cross_cpu_frees(cross_cpu_frees)
         , _total_memory(total_memory), _free_memory(free_memory), _reclaims(reclaims)
         , _large_allocs(large_allocs), _failed_allocs(failed_allocs)
         , _foreign_mallocs(foreign_mallocs), _foreign_frees(foreign_frees)
-        , _foreign_cross_frees(foreign_cross_frees) {}
+        , _foreign_cross_frees(foreign_cross_frees)
+        , _cross_cpu_free_batches(cross_cpu_free_batches), _cross_cpu_batched_frees(cross_cpu_batched_frees)
+        , _relocations(relocations), _compacted_memory(compacted_memory)
+        , _hugetlb_2m_memory(hugetlb_2m_memory), _hugetlb_1g_memory(hugetlb_1g_memory) {}
 public:
     /// Total number of memory allocations calls since the system was started.
     uint64_t mallocs() const { return _mallocs; }
@@ -336,6 +404,21 @@ class statistics {
     uint64_t foreign_frees() const { return _foreign_frees; }
     /// Number of foreign frees on reactor threads
     uint64_t foreign_cross_frees() const { return _foreign_cross_frees; }
+    /// Number of batches in which this lcore returned freed objects to
+    /// the lcores owning them
+    uint64_t cross_cpu_free_batches() const { return _cross_cpu_free_batches; }
+    /// Number of cross-lcore frees returned to their owner in batches
+    /// (a subset of \ref cross_cpu_frees())
+    uint64_t cross_cpu_batched_frees() const { return _cross_cpu_batched_frees; }
+    /// Number of objects moved by \ref compact_relocatable()
+    uint64_t relocations() const { return _relocations; }
+    /// Total memory (in bytes) returned to the page allocator by
+    /// \ref compact_relocatable()
+    uint64_t compacted_memory() const { return _compacted_memory; }
+    /// Total memory (in bytes) backed by explicit 2MB huge pages
+    size_t hugetlb_2m_memory() const { return _hugetlb_2m_memory; }
+    /// Total memory (in bytes) backed by explicit 1GB huge pages
+    size_t hugetlb_1g_memory() const { return _hugetlb_1g_memory; }
     friend statistics stats();
 };
 
@@ -420,6 +503,8 @@ class scoped_large_allocation_warning_disable {
 struct allocation_site {
     mutable size_t count = 0; /// number of live objects allocated at backtrace.
     mutable size_t size = 0; /// amount of bytes in live objects allocated at backtrace.
+    mutable size_t total_count = 0; /// number of objects ever allocated at backtrace, live or not.
+    mutable size_t total_size = 0; /// amount of bytes ever allocated at backtrace, live or not.
     simple_backtrace backtrace; /// call site for this allocation
 
     // All allocation sites are linked to each other. This can be used for easy
@@ -460,6 +545,15 @@ std::vector<allocation_site> sampled_memory_profile();
 /// @return number of \ref allocation_site copied to the vector
 size_t sampled_memory_profile(allocation_site* output, size_t size);
 
+/// @brief Like \ref sampled_memory_profile(), but also returns allocation
+/// sites none of whose sampled allocations are alive any more
+///
+/// Such sites are kept for their cumulative allocation_site::total_count and
+/// allocation_site::total_size, until room is needed for new sites.
+///
+/// @return a vector of \ref allocation_site
+std::vector<allocation_site> sampled_allocation_profile();
+
 /// @brief Enable sampled heap profiling by setting a sample rate
 ///
 /// @param sample_rate the sample rate to use. Disable heap profiling by setting
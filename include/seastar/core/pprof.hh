@@ -0,0 +1,73 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*
+ * Copyright (C) 2025 ScyllaDB
+ */
+
+#pragma once
+
+#ifndef SEASTAR_MODULE
+#include <seastar/http/httpd.hh>
+#include <seastar/core/sstring.hh>
+#include <seastar/util/modules.hh>
+#include <optional>
+#endif
+
+namespace seastar {
+
+namespace pprof {
+
+SEASTAR_MODULE_EXPORT_BEGIN
+
+/*!
+ * Holds configuration of the heap profile endpoint
+ */
+struct config {
+    sstring path = "/debug/pprof/heap"; //!< route serving the profile
+};
+
+/// \brief Builds a profile of the sampled heap, in the gzip-compressed
+/// protobuf format read by `pprof`.
+///
+/// The profile has alloc_objects, alloc_space, inuse_objects and inuse_space
+/// sample types (inuse_space shown by default), with one sample per
+/// allocation site and shard, labeled with the shard. Frames are recorded as
+/// addresses within the process' shared objects, to be symbolized by `pprof`
+/// against the binaries, like the backtraces seastar logs are by
+/// seastar-addr2line. Two profiles of the same process can be compared with
+/// `pprof -diff_base`.
+///
+/// Requires heap profiling to be enabled, see
+/// \ref memory::set_heap_profiling_sampling_rate(); the profile is otherwise
+/// empty.
+///
+/// \param shard if set, only profile this shard, otherwise all of them
+future<sstring> heap_profile(std::optional<unsigned> shard = std::nullopt);
+
+/// \defgroup add_heap_profile_routes adds an endpoint (/debug/pprof/heap by
+///    default) serving \ref heap_profile(). The optional `shard` query
+///    parameter restricts the profile to one shard.
+/// @{
+future<> add_heap_profile_routes(distributed<httpd::http_server>& server, config ctx = {});
+future<> add_heap_profile_routes(httpd::http_server& server, config ctx = {});
+/// @}
+
+SEASTAR_MODULE_EXPORT_END
+
+}
+}
@@ -33,6 +33,7 @@
 #include <seastar/core/internal/io_desc.hh>
 #include <seastar/core/internal/io_request.hh>
 #include <seastar/core/internal/io_sink.hh>
+#include <seastar/core/io_priority_group.hh>
 #include <seastar/core/iostream.hh>
 #include <seastar/core/lowres_clock.hh>
 #include <seastar/core/make_task.hh>
@@ -120,6 +121,7 @@ namespace internal {
 
 class reactor_stall_sampler;
 class cpu_stall_detector;
+class busy_poll_sockets;
 class buffer_allocator;
 class priority_class;
 class poller;
@@ -146,6 +148,8 @@ class io_completion : public kernel_completion {
 
     virtual void complete(size_t res) noexcept = 0;
     virtual void set_exception(std::exception_ptr eptr) noexcept = 0;
+    // Called when the request is taken from the io_sink to be submitted to the kernel
+    virtual void on_submit() noexcept {}
 };
 
 SEASTAR_MODULE_EXPORT
@@ -167,6 +171,7 @@ class reactor {
     class io_queue_submission_pollfn;
     class syscall_pollfn;
     class execution_stage_pollfn;
+    class busy_poll_pollfn;
     template <typename Func>
     friend void internal::at_destroy(Func&&);
     friend void internal::at_exit(noncopyable_function<future<> ()> func);
@@ -227,6 +232,7 @@ class reactor {
     std::unique_ptr<reactor_backend> _backend;
     sigset_t _active_sigmask; // holds sigmask while sleeping with sig disabled
     std::vector<pollfn*> _pollers;
+    std::unique_ptr<internal::busy_poll_sockets> _busy_poll_sockets;
 
     static constexpr unsigned max_aio_per_queue = 128;
     static constexpr unsigned max_queues = 8;
@@ -286,8 +292,19 @@ class reactor {
         void set_shares(float shares) noexcept;
         struct indirect_compare;
         sched_clock::duration _time_spent_on_task_quota_violations = {};
+        // Timing of every task_sample_period-th task, see reactor::run_tasks()
+        static constexpr unsigned task_sample_period = 64;
+        using task_time_histogram = seastar::metrics::internal::approximate_exponential_histogram<1, 1048576, 2>; // microseconds
+        task_time_histogram _task_runtime;
+        task_time_histogram _task_sched_delay;
+        unsigned _tasks_queued = 0;
+        task* _delay_sampled_task = nullptr;
+        sched_clock::time_point _delay_sample_ts;
         seastar::metrics::metric_groups _metrics;
         void rename(sstring new_name, sstring new_shortname);
+        void maybe_sample_delay(task* t) noexcept;
+        void on_sampled_task_run() noexcept;
+        bool sample_runtime() const noexcept { return _tasks_processed % task_sample_period == 0; }
     private:
         void register_stats();
     };
@@ -470,6 +487,11 @@ class reactor {
     future<> update_bandwidth_for_queues(internal::priority_class pc, uint64_t bandwidth);
     void rename_queues(internal::priority_class pc, sstring new_name);
     void update_shares_for_queues(internal::priority_class pc, uint32_t shares);
+    void create_io_priority_group(unsigned id, sstring name, uint32_t shares, std::optional<unsigned> parent);
+    void destroy_io_priority_group(unsigned id);
+    void update_shares_for_io_priority_group(unsigned id, uint32_t shares);
+    future<> update_bandwidth_for_io_priority_group(unsigned id, uint64_t bandwidth);
+    void set_io_priority_group(internal::priority_class pc, std::optional<unsigned> group);
 
 public:
     server_socket listen(socket_address sa, listen_options opts = {});
@@ -666,6 +688,7 @@ template <typename Func>
     friend class smp;
     friend class internal::poller;
     friend class scheduling_group;
+    friend class io_priority_group;
     friend void internal::add_to_flush_poller(output_stream<char>& os) noexcept;
     friend void seastar::internal::increase_thrown_exceptions_counter() noexcept;
     friend void seastar::internal::increase_internal_errors_counter() noexcept;
@@ -675,10 +698,14 @@ template <typename Func>
     friend future<> seastar::destroy_scheduling_group(scheduling_group) noexcept;
     friend future<> seastar::rename_scheduling_group(scheduling_group sg, sstring new_name, sstring new_shortname) noexcept;
     friend future<scheduling_group_key> scheduling_group_key_create(scheduling_group_key_config cfg) noexcept;
+    friend future<io_priority_group> create_io_priority_group(sstring name, float shares, std::optional<io_priority_group> parent) noexcept;
+    friend future<> destroy_io_priority_group(io_priority_group group) noexcept;
+    friend future<> set_io_priority_group(scheduling_group sg, std::optional<io_priority_group> group) noexcept;
     friend seastar::internal::log_buf::inserter_iterator do_dump_task_queue(seastar::internal::log_buf::inserter_iterator it, const task_queue& tq);
 
     future<struct statfs> fstatfs(int fd) noexcept;
     friend future<shared_ptr<file_impl>> make_file_impl(int fd, file_open_options options, int flags, struct stat st) noexcept;
+    void enable_busy_poll(pollable_fd_state& fd);
 public:
     future<> readable(pollable_fd_state& fd);
     future<> writeable(pollable_fd_state& fd);
@@ -25,6 +25,7 @@
 #include <seastar/util/memory_diagnostics.hh>
 #include <seastar/util/modules.hh>
 #include <seastar/core/scheduling.hh>
+#include <seastar/core/resource.hh>
 
 namespace seastar {
 
@@ -42,6 +43,22 @@ struct reactor_config {
     bool strict_o_direct = true;
     bool bypass_fsync = false;
     bool no_poll_aio = false;
+    unsigned uring_registered_buffers = 0;
+    size_t uring_registered_buffer_size = 128 << 10;
+    unsigned uring_fixed_files = 0;
+    bool uring_multishot_accept = false;
+    unsigned uring_provided_buffers = 0;
+    size_t uring_provided_buffer_size = 16 << 10;
+    size_t uring_zero_copy_send_threshold = 0;
+    bool uring_sqpoll = false;
+    unsigned uring_sqpoll_idle_ms = 10;
+    std::vector<unsigned> uring_sqpoll_cpus;
+    bool uring_single_issuer = false;
+    bool uring_coop_taskrun = false;
+    bool uring_defer_taskrun = false;
+    bool uring_linked_fdatasync = false;
+    std::chrono::milliseconds memory_compaction_period = std::chrono::seconds(1);
+    bool work_stealing = true;
 };
 /// \endcond
 
@@ -85,6 +102,22 @@ struct reactor_options : public program_options::option_group {
     ///
     /// Default: 1.1
     program_options::value<double> io_flow_ratio_threshold;
+    /// \brief Adjust the disk model at runtime.
+    ///
+    /// Watches the 99th percentile of IO requests execution latency and scales
+    /// the dispatch rate derived from io-properties within 0.6x..1.4x, so that
+    /// the latency stays within io_latency_goal_ms.
+    ///
+    /// Default: false
+    program_options::value<bool> io_adaptive_rate;
+    /// \brief Merge reads of adjacent file ranges.
+    ///
+    /// Reads of the same file dispatched to the disk at the same time are
+    /// submitted as a single IO if their ranges are adjacent. Helps disks
+    /// that are bound by IOPS rather than bandwidth.
+    ///
+    /// Default: false
+    program_options::value<bool> io_merge_reads;
     /// \brief If an IO request is executed longer than that, this is printed to
     /// logs with extra debugging
     ///
@@ -180,6 +213,123 @@ struct reactor_options : public program_options::option_group {
     ///
     /// \see max_networking_io_control_blocks
     program_options::value<unsigned> reserve_io_control_blocks;
+    /// \brief Number of DMA buffers to register with io_uring per shard.
+    ///
+    /// Reads and writes targeting these buffers are issued as
+    /// \p IORING_OP_READ_FIXED / \p IORING_OP_WRITE_FIXED, which saves
+    /// the kernel from pinning the pages on every request. Buffers returned
+    /// by \ref file::dma_read_bulk() are drawn from this pool while it has
+    /// free entries, and give their entry back when released; holding on to
+    /// them makes later reads use regular buffers, which are not registered.
+    /// Only valid for the \p io_uring reactor backend (see
+    /// \ref reactor_backend).
+    ///
+    /// Default: 0 (disabled).
+    program_options::value<unsigned> io_uring_registered_buffers;
+    /// \brief Size of each buffer registered with io_uring, in bytes.
+    ///
+    /// Rounded up to a multiple of 4096.
+    ///
+    /// Default: 131072.
+    program_options::value<unsigned> io_uring_registered_buffer_size;
+    /// \brief Number of file descriptor slots to register with io_uring
+    /// per shard.
+    ///
+    /// Files opened with \ref open_file_dma() occupy a slot while they are
+    /// open, and their disk I/O is submitted with \p IOSQE_FIXED_FILE. Only
+    /// valid for the \p io_uring reactor backend (see \ref reactor_backend).
+    ///
+    /// Default: 0 (disabled).
+    program_options::value<unsigned> io_uring_fixed_files;
+    /// \brief Use multishot accept on listening sockets.
+    ///
+    /// A listening socket keeps a single accept request armed in the ring
+    /// instead of submitting a new one per connection. Requires Linux 5.19
+    /// or later. Only valid for the \p io_uring reactor backend (see
+    /// \ref reactor_backend).
+    ///
+    /// Default: \p false.
+    program_options::value<bool> io_uring_multishot_accept;
+    /// \brief Number of buffers in the per-shard io_uring provided-buffer ring.
+    ///
+    /// When non-zero, sockets receive with a single multishot recv request
+    /// that picks its buffers from this ring, so idle connections don't hold
+    /// receive buffers and busy ones don't resubmit after every completion.
+    /// Rounded up to a power of two. Requires Linux 6.0 or later. Only valid
+    /// for the \p io_uring reactor backend (see \ref reactor_backend).
+    ///
+    /// Default: 0 (disabled).
+    program_options::value<unsigned> io_uring_provided_buffers;
+    /// \brief Size of each buffer in the provided-buffer ring, in bytes.
+    ///
+    /// Default: 16384.
+    program_options::value<unsigned> io_uring_provided_buffer_size;
+    /// \brief Send packets of at least this many bytes with zero-copy
+    /// \p IORING_OP_SENDMSG_ZC.
+    ///
+    /// The packet's memory is released only when the kernel reports it no
+    /// longer references it, which can be well after the send itself
+    /// completes. Sockets that don't support zero-copy sends (e.g. UNIX
+    /// domain ones) fall back to regular sends. The
+    /// \p reactor_io_uring_zero_copy_sends metric counts the outcomes.
+    /// Requires Linux 6.1 or later. Only valid for the
+    /// \p io_uring reactor backend (see \ref reactor_backend).
+    ///
+    /// Default: 0 (disabled).
+    program_options::value<unsigned> io_uring_zero_copy_send_threshold;
+    /// \brief Let a kernel thread poll the io_uring submission queue.
+    ///
+    /// While the thread is awake, submitting work needs no system call.
+    /// Only valid for the \p io_uring reactor backend (see
+    /// \ref reactor_backend).
+    ///
+    /// Default: \p false.
+    program_options::value<bool> io_uring_sqpoll;
+    /// \brief Idle time in milliseconds after which the submission queue
+    /// polling thread goes to sleep.
+    ///
+    /// Default: 10.
+    program_options::value<unsigned> io_uring_sqpoll_idle_ms;
+    /// \brief CPUs to pin the submission queue polling threads to.
+    ///
+    /// Shard N's thread is pinned to the N-th CPU of the set (wrapping
+    /// around), typically an SMT sibling of the shard's CPU.
+    ///
+    /// Default: not pinned.
+    program_options::value<resource::cpuset> io_uring_sqpoll_cpuset;
+    /// \brief Create the ring with \p IORING_SETUP_SINGLE_ISSUER.
+    ///
+    /// Requires Linux 6.0 or later.
+    ///
+    /// Default: \p false.
+    program_options::value<bool> io_uring_single_issuer;
+    /// \brief Create the ring with \p IORING_SETUP_COOP_TASKRUN.
+    ///
+    /// Completions no longer interrupt the reactor thread; they're run the
+    /// next time it enters the kernel. Requires Linux 5.19 or later.
+    /// Ignored with \ref io_uring_sqpoll.
+    ///
+    /// Default: \p false.
+    program_options::value<bool> io_uring_coop_taskrun;
+    /// \brief Create the ring with \p IORING_SETUP_DEFER_TASKRUN.
+    ///
+    /// Completion work is deferred until the reactor asks for it, which it
+    /// only does when the kernel flags pending work. Implies
+    /// \ref io_uring_single_issuer. Requires Linux 6.1 or later. Ignored
+    /// with \ref io_uring_sqpoll.
+    ///
+    /// Default: \p false.
+    program_options::value<bool> io_uring_defer_taskrun;
+    /// \brief Chain the flush of an append-challenged file to the write
+    /// queued just before it.
+    ///
+    /// The write and the \p fdatasync() are submitted together as linked
+    /// requests, saving a round-trip to the kernel per flushed append.
+    /// Only valid for the \p io_uring reactor backend (see
+    /// \ref reactor_backend).
+    ///
+    /// Default: \p false.
+    program_options::value<bool> io_uring_linked_fdatasync;
     /// \brief Enable seastar heap profiling.
     ///
     /// Allocations will be sampled every N bytes on average. Zero means off.
@@ -188,6 +338,17 @@ struct reactor_options : public program_options::option_group {
     ///
     /// \note Unused when seastar was compiled without heap profiling support.
     program_options::value<unsigned> heapprof;
+    /// \brief Period of the background compaction of relocatable memory, in ms.
+    ///
+    /// See \ref memory::relocatable_class. Zero means off.
+    ///
+    /// Default: 1000.
+    program_options::value<unsigned> memory_compaction_period_ms;
+    /// \brief Let idle shards run the jobs other shards submitted with
+    /// \ref submit_stealable().
+    ///
+    /// Default: \p true.
+    program_options::value<bool> work_stealing;
     /// Ignore SIGINT (for gdb).
     program_options::value<> no_handle_interrupt;
 
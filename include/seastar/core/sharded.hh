@@ -35,6 +35,7 @@
 #ifndef SEASTAR_MODULE
 #include <concepts>
 #include <functional>
+#include <memory>
 #include <ranges>
 #include <type_traits>
 #endif
@@ -330,6 +331,54 @@ class sharded {
         && std::is_same_v<futurize_t<std::invoke_result_t<Func, Service&, Args...>>, future<>>
     future<> invoke_on_others(Func func, Args... args) noexcept;
 
+    /// Invoke a callable on all instances of \c Service except the instance
+    /// which is allocated on current shard, NUMA node by node.
+    ///
+    /// Like \ref invoke_on_others(), but sends one message per NUMA node,
+    /// which the receiving shard forwards to the rest of its node; see
+    /// \ref smp::invoke_on_others_by_node(). Prefer it for broadcasts on
+    /// machines with several NUMA nodes, where messages across nodes are
+    /// considerably more expensive.
+    ///
+    /// \param options the options to forward to the \ref smp::submit_to()
+    ///         calls behind the scenes.
+    /// \param func a callable with the signature `void (Service&)`
+    ///             or `future<> (Service&)`, to be called on each core
+    ///             with the local instance as an argument.
+    /// \return a `future<>` that becomes ready when all cores but the current one have
+    ///         processed the message.
+    template <typename Func, typename... Args>
+    requires std::invocable<Func, Service&, Args...>
+        && std::is_same_v<futurize_t<std::invoke_result_t<Func, Service&, Args...>>, future<>>
+    future<> invoke_on_others_by_node(smp_submit_to_options options, Func func, Args... args) noexcept;
+
+    /// Invoke a callable on all instances of \c Service except the instance
+    /// which is allocated on current shard, NUMA node by node.
+    ///
+    /// Passes the default \ref smp_submit_to_options to the
+    /// \ref smp::submit_to() calls behind the scenes.
+    template <typename Func, typename... Args>
+    requires std::invocable<Func, Service&, Args...>
+        && std::is_same_v<futurize_t<std::invoke_result_t<Func, Service&, Args...>>, future<>>
+    future<> invoke_on_others_by_node(Func func, Args... args) noexcept;
+
+    /// Invoke a callable on all instances of `Service`, along a tree.
+    ///
+    /// Like \ref invoke_on_all(), but the current shard only sends the
+    /// message to its children in the tree described by \c tree_options,
+    /// which forward it to theirs; see \ref smp::invoke_on_all_tree().
+    ///
+    /// \param tree_options the shape of the tree
+    /// \param func a callable with the signature `void (Service&, Args...)`
+    ///             or `future<> (Service&, Args...)`, to be called on each
+    ///             core with the local instance as an argument. \c func and
+    ///             \c args are copied to each shard by its parent in the tree.
+    /// \return Future that becomes ready once all calls have completed
+    template <typename Func, typename... Args>
+    requires std::invocable<Func, Service&, Args...>
+        && std::is_same_v<futurize_t<std::invoke_result_t<Func, Service&, Args...>>, future<>>
+    future<> invoke_on_all_tree(smp_tree_options tree_options, Func func, Args... args) noexcept;
+
     /// Invoke a callable on a specific instance of `Service`.
     ///
     /// \param id shard id to call
@@ -478,6 +527,48 @@ class sharded {
                             std::move(reduce));
     }
 
+    /// Like \ref map_reduce0(Mapper map, Initial initial, Reduce reduce), but
+    /// fans out and in along a tree.
+    ///
+    /// The current shard only exchanges messages with its children in the
+    /// tree described by \c tree_options, each of which forwards \c map to
+    /// its own children and reduces their results with its own before
+    /// replying. With many shards, this spreads the sending and reducing
+    /// over the tree instead of serializing them on one shard.
+    ///
+    /// Because partial results are reduced on intermediate shards, \c reduce
+    /// must also accept two \c Initial values, be associative and
+    /// commutative, and have a value-initialized \c Initial as its identity
+    /// (like 0 for a sum). \c map and \c reduce are copied to each shard by
+    /// its parent in the tree.
+    ///
+    /// \param map callable with the signature `Value (Service&)` or
+    ///               `future<Value> (Service&)` (for some `Value` type).
+    /// \param initial initial value, reduced with the result of the whole tree
+    /// \param reduce binary function reducing an \c Initial with a `Value` or
+    ///               with another \c Initial into an \c Initial
+    /// \param tree_options the shape of the tree
+    template <typename Mapper, typename Initial, typename Reduce>
+    requires std::default_initializable<Initial>
+        && std::invocable<Reduce, Initial, Initial>
+    future<Initial>
+    map_reduce0_tree(Mapper map, Initial initial, Reduce reduce, smp_tree_options tree_options = {}) {
+      try {
+        auto tree = std::make_shared<const internal::smp_tree>(this_shard_id(), tree_options);
+        auto size = tree->size();
+        auto wrapped_map = [this, map] {
+            auto inst = get_local_service();
+            return std::invoke(map, *inst);
+        };
+        return internal::map_reduce_subtree<Initial>(std::move(tree), 0, size, smp_submit_to_options{}, std::move(wrapped_map), reduce).then(
+                [initial = std::move(initial), reduce] (Initial result) mutable {
+            return std::invoke(reduce, std::move(initial), std::move(result));
+        });
+      } catch (...) {
+        return current_exception_as_future<Initial>();
+      }
+    }
+
     /// Applies a map function to all shards, and return a vector of the result.
     ///
     /// \param mapper callable with the signature `Value (Service&)` or
@@ -830,6 +921,56 @@ sharded<Service>::invoke_on_others(Func func, Args... args) noexcept {
     }
 }
 
+template <typename Service>
+template <typename Func, typename... Args>
+requires std::invocable<Func, Service&, Args...>
+    && std::is_same_v<futurize_t<std::invoke_result_t<Func, Service&, Args...>>, future<>>
+future<>
+sharded<Service>::invoke_on_others_by_node(smp_submit_to_options options, Func func, Args... args) noexcept {
+  try {
+    using func_and_args = std::tuple<Func, std::tuple<Args...>>;
+    // Copied by the forwarding shards, hence the atomic reference count. The
+    // last reference is dropped here, once all shards are done.
+    auto shared = std::make_shared<const func_and_args>(std::move(func), std::tuple(std::move(args)...));
+    return smp::invoke_on_others_by_node(this_shard_id(), options, [this, shared] {
+        // Each shard works with its own copy, like with invoke_on_others()
+        return do_with(func_and_args(*shared), [this] (func_and_args& fa) {
+            return futurize_apply(std::get<0>(fa), std::tuple_cat(std::forward_as_tuple(*get_local_service()), std::get<1>(fa)));
+        });
+    }).finally([shared] {});
+  } catch (...) {
+    return current_exception_as_future();
+  }
+}
+
+template <typename Service>
+template <typename Func, typename... Args>
+requires std::invocable<Func, Service&, Args...>
+    && std::is_same_v<futurize_t<std::invoke_result_t<Func, Service&, Args...>>, future<>>
+future<>
+sharded<Service>::invoke_on_all_tree(smp_tree_options tree_options, Func func, Args... args) noexcept {
+  try {
+    return smp::invoke_on_all_tree(tree_options, smp_submit_to_options{}, [this, func = std::move(func), args = std::tuple(std::move(args)...)] () mutable {
+        return futurize_apply(func, std::tuple_cat(std::forward_as_tuple(*get_local_service()), args));
+    });
+  } catch (...) {
+    return current_exception_as_future();
+  }
+}
+
+template <typename Service>
+template <typename Func, typename... Args>
+requires std::invocable<Func, Service&, Args...>
+    && std::is_same_v<futurize_t<std::invoke_result_t<Func, Service&, Args...>>, future<>>
+future<>
+sharded<Service>::invoke_on_others_by_node(Func func, Args... args) noexcept {
+    try {
+        return invoke_on_others_by_node(smp_submit_to_options{}, std::move(func), std::move(args)...);
+    } catch (...) {
+        return current_exception_as_future();
+    }
+}
+
 template <typename Service>
 template <typename Func, typename... Args, typename Ret>
 requires std::invocable<Func, Service&, Args&&...>
@@ -24,6 +24,7 @@
 #include <seastar/core/future.hh>
 #include <seastar/core/loop.hh>
 #include <seastar/core/semaphore.hh>
+#include <seastar/core/circular_buffer.hh>
 #include <seastar/core/metrics_registration.hh>
 #include <seastar/core/posix.hh>
 #include <seastar/core/reactor_config.hh>
@@ -34,6 +35,7 @@
 #ifndef SEASTAR_MODULE
 #include <boost/lockfree/spsc_queue.hpp>
 #include <boost/thread/barrier.hpp>
+#include <chrono>
 #include <deque>
 #include <optional>
 #include <thread>
@@ -179,6 +181,23 @@ struct smp_submit_to_options {
     }
 };
 
+/// Shape of the tree along which a broadcast such as
+/// \ref smp::invoke_on_all_tree() fans out.
+///
+/// Each shard in the tree runs the function and forwards it to its children,
+/// so that no shard sends more than \c arity messages (plus one per remote
+/// NUMA node, for the root), and a broadcast to N shards takes about
+/// log(N)/log(arity) hops instead of one shard sending N - 1 messages.
+struct smp_tree_options {
+    /// Maximum number of children of each shard.
+    unsigned arity = 8;
+    /// Whether the root's children include exactly one shard of every other
+    /// NUMA node, whose subtree covers that node. Only one message per remote
+    /// node then crosses the interconnect, and the root's own node takes up
+    /// the rest of \c arity.
+    bool numa_aware = true;
+};
+
 void init_default_smp_service_group(shard_id cpu);
 
 smp_service_group_semaphore& get_smp_service_groups_semaphore(unsigned ssg_id, shard_id t) noexcept;
@@ -186,7 +205,15 @@ smp_service_group_semaphore& get_smp_service_groups_semaphore(unsigned ssg_id, s
 class smp_message_queue {
     static constexpr size_t queue_length = 128;
     static constexpr size_t batch_size = 16;
+    // Largest batch the adaptive mode will wait for, so that a full batch
+    // always fits the ring along with one in flight
+    static constexpr size_t max_batch_size = queue_length / 2;
     static constexpr size_t prefetch_cnt = 2;
+    // Sizes of the batches pushed to the ring, written by the sender
+    struct batch_size_histogram;
+    // Microseconds between a message being queued and the remote shard
+    // picking it up, written by the receiver
+    struct queue_time_histogram;
     struct work_item;
     struct lf_queue_remote {
         reactor* remote;
@@ -207,6 +234,15 @@ class smp_message_queue {
         size_t _last_snt_batch = 0;
         size_t _last_cmpl_batch = 0;
         size_t _current_queue_length = 0;
+        // Adaptive batching: messages submitted since the last poll, and their
+        // exponentially weighted average per poll (in 1/16ths)
+        size_t _arrivals = 0;
+        size_t _avg_arrivals = 0;
+        size_t _batch_target = batch_size;
+        bool _adaptive_batching = false;
+        // Null unless histograms are enabled, in which case messages are
+        // also stamped with the time they are queued at. Owned.
+        batch_size_histogram* _batch_sizes = nullptr;
     };
     // keep this between two structures with statistics
     // this makes sure that they have at least one cache line
@@ -216,10 +252,12 @@ class smp_message_queue {
     struct alignas(seastar::cache_line_size) {
         size_t _received = 0;
         size_t _last_rcv_batch = 0;
+        queue_time_histogram* _queue_times = nullptr; // owned
     };
     struct work_item : public task {
         explicit work_item(smp_service_group ssg) : task(current_scheduling_group()), ssg(ssg) {}
         smp_service_group ssg;
+        std::chrono::steady_clock::time_point queued_at;
         virtual ~work_item() {}
         virtual void fail_with(std::exception_ptr) = 0;
         void process();
@@ -272,12 +310,15 @@ class smp_message_queue {
         ~tx_side() {}
         void init() { new (&a) aa; }
         struct aa {
-            std::deque<work_item*> pending_fifo;
+            // Messages that haven't made a batch yet, or don't fit the
+            // ring. The ring keeps its fixed capacity; this side of it is
+            // unbounded, so a full ring never blocks submit_to().
+            circular_buffer<work_item*> pending_fifo;
         } a;
     } _tx;
     std::vector<work_item*> _completed_fifo;
 public:
-    smp_message_queue(reactor* from, reactor* to);
+    smp_message_queue(reactor* from, reactor* to, bool adaptive_batching = false, bool histograms = false);
     ~smp_message_queue();
     template <typename Func>
     futurize_t<std::invoke_result_t<Func>> submit(shard_id t, smp_submit_to_options options, Func&& func) noexcept {
@@ -298,6 +339,7 @@ class smp_message_queue {
     void submit_item(shard_id t, smp_timeout_clock::time_point timeout, std::unique_ptr<work_item> wi);
     void respond(work_item* wi);
     void move_pending();
+    void update_batch_target() noexcept;
     void flush_request_batch();
     void flush_response_batch();
     bool has_unflushed_responses() const;
@@ -311,6 +353,25 @@ class smp_message_queue;
 struct reactor_options;
 struct smp_options;
 
+namespace internal {
+
+// The shards of a broadcast tree, laid out so that every subtree covers a
+// contiguous range of them with its root first.
+class smp_tree {
+    std::vector<shard_id> _shards;
+    // Ends of the root's own node, then of each remote node (if NUMA aware)
+    std::vector<size_t> _node_ends;
+    unsigned _arity;
+public:
+    smp_tree(shard_id root, smp_tree_options opts);
+    size_t size() const noexcept { return _shards.size(); }
+    shard_id shard(size_t i) const noexcept { return _shards[i]; }
+    // The subtrees below the root of the subtree [b, e)
+    std::vector<std::pair<size_t, size_t>> children(size_t b, size_t e) const;
+};
+
+}
+
 class smp : public std::enable_shared_from_this<smp> {
     alien::instance& _alien;
     std::vector<posix_thread> _threads;
@@ -325,6 +386,13 @@ class smp : public std::enable_shared_from_this<smp> {
     static thread_local std::thread::id _tmain;
     bool _using_dpdk = false;
     std::vector<unsigned> _shard_to_numa_node_mapping;
+    // Empty unless the shards are pinned to their cpus
+    std::vector<unsigned> _shard_to_cpu_mapping;
+    // Shards of each NUMA node, indexed by node id
+    std::vector<std::vector<shard_id>> _node_shards;
+    // Row-major count x count matrix, see submit_to_cost()
+    std::vector<uint32_t> _submit_to_costs;
+    unsigned _latency_probes = 0;
 
 private:
     void setup_prefaulter(const seastar::resource::resources& res, seastar::memory::internal::numa_layout layout);
@@ -341,6 +409,31 @@ class smp : public std::enable_shared_from_this<smp> {
     /// \returns A integer span of size smp::count, with nth integer being the ID of nth shard's NUMA node.
     std::span<const unsigned> shard_to_numa_node_mapping() const noexcept;
 
+    /// \returns A integer span of size smp::count, with nth integer being the ID of the cpu
+    /// nth shard is pinned to, or an empty span if shards are not pinned.
+    std::span<const unsigned> shard_to_cpu_mapping() const noexcept;
+
+    /// \returns the relative cost of a \ref submit_to() from shard \c from to
+    /// shard \c to: the round-trip latency in nanoseconds measured at startup
+    /// (see \ref smp_options::smp_latency_probes), or, until then or if probing
+    /// is disabled, 1 within a NUMA node and 2 across nodes. The cost of a
+    /// shard to itself is 0.
+    static unsigned submit_to_cost(shard_id from, shard_id to) noexcept;
+    /// \returns the shard in \c shards that is the cheapest to reach from the
+    /// current shard (the current shard itself, if it is included). Ties go to
+    /// the earliest one. \c shards must not be empty.
+    static shard_id nearest_shard(std::span<const shard_id> shards) noexcept;
+    /// \returns the shards on the same NUMA node as shard \c id (including it),
+    /// in ascending order.
+    static std::span<const shard_id> shards_on_node_of(shard_id id) noexcept;
+    /// \returns for each NUMA node with shards, the one that is the cheapest to
+    /// reach from the current shard.
+    static std::vector<shard_id> nearest_shard_per_node();
+    /// \cond internal
+    // Measures submit_to_cost() between all shard pairs with a ping-pong
+    future<> probe_submit_to_latencies();
+    /// \endcond
+
     /// Runs a function on a remote core.
     ///
     /// \param t designates the core to run the function on (may be a remote
@@ -477,6 +570,67 @@ class smp : public std::enable_shared_from_this<smp> {
     static future<> invoke_on_others(Func func) noexcept {
         return invoke_on_others(this_shard_id(), std::move(func));
     }
+    /// Invokes func on all other shards, NUMA node by node.
+    ///
+    /// Like \ref invoke_on_others(), but instead of sending a message to
+    /// every shard, sends one to the nearest shard (see \ref nearest_shard())
+    /// of each NUMA node, which forwards it to the rest of its node. Only one
+    /// message per remote node crosses the interconnect. The copies of \c func
+    /// for a node's shards are made on the forwarding shard.
+    ///
+    /// \param cpu_id the cpu on which **not** to run the function.
+    /// \param options the options to forward to the \ref smp::submit_to()
+    ///         calls behind the scenes.
+    /// \param func the function to be invoked on each shard. May return void or
+    ///         future<>. Each async invocation will work with a separate copy
+    ///         of \c func.
+    /// \returns a future that resolves when all async invocations finish.
+    template<typename Func>
+    requires std::is_nothrow_move_constructible_v<Func> &&
+            std::is_nothrow_copy_constructible_v<Func>
+    static future<> invoke_on_others_by_node(unsigned cpu_id, smp_submit_to_options options, Func func) noexcept {
+        static_assert(std::is_same_v<future<>, typename futurize<std::invoke_result_t<Func>>::type>, "bad Func signature");
+      try {
+        return parallel_for_each(nearest_shard_per_node(), [cpu_id, options, func = std::move(func)] (unsigned node_leader) {
+            return smp::submit_to(node_leader, options, [cpu_id, options, func] {
+                return parallel_for_each(shards_on_node_of(this_shard_id()), [cpu_id, options, &func] (unsigned id) {
+                    return id != cpu_id ? smp::submit_to(id, options, Func(func)) : make_ready_future<>();
+                });
+            });
+        });
+      } catch (...) {
+        return current_exception_as_future();
+      }
+    }
+    /// Invokes func on all shards but the current one, NUMA node by node.
+    ///
+    /// See \ref invoke_on_others_by_node(unsigned, smp_submit_to_options, Func).
+    /// Passes the default \ref smp_submit_to_options to the
+    /// \ref smp::submit_to() calls behind the scenes.
+    template<typename Func>
+    requires std::is_nothrow_move_constructible_v<Func> &&
+            std::is_nothrow_copy_constructible_v<Func>
+    static future<> invoke_on_others_by_node(Func func) noexcept {
+        return invoke_on_others_by_node(this_shard_id(), smp_submit_to_options{}, std::move(func));
+    }
+    /// Invokes func on all shards, along a tree.
+    ///
+    /// Like \ref invoke_on_all(), but the current shard only sends the
+    /// function to its children in the tree described by \c tree_options,
+    /// which forward it to theirs. Use it for broadcasts on machines with
+    /// many shards, where sending all messages from one shard serializes on it.
+    ///
+    /// \param tree_options the shape of the tree
+    /// \param options the options to forward to the \ref smp::submit_to()
+    ///         calls behind the scenes.
+    /// \param func the function to be invoked on each shard. May return void or
+    ///         future<>. Each async invocation will work with a separate copy
+    ///         of \c func, made by the shard's parent in the tree.
+    /// \returns a future that resolves when all async invocations finish.
+    template<typename Func>
+    requires std::is_nothrow_move_constructible_v<Func> &&
+            std::is_copy_constructible_v<Func>
+    static future<> invoke_on_all_tree(smp_tree_options tree_options, smp_submit_to_options options, Func func) noexcept;
 private:
     void start_all_queues();
     void pin(unsigned cpu_id);
@@ -488,6 +642,68 @@ class smp : public std::enable_shared_from_this<smp> {
     static unsigned count;
 };
 
+namespace internal {
+
+// Runs func on the current shard, the root of the subtree [b, e) of tree,
+// and forwards it to the subtrees below.
+template <typename Func>
+future<> invoke_on_subtree(std::shared_ptr<const smp_tree> tree, size_t b, size_t e, smp_submit_to_options options, Func func) {
+    return do_with(std::move(tree), std::move(func), [b, e, options] (std::shared_ptr<const smp_tree>& tree, Func& func) {
+        auto subtrees = tree->children(b, e);
+        // The root itself goes last, not to hold up the forwarding
+        subtrees.emplace_back(b, b + 1);
+        return parallel_for_each(subtrees, [b, &tree, options, &func] (std::pair<size_t, size_t> st) {
+            if (st.first == b) {
+                return futurize_invoke(func);
+            }
+            return smp::submit_to(tree->shard(st.first), options, [tree, st, options, func] {
+                return invoke_on_subtree(tree, st.first, st.second, options, func);
+            });
+        });
+    });
+}
+
+// Like invoke_on_subtree(), reducing the results of the subtree's shards into
+// a value-initialized Initial.
+template <typename Initial, typename Mapper, typename Reduce>
+future<Initial> map_reduce_subtree(std::shared_ptr<const smp_tree> tree, size_t b, size_t e, smp_submit_to_options options, Mapper map, Reduce reduce) {
+    return do_with(std::move(tree), std::move(map), std::move(reduce), Initial{},
+            [b, e, options] (std::shared_ptr<const smp_tree>& tree, Mapper& map, Reduce& reduce, Initial& result) {
+        auto subtrees = tree->children(b, e);
+        subtrees.emplace_back(b, b + 1);
+        return parallel_for_each(subtrees, [b, &tree, options, &map, &reduce, &result] (std::pair<size_t, size_t> st) {
+            if (st.first == b) {
+                return futurize_invoke(map).then([&reduce, &result] (auto value) {
+                    result = std::invoke(reduce, std::move(result), std::move(value));
+                });
+            }
+            return smp::submit_to(tree->shard(st.first), options, [tree, st, options, map, reduce] {
+                return map_reduce_subtree<Initial>(tree, st.first, st.second, options, map, reduce);
+            }).then([&reduce, &result] (Initial value) {
+                result = std::invoke(reduce, std::move(result), std::move(value));
+            });
+        }).then([&result] {
+            return std::move(result);
+        });
+    });
+}
+
+}
+
+template<typename Func>
+requires std::is_nothrow_move_constructible_v<Func> &&
+        std::is_copy_constructible_v<Func>
+future<> smp::invoke_on_all_tree(smp_tree_options tree_options, smp_submit_to_options options, Func func) noexcept {
+    static_assert(std::is_same_v<future<>, typename futurize<std::invoke_result_t<Func>>::type>, "bad Func signature");
+  try {
+    auto tree = std::make_shared<const internal::smp_tree>(this_shard_id(), tree_options);
+    auto size = tree->size();
+    return internal::invoke_on_subtree(std::move(tree), 0, size, options, std::move(func));
+  } catch (...) {
+    return current_exception_as_future();
+  }
+}
+
 SEASTAR_MODULE_EXPORT_END
 
 }
@@ -56,6 +56,12 @@ struct smp_options : public program_options::option_group {
     program_options::value<std::string> reserve_memory;
     /// Path to accessible hugetlbfs mount (typically /dev/hugepages/something).
     program_options::value<std::string> hugepages;
+    /// \brief Back memory with anonymous huge pages of this size (2M or 1G).
+    ///
+    /// Each shard's memory is bound to its NUMA node; where 1G pages don't fit,
+    /// 2M pages are used, and regions the node's huge page pool cannot supply
+    /// fall back to normal pages. Ignored if \ref hugepages is set.
+    program_options::value<std::string> hugetlb_page_size;
     /// Lock all memory (prevents swapping).
     program_options::value<bool> lock_memory;
     /// Pin threads to their cpus (disable for overprovisioning).
@@ -76,6 +82,31 @@ struct smp_options : public program_options::option_group {
     ///
     /// Default: \p true.
     program_options::value<bool> mbind;
+    /// \brief Size cross-shard message batches adaptively.
+    ///
+    /// Each pair of shards sizes its batches after the number of messages
+    /// it sees between two polls, instead of the fixed batch of 16: sparse
+    /// messages are sent right away, and heavy traffic is sent in larger
+    /// batches.
+    ///
+    /// Default: \p false.
+    program_options::value<bool> smp_queue_adaptive_batching;
+    /// \brief Collect histograms of cross-shard message batch sizes and
+    /// queueing times.
+    ///
+    /// Measuring queueing times reads the clock twice per message, so they
+    /// are only collected when asked for.
+    ///
+    /// Default: \p false.
+    program_options::value<bool> smp_queue_histograms;
+    /// \brief Number of round trips with which the latency of
+    /// \ref smp::submit_to() is measured between each pair of shards at startup.
+    ///
+    /// The lowest round trip is kept, see \ref smp::submit_to_cost(). Set to 0
+    /// to skip the measurement and estimate costs from the NUMA topology.
+    ///
+    /// Default: 8.
+    program_options::value<unsigned> smp_latency_probes;
     /// Enable workaround for glibc/gcc c++ exception scalablity problem.
     ///
     /// Default: \p true.
@@ -92,6 +123,7 @@ struct smp_options : public program_options::option_group {
     /// * \ref smp_options::memory
     /// * \ref smp_options::reserve_memory
     /// * \ref smp_options::hugepages
+    /// * \ref smp_options::hugetlb_page_size
     /// * \ref smp_options::mbind
     /// * \ref reactor_options::heapprof
     /// * \ref reactor_options::abort_on_seastar_bad_alloc
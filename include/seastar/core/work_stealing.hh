@@ -0,0 +1,147 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*
+ * Copyright (C) 2025 ScyllaDB
+ */
+
+#pragma once
+
+#ifndef SEASTAR_MODULE
+#include <seastar/core/future.hh>
+#include <seastar/core/scheduling.hh>
+#include <seastar/core/shard_id.hh>
+#include <seastar/core/metrics_registration.hh>
+#include <seastar/util/modules.hh>
+#include <seastar/util/noncopyable_function.hh>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#endif
+
+/// \file
+
+namespace seastar {
+
+class reactor;
+
+namespace internal {
+
+// A CPU-bound job that any shard may run
+class stealable_job {
+    shard_id _origin = this_shard_id();
+    scheduling_group _sg = current_scheduling_group();
+public:
+    virtual ~stealable_job() = default;
+    // Runs the job on the current shard, which may not be its origin
+    virtual void run() noexcept = 0;
+    // Called on the origin shard after run(), delivers the result and
+    // destroys the job
+    virtual void complete() noexcept = 0;
+    shard_id origin() const noexcept { return _origin; }
+    // The submitter's group, which the job runs in wherever it runs
+    scheduling_group group() const noexcept { return _sg; }
+};
+
+template <typename Func>
+class stealable_job_impl final : public stealable_job {
+    using futurator = futurize<std::invoke_result_t<Func>>;
+    using future_type = typename futurator::type;
+    using value_type = typename future_type::value_type;
+    Func _func;
+    std::optional<value_type> _result;
+    std::exception_ptr _ex; // if !_result
+    typename futurator::promise_type _promise;
+public:
+    explicit stealable_job_impl(Func&& func) : _func(std::move(func)) {}
+    virtual void run() noexcept override {
+        try {
+            _result = futurator::invoke(_func).get();
+        } catch (...) {
+            _ex = std::current_exception();
+        }
+    }
+    virtual void complete() noexcept override {
+        if (_result) {
+            _promise.set_value(std::move(*_result));
+        } else {
+            _promise.set_exception(std::move(_ex));
+        }
+        delete this;
+    }
+    future_type get_future() noexcept { return _promise.get_future(); }
+};
+
+// Queues the job on the current shard, for it or an idle shard to run
+void submit_stealable(std::unique_ptr<stealable_job> job);
+
+// Sets up the shards' queues, before the reactors start
+void configure_work_stealing(unsigned nr_shards);
+// Called on each shard as its reactor starts, so that shards submitting a
+// backlog of jobs can wake it up if it sleeps
+void start_work_stealing(reactor& r);
+// Runs jobs queued on other shards until poll() reports work for the
+// current one; returns whether any job was run
+bool steal_stealable_jobs(const noncopyable_function<bool ()>& poll);
+void register_work_stealing_metrics(metrics::metric_groups& mg);
+// Number of jobs submitted on this shard which other shards ran
+uint64_t stolen_stealable_jobs() noexcept;
+
+}
+
+SEASTAR_MODULE_EXPORT_BEGIN
+
+/// Runs a CPU-bound function on the current shard, or on an idle one.
+///
+/// The function is queued on the current shard, where it runs in the
+/// current scheduling group when its turn comes, like any task would.
+/// Until then, shards with nothing to do may take it over ("steal" it) and
+/// run it in their place, in the same scheduling group, the result then
+/// being sent back to the current shard. Sleeping shards are woken up as a
+/// backlog of jobs builds up. This lets idle shards help a shard that got more than its share
+/// of work, e.g. with compression, checksumming or sorting.
+///
+/// As it may run on any shard, \c func must not touch shard-local state
+/// (sharded services, \ref lw_shared_ptr, anything bound to the submitting
+/// shard's reactor); it is called from whichever shard runs it, and destroyed
+/// on the current shard. It must run to completion without waiting on anything, so it returns a
+/// value rather than a future. Its result, or exception, is moved back to the
+/// current shard.
+///
+/// Stealing is done by the reactor of idle shards, unless disabled with
+/// \ref reactor_options::work_stealing.
+///
+/// \param func a synchronous function, taking no arguments
+/// \return a future for the result of \c func
+template <typename Func>
+requires (!is_future<std::invoke_result_t<Func>>::value)
+futurize_t<std::invoke_result_t<Func>> submit_stealable(Func func) noexcept {
+    using futurator = futurize<std::invoke_result_t<Func>>;
+    try {
+        auto job = std::make_unique<internal::stealable_job_impl<Func>>(std::move(func));
+        auto fut = job->get_future();
+        internal::submit_stealable(std::move(job));
+        return fut;
+    } catch (...) {
+        return futurator::make_exception_future(std::current_exception());
+    }
+}
+
+SEASTAR_MODULE_EXPORT_END
+
+}
@@ -113,6 +113,12 @@ class datagram final {
 
 using udp_datagram = datagram;
 
+/// A datagram to be sent with \ref datagram_channel::send_batch()
+struct outgoing_datagram {
+    socket_address dst;
+    packet data;
+};
+
 class datagram_channel {
 private:
     std::unique_ptr<datagram_channel_impl> _impl;
@@ -129,6 +135,27 @@ class datagram_channel {
     future<datagram> receive();
     future<> send(const socket_address& dst, const char* msg);
     future<> send(const socket_address& dst, packet p);
+    /// Receives one or more datagrams, at most \c max
+    ///
+    /// Waits until at least one datagram is available and returns all the
+    /// ones that can be read without waiting, up to \c max. Channels that
+    /// cannot batch return one datagram at a time.
+    future<std::vector<datagram>> receive_batch(size_t max);
+    /// Sends all the datagrams, possibly to different destinations
+    ///
+    /// Channels that support it pass several datagrams to the kernel at once.
+    /// The returned future resolves when all of them are sent.
+    future<> send_batch(std::vector<outgoing_datagram> batch);
+    /// Enables or disables UDP segmentation offload (GSO) and generic receive
+    /// offload (GRO) for the channel
+    ///
+    /// With the offload enabled, send_batch() coalesces equally sized
+    /// datagrams to the same destination into one kernel buffer, and the
+    /// kernel may hand several received datagrams to receive_batch() at once.
+    /// Received datagrams are still returned one by one.
+    ///
+    /// \return whether the offload is in effect
+    bool set_segmentation_offload(bool enable);
     bool is_closed() const;
     /// Causes a pending receive() to complete (possibly with an exception)
     void shutdown_input();
@@ -338,6 +365,13 @@ class server_socket {
         port,
         // This algorithm distributes all new connections to listen_options::fixed_cpu shard only.
         fixed,
+        // This algorithm has every shard listen on its own SO_REUSEPORT socket and lets the kernel
+        // pick the socket of the shard pinned to the cpu that processed the connection's packets
+        // (SO_INCOMING_CPU). With NIC queue interrupts steered to the shards' cpus, connections are
+        // accepted where their traffic is handled, without a hop to another shard. Connections
+        // processed on other cpus are hashed over the shards. Every shard must listen. Requires
+        // the shards to be pinned to their cpus, falls back to connection_distribution otherwise.
+        incoming_cpu,
         default_ = connection_distribution
     };
     /// Constructs a \c server_socket without being bound to any address
@@ -414,6 +448,15 @@ struct listen_options {
     /// setting it directly on the already-accepted socket is ineffective (see TCP(7)).
     std::optional<int> so_rcvbuf;
 
+    /// If set, the reactor busy-polls the NIC receive queues of the accepted
+    /// connections while it polls for work, instead of waiting for the queues'
+    /// interrupts. SO_BUSY_POLL is set to the given time and SO_PREFER_BUSY_POLL
+    /// is enabled on the listening socket, which needs CAP_NET_ADMIN. Combine with the
+    /// \c incoming_cpu load balancing algorithm, the NIC queue's
+    /// gro_flush_timeout and napi_defer_hard_irqs settings, and
+    /// \c --idle-poll-time-us to keep polling between requests.
+    std::optional<std::chrono::microseconds> busy_poll;
+
     void set_fixed_cpu(unsigned cpu) {
         lba = server_socket::load_balancing_algorithm::fixed;
         fixed_cpu = cpu;
@@ -76,6 +76,19 @@ struct native_stack_options : public program_options::option_group {
     ///
     /// Default: \p on.
     program_options::value<std::string> lro;
+    /// \brief TCP congestion control algorithm: \p reno, \p cubic, \p bbr
+    /// or \p bbr2.
+    ///
+    /// Connections can switch to another one with the \p TCP_CONGESTION
+    /// socket option.
+    ///
+    /// Default: \p reno.
+    program_options::value<std::string> tcp_congestion_control;
+    /// \brief Export congestion window, RTT and pacing rate metrics for
+    /// every TCP connection.
+    ///
+    /// Default: \p false.
+    program_options::value<bool> tcp_connection_metrics;
 
     /// Virtio configuration.
     virtio_options virtio_opts;
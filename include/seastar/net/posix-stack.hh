@@ -174,11 +174,12 @@ class posix_server_socket_impl : public server_socket_impl {
     conntrack _conntrack;
     server_socket::load_balancing_algorithm _lba;
     shard_id _fixed_cpu;
+    bool _busy_poll;
     std::pmr::polymorphic_allocator<char>* _allocator;
 public:
     explicit posix_server_socket_impl(int protocol, socket_address sa, pollable_fd lfd,
-        server_socket::load_balancing_algorithm lba, shard_id fixed_cpu,
-        std::pmr::polymorphic_allocator<char>* allocator=memory::malloc_allocator) : _sa(sa), _protocol(protocol), _lfd(std::move(lfd)), _lba(lba), _fixed_cpu(fixed_cpu), _allocator(allocator) {}
+        server_socket::load_balancing_algorithm lba, shard_id fixed_cpu, bool busy_poll,
+        std::pmr::polymorphic_allocator<char>* allocator=memory::malloc_allocator) : _sa(sa), _protocol(protocol), _lfd(std::move(lfd)), _lba(lba), _fixed_cpu(fixed_cpu), _busy_poll(busy_poll), _allocator(allocator) {}
     virtual future<accept_result> accept() override;
     virtual void abort_accept() override;
     virtual socket_address local_address() const override;
@@ -188,10 +189,11 @@ class posix_reuseport_server_socket_impl : public server_socket_impl {
     socket_address _sa;
     int _protocol;
     pollable_fd _lfd;
+    bool _busy_poll;
     std::pmr::polymorphic_allocator<char>* _allocator;
 public:
-    explicit posix_reuseport_server_socket_impl(int protocol, socket_address sa, pollable_fd lfd,
-        std::pmr::polymorphic_allocator<char>* allocator=memory::malloc_allocator) : _sa(sa), _protocol(protocol), _lfd(std::move(lfd)), _allocator(allocator) {}
+    explicit posix_reuseport_server_socket_impl(int protocol, socket_address sa, pollable_fd lfd, bool busy_poll,
+        std::pmr::polymorphic_allocator<char>* allocator=memory::malloc_allocator) : _sa(sa), _protocol(protocol), _lfd(std::move(lfd)), _busy_poll(busy_poll), _allocator(allocator) {}
     virtual future<accept_result> accept() override;
     virtual void abort_accept() override;
     virtual socket_address local_address() const override;
@@ -0,0 +1,173 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*
+ * Copyright (C) 2026 ScyllaDB
+ */
+
+#pragma once
+
+#ifndef SEASTAR_MODULE
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string_view>
+#endif
+
+namespace seastar {
+
+namespace net {
+
+/// Congestion window of a native TCP connection, in bytes.
+struct tcp_congestion_window {
+    uint32_t cwnd;
+    uint32_t ssthresh;
+    uint16_t mss;
+};
+
+/// What a single ACK told the sender.
+///
+/// The delivery rate part follows draft-cheng-iccrg-delivery-rate-estimation.
+struct tcp_rate_sample {
+    std::chrono::steady_clock::time_point now;
+    /// Bytes newly acknowledged by the ACK, cumulatively or by SACK
+    uint32_t acked = 0;
+    /// Number of segments the acknowledged bytes were sent in
+    uint32_t acked_segments = 0;
+    /// Bytes in flight once the ACK is processed
+    uint32_t in_flight = 0;
+    /// Bytes delivered and declared lost over the life of the connection
+    uint64_t total_delivered = 0;
+    uint64_t total_lost = 0;
+    /// Value of \c total_delivered when the most recently sent of the
+    /// acknowledged segments was sent
+    uint64_t prior_delivered = 0;
+    /// \c delivered bytes were delivered over \c interval. A zero interval
+    /// means the ACK carries no valid rate sample.
+    uint64_t delivered = 0;
+    std::chrono::microseconds interval{0};
+    /// Round trip time of the most recently sent of the acknowledged
+    /// segments, unset if it was retransmitted
+    std::optional<std::chrono::microseconds> rtt;
+    /// The sender ran out of data while the sample was taken, so the rate
+    /// says little about the path
+    bool app_limited = false;
+    /// Loss recovery is in progress
+    bool in_recovery = false;
+
+    /// Delivery rate in bytes per second, 0 if there is no valid sample
+    uint64_t delivery_rate() const noexcept {
+        return interval.count() > 0 ? delivered * 1000000 / interval.count() : 0;
+    }
+};
+
+/// \brief Delivery rate estimation of a native TCP connection
+///
+/// Follows draft-cheng-iccrg-delivery-rate-estimation. The connection takes a
+/// \ref snapshot whenever it (re)transmits a segment and hands it back when
+/// the segment is delivered. Once an ACK is processed, \ref sample() turns
+/// what the ACK delivered into a \ref tcp_rate_sample.
+class tcp_delivery_rate {
+public:
+    using clock_type = std::chrono::steady_clock;
+    /// Delivery state when a segment was sent
+    struct snapshot {
+        clock_type::time_point sent;
+        uint64_t delivered = 0;
+        clock_type::time_point delivered_time;
+        clock_type::time_point first_tx_time;
+        bool app_limited = false;
+    };
+private:
+    uint64_t _delivered = 0;
+    uint64_t _lost = 0;
+    clock_type::time_point _delivered_time;
+    clock_type::time_point _first_tx_time;
+    // Non-zero while the application does not keep the window full, until
+    // this many bytes are delivered
+    uint64_t _app_limited = 0;
+    std::optional<std::chrono::microseconds> _min_rtt;
+    // Sample of the ACK being processed
+    tcp_rate_sample _rs;
+    clock_type::duration _send_elapsed{0};
+    clock_type::duration _ack_elapsed{0};
+    bool _has_segment = false;
+public:
+    /// Called when a segment is sent, with the bytes in flight before it
+    snapshot on_send(clock_type::time_point now, uint32_t in_flight) noexcept;
+    /// Called when the sender runs out of data with room left in the window,
+    /// before the snapshot of the last segment sent is taken
+    void on_app_limited(uint32_t in_flight) noexcept {
+        _app_limited = std::max<uint64_t>(_delivered + in_flight, 1);
+    }
+    /// Called for every segment an ACK delivers, cumulatively or by SACK
+    void on_delivered(const snapshot& s, uint32_t bytes, bool retransmitted, clock_type::time_point now) noexcept;
+    void on_lost(uint32_t bytes) noexcept {
+        _lost += bytes;
+    }
+    /// Completes the sample of the ACK processed and starts the next one.
+    /// Returns false if the ACK delivered nothing. Fills all of \p rs but
+    /// \c in_flight and \c in_recovery.
+    bool sample(tcp_rate_sample& rs) noexcept;
+    uint64_t delivered() const noexcept {
+        return _delivered;
+    }
+    uint64_t lost() const noexcept {
+        return _lost;
+    }
+};
+
+/// \brief Congestion control algorithm of a native TCP connection
+///
+/// The connection owns the congestion window and runs loss detection and
+/// recovery. The algorithm decides how the window grows on ACKs and shrinks on
+/// losses, and may ask for the connection's data to be paced.
+///
+/// Built-in algorithms are created by name with
+/// \ref make_tcp_congestion_control().
+class tcp_congestion_control {
+public:
+    virtual ~tcp_congestion_control() = default;
+    virtual std::string_view name() const noexcept = 0;
+    /// Called when the connection is established or switches to this
+    /// algorithm, with the current window.
+    virtual void init(tcp_congestion_window& w) {}
+    /// Called once for every ACK that delivers data.
+    virtual void on_ack(tcp_congestion_window& w, const tcp_rate_sample& rs) = 0;
+    /// Called when a loss is detected, returns the new slow start threshold.
+    /// The connection then sets cwnd as its recovery procedure requires.
+    virtual uint32_t ssthresh(const tcp_congestion_window& w, uint32_t flight_size) = 0;
+    /// Called after the retransmission timer fired and cwnd was reset to one segment.
+    virtual void on_rto(tcp_congestion_window& w) {}
+    /// Called when loss recovery completes.
+    virtual void on_recovery_exit(tcp_congestion_window& w) {}
+    /// Rate to pace the connection's data at, in bytes per second. Zero
+    /// means the data is not paced.
+    virtual uint64_t pacing_rate() const noexcept { return 0; }
+};
+
+/// Creates a built-in congestion control algorithm.
+///
+/// \param name one of \c "reno", \c "cubic", \c "bbr" or \c "bbr2"
+/// \throws std::invalid_argument for an unknown name
+std::unique_ptr<tcp_congestion_control> make_tcp_congestion_control(std::string_view name);
+
+}
+
+}
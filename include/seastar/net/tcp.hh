@@ -23,6 +23,7 @@
 
 #ifndef SEASTAR_MODULE
 #include <unordered_map>
+#include <array>
 #include <map>
 #include <functional>
 #include <deque>
@@ -31,6 +32,8 @@
 #include <stdexcept>
 #include <system_error>
 #include <gnutls/crypto.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #endif
 #include <seastar/core/shared_ptr.hh>
 #include <seastar/core/queue.hh>
@@ -40,10 +43,13 @@
 #include <seastar/net/net.hh>
 #include <seastar/net/ip_checksum.hh>
 #include <seastar/net/ip.hh>
+#include <seastar/net/inet_address.hh>
 #include <seastar/net/const.hh>
 #include <seastar/net/packet-util.hh>
+#include <seastar/net/tcp-congestion.hh>
 #include <seastar/util/assert.hh>
 #include <seastar/util/std-compat.hh>
+#include <boost/intrusive/list.hpp>
 
 namespace seastar {
 
@@ -96,7 +102,7 @@ void tcp_debug(const char* fmt, Args&&... args) {
 
 struct tcp_option {
     // The kind and len field are fixed and defined in TCP protocol
-    enum class option_kind: uint8_t { mss = 2, win_scale = 3, sack = 4, timestamps = 8,  nop = 1, eol = 0 };
+    enum class option_kind: uint8_t { mss = 2, win_scale = 3, sack = 4, sack_blocks = 5, timestamps = 8,  nop = 1, eol = 0 };
     enum class option_len:  uint8_t { mss = 4, win_scale = 3, sack = 2, timestamps = 10, nop = 1, eol = 1 };
     static void write(char* p, option_kind kind, option_len len) {
         p[0] = static_cast<uint8_t>(kind);
@@ -142,6 +148,37 @@ struct tcp_option {
             tcp_option::write(p, kind, len);
         }
     };
+    struct sack_blocks {
+        static constexpr option_kind kind = option_kind::sack_blocks;
+        // We do not send timestamps, so four blocks fit into the option space
+        static constexpr uint8_t max_blocks = 4;
+        struct block {
+            uint32_t left;
+            uint32_t right;
+        };
+        std::array<block, max_blocks> blocks;
+        uint8_t nr = 0;
+        uint8_t len() const {
+            return 2 + 8 * nr;
+        }
+        static tcp_option::sack_blocks read(const char* p) {
+            tcp_option::sack_blocks x;
+            x.nr = std::min<uint8_t>((uint8_t(p[1]) - 2) / 8, max_blocks);
+            for (uint8_t i = 0; i < x.nr; i++) {
+                x.blocks[i].left = read_be<uint32_t>(p + 2 + 8 * i);
+                x.blocks[i].right = read_be<uint32_t>(p + 6 + 8 * i);
+            }
+            return x;
+        }
+        void write(char* p) const {
+            p[0] = static_cast<uint8_t>(kind);
+            p[1] = len();
+            for (uint8_t i = 0; i < nr; i++) {
+                write_be<uint32_t>(p + 2 + 8 * i, blocks[i].left);
+                write_be<uint32_t>(p + 6 + 8 * i, blocks[i].right);
+            }
+        }
+    };
     struct timestamps {
         static constexpr option_kind kind = option_kind::timestamps;
         static constexpr option_len len = option_len::timestamps;
@@ -176,6 +213,8 @@ struct tcp_option {
     static const uint8_t align = 4;
 
     void parse(uint8_t* beg, uint8_t* end);
+    // Only picks the SACK blocks, used on segments past the handshake
+    void parse_sack_blocks(uint8_t* beg, uint8_t* end);
     uint8_t fill(void* h, const tcp_hdr* th, uint8_t option_size);
     uint8_t get_size(bool syn_on, bool ack_on);
 
@@ -190,6 +229,10 @@ struct tcp_option {
     uint16_t _local_mss;
     uint8_t _remote_win_scale = 0;
     uint8_t _local_win_scale = 0;
+    // SACK blocks to report with the next segment we send
+    sack_blocks _local_sack_blocks;
+    // SACK blocks carried by the last segment received
+    sack_blocks _remote_sack_blocks;
 };
 inline char*& operator+=(char*& x, tcp_option::option_len len) { x += uint8_t(len); return x; }
 inline const char*& operator+=(const char*& x, tcp_option::option_len len) { x += uint8_t(len); return x; }
@@ -288,6 +331,11 @@ struct tcp_hdr {
 struct tcp_tag {};
 using tcp_packet_merger = packet_merger<tcp_seq, tcp_tag>;
 
+// Fills the SACK blocks reporting the out of order data we hold. RFC 2018: the
+// first block covers `latest`, the most recently received segment, the rest
+// repeat the other blocks in sequence order.
+void make_sack_blocks(tcp_option::sack_blocks& sb, const tcp_packet_merger& ooo, tcp_seq latest);
+
 template <typename InetTraits>
 class tcp {
 public:
@@ -302,6 +350,8 @@ class tcp {
 
     class tcb : public enable_lw_shared_from_this<tcb> {
         using clock_type = lowres_clock;
+        // Delivery rate samples and pacing need a finer clock
+        using rate_clock_type = steady_clock_type;
         static constexpr tcp_state CLOSED         = tcp_state::CLOSED;
         static constexpr tcp_state LISTEN         = tcp_state::LISTEN;
         static constexpr tcp_state SYN_SENT       = tcp_state::SYN_SENT;
@@ -322,11 +372,66 @@ class tcp {
         ipaddr _foreign_ip;
         uint16_t _local_port;
         uint16_t _foreign_port;
+        using rack_hook = boost::intrusive::list_member_hook<boost::intrusive::link_mode<boost::intrusive::auto_unlink>>;
         struct unacked_segment {
             packet p;
             uint16_t data_len;
             unsigned nr_transmits;
+            // Time of the most recent (re)transmission, for the RTO
             clock_type::time_point tx_time;
+            tcp_seq end_seq;
+            // SACK scoreboard, see RFC 6675
+            bool sacked = false;
+            bool lost = false;
+            bool retransmitted = false;
+            // Delivery state when the segment was (re)transmitted; its
+            // send time is what RACK goes by
+            tcp_delivery_rate::snapshot rate;
+            // Linked into rack::segments while RACK may still mark it lost
+            rack_hook rack_link;
+        };
+        using rack_list = boost::intrusive::list<unacked_segment,
+            boost::intrusive::member_hook<unacked_segment, rack_hook, &unacked_segment::rack_link>,
+            boost::intrusive::constant_time_size<false>>;
+        // Totals over the segments in flight, so that the window checks made
+        // on every ACK do not walk the retransmission queue
+        struct scoreboard {
+            uint32_t in_flight = 0;
+            uint32_t sacked = 0;
+            unsigned sacked_segments = 0;
+            // Of the segments not SACKed
+            uint32_t lost = 0;
+            uint32_t retransmitted = 0;
+            void add(const unacked_segment& seg) {
+                auto len = seg.p.len();
+                in_flight += len;
+                if (seg.sacked) {
+                    sacked += len;
+                    sacked_segments++;
+                    return;
+                }
+                lost += seg.lost ? len : 0;
+                retransmitted += seg.retransmitted ? len : 0;
+            }
+            void remove(const unacked_segment& seg) {
+                auto len = seg.p.len();
+                in_flight -= len;
+                if (seg.sacked) {
+                    sacked -= len;
+                    sacked_segments--;
+                    return;
+                }
+                lost -= seg.lost ? len : 0;
+                retransmitted -= seg.retransmitted ? len : 0;
+            }
+        };
+        // Loss recovery when SACK is negotiated
+        enum class loss_recovery : uint8_t {
+            none,
+            // Lost segments detected by RACK, cwnd stays at ssthresh
+            fast,
+            // Retransmission timeout, cwnd grows from one segment
+            rto,
         };
         struct send {
             tcp_seq unacknowledged;
@@ -339,6 +444,7 @@ class tcp {
             tcp_seq wl2;
             tcp_seq initial;
             std::deque<unacked_segment> data;
+            scoreboard sb;
             std::deque<packet> unsent;
             uint32_t unsent_len = 0;
             bool closed = false;
@@ -367,6 +473,7 @@ class tcp {
             uint32_t limited_transfer = 0;
             uint32_t partial_ack = 0;
             tcp_seq recover;
+            loss_recovery recovery = loss_recovery::none;
             bool window_probe = false;
             uint8_t zero_window_probing_out = 0;
         } _snd;
@@ -381,12 +488,47 @@ class tcp {
             // The total size of data stored in std::deque<packet> data
             size_t data_size = 0;
             tcp_packet_merger out_of_order;
+            // Start of the last out of order segment, reported first in SACK blocks
+            tcp_seq last_out_of_order;
             std::optional<promise<>> _data_received_promise;
             // The maximun memory buffer size allowed for receiving
             // Currently, it is the same as default receive window size when window scaling is enabled
             size_t max_receive_buf_size = 3737600;
         } _rcv;
         tcp_option _option;
+        // RACK-TLP state, see RFC 8985. Times are taken on rate_clock_type,
+        // the RTTs of a LAN are far below a lowres_clock tick.
+        struct rack {
+            // Most recently sent segment that has been delivered
+            rate_clock_type::time_point xmit_ts;
+            tcp_seq end_seq;
+            std::chrono::microseconds rtt{0};
+            std::chrono::microseconds min_rtt = std::chrono::microseconds::max();
+            // Smoothed RTT bounding the reordering window; _snd.srtt is
+            // measured on lowres_clock
+            std::chrono::microseconds srtt{0};
+            // Highest sequence delivered so far
+            tcp_seq fack;
+            bool reordering_seen = false;
+            unsigned reo_wnd_mult = 1;
+            unsigned reo_wnd_persist = 16;
+            // reo_wnd_mult grows at most once per round trip
+            std::optional<tcp_seq> dsack_round;
+            // Tail loss probe in flight
+            std::optional<tcp_seq> tlp_end_seq;
+            bool tlp_is_retrans = false;
+            // Segments neither SACKed nor waiting for retransmission, in the
+            // order of their most recent transmission
+            rack_list segments;
+        } _rack;
+        std::unique_ptr<tcp_congestion_control> _cc;
+        tcp_delivery_rate _delivery;
+        // Earliest time the next new segment may be sent when pacing
+        rate_clock_type::time_point _pacing_next;
+        // Segments this close to their time are sent without waiting
+        static constexpr std::chrono::microseconds _pacing_slack{200};
+        timer<> _pacing;
+        metrics::metric_groups _metrics;
         timer<lowres_clock> _delayed_ack;
         // Retransmission timeout
         std::chrono::milliseconds _rto{1000};
@@ -396,8 +538,15 @@ class tcp {
         // Clock granularity
         static constexpr std::chrono::milliseconds _rto_clk_granularity{1};
         static constexpr uint16_t _max_nr_retransmit{5};
+        // Maximum delayed ACK time of the peer, added to the loss probe
+        // timeout when a single segment is in flight
+        static constexpr std::chrono::milliseconds _tlp_max_ack_delay{200};
+        // Keeps loss probes from firing every lowres_clock tick on low RTT links
+        static constexpr std::chrono::milliseconds _tlp_min_pto{10};
         timer<lowres_clock> _retransmit;
         timer<lowres_clock> _persist;
+        timer<> _rack_reorder;
+        timer<lowres_clock> _tlp;
         uint16_t _nr_full_seg_received = 0;
         struct isn_secret {
             // 512 bits secretkey for ISN generating
@@ -430,7 +579,7 @@ class tcp {
         void input_handle_listen_state(tcp_hdr* th, packet p);
         void input_handle_syn_sent_state(tcp_hdr* th, packet p);
         void input_handle_other_state(tcp_hdr* th, packet p);
-        void output_one(bool data_retransmit = false);
+        void output_one(unacked_segment* rexmit = nullptr);
         future<> wait_for_data();
         future<> wait_input_shutdown();
         void abort_reader() noexcept;
@@ -481,8 +630,7 @@ class tcp {
         void clear_delayed_ack() noexcept;
         packet get_transmit_packet();
         void retransmit_one() {
-            bool data_retransmit = true;
-            output_one(data_retransmit);
+            output_one(&_snd.data.front());
         }
         void start_retransmit_timer() {
             auto now = clock_type::now();
@@ -510,8 +658,77 @@ class tcp {
         void retransmit();
         void fast_retransmit();
         void update_rto(clock_type::time_point tx_time);
-        void update_cwnd(uint32_t acked_bytes);
+        void update_cwnd();
+        void update_delivery(unacked_segment& seg, uint32_t bytes, rate_clock_type::time_point now) {
+            _delivery.on_delivered(seg.rate, bytes, seg.nr_transmits, now);
+        }
+        tcp_congestion_window congestion_window() const noexcept {
+            return {_snd.cwnd, _snd.ssthresh, _snd.mss};
+        }
+        void set_congestion_window(const tcp_congestion_window& w) noexcept {
+            _snd.cwnd = w.cwnd;
+            _snd.ssthresh = w.ssthresh;
+        }
+        // Slow start threshold after a loss
+        uint32_t loss_ssthresh(uint32_t flight) {
+            return _cc->ssthresh(congestion_window(), flight);
+        }
+        void congestion_rto() {
+            auto w = congestion_window();
+            _cc->on_rto(w);
+            set_congestion_window(w);
+        }
+        void congestion_recovery_exit() {
+            auto w = congestion_window();
+            _cc->on_recovery_exit(w);
+            set_congestion_window(w);
+        }
+        void set_congestion_control(std::string_view name);
+        bool pacing_blocked();
+        void pace(uint32_t len);
+        void register_metrics();
         void cleanup();
+        bool sack_enabled() const noexcept {
+            return _option._sack_received;
+        }
+        void update_local_sack_blocks();
+        bool update_scoreboard(tcp_seq seg_ack);
+        void sack_ack_received(tcp_seq seg_ack, bool dsack);
+        void enter_sack_recovery();
+        void rack_update(unacked_segment& seg, rate_clock_type::time_point now);
+        std::chrono::microseconds rack_reo_wnd();
+        bool rack_detect_loss();
+        static bool rack_sent_after(rate_clock_type::time_point t1, tcp_seq seq1, rate_clock_type::time_point t2, tcp_seq seq2) {
+            return t1 > t2 || (t1 == t2 && seq1 > seq2);
+        }
+        void arm_tlp();
+        void send_tlp();
+        // Changes the scoreboard state of a segment in _snd.data
+        template <typename Func>
+        void update_segment(unacked_segment& seg, Func&& func) {
+            _snd.sb.remove(seg);
+            func(seg);
+            _snd.sb.add(seg);
+            if (seg.sacked || (seg.lost && !seg.retransmitted)) {
+                seg.rack_link.unlink();
+            }
+        }
+        // Bytes in flight as RFC 6675 defines them
+        uint32_t pipe() {
+            return _snd.sb.in_flight - _snd.sb.sacked - _snd.sb.lost + _snd.sb.retransmitted;
+        }
+        // RFC 6675 NextSeg() rule 1, if cwnd has room for another segment
+        unacked_segment* next_lost_segment() {
+            if (_snd.recovery == loss_recovery::none || pipe() + _snd.mss > _snd.cwnd) {
+                return nullptr;
+            }
+            for (auto& seg : _snd.data) {
+                if (seg.lost && !seg.retransmitted && !seg.sacked) {
+                    return &seg;
+                }
+            }
+            return nullptr;
+        }
         uint32_t can_send() {
             if (_snd.window_probe) {
                 return 1;
@@ -532,8 +749,11 @@ class tcp {
             auto x = std::min(_snd.window - window_used, _snd.unsent_len);
 
             // Can not send more than congestion window allows
-            x = std::min(_snd.cwnd, x);
-            if (_snd.dupacks == 1 || _snd.dupacks == 2) {
+            if (_snd.recovery != loss_recovery::none) {
+                // RFC 6675: send while cwnd - pipe is at least one segment
+                auto in_flight = pipe();
+                x = in_flight + _snd.mss <= _snd.cwnd ? std::min(x, _snd.cwnd - in_flight) : 0;
+            } else if (_snd.dupacks == 1 || _snd.dupacks == 2) {
                 // RFC5681 Step 3.1
                 // Send cwnd + 2 * smss per RFC3042
                 auto flight = flight_size();
@@ -544,13 +764,19 @@ class tcp {
                 // RFC5681 Step 3.5
                 // Sent 1 full-sized segment at most
                 x = std::min(uint32_t(_snd.mss), x);
+            } else {
+                // Data in flight is bounded by cwnd
+                x = window_used < _snd.cwnd ? std::min(x, _snd.cwnd - window_used) : 0;
+            }
+
+            // A paced connection waits for its next transmission time
+            if (x && pacing_blocked()) {
+                return 0;
             }
             return x;
         }
         uint32_t flight_size() {
-            uint32_t size = 0;
-            std::for_each(_snd.data.begin(), _snd.data.end(), [&] (unacked_segment& seg) { size += seg.p.len(); });
-            return size;
+            return _snd.sb.in_flight;
         }
         uint16_t local_mss() {
             return _tcp.hw_features().mtu - net::tcp_hdr_len_min - InetTraits::ip_hdr_len_min;
@@ -591,6 +817,12 @@ class tcp {
         void do_established() {
             _state = ESTABLISHED;
             update_rto(_snd.syn_tx_time);
+            auto w = congestion_window();
+            _cc->init(w);
+            set_congestion_window(w);
+            if (_tcp._connection_metrics) {
+                register_metrics();
+            }
             _connect_done.set_value();
         }
         void do_reset() {
@@ -623,6 +855,8 @@ class tcp {
             _snd.unacknowledged = _snd.initial;
             _snd.next = _snd.initial + 1;
             _snd.recover = _snd.initial;
+            _rack.end_seq = _snd.initial;
+            _rack.fack = _snd.initial;
         }
         void do_local_fin_acked() {
             _snd.unacknowledged += 1;
@@ -665,6 +899,8 @@ class tcp {
     circular_buffer<ipv4_traits::l4packet> _packetq;
     semaphore _queue_space = {212992};
     metrics::metric_groups _metrics;
+    std::string _default_congestion_control = "reno";
+    bool _connection_metrics = false;
 public:
     const inet_type& inet() const {
         return _inet;
@@ -713,6 +949,33 @@ class tcp {
         uint16_t local_port() {
             return _tcb->_local_port;
         }
+        /// Switches the connection to another congestion control algorithm,
+        /// see \ref make_tcp_congestion_control() for the names.
+        void set_congestion_control(std::string_view name) {
+            _tcb->set_congestion_control(name);
+        }
+        std::string_view congestion_control() const {
+            return _tcb->_cc->name();
+        }
+        /// Only \c TCP_CONGESTION is supported, its value being the name
+        /// of the algorithm. Throws std::runtime_error for other options.
+        void set_sockopt(int level, int optname, const void* data, size_t len) {
+            if (level == IPPROTO_TCP && optname == TCP_CONGESTION) {
+                auto name = std::string_view(static_cast<const char*>(data), len);
+                set_congestion_control(name.substr(0, name.find('\0')));
+                return;
+            }
+            throw std::runtime_error("Setting custom socket options is not supported for native stack");
+        }
+        int get_sockopt(int level, int optname, void* data, size_t len) const {
+            if (level == IPPROTO_TCP && optname == TCP_CONGESTION) {
+                auto name = congestion_control();
+                auto n = std::min(len, name.size());
+                std::fill_n(std::copy_n(name.data(), n, static_cast<char*>(data)), len - n, '\0');
+                return 0;
+            }
+            throw std::runtime_error("Getting custom socket options is not supported for native stack");
+        }
         void shutdown_connect();
         void close_read() noexcept;
         void close_write() noexcept;
@@ -764,6 +1027,18 @@ class tcp {
     connection connect(socket_address sa);
     const net::hw_features& hw_features() const { return _inet._inet.hw_features(); }
     future<> poll_tcb(ipaddr to, lw_shared_ptr<tcb> tcb);
+    /// Sets the congestion control algorithm of connections created from
+    /// now on. Throws std::invalid_argument for an unknown name.
+    void set_default_congestion_control(std::string_view name) {
+        make_tcp_congestion_control(name);
+        _default_congestion_control = name;
+    }
+    /// Exports the congestion window, RTT and pacing rate of every
+    /// connection established from now on. Meant for debugging, as each
+    /// connection adds its own series.
+    void enable_connection_metrics(bool enable) noexcept {
+        _connection_metrics = enable;
+    }
     void add_connected_tcb(lw_shared_ptr<tcb> tcbp, uint16_t local_port) {
         auto it = _listening.find(local_port);
         if (it != _listening.end()) {
@@ -968,9 +1243,45 @@ tcp<InetTraits>::tcb::tcb(tcp& t, connid id)
     , _foreign_ip(id.foreign_ip)
     , _local_port(id.local_port)
     , _foreign_port(id.foreign_port)
+    , _cc(make_tcp_congestion_control(t._default_congestion_control))
+    , _pacing([this] { output(); })
     , _delayed_ack([this] { _nr_full_seg_received = 0; output(); })
     , _retransmit([this] { retransmit(); })
-    , _persist([this] { persist(); }) {
+    , _persist([this] { persist(); })
+    , _rack_reorder([this] {
+        if (rack_detect_loss()) {
+            enter_sack_recovery();
+            output();
+        }
+    })
+    , _tlp([this] { send_tlp(); }) {
+}
+
+template <typename InetTraits>
+void tcp<InetTraits>::tcb::set_congestion_control(std::string_view name) {
+    _cc = make_tcp_congestion_control(name);
+    if (!in_state(CLOSED | LISTEN | SYN_SENT | SYN_RECEIVED)) {
+        auto w = congestion_window();
+        _cc->init(w);
+        set_congestion_window(w);
+    }
+}
+
+template <typename InetTraits>
+void tcp<InetTraits>::tcb::register_metrics() {
+    namespace sm = metrics;
+
+    static auto connection_label = sm::label("connection");
+    auto connection = connection_label(fmt::format("{}->{}",
+            socket_address(_local_ip, _local_port), socket_address(_foreign_ip, _foreign_port)));
+    _metrics.add_group("tcp_connection", {
+        sm::make_gauge("cwnd", [this] { return _snd.cwnd; },
+                sm::description("Congestion window in bytes"), {connection}),
+        sm::make_gauge("srtt", [this] { return _snd.srtt.count(); },
+                sm::description("Smoothed round trip time in milliseconds"), {connection}),
+        sm::make_gauge("pacing_rate", [this] { return _cc->pacing_rate(); },
+                sm::description("Rate the congestion control paces data at in bytes per second, 0 when not paced"), {connection}),
+    });
 }
 
 template <typename InetTraits>
@@ -1025,6 +1336,7 @@ void tcp<InetTraits>::respond_with_reset(tcp_hdr* rth, ipaddr local_ip, ipaddr f
 template <typename InetTraits>
 uint32_t tcp<InetTraits>::tcb::data_segment_acked(tcp_seq seg_ack) {
     uint32_t total_acked_bytes = 0;
+    auto rate_now = rate_clock_type::now();
     // Full ACK of segment
     while (!_snd.data.empty()
             && (_snd.unacknowledged + _snd.data.front().p.len() <= seg_ack)) {
@@ -1034,10 +1346,17 @@ uint32_t tcp<InetTraits>::tcb::data_segment_acked(tcp_seq seg_ack) {
         if (_snd.data.front().nr_transmits == 0) {
             update_rto(_snd.data.front().tx_time);
         }
-        update_cwnd(acked_bytes);
+        // SACKed segments have been accounted for when they were SACKed
+        if (!_snd.data.front().sacked) {
+            if (sack_enabled()) {
+                rack_update(_snd.data.front(), rate_now);
+            }
+            update_delivery(_snd.data.front(), acked_bytes, rate_now);
+        }
         total_acked_bytes += acked_bytes;
         _snd.current_queue_space -= _snd.data.front().data_len;
         signal_send_available();
+        _snd.sb.remove(_snd.data.front());
         _snd.data.pop_front();
     }
     // Partial ACK of segment
@@ -1045,12 +1364,15 @@ uint32_t tcp<InetTraits>::tcb::data_segment_acked(tcp_seq seg_ack) {
         auto acked_bytes = seg_ack - _snd.unacknowledged;
         if (!_snd.data.empty()) {
             auto& unacked_seg = _snd.data.front();
-            unacked_seg.p.trim_front(acked_bytes);
+            update_segment(unacked_seg, [&] (unacked_segment& seg) { seg.p.trim_front(acked_bytes); });
+            if (!unacked_seg.sacked) {
+                update_delivery(unacked_seg, acked_bytes, rate_now);
+            }
         }
         _snd.unacknowledged = seg_ack;
-        update_cwnd(acked_bytes);
         total_acked_bytes += acked_bytes;
     }
+    update_cwnd();
     return total_acked_bytes;
 }
 
@@ -1213,9 +1535,20 @@ void tcp<InetTraits>::tcb::input_handle_syn_sent_state(tcp_hdr* th, packet p) {
 
 template <typename InetTraits>
 void tcp<InetTraits>::tcb::input_handle_other_state(tcp_hdr* th, packet p) {
+    if (sack_enabled()) {
+        auto opt_len = th->data_offset * 4 - tcp_hdr::len;
+        auto opt_start = reinterpret_cast<uint8_t*>(p.get_header(0, th->data_offset * 4));
+        if (opt_start) {
+            opt_start += tcp_hdr::len;
+            _option.parse_sack_blocks(opt_start, opt_start + opt_len);
+        } else {
+            _option._remote_sack_blocks.nr = 0;
+        }
+    }
     p.trim_front(th->data_offset * 4);
     bool do_output = false;
     bool do_output_data = false;
+    bool do_retransmit = false;
     tcp_seq seg_seq = th->seq;
     auto seg_ack = th->ack;
     auto seg_len = p.len();
@@ -1332,8 +1665,35 @@ void tcp<InetTraits>::tcb::input_handle_other_state(tcp_hdr* th, packet p) {
         if (in_state(ESTABLISHED | CLOSE_WAIT)){
             // When we are in zero window probing phase and packets_out = 0 we bypass "duplicated ack" check
             auto packets_out = _snd.next - _snd.unacknowledged - _snd.zero_window_probing_out;
-            // If SND.UNA < SEG.ACK =< SND.NXT then, set SND.UNA <- SEG.ACK.
-            if (_snd.unacknowledged < seg_ack && seg_ack <= _snd.next) {
+            if (sack_enabled() && _snd.unacknowledged <= seg_ack && seg_ack <= _snd.next) {
+                // With SACK, losses are detected by RACK-TLP (RFC 8985) rather
+                // than by counting duplicate ACKs, and repaired selectively
+                // using the RFC 6675 scoreboard.
+                bool acked = _snd.unacknowledged < seg_ack;
+                bool dsack = update_scoreboard(seg_ack);
+                if (acked) {
+                    data_segment_acked(seg_ack);
+                } else {
+                    // Only SACK blocks delivered data
+                    update_cwnd();
+                }
+                bool window_changed = uint32_t(th->window << _snd.window_scale) != _snd.window;
+                if ((acked || window_changed) &&
+                        (_snd.wl1 < seg_seq || (_snd.wl1 == seg_seq && _snd.wl2 <= seg_ack))) {
+                    update_window();
+                }
+                if (_snd.data.empty()) {
+                    stop_retransmit_timer();
+                    signal_all_data_acked();
+                } else if (acked) {
+                    start_retransmit_timer();
+                }
+                sack_ack_received(seg_ack, dsack);
+                // Lost segments are retransmitted even when there is no new data to send
+                do_retransmit = next_lost_segment() != nullptr;
+                do_output_data = true;
+            } else if (_snd.unacknowledged < seg_ack && seg_ack <= _snd.next) {
+                // If SND.UNA < SEG.ACK =< SND.NXT then, set SND.UNA <- SEG.ACK.
                 // Remote ACKed data we sent
                 auto acked_bytes = data_segment_acked(seg_ack);
 
@@ -1364,6 +1724,7 @@ void tcp<InetTraits>::tcb::input_handle_other_state(tcp_hdr* th, packet p) {
                         tcp_debug("ack: full_ack\n");
                         // Set cwnd to min (ssthresh, max(FlightSize, SMSS) + SMSS)
                         _snd.cwnd = std::min(_snd.ssthresh, std::max(flight_size(), smss) + smss);
+                        congestion_recovery_exit();
                         // Exit the fast recovery procedure
                         exit_fast_recovery();
                         set_retransmit_timer();
@@ -1421,7 +1782,8 @@ void tcp<InetTraits>::tcb::input_handle_other_state(tcp_hdr* th, packet p) {
                     if (seg_ack - 1 > _snd.recover) {
                         _snd.recover = _snd.next - 1;
                         // RFC5681 Step 3.2
-                        _snd.ssthresh = std::max((flight_size() - _snd.limited_transfer) / 2, 2 * smss);
+                        _snd.ssthresh = loss_ssthresh(flight_size() - _snd.limited_transfer);
+                        _delivery.on_lost(_snd.data.front().p.len());
                         fast_retransmit();
                     } else {
                         // Do not enter fast retransmit and do not reset ssthresh
@@ -1567,7 +1929,7 @@ void tcp<InetTraits>::tcb::input_handle_other_state(tcp_hdr* th, packet p) {
             }
         }
     }
-    if (do_output || (do_output_data && can_send())) {
+    if (do_output || do_retransmit || (do_output_data && can_send())) {
         // Since we will do output, we can canncel scheduled delayed ACK.
         clear_delayed_ack();
         output();
@@ -1588,6 +1950,10 @@ packet tcp<InetTraits>::tcb::get_transmit_packet() {
         len = _tcp.hw_features().max_packet_len - net::tcp_hdr_len_min - InetTraits::ip_hdr_len_min;
     } else {
         len = std::min(uint16_t(_tcp.hw_features().mtu - net::tcp_hdr_len_min - InetTraits::ip_hdr_len_min), _snd.mss);
+        // Leave room for the SACK blocks
+        if (_option._local_sack_blocks.nr) {
+            len -= 2 * uint8_t(tcp_option::option_len::nop) + _option._local_sack_blocks.len();
+        }
     }
     can_send = std::min(can_send, len);
     // easy case: one small packet
@@ -1624,12 +1990,26 @@ packet tcp<InetTraits>::tcb::get_transmit_packet() {
 }
 
 template <typename InetTraits>
-void tcp<InetTraits>::tcb::output_one(bool data_retransmit) {
+void tcp<InetTraits>::tcb::output_one(unacked_segment* rexmit) {
     if (in_state(CLOSED)) {
         return;
     }
 
-    packet p = data_retransmit ? _snd.data.front().p.share() : get_transmit_packet();
+    if (!rexmit && !_snd.window_probe) {
+        // RFC 6675 NextSeg(): lost segments go before new data
+        rexmit = next_lost_segment();
+        if (rexmit) {
+            rexmit->nr_transmits++;
+        }
+    }
+    _option._local_sack_blocks.nr = 0;
+    // Retransmissions keep their original size and have no room for SACK blocks
+    if (sack_enabled() && !rexmit) {
+        update_local_sack_blocks();
+    }
+
+    bool data_retransmit = rexmit != nullptr;
+    packet p = data_retransmit ? rexmit->p.share() : get_transmit_packet();
     packet clone = p.share();  // early clone to prevent share() from calling packet::unuse_internal_data() on header.
     uint16_t len = p.len();
     bool syn_on = syn_needs_on();
@@ -1652,7 +2032,7 @@ void tcp<InetTraits>::tcb::output_one(bool data_retransmit) {
 
     tcp_seq seq;
     if (data_retransmit) {
-        seq = _snd.unacknowledged;
+        seq = rexmit->end_seq - rexmit->p.len();
     } else {
         seq = syn_on ? _snd.initial : _snd.next;
         _snd.next += len;
@@ -1689,8 +2069,13 @@ void tcp<InetTraits>::tcb::output_one(bool data_retransmit) {
         // segment length set to 0. All the rest is the same as for a TCP Tx
         // CSUM offload case.
         //
-        if (_tcp.hw_features().tx_tso && len > _snd.mss) {
-            oi.tso_seg_size = _snd.mss;
+        // Every segment the NIC cuts out carries the SACK blocks as well
+        uint16_t seg_size = _snd.mss;
+        if (_option._local_sack_blocks.nr) {
+            seg_size -= 2 * uint8_t(tcp_option::option_len::nop) + _option._local_sack_blocks.len();
+        }
+        if (_tcp.hw_features().tx_tso && len > seg_size) {
+            oi.tso_seg_size = seg_size;
         } else {
             pseudo_hdr_seg_len = tcp_hdr::len + options_size + len;
         }
@@ -1715,16 +2100,38 @@ void tcp<InetTraits>::tcb::output_one(bool data_retransmit) {
 
     p.set_offload_info(oi);
 
-    if (!data_retransmit && (len || syn_on || fin_on)) {
+    if (data_retransmit) {
+        // RACK orders segments by their most recent transmission, which
+        // the new snapshot records
+        rexmit->tx_time = clock_type::now();
+        rexmit->rate = _delivery.on_send(rate_clock_type::now(), flight_size());
+        update_segment(*rexmit, [] (unacked_segment& seg) { seg.retransmitted = true; });
+        rexmit->rack_link.unlink();
+        _rack.segments.push_back(*rexmit);
+    } else if (len || syn_on || fin_on) {
         auto now = clock_type::now();
         if (len) {
+            auto in_flight = uint32_t(_snd.next - _snd.unacknowledged);
+            if (!_snd.unsent_len && in_flight < _snd.cwnd) {
+                // Out of data with room left in the window, this segment
+                // is the first one sent app-limited
+                _delivery.on_app_limited(in_flight);
+            }
+            auto rate = _delivery.on_send(rate_clock_type::now(), flight_size());
             unsigned nr_transmits = 0;
             _snd.data.emplace_back(unacked_segment{std::move(clone),
-                                   len, nr_transmits, now});
+                                   len, nr_transmits, now, seq + len});
+            _snd.data.back().rate = rate;
+            _snd.sb.add(_snd.data.back());
+            _rack.segments.push_back(_snd.data.back());
+            pace(len);
         }
         if (!_retransmit.armed()) {
             start_retransmit_timer(now);
         }
+        if (len) {
+            arm_tlp();
+        }
     }
 
 
@@ -1931,6 +2338,7 @@ bool tcp<InetTraits>::tcb::merge_out_of_order() {
 
 template <typename InetTraits>
 void tcp<InetTraits>::tcb::insert_out_of_order(tcp_seq seg, packet p) {
+    _rcv.last_out_of_order = seg;
     _rcv.out_of_order.merge(seg, std::move(p));
 }
 
@@ -1992,16 +2400,38 @@ void tcp<InetTraits>::tcb::retransmit() {
     // If there are unacked data, retransmit the earliest segment
     auto& unacked_seg = _snd.data.front();
 
+    if (sack_enabled()) {
+        // RFC 8985 6.3: after a timeout all the segments that have not been
+        // SACKed are considered lost, and the loss probe episode is over
+        for (auto& seg : _snd.data) {
+            if (!seg.sacked) {
+                if (!seg.lost || seg.retransmitted) {
+                    _delivery.on_lost(seg.p.len());
+                }
+                update_segment(seg, [] (unacked_segment& s) {
+                    s.lost = true;
+                    s.retransmitted = false;
+                });
+            }
+        }
+        _snd.recovery = loss_recovery::rto;
+        _rack.tlp_end_seq.reset();
+        _tlp.cancel();
+    } else {
+        _delivery.on_lost(unacked_seg.p.len());
+    }
+
     // According to RFC5681
     // Update ssthresh only for the first retransmit
     uint32_t smss = _snd.mss;
     if (unacked_seg.nr_transmits == 0) {
-        _snd.ssthresh = std::max(flight_size() / 2, 2 * smss);
+        _snd.ssthresh = loss_ssthresh(flight_size());
     }
     // RFC6582 Step 4
     _snd.recover = _snd.next - 1;
     // Start the slow start process
     _snd.cwnd = smss;
+    congestion_rto();
     // End fast recovery
     exit_fast_recovery();
 
@@ -2053,27 +2483,284 @@ void tcp<InetTraits>::tcb::update_rto(clock_type::time_point tx_time) {
     _rto = std::min(_rto, _rto_max);
 }
 
+// Hands the data delivered by the ACK being processed to the congestion control
 template <typename InetTraits>
-void tcp<InetTraits>::tcb::update_cwnd(uint32_t acked_bytes) {
-    uint32_t smss = _snd.mss;
-    if (_snd.cwnd < _snd.ssthresh) {
-        // In slow start phase
-        _snd.cwnd += std::min(acked_bytes, smss);
+void tcp<InetTraits>::tcb::update_cwnd() {
+    tcp_rate_sample rs;
+    if (!_delivery.sample(rs)) {
+        return;
+    }
+    rs.in_flight = _snd.recovery != loss_recovery::none ? pipe() : flight_size();
+    // RFC 6675 keeps cwnd at ssthresh until the recovery is over. NewReno
+    // fast recovery without SACK inflates and deflates cwnd itself on every
+    // partial ACK, after the algorithm has seen it, as it always did.
+    rs.in_recovery = _snd.recovery == loss_recovery::fast;
+    auto w = congestion_window();
+    _cc->on_ack(w, rs);
+    set_congestion_window(w);
+}
+
+template <typename InetTraits>
+bool tcp<InetTraits>::tcb::pacing_blocked() {
+    if (!_cc->pacing_rate()) {
+        return false;
+    }
+    if (_pacing_next <= rate_clock_type::now() + _pacing_slack) {
+        return false;
+    }
+    if (!_pacing.armed()) {
+        _pacing.arm(_pacing_next);
+    }
+    return true;
+}
+
+template <typename InetTraits>
+void tcp<InetTraits>::tcb::pace(uint32_t len) {
+    auto rate = _cc->pacing_rate();
+    if (!rate) {
+        return;
+    }
+    // An idle connection does not save up credit for a burst
+    auto start = std::max(_pacing_next, rate_clock_type::now());
+    _pacing_next = start + std::chrono::nanoseconds(uint64_t(len) * 1000000000 / rate);
+}
+
+template <typename InetTraits>
+void tcp<InetTraits>::tcb::update_local_sack_blocks() {
+    make_sack_blocks(_option._local_sack_blocks, _rcv.out_of_order, _rcv.last_out_of_order);
+}
+
+// Marks the segments covered by the received SACK blocks. Returns whether the
+// first block is a D-SACK (RFC 2883), reporting data received twice.
+template <typename InetTraits>
+bool tcp<InetTraits>::tcb::update_scoreboard(tcp_seq seg_ack) {
+    auto& sb = _option._remote_sack_blocks;
+    auto rate_now = rate_clock_type::now();
+    bool dsack = false;
+    for (uint8_t i = 0; i < sb.nr; i++) {
+        auto left = make_seq(sb.blocks[i].left);
+        auto right = make_seq(sb.blocks[i].right);
+        // RFC 2883: only the first block can be a D-SACK, the receiver
+        // reports the duplicate ahead of the regular blocks
+        if (i == 0 && (right <= seg_ack || (sb.nr > 1 &&
+                make_seq(sb.blocks[1].left) <= left && right <= make_seq(sb.blocks[1].right)))) {
+            dsack = true;
+            continue;
+        }
+        // Ignore blocks outside of the data in flight
+        if (right <= left || left < _snd.unacknowledged || right > _snd.next) {
+            continue;
+        }
+        // Only whole segments are marked, a TSO segment SACKed in part
+        // is retransmitted as a whole
+        auto it = std::lower_bound(_snd.data.begin(), _snd.data.end(), left, [] (const unacked_segment& seg, tcp_seq seq) {
+            return seg.end_seq <= seq;
+        });
+        for (; it != _snd.data.end() && it->end_seq <= right; ++it) {
+            if (!it->sacked && left <= it->end_seq - it->p.len()) {
+                update_segment(*it, [] (unacked_segment& seg) { seg.sacked = true; });
+                rack_update(*it, rate_now);
+                update_delivery(*it, it->p.len(), rate_now);
+            }
+        }
+    }
+    return dsack;
+}
+
+template <typename InetTraits>
+void tcp<InetTraits>::tcb::sack_ack_received(tcp_seq seg_ack, bool dsack) {
+    // RFC 8985 6.2 step 4: a D-SACK means a retransmission was spurious,
+    // make the reordering window wider
+    if (dsack && (!_rack.dsack_round || _snd.unacknowledged >= *_rack.dsack_round)) {
+        _rack.dsack_round = _snd.next;
+        _rack.reo_wnd_mult++;
+        _rack.reo_wnd_persist = 16;
+    }
+
+    // RFC 8985 7.4: the loss probe is acknowledged. Unless a D-SACK shows the
+    // original arrived too, the probe repaired a loss, so respond to it as
+    // fast recovery would.
+    if (_rack.tlp_end_seq && seg_ack >= *_rack.tlp_end_seq) {
+        if (_rack.tlp_is_retrans && !dsack) {
+            _snd.ssthresh = loss_ssthresh(flight_size());
+            _snd.cwnd = _snd.ssthresh;
+        }
+        _rack.tlp_end_seq.reset();
+    }
+
+    if (_snd.recovery != loss_recovery::none && seg_ack > _snd.recover) {
+        _snd.recovery = loss_recovery::none;
+        congestion_recovery_exit();
+        if (--_rack.reo_wnd_persist == 0) {
+            _rack.reo_wnd_mult = 1;
+            _rack.reo_wnd_persist = 16;
+        }
+    }
+
+    if (rack_detect_loss()) {
+        enter_sack_recovery();
+    }
+    arm_tlp();
+}
+
+template <typename InetTraits>
+void tcp<InetTraits>::tcb::enter_sack_recovery() {
+    if (_snd.recovery != loss_recovery::none) {
+        return;
+    }
+    tcp_debug("sack: enter fast recovery\n");
+    _snd.recovery = loss_recovery::fast;
+    // RFC 6675 Section 5: RecoveryPoint = HighData
+    _snd.recover = _snd.next - 1;
+    _snd.ssthresh = loss_ssthresh(flight_size());
+    _snd.cwnd = _snd.ssthresh;
+    // The probe is now part of the recovery
+    _rack.tlp_end_seq.reset();
+    _tlp.cancel();
+}
+
+template <typename InetTraits>
+void tcp<InetTraits>::tcb::rack_update(unacked_segment& seg, rate_clock_type::time_point now) {
+    // RFC 8985 6.2 steps 2 and 3
+    auto sent = seg.rate.sent;
+    auto rtt = std::chrono::duration_cast<std::chrono::microseconds>(now - sent);
+    if (seg.nr_transmits) {
+        // Without timestamps an RTT shorter than the minimum means the ACK
+        // is for an earlier transmission
+        if (rtt < _rack.min_rtt) {
+            return;
+        }
+    } else {
+        _rack.min_rtt = std::min(_rack.min_rtt, rtt);
+        // As RFC 6298 smooths it
+        _rack.srtt = _rack.srtt.count() ? (7 * _rack.srtt + rtt) / 8 : rtt;
+    }
+    if (rack_sent_after(sent, seg.end_seq, _rack.xmit_ts, _rack.end_seq)) {
+        _rack.rtt = rtt;
+        _rack.xmit_ts = sent;
+        _rack.end_seq = seg.end_seq;
+    }
+    if (seg.end_seq > _rack.fack) {
+        _rack.fack = seg.end_seq;
+    } else if (seg.end_seq < _rack.fack && !seg.nr_transmits) {
+        _rack.reordering_seen = true;
+    }
+}
+
+template <typename InetTraits>
+std::chrono::microseconds tcp<InetTraits>::tcb::rack_reo_wnd() {
+    // RFC 8985 6.2 step 4
+    if (!_rack.reordering_seen) {
+        if (_snd.recovery != loss_recovery::none) {
+            return std::chrono::microseconds(0);
+        }
+        // DupThresh
+        if (_snd.sb.sacked_segments >= 3) {
+            return std::chrono::microseconds(0);
+        }
+    }
+    auto min_rtt = std::min(_rack.min_rtt, _rack.srtt);
+    return std::min(min_rtt * _rack.reo_wnd_mult / 4, _rack.srtt);
+}
+
+// RFC 8985 6.2 step 5. Marks segments sent before the most recently delivered
+// one as lost once the reordering window has passed, and arms the reordering
+// timer for the others. Returns whether any segment was newly marked.
+template <typename InetTraits>
+bool tcp<InetTraits>::tcb::rack_detect_loss() {
+    auto now = rate_clock_type::now();
+    auto reo_wnd = rack_reo_wnd();
+    std::optional<rate_clock_type::duration> timeout;
+    bool lost = false;
+    for (auto it = _rack.segments.begin(); it != _rack.segments.end();) {
+        auto& seg = *it++;
+        // The rest were sent after the most recently delivered segment
+        if (seg.rate.sent > _rack.xmit_ts) {
+            break;
+        }
+        if (!rack_sent_after(_rack.xmit_ts, _rack.end_seq, seg.rate.sent, seg.end_seq)) {
+            continue;
+        }
+        auto remaining = seg.rate.sent + _rack.rtt + reo_wnd - now;
+        if (remaining <= rate_clock_type::duration(0)) {
+            tcp_debug("rack: segment ending at %d lost\n", seg.end_seq);
+            _delivery.on_lost(seg.p.len());
+            update_segment(seg, [] (unacked_segment& s) {
+                s.lost = true;
+                s.retransmitted = false;
+            });
+            lost = true;
+        } else {
+            timeout = std::max(remaining, timeout.value_or(remaining));
+        }
+    }
+    if (timeout) {
+        _rack_reorder.rearm(now + *timeout);
     } else {
-        // In congestion avoidance phase
-        uint32_t round_up = 1;
-        _snd.cwnd += std::max(round_up, smss * smss / _snd.cwnd);
+        _rack_reorder.cancel();
+    }
+    return lost;
+}
+
+template <typename InetTraits>
+void tcp<InetTraits>::tcb::arm_tlp() {
+    // RFC 8985 7.2
+    if (!sack_enabled() || _snd.recovery != loss_recovery::none || _rack.tlp_end_seq ||
+            _snd.data.empty() || _snd.window == 0) {
+        _tlp.cancel();
+        return;
+    }
+    std::chrono::milliseconds pto = 2 * _snd.srtt;
+    if (_snd.data.size() == 1) {
+        pto += _tlp_max_ack_delay;
     }
+    pto = std::max(pto, _tlp_min_pto);
+    auto tp = clock_type::now() + pto;
+    // The retransmission timer fires first, no point in probing
+    if (_retransmit.armed() && tp >= _retransmit.get_timeout()) {
+        _tlp.cancel();
+        return;
+    }
+    _tlp.rearm(tp);
+}
+
+template <typename InetTraits>
+void tcp<InetTraits>::tcb::send_tlp() {
+    if (in_state(CLOSED) || _snd.data.empty() || _snd.recovery != loss_recovery::none) {
+        return;
+    }
+    tcp_debug("tlp: probe timer fired\n");
+    // RFC 8985 7.3: probe with new data if the window allows, otherwise
+    // retransmit the last segment sent
+    if (_snd.unsent_len && can_send() > 0) {
+        _rack.tlp_is_retrans = false;
+        output_one();
+    } else {
+        auto& seg = _snd.data.back();
+        seg.nr_transmits++;
+        _rack.tlp_is_retrans = true;
+        output_one(&seg);
+    }
+    // No further probe until this one is acknowledged
+    _rack.tlp_end_seq = _snd.next;
+    _tlp.cancel();
+    output();
+    start_retransmit_timer();
 }
 
 template <typename InetTraits>
 void tcp<InetTraits>::tcb::cleanup() {
     _snd.unsent.clear();
     _snd.data.clear();
+    _snd.sb = {};
     _rcv.out_of_order.map.clear();
     _rcv.data_size = 0;
     _rcv.data.clear();
     stop_retransmit_timer();
+    _rack_reorder.cancel();
+    _tlp.cancel();
+    _pacing.cancel();
+    _metrics.clear();
     clear_delayed_ack();
     remove_from_tcbs();
 }
@@ -2118,11 +2805,12 @@ std::optional<typename InetTraits::l4packet> tcp<InetTraits>::tcb::get_packet()
 
     auto p = std::move(_packetq.front());
     _packetq.pop_front();
-    if (!_packetq.empty() || (_snd.dupacks < 3 && can_send() > 0 && (_snd.window > 0))) {
+    if (!_packetq.empty() || (_snd.dupacks < 3 && can_send() > 0 && (_snd.window > 0)) || next_lost_segment()) {
         // If there are packets to send in the queue or tcb is allowed to send
         // more add tcp back to polling set to keep sending. In addition, dupacks >= 3
         // is an indication that an segment is lost, stop sending more in this case.
-        // Finally - we can't send more until window is opened again.
+        // Finally - we can't send more until window is opened again. Lost
+        // segments found by SACK recovery are retransmitted regardless.
         output();
     }
     return p;
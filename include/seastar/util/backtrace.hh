@@ -117,6 +117,8 @@ class simple_backtrace {
 
     size_t hash() const noexcept { return _hash; }
     char delimeter() const noexcept { return _delimeter; }
+    // Innermost frame first
+    const vector_type& frames() const noexcept { return _frames; }
 
     friend fmt::formatter<simple_backtrace>;
 
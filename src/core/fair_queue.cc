@@ -23,10 +23,14 @@
 module;
 #endif
 
+#include <array>
+#include <bit>
 #include <chrono>
+#include <cstdlib>
 #include <functional>
 #include <utility>
 #include <boost/container/small_vector.hpp>
+#include <boost/intrusive/list.hpp>
 #include <boost/intrusive/parent_from_member.hpp>
 
 #ifdef SEASTAR_MODULE
@@ -97,33 +101,193 @@ fair_queue_ticket wrapping_difference(const fair_queue_ticket& a, const fair_que
             std::max<int32_t>(a._size - b._size, 0));
 }
 
-// Priority class, to be used with a given fair_queue
-class fair_queue::priority_class_data {
+// Common part of priority classes and groups, i.e. of whatever competes for
+// capacity inside a group
+class fair_queue::priority_entry : public bi::list_base_hook<> {
     friend class fair_queue;
+    friend class priority_group_data;
+protected:
     uint32_t _shares = 0;
     capacity_t _accumulated = 0;
-    capacity_t _pure_accumulated = 0;
-    fair_queue_entry::container_list_t _queue;
+    priority_group_data* _parent;
+    const bool _is_group;
     bool _queued = false;
     bool _plugged = true;
     uint32_t _activations = 0;
+    unsigned _bucket = 0;
 
 public:
-    explicit priority_class_data(uint32_t shares) noexcept : _shares(std::max(shares, 1u)) {}
-    priority_class_data(const priority_class_data&) = delete;
-    priority_class_data(priority_class_data&&) = delete;
+    priority_entry(uint32_t shares, priority_group_data* parent, bool is_group) noexcept
+        : _shares(std::max(shares, 1u))
+        , _parent(parent)
+        , _is_group(is_group)
+    {}
+    priority_entry(const priority_entry&) = delete;
+    priority_entry(priority_entry&&) = delete;
 
     void update_shares(uint32_t shares) noexcept {
         _shares = (std::max(shares, 1u));
     }
 };
 
-bool fair_queue::class_compare::operator() (const priority_class_ptr& lhs, const priority_class_ptr & rhs) const noexcept {
-    return lhs->_accumulated > rhs->_accumulated;
-}
+// Priority class, to be used with a given fair_queue
+class fair_queue::priority_class_data : public fair_queue::priority_entry {
+    friend class fair_queue;
+    capacity_t _pure_accumulated = 0;
+    fair_queue_entry::container_list_t _queue;
+
+public:
+    priority_class_data(uint32_t shares, priority_group_data* parent) noexcept
+        : priority_entry(shares, parent, false)
+    {}
+};
+
+// Group of priority classes and other groups. The root one has no parent.
+//
+// Members with pending requests are kept in a calendar. Bucket i holds the
+// members whose accumulated cost falls into slot
+// _calendar_base + ((i - _calendar_base) % calendar_buckets). Members further
+// ahead than the calendar covers are parked in its last bucket and re-filed
+// once it is reached.
+class fair_queue::priority_group_data : public fair_queue::priority_entry {
+    friend class fair_queue;
+    static constexpr unsigned calendar_buckets = 256;
+    using entry_list = bi::list<priority_entry, bi::constant_time_size<false>>;
+
+    std::array<entry_list, calendar_buckets> _calendar;
+    std::array<uint64_t, calendar_buckets / 64> _calendar_nonempty = {};
+    capacity_t _calendar_base = 0;
+    // The member being dispatched from; it is out of the calendar until it
+    // uses up its quantum.
+    priority_entry* _current = nullptr;
+    capacity_t _last_accumulated = 0;
+    unsigned _nr_members = 0;
+
+public:
+    priority_group_data(uint32_t shares, priority_group_data* parent) noexcept
+        : priority_entry(shares, parent, true)
+    {}
+
+    bool calendar_empty() const noexcept {
+        for (auto word : _calendar_nonempty) {
+            if (word) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool idle() const noexcept {
+        return _current == nullptr && calendar_empty();
+    }
+
+    void insert(priority_entry& e, capacity_t slot) noexcept {
+        unsigned idx;
+        if (slot < _calendar_base) {
+            // It lags behind everybody else, let it go first
+            idx = _calendar_base % calendar_buckets;
+            _calendar[idx].push_front(e);
+        } else {
+            slot = std::min<capacity_t>(slot, _calendar_base + calendar_buckets - 1);
+            idx = slot % calendar_buckets;
+            _calendar[idx].push_back(e);
+        }
+        e._bucket = idx;
+        _calendar_nonempty[idx / 64] |= uint64_t(1) << (idx % 64);
+    }
+
+    void erase(priority_entry& e) noexcept {
+        auto& bucket = _calendar[e._bucket];
+        bucket.erase(bucket.iterator_to(e));
+        if (bucket.empty()) {
+            _calendar_nonempty[e._bucket / 64] &= ~(uint64_t(1) << (e._bucket % 64));
+        }
+    }
+
+    priority_entry* pop() noexcept {
+        constexpr unsigned words = calendar_buckets / 64;
+        unsigned start = _calendar_base % calendar_buckets;
+
+        // Look at the buckets at and after the base one in its word first, then
+        // at the following words, wrapping around to the base word's lower part.
+        unsigned idx = calendar_buckets;
+        uint64_t word = _calendar_nonempty[start / 64] & (~uint64_t(0) << (start % 64));
+        if (word) {
+            idx = (start / 64) * 64 + std::countr_zero(word);
+        } else {
+            for (unsigned i = 1; i <= words; i++) {
+                unsigned w = (start / 64 + i) % words;
+                if (_calendar_nonempty[w]) {
+                    idx = w * 64 + std::countr_zero(_calendar_nonempty[w]);
+                    break;
+                }
+            }
+        }
+
+        if (idx == calendar_buckets) {
+            return nullptr;
+        }
+
+        _calendar_base += (idx + calendar_buckets - start) % calendar_buckets;
+        auto& e = _calendar[idx].front();
+        _calendar[idx].pop_front();
+        if (_calendar[idx].empty()) {
+            _calendar_nonempty[idx / 64] &= ~(uint64_t(1) << (idx % 64));
+        }
+        return &e;
+    }
+
+    // Re-files a member that pop() found parked at the end of the calendar.
+    // Whatever else is left in that bucket was parked along with it and is
+    // re-filed too. If nothing else is queued, the base moves straight to the
+    // earliest of them instead of one calendar length at a time.
+    void unpark(priority_entry& e, unsigned shift) noexcept {
+        unsigned idx = _calendar_base % calendar_buckets;
+        entry_list parked;
+        parked.splice(parked.end(), _calendar[idx]);
+        _calendar_nonempty[idx / 64] &= ~(uint64_t(1) << (idx % 64));
+        parked.push_front(e);
+
+        if (calendar_empty()) {
+            _calendar_base = std::numeric_limits<capacity_t>::max();
+            for (auto& m : parked) {
+                _calendar_base = std::min(_calendar_base, m._accumulated >> shift);
+            }
+        }
+        while (!parked.empty()) {
+            auto& m = parked.front();
+            parked.pop_front();
+            insert(m, m._accumulated >> shift);
+        }
+    }
+
+    void rebuild(unsigned shift) noexcept {
+        entry_list all;
+        for (unsigned idx = 0; idx < calendar_buckets; idx++) {
+            all.splice(all.end(), _calendar[idx]);
+        }
+        _calendar_nonempty = {};
+
+        if (all.empty()) {
+            return;
+        }
+
+        _calendar_base = std::numeric_limits<capacity_t>::max();
+        for (auto& e : all) {
+            _calendar_base = std::min(_calendar_base, e._accumulated >> shift);
+        }
+        while (!all.empty()) {
+            auto& e = all.front();
+            all.pop_front();
+            insert(e, e._accumulated >> shift);
+        }
+    }
+};
 
 fair_queue::fair_queue(config cfg)
     : _config(std::move(cfg))
+    , _quantum_shift(_config.dispatch_quantum ? std::bit_width(_config.dispatch_quantum) - 1 : 0)
+    , _root(std::make_unique<priority_group_data>(1, nullptr))
 {
 }
 
@@ -131,17 +295,55 @@ fair_queue::~fair_queue() {
     for (const auto& fq : _priority_classes) {
         SEASTAR_ASSERT(!fq);
     }
+    for (const auto& g : _priority_groups) {
+        SEASTAR_ASSERT(!g);
+    }
 }
 
-void fair_queue::push_priority_class(priority_class_data& pc) noexcept {
-    SEASTAR_ASSERT(pc._plugged && !pc._queued);
-    _handles.assert_enough_capacity();
-    _handles.push(&pc);
-    pc._queued = true;
+fair_queue::capacity_t fair_queue::slot_of(const priority_entry& e) const noexcept {
+    return e._accumulated >> _quantum_shift;
 }
 
-void fair_queue::push_priority_class_from_idle(priority_class_data& pc) noexcept {
-    if (!pc._queued) {
+fair_queue::priority_group_data& fair_queue::group_or_root(std::optional<group_id> g) noexcept {
+    if (!g) {
+        return *_root;
+    }
+    SEASTAR_ASSERT(*g < _priority_groups.size() && _priority_groups[*g]);
+    return *_priority_groups[*g];
+}
+
+void fair_queue::maybe_retune_quantum(capacity_t req_cost) noexcept {
+    if (_config.dispatch_quantum) {
+        return;
+    }
+
+    // Saturate rather than wrap on (unrealistically) expensive requests
+    _dispatched_cost = std::min(_dispatched_cost, std::numeric_limits<capacity_t>::max() - req_cost) + req_cost;
+    if (++_dispatched_since_retune < quantum_retune_period) {
+        return;
+    }
+
+    // Re-filing all the classes isn't free, so only do it when the average
+    // request cost drifts away from the quantum by more than 2x
+    auto avg_cost = std::max<capacity_t>(_dispatched_cost / _dispatched_since_retune, 1);
+    int shift = std::bit_width(avg_cost) - 1;
+    _dispatched_cost = 0;
+    _dispatched_since_retune = 0;
+    if (std::abs(shift - int(_quantum_shift)) > 1) {
+        _quantum_shift = shift;
+        _root->rebuild(_quantum_shift);
+        for (auto& g : _priority_groups) {
+            if (g) {
+                g->rebuild(_quantum_shift);
+            }
+        }
+    }
+}
+
+// Activates the entry and, if needed, the groups above it
+void fair_queue::push_priority_entry_from_idle(priority_entry& pe) noexcept {
+    for (auto* e = &pe; e->_parent != nullptr && !e->_queued && e->_plugged; e = e->_parent) {
+        auto& g = *e->_parent;
         // Don't let the newcomer monopolize the disk for more than tau
         // duration. For this estimate how many capacity units can be
         // accumulated with the current class shares per rate resulution
@@ -150,40 +352,59 @@ void fair_queue::push_priority_class_from_idle(priority_class_data& pc) noexcept
         // introduce extra if's for that short corner case, use signed
         // arithmetics and make sure the _accumulated value doesn't grow
         // over signed maximum (see overflow check below)
-        pc._accumulated = std::max<signed_capacity_t>(_last_accumulated - _config.forgiving_factor / pc._shares, pc._accumulated);
-        _handles.assert_enough_capacity();
-        _handles.push(&pc);
-        pc._queued = true;
-        pc._activations++;
+        e->_accumulated = std::max<signed_capacity_t>(g._last_accumulated - _config.forgiving_factor / e->_shares, e->_accumulated);
+        if (g.idle()) {
+            g._calendar_base = slot_of(*e);
+        }
+        g.insert(*e, slot_of(*e));
+        e->_queued = true;
+        e->_activations++;
     }
 }
 
-// ATTN: This can only be called on pc that is from _handles.top()
-void fair_queue::pop_priority_class(priority_class_data& pc) noexcept {
-    SEASTAR_ASSERT(pc._queued);
-    pc._queued = false;
-    _handles.pop();
+// Takes the entry out of its group. Groups above it are left as they are and
+// are dropped by top() if they turn out to be empty.
+void fair_queue::detach_priority_entry(priority_entry& e) noexcept {
+    auto& g = *e._parent;
+    if (g._current == &e) {
+        g._current = nullptr;
+    } else if (e._queued) {
+        g.erase(e);
+    }
+    e._queued = false;
+    g._nr_members--;
+}
+
+void fair_queue::plug_priority_entry(priority_entry& e) noexcept {
+    SEASTAR_ASSERT(!e._plugged);
+    e._plugged = true;
+    bool pending = e._is_group
+            ? !static_cast<priority_group_data&>(e).idle()
+            : !static_cast<priority_class_data&>(e)._queue.empty();
+    if (pending) {
+        push_priority_entry_from_idle(e);
+    }
 }
 
-void fair_queue::plug_priority_class(priority_class_data& pc) noexcept {
-    SEASTAR_ASSERT(!pc._plugged);
-    pc._plugged = true;
-    if (!pc._queue.empty()) {
-        push_priority_class_from_idle(pc);
-    }
+void fair_queue::unplug_priority_entry(priority_entry& e) noexcept {
+    SEASTAR_ASSERT(e._plugged);
+    e._plugged = false;
 }
 
 void fair_queue::plug_class(class_id cid) noexcept {
-    plug_priority_class(*_priority_classes[cid]);
+    plug_priority_entry(*_priority_classes[cid]);
 }
 
-void fair_queue::unplug_priority_class(priority_class_data& pc) noexcept {
-    SEASTAR_ASSERT(pc._plugged);
-    pc._plugged = false;
+void fair_queue::unplug_class(class_id cid) noexcept {
+    unplug_priority_entry(*_priority_classes[cid]);
 }
 
-void fair_queue::unplug_class(class_id cid) noexcept {
-    unplug_priority_class(*_priority_classes[cid]);
+void fair_queue::plug_group(group_id gid) noexcept {
+    plug_priority_entry(*_priority_groups[gid]);
+}
+
+void fair_queue::unplug_group(group_id gid) noexcept {
+    unplug_priority_entry(*_priority_groups[gid]);
 }
 
 fair_queue::capacity_t fair_queue::accumulated(class_id cid) const noexcept {
@@ -198,21 +419,27 @@ unsigned fair_queue::activations(class_id cid) const noexcept {
     return _priority_classes[cid]->_activations;
 }
 
-void fair_queue::register_priority_class(class_id id, uint32_t shares) {
+fair_queue::capacity_t fair_queue::group_accumulated(group_id gid) const noexcept {
+    return _priority_groups[gid]->_accumulated;
+}
+
+void fair_queue::register_priority_class(class_id id, uint32_t shares, std::optional<group_id> group) {
     if (id >= _priority_classes.size()) {
         _priority_classes.resize(id + 1);
     } else {
         SEASTAR_ASSERT(!_priority_classes[id]);
     }
 
-    _handles.reserve(_nr_classes + 1);
-    _priority_classes[id] = std::make_unique<priority_class_data>(shares);
+    auto& parent = group_or_root(group);
+    _priority_classes[id] = std::make_unique<priority_class_data>(shares, &parent);
+    parent._nr_members++;
     _nr_classes++;
 }
 
 void fair_queue::unregister_priority_class(class_id id) {
     auto& pclass = _priority_classes[id];
     SEASTAR_ASSERT(pclass);
+    detach_priority_entry(*pclass);
     pclass.reset();
     _nr_classes--;
 }
@@ -224,6 +451,50 @@ void fair_queue::update_shares_for_class(class_id id, uint32_t shares) {
     pc->update_shares(shares);
 }
 
+void fair_queue::set_class_group(class_id id, std::optional<group_id> group) {
+    SEASTAR_ASSERT(id < _priority_classes.size());
+    auto& pc = *_priority_classes[id];
+    auto& parent = group_or_root(group);
+    if (pc._parent == &parent) {
+        return;
+    }
+
+    detach_priority_entry(pc);
+    pc._parent = &parent;
+    parent._nr_members++;
+    pc._accumulated = parent._last_accumulated;
+    if (pc._plugged && !pc._queue.empty()) {
+        push_priority_entry_from_idle(pc);
+    }
+}
+
+void fair_queue::register_priority_group(group_id id, uint32_t shares, std::optional<group_id> parent_id) {
+    if (id >= _priority_groups.size()) {
+        _priority_groups.resize(id + 1);
+    } else {
+        SEASTAR_ASSERT(!_priority_groups[id]);
+    }
+
+    auto& parent = group_or_root(parent_id);
+    _priority_groups[id] = std::make_unique<priority_group_data>(shares, &parent);
+    parent._nr_members++;
+}
+
+void fair_queue::unregister_priority_group(group_id id) {
+    auto& pg = _priority_groups[id];
+    SEASTAR_ASSERT(pg);
+    SEASTAR_ASSERT(pg->_nr_members == 0);
+    detach_priority_entry(*pg);
+    pg.reset();
+}
+
+void fair_queue::update_shares_for_group(group_id id, uint32_t shares) {
+    SEASTAR_ASSERT(id < _priority_groups.size());
+    auto& pg = _priority_groups[id];
+    SEASTAR_ASSERT(pg);
+    pg->update_shares(shares);
+}
+
 fair_queue_ticket fair_queue::resources_currently_waiting() const {
     return _resources_queued;
 }
@@ -238,7 +509,7 @@ void fair_queue::queue(class_id id, fair_queue_entry& ent) noexcept {
     // Since we don't know which queue we will use to execute the next request - if ours or
     // someone else's, we need a separate promise at this point.
     if (pc._plugged) {
-        push_priority_class_from_idle(pc);
+        push_priority_entry_from_idle(pc);
     }
     pc._queue.push_back(ent);
     _queued_capacity += ent.capacity();
@@ -253,54 +524,126 @@ void fair_queue::notify_request_cancelled(fair_queue_entry& ent) noexcept {
 }
 
 fair_queue_entry* fair_queue::top() {
-    while (!_handles.empty()) {
-        priority_class_data& h = *_handles.top();
-        if (h._queue.empty() || !h._plugged) {
-            pop_priority_class(h);
-            continue;
+    return top(*_root);
+}
+
+fair_queue_entry* fair_queue::top(priority_group_data& g) noexcept {
+    while (true) {
+        if (g._current == nullptr) {
+            auto* e = g.pop();
+            if (e == nullptr) {
+                return nullptr;
+            }
+            if (slot_of(*e) > g._calendar_base) {
+                g.unpark(*e, _quantum_shift);
+                continue;
+            }
+            g._current = e;
         }
 
-        return &h._queue.front();
-    }
+        auto& e = *g._current;
+        fair_queue_entry* ent = nullptr;
+        if (e._plugged) {
+            if (e._is_group) {
+                ent = top(static_cast<priority_group_data&>(e));
+            } else if (auto& pc = static_cast<priority_class_data&>(e); !pc._queue.empty()) {
+                ent = &pc._queue.front();
+            }
+        }
+        if (ent != nullptr) {
+            return ent;
+        }
 
-    return nullptr;
+        e._queued = false;
+        g._current = nullptr;
+    }
 }
 
-void fair_queue::pop_front() {
-    auto& h = *_handles.top();
-
-    _last_accumulated = std::max(h._accumulated, _last_accumulated);
-    pop_priority_class(h);
-
-    auto& req = h._queue.front();
-    h._queue.pop_front();
+// Charges the cost of a request to the member of a group
+fair_queue::capacity_t fair_queue::charge(priority_group_data& g, priority_entry& e, capacity_t cap) noexcept {
+    g._last_accumulated = std::max(e._accumulated, g._last_accumulated);
 
     // Usually the cost of request is tens to hundreeds of thousands. However, for
     // unrestricted queue it can be as low as 2k. With large enough shares this
     // has chances to be translated into zero cost which, in turn, will make the
     // class show no progress and monopolize the queue.
-    auto req_cap = req._capacity;
-    auto req_cost  = std::max(req_cap / h._shares, (capacity_t)1);
-    // signed overflow check to make push_priority_class_from_idle math work
-    if (h._accumulated >= std::numeric_limits<signed_capacity_t>::max() - req_cost) {
+    auto cost = std::max(cap / e._shares, (capacity_t)1);
+    // signed overflow check to make push_priority_entry_from_idle math work
+    if (e._accumulated >= std::numeric_limits<signed_capacity_t>::max() - cost) {
+        // e itself is rebased along the way, keep what the others are rebased by
+        auto base = e._accumulated;
+        auto rebase = [&g, &e, base] (priority_entry& m) {
+            if (m._parent != &g) {
+                return;
+            }
+            if (m._queued && &m != &e) {
+                // Members sharing a calendar bucket may be slightly behind e
+                m._accumulated = m._accumulated > base ? m._accumulated - base : 0;
+            } else { // this includes e
+                m._accumulated = 0;
+            }
+        };
         for (auto& pc : _priority_classes) {
             if (pc) {
-                if (pc->_queued) {
-                    pc->_accumulated -= h._accumulated;
-                } else { // this includes h
-                    pc->_accumulated = 0;
-                }
+                rebase(*pc);
+            }
+        }
+        for (auto& pg : _priority_groups) {
+            if (pg) {
+                rebase(*pg);
             }
         }
-        _last_accumulated = 0;
+        g._last_accumulated = 0;
+        g._calendar_base = 0;
+        g.rebuild(_quantum_shift);
+    }
+    e._accumulated += cost;
+    return cost;
+}
+
+void fair_queue::pop_front() {
+    priority_entry* e = _root->_current;
+    while (e->_is_group) {
+        e = static_cast<priority_group_data&>(*e)._current;
     }
-    h._accumulated += req_cost;
+
+    auto& h = static_cast<priority_class_data&>(*e);
+    auto& req = h._queue.front();
+    h._queue.pop_front();
+
+    auto req_cap = req._capacity;
     h._pure_accumulated += req_cap;
     _queued_capacity -= req_cap;
 
-    if (!h._queue.empty()) {
-        push_priority_class(h);
+    // Charge the request to the class and to every group above it, bottom-up,
+    // so that a group knows whether it still has something to dispatch
+    capacity_t req_cost = 0;
+    for (; e->_parent != nullptr; e = e->_parent) {
+        auto& g = *e->_parent;
+        auto cost = charge(g, *e, req_cap);
+        if (e == &h) {
+            req_cost = cost;
+        }
+
+        bool pending = e->_is_group
+                ? !static_cast<priority_group_data&>(*e).idle()
+                : !h._queue.empty();
+        if (!pending) {
+            e->_queued = false;
+            g._current = nullptr;
+        } else if (slot_of(*e) > g._calendar_base) {
+            if (g.calendar_empty()) {
+                // Nobody else to yield to
+                g._calendar_base = slot_of(*e);
+            } else {
+                // Used up its quantum, let the others go
+                g._current = nullptr;
+                g.insert(*e, slot_of(*e));
+            }
+        }
     }
+
+    maybe_retune_quantum(req_cost);
 }
 
 }
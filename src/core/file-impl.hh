@@ -27,6 +27,8 @@
 #include <deque>
 #include <functional>
 #include <memory>
+#include <optional>
+#include <type_traits>
 #include <vector>
 #include <sys/uio.h>
 
@@ -141,12 +143,17 @@ class posix_file_impl : public file_impl {
      */
     future<temporary_buffer<uint8_t>> read_maybe_eof(uint64_t pos, size_t len, internal::maybe_priority_class_ref pc, io_intent* intent);
 
+    // Allocates a buffer suitable as a DMA read destination
+    temporary_buffer<uint8_t> allocate_dma_buffer(size_t size);
+
     future<size_t> read_dma_one(uint64_t pos, void* buffer, size_t len, internal::maybe_priority_class_ref pc, io_intent* intent) noexcept {
         return read_dma(pos, buffer, len, intent);
     }
 protected:
-    future<size_t> do_write_dma(uint64_t pos, const void* buffer, size_t len, internal::maybe_priority_class_ref pc, io_intent* intent) noexcept;
-    future<size_t> do_write_dma(uint64_t pos, std::vector<iovec> iov, internal::maybe_priority_class_ref pc, io_intent* intent) noexcept;
+    // Whether do_write_dma() may be asked to sync the file along with the write
+    bool can_link_fdatasync() const noexcept;
+    future<size_t> do_write_dma(uint64_t pos, const void* buffer, size_t len, internal::maybe_priority_class_ref pc, io_intent* intent, bool linked_fdatasync = false) noexcept;
+    future<size_t> do_write_dma(uint64_t pos, std::vector<iovec> iov, internal::maybe_priority_class_ref pc, io_intent* intent, bool linked_fdatasync = false) noexcept;
     future<size_t> do_read_dma(uint64_t pos, void* buffer, size_t len, internal::maybe_priority_class_ref pc, io_intent* intent) noexcept;
     future<size_t> do_read_dma(uint64_t pos, std::vector<iovec> iov, internal::maybe_priority_class_ref pc, io_intent* intent) noexcept;
     future<temporary_buffer<uint8_t>> do_dma_read_bulk(uint64_t offset, size_t range_size, internal::maybe_priority_class_ref pc, io_intent* intent) noexcept;
@@ -207,7 +214,10 @@ class append_challenged_posix_file_impl final : public posix_file_impl, public e
         opcode type;
         uint64_t pos;
         size_t len;
-        noncopyable_function<future<> ()> run;
+        // Called with whether a flush() rides on the operation (writes only)
+        noncopyable_function<future<> (bool flush)> run;
+        // Set on a queued write that a later flush() was folded into
+        std::optional<promise<>> flushed;
     };
     // Queue of pending operations; processed from front to end to avoid
     // starvation, but can issue concurrent operations.
@@ -243,9 +253,23 @@ class append_challenged_posix_file_impl final : public posix_file_impl, public e
         try {
             auto pr = make_lw_shared(promise<T...>());
             auto fut = pr->get_future();
-            auto op_func = [func = std::move(func), pr = std::move(pr)] () mutable {
-                return futurize_invoke(std::move(func)).then_wrapped([pr = std::move(pr)] (future<T...> f) mutable {
+            auto op_func = [func = std::move(func), pr = std::move(pr)] (bool flush) mutable {
+                auto fut = [&] {
+                    if constexpr (std::is_invocable_v<Func, bool>) {
+                        return futurize_invoke(std::move(func), flush);
+                    } else {
+                        return futurize_invoke(std::move(func));
+                    }
+                }();
+                // The failure is also passed on, for a flush riding on the op
+                return std::move(fut).then_wrapped([pr = std::move(pr)] (future<T...> f) mutable {
+                    if (f.failed()) {
+                        auto ex = f.get_exception();
+                        pr->set_exception(ex);
+                        return make_exception_future<>(std::move(ex));
+                    }
                     f.forward_to(std::move(*pr));
+                    return make_ready_future<>();
                 });
             };
             try {
@@ -69,6 +69,7 @@ module seastar;
 #include <seastar/core/io_queue.hh>
 #include <seastar/core/queue.hh>
 #include "core/file-impl.hh"
+#include "core/reactor_backend.hh"
 #include "core/syscall_result.hh"
 #include "core/thread_pool.hh"
 #endif
@@ -122,6 +123,7 @@ posix_file_impl::posix_file_impl(int fd, open_flags f, file_open_options options
         , _fd(fd)
 {
     configure_io_lengths();
+    engine()._backend->register_file(_fd);
 }
 
 posix_file_impl::posix_file_impl(int fd, open_flags f, file_open_options options, dev_t device_id, const internal::fs_info& fsi)
@@ -131,6 +133,9 @@ posix_file_impl::posix_file_impl(int fd, open_flags f, file_open_options options
 }
 
 posix_file_impl::~posix_file_impl() {
+    if (_fd != -1 && engine_is_ready()) {
+        engine()._backend->unregister_file(_fd);
+    }
     if (_refcount && _refcount->fetch_add(-1, std::memory_order_relaxed) != 1) {
         return;
     }
@@ -190,6 +195,7 @@ posix_file_impl::posix_file_impl(int fd, open_flags f, std::atomic<unsigned>* re
     _disk_write_dma_alignment = disk_write_dma_alignment;
     _disk_overwrite_dma_alignment = disk_overwrite_dma_alignment;
     configure_io_lengths();
+    engine()._backend->register_file(_fd);
 }
 
 future<>
@@ -204,8 +210,11 @@ posix_file_impl::flush() noexcept {
 
 future<struct stat>
 posix_file_impl::stat() noexcept {
-    auto ret = co_await engine()._thread_pool->submit<syscall_result_extra<struct stat>>(
-            internal::thread_pool_submit_reason::file_operation, [fd = _fd] {
+    auto& backend = *engine()._backend;
+    auto ret = backend.can_offload_file_system_calls()
+            ? co_await backend.statx(_fd, "", AT_EMPTY_PATH)
+            : co_await engine()._thread_pool->submit<syscall_result_extra<struct stat>>(
+                    internal::thread_pool_submit_reason::file_stat, [fd = _fd] {
         struct stat st;
         auto ret = ::fstat(fd, &st);
         return wrap_syscall(ret, st);
@@ -315,6 +324,7 @@ posix_file_impl::close() noexcept {
     }
     auto fd = _fd;
     _fd = -1;  // Prevent a concurrent close (which is illegal) from closing another file's fd
+    engine()._backend->unregister_file(fd);
     if (_refcount && _refcount->fetch_add(-1, std::memory_order_relaxed) != 1) {
         _refcount = nullptr;
         return make_ready_future<>();
@@ -474,16 +484,27 @@ posix_file_impl::list_directory(std::function<future<> (directory_entry de)> nex
     return ret;
 }
 
+bool
+posix_file_impl::can_link_fdatasync() const noexcept {
+    return engine()._backend->can_link_fdatasync();
+}
+
 future<size_t>
-posix_file_impl::do_write_dma(uint64_t pos, const void* buffer, size_t len, internal::maybe_priority_class_ref io_priority_class, io_intent* intent) noexcept {
-    auto req = internal::io_request::make_write(_fd, pos, buffer, len, _nowait_works);
+posix_file_impl::do_write_dma(uint64_t pos, const void* buffer, size_t len, internal::maybe_priority_class_ref io_priority_class, io_intent* intent, bool linked_fdatasync) noexcept {
+    if (linked_fdatasync) {
+        ++engine()._fsyncs;
+    }
+    auto req = internal::io_request::make_write(_fd, pos, buffer, len, _nowait_works, linked_fdatasync);
     return _io_queue.submit_io_write(internal::priority_class(io_priority_class), len, std::move(req), intent);
 }
 
 future<size_t>
-posix_file_impl::do_write_dma(uint64_t pos, std::vector<iovec> iov, internal::maybe_priority_class_ref io_priority_class, io_intent* intent) noexcept {
+posix_file_impl::do_write_dma(uint64_t pos, std::vector<iovec> iov, internal::maybe_priority_class_ref io_priority_class, io_intent* intent, bool linked_fdatasync) noexcept {
+    if (linked_fdatasync) {
+        ++engine()._fsyncs;
+    }
     auto len = internal::sanitize_iovecs(iov, _disk_write_dma_alignment);
-    auto req = internal::io_request::make_writev(_fd, pos, iov, _nowait_works);
+    auto req = internal::io_request::make_writev(_fd, pos, iov, _nowait_works, linked_fdatasync);
     return _io_queue.submit_io_write(internal::priority_class(io_priority_class), len, std::move(req), intent, std::move(iov));
 }
 
@@ -536,8 +557,7 @@ posix_file_impl::do_dma_read_bulk(uint64_t offset, size_t range_size, internal::
 
     auto rstate = make_lw_shared<internal::file_read_state<uint8_t>>(offset, front,
                                                        range_size,
-                                                       _memory_dma_alignment,
-                                                       _disk_read_dma_alignment,
+                                                       allocate_dma_buffer(align_up(range_size, size_t(_disk_read_dma_alignment))),
                                                        intent);
 
     //
@@ -572,7 +592,7 @@ posix_file_impl::do_dma_read_bulk(uint64_t offset, size_t range_size, internal::
 
                 return make_ready_future<>();
             });
-        }).then([rstate] () mutable {
+        }).then([rstate, this] () mutable {
             //
             // If we are here we are promised to have read some bytes beyond
             // "front" so we may trim straight away.
@@ -586,14 +606,22 @@ posix_file_impl::do_dma_read_bulk(uint64_t offset, size_t range_size, internal::
   }
 }
 
+temporary_buffer<uint8_t>
+posix_file_impl::allocate_dma_buffer(size_t size) {
+    // Let the backend serve it from its registered buffers, if it has any
+    auto buf = engine()._backend->allocate_dma_buffer(_memory_dma_alignment, size);
+    auto p = reinterpret_cast<uint8_t*>(buf.get_write());
+    return temporary_buffer<uint8_t>(p, buf.size(), buf.release());
+}
+
 future<temporary_buffer<uint8_t>>
 posix_file_impl::read_maybe_eof(uint64_t pos, size_t len, internal::maybe_priority_class_ref pc, io_intent* intent) {
     //
     // We have to allocate a new aligned buffer to make sure we don't get
-    // an EINVAL error due to unaligned destination buffer.
+    // an EINVAL error due to unaligned destination buffer. It is returned to
+    // the caller, so it doesn't come from the registered buffer pool.
     //
-    temporary_buffer<uint8_t> buf = temporary_buffer<uint8_t>::aligned(
-               _memory_dma_alignment, align_up(len, size_t(_disk_read_dma_alignment)));
+    auto buf = temporary_buffer<uint8_t>::aligned(_memory_dma_alignment, align_up(len, size_t(_disk_read_dma_alignment)));
 
     // try to read a single bulk from the given position
     auto dst = buf.get_write();
@@ -714,7 +742,8 @@ append_challenged_posix_file_impl::must_run_alone(const op& candidate) const noe
     // checks if candidate is a non-write, size-changing operation.
     return (candidate.type == opcode::truncate)
             || (candidate.type == opcode::allocate)
-            || (candidate.type == opcode::flush && (_fsync_is_exclusive || _sloppy_size));
+            || (candidate.type == opcode::flush && (_fsync_is_exclusive || _sloppy_size))
+            || candidate.flushed;
 }
 
 bool
@@ -742,9 +771,15 @@ append_challenged_posix_file_impl::dispatch(op& candidate) noexcept {
     unsigned* op_counter = size_changing(candidate)
             ? &_current_size_changing_ops : &_current_non_size_changing_ops;
     ++*op_counter;
+    bool flush = bool(candidate.flushed);
     // FIXME: future is discarded
-    (void)candidate.run().then([me = shared_from_this(), op_counter] {
+    (void)candidate.run(flush).then_wrapped([me = shared_from_this(), op_counter, flushed = std::move(candidate.flushed)] (future<> f) mutable {
         --*op_counter;
+        if (flushed) {
+            f.forward_to(std::move(*flushed));
+        } else {
+            f.ignore_ready_future();
+        }
         me->process_queue();
     });
 }
@@ -899,8 +934,8 @@ append_challenged_posix_file_impl::write_dma(uint64_t pos, const void* buffer, s
         opcode::write,
         pos,
         len,
-        [this, pos, buffer, len, pc, iref = std::move(iref)] {
-            return posix_file_impl::do_write_dma(pos, buffer, len, pc, iref.retrieve()).then([this, pos] (size_t ret) {
+        [this, pos, buffer, len, pc, iref = std::move(iref)] (bool flush) {
+            return posix_file_impl::do_write_dma(pos, buffer, len, pc, iref.retrieve(), flush).then([this, pos] (size_t ret) {
                 commit_size(pos + ret);
                 return make_ready_future<size_t>(ret);
             });
@@ -916,8 +951,8 @@ append_challenged_posix_file_impl::write_dma(uint64_t pos, std::vector<iovec> io
         opcode::write,
         pos,
         len,
-        [this, pos, iov = std::move(iov), pc, iref = std::move(iref)] () mutable {
-            return posix_file_impl::do_write_dma(pos, std::move(iov), pc, iref.retrieve()).then([this, pos] (size_t ret) {
+        [this, pos, iov = std::move(iov), pc, iref = std::move(iref)] (bool flush) mutable {
+            return posix_file_impl::do_write_dma(pos, std::move(iov), pc, iref.retrieve(), flush).then([this, pos] (size_t ret) {
                 commit_size(pos + ret);
                 return make_ready_future<size_t>(ret);
             });
@@ -935,6 +970,13 @@ append_challenged_posix_file_impl::flush() noexcept {
     if ((!_sloppy_size || _logical_size == _committed_size) && !_fsync_is_exclusive) {
         // FIXME: determine if flush can block concurrent reads or writes
         return posix_file_impl::flush();
+    } else if (!_sloppy_size && !_q.empty() && _q.back().type == opcode::write && !_q.back().flushed && can_link_fdatasync()) {
+        // Fold the flush into the write queued last. That makes it run alone
+        // after everything queued before it, like the flush would, and lets
+        // the backend submit the write and the fdatasync() in one go.
+        auto& w = _q.back();
+        w.flushed.emplace();
+        return w.flushed->get_future();
     } else {
         return enqueue<>(
             opcode::flush,
@@ -23,10 +23,16 @@
 module;
 #endif
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <bit>
 #include <chrono>
+#include <cmath>
 #include <cstdint>
+#include <cstring>
 #include <mutex>
+#include <tuple>
 #include <utility>
 #include <fmt/format.h>
 #include <fmt/ostream.h>
@@ -44,6 +50,7 @@ module seastar;
 #include <seastar/core/reactor.hh>
 #include <seastar/core/when_all.hh>
 #include <seastar/core/metrics.hh>
+#include <seastar/core/internal/estimated_histogram.hh>
 #include <seastar/core/internal/io_desc.hh>
 #include <seastar/core/internal/io_sink.hh>
 #include <seastar/core/io_priority_class.hh>
@@ -104,12 +111,85 @@ auto io_throttler::capacity_deficiency(capacity_t from) const noexcept -> capaci
     return _token_bucket.deficiency(from);
 }
 
+
+// Closed-loop correction of the disk model.
+//
+// The throttlers' rate comes from the io-properties measured by iotune, but
+// real disks (notably cloud volumes) drift away from it over time. Every queue
+// of the group collects the execution latencies of its requests and the number
+// of polls at which it had requests, but no tokens to dispatch them. Once per
+// period the queues merge this into the group, and the queue on the shard that
+// allocated the group slides the window and adjusts the throttlers' rate:
+//
+//  - if the 99th percentile of latency is above the goal, the disk is slower
+//    than the model and the rate is cut in proportion to the overshoot
+//  - if it's well below the goal while queues wait for tokens, the disk is
+//    faster than the model and the rate is increased by a small step
+//
+// The rate stays within the configured factors of the model's one. After a
+// change the window is restarted, since older samples describe the old rate.
+struct io_group::rate_controller {
+    using histogram = internal::io_latency_histogram;
+
+    std::vector<std::atomic<uint64_t>> incoming;
+    std::atomic<uint64_t> incoming_throttled = 0;
+
+    // Owner shard only
+    std::vector<histogram> window;
+    unsigned head = 0;
+    histogram total;
+    double factor = 1.0;
+    double p99 = 0.0;
+    uint64_t increases = 0;
+    uint64_t decreases = 0;
+
+    static constexpr double max_decrease_step = 0.8;
+    static constexpr double increase_step = 1.05;
+    static constexpr double increase_threshold = 0.8;
+
+    explicit rate_controller(unsigned window_periods)
+        : incoming(histogram().size())
+        , window(std::max(window_periods, 1u))
+    {}
+
+    void merge(const histogram& h, uint64_t throttled) noexcept {
+        for (unsigned i = 0; i < incoming.size(); i++) {
+            if (auto c = h.get(i)) {
+                incoming[i].fetch_add(c, std::memory_order_relaxed);
+            }
+        }
+        incoming_throttled.fetch_add(throttled, std::memory_order_relaxed);
+    }
+
+    // Moves the merged samples into the window, returns the number
+    // of throttled polls reported during the last period
+    uint64_t slide() noexcept {
+        auto& slot = window[head];
+        for (unsigned i = 0; i < incoming.size(); i++) {
+            total[i] -= slot.get(i);
+            slot[i] = incoming[i].exchange(0, std::memory_order_relaxed);
+            total[i] += slot.get(i);
+        }
+        head = (head + 1) % window.size();
+        return incoming_throttled.exchange(0, std::memory_order_relaxed);
+    }
+
+    void restart() noexcept {
+        for (auto& h : window) {
+            h.clear();
+        }
+        total.clear();
+    }
+};
+
 struct io_group::priority_class_data {
     using token_bucket_t = internal::shared_token_bucket<uint64_t, std::ratio<1>, internal::capped_release::no>;
 
     static constexpr uint64_t bandwidth_burst_in_blocks = 10 << (20 - io_queue::block_size_shift); // 10MB
     static constexpr uint64_t bandwidth_threshold_in_blocks = 128 << (10 - io_queue::block_size_shift); // 128kB
     token_bucket_t tb;
+    // Number of io_queues using it, when it limits a group of classes
+    unsigned group_users = 0;
 
     uint64_t tokens(size_t length) const noexcept {
         return length >> io_queue::block_size_shift;
@@ -130,7 +210,91 @@ struct io_group::priority_class_data {
     }
 };
 
+// Group of classes. Accounts the requests dispatched from all the classes in it
+// and applies the group's bandwidth limit to them altogether.
+class io_queue::priority_group_data {
+    io_queue& _queue;
+    const unsigned _id;
+    uint32_t _shares;
+    priority_group_data* _parent;
+    struct {
+        size_t bytes = 0;
+        uint64_t ops = 0;
+
+        void add(size_t len) noexcept {
+            ops++;
+            bytes += len;
+        }
+    } _rwstat[2] = {};
+
+    io_group::priority_class_data& _group;
+    size_t _replenish_head;
+    timer<lowres_clock> _replenish;
+
+    void try_to_replenish() noexcept {
+        _group.tb.replenish(io_queue::clock_type::now());
+        auto delta = _group.tb.deficiency(_replenish_head);
+        if (delta > 0) {
+            _replenish.arm(std::chrono::duration_cast<std::chrono::microseconds>(_group.tb.duration_for(delta)));
+        } else {
+            _queue.unthrottle_priority_group(*this);
+        }
+    }
+
+public:
+    priority_group_data(unsigned id, uint32_t shares, priority_group_data* parent, io_queue& q, io_group::priority_class_data& pg)
+        : _queue(q)
+        , _id(id)
+        , _shares(std::max(shares, 1u))
+        , _parent(parent)
+        , _group(pg)
+        , _replenish([this] { try_to_replenish(); })
+    {
+    }
+    priority_group_data(const priority_group_data&) = delete;
+    priority_group_data(priority_group_data&&) = delete;
+
+    unsigned id() const noexcept { return _id; }
+    priority_group_data* parent() const noexcept { return _parent; }
+
+    void update_shares(uint32_t shares) noexcept {
+        _shares = std::max(shares, 1u);
+    }
+
+    void update_bandwidth(uint64_t bandwidth) {
+        _group.update_bandwidth(bandwidth);
+        io_log.debug("Updated {} group bandwidth to {}MB/s", _id, bandwidth >> 20);
+    }
+
+    void on_dispatch(io_direction_and_length dnl) noexcept {
+        _rwstat[dnl.rw_idx()].add(dnl.length());
+
+        auto tokens = _group.tokens(dnl.length());
+        auto ph = _group.tb.grab(tokens);
+        auto delta = _group.tb.deficiency(ph);
+        if (delta > 0 && !_replenish.armed()) {
+            _queue.throttle_priority_group(*this);
+            _replenish_head = ph;
+            _replenish.arm(std::chrono::duration_cast<std::chrono::microseconds>(_group.tb.duration_for(delta)));
+        }
+    }
+
+    std::vector<seastar::metrics::impl::metric_definition_impl> metrics();
+    metrics::metric_groups metric_groups;
+};
+
 class io_queue::priority_class_data {
+public:
+    enum class stage : unsigned {
+        queue,  // waiting in the fair queue
+        sink,   // dispatched, waiting to be submitted to the kernel
+        kernel, // submitted, waiting for completion
+    };
+    static constexpr unsigned nr_stages = 3;
+    // Microseconds, 8us..16s
+    using latency_histogram = metrics::internal::approximate_exponential_histogram<8, 16777216, 4>;
+
+private:
     io_queue& _queue;
     const internal::priority_class _pc;
     uint32_t _shares;
@@ -150,10 +314,12 @@ class io_queue::priority_class_data {
     std::chrono::duration<double> _total_execution_time;
     std::chrono::duration<double> _starvation_time;
     io_queue::clock_type::time_point _activated;
+    std::array<std::array<latency_histogram, nr_stages>, 2> _stage_latency;
 
     io_group::priority_class_data& _group;
     size_t _replenish_head;
     timer<lowres_clock> _replenish;
+    io_queue::priority_group_data* _parent = nullptr;
 
     void try_to_replenish() noexcept {
         _group.tb.replenish(io_queue::clock_type::now());
@@ -166,6 +332,10 @@ class io_queue::priority_class_data {
     }
 
 public:
+    void set_parent(io_queue::priority_group_data* parent) noexcept {
+        _parent = parent;
+    }
+
     void update_shares(uint32_t shares) noexcept {
         _shares = std::max(shares, 1u);
     }
@@ -199,8 +369,13 @@ class io_queue::priority_class_data {
         }
     }
 
+    void on_stage(io_direction_and_length dnl, stage st, std::chrono::duration<double> lat) noexcept {
+        _stage_latency[dnl.rw_idx()][unsigned(st)].add(std::chrono::duration_cast<std::chrono::microseconds>(lat).count());
+    }
+
     void on_dispatch(io_direction_and_length dnl, std::chrono::duration<double> lat) noexcept {
         _rwstat[dnl.rw_idx()].add(dnl.length());
+        on_stage(dnl, stage::queue, lat);
         _queue_time = lat;
         _total_queue_time += lat;
         _nr_queued--;
@@ -217,6 +392,10 @@ class io_queue::priority_class_data {
             _replenish_head = ph;
             _replenish.arm(std::chrono::duration_cast<std::chrono::microseconds>(_group.tb.duration_for(delta)));
         }
+
+        for (auto* pg = _parent; pg != nullptr; pg = pg->parent()) {
+            pg->on_dispatch(dnl);
+        }
     }
 
     void on_cancel() noexcept {
@@ -245,6 +424,7 @@ class io_queue::priority_class_data {
     fair_queue::class_id fq_class() const noexcept { return _pc.id(); }
 
     std::vector<seastar::metrics::impl::metric_definition_impl> metrics();
+    std::vector<seastar::metrics::impl::metric_definition_impl> latency_metrics();
     metrics::metric_groups metric_groups;
 };
 
@@ -252,6 +432,7 @@ class io_desc_read_write final : public io_completion {
     io_queue& _ioq;
     io_queue::priority_class_data& _pclass;
     io_queue::clock_type::time_point _ts;
+    io_queue::clock_type::time_point _submitted;
     const stream_id _stream;
     const io_direction_and_length _dnl;
     const fair_queue_entry::capacity_t _fq_capacity;
@@ -285,6 +466,7 @@ class io_desc_read_write final : public io_completion {
         auto now = io_queue::clock_type::now();
         auto delay = std::chrono::duration_cast<std::chrono::duration<double>>(now - _ts);
         _pclass.on_complete(delay);
+        _pclass.on_stage(_dnl, io_queue::priority_class_data::stage::kernel, now - _submitted);
         _ioq.complete_request(*this, delay);
         _pr.set_value(res);
         delete this;
@@ -301,9 +483,16 @@ class io_desc_read_write final : public io_completion {
         auto now = io_queue::clock_type::now();
         _pclass.on_dispatch(_dnl, std::chrono::duration_cast<std::chrono::duration<double>>(now - _ts));
         _ts = now;
+        _submitted = now;
         _dispatched_polls = engine().polls();
     }
 
+    virtual void on_submit() noexcept override {
+        auto now = io_queue::clock_type::now();
+        _pclass.on_stage(_dnl, io_queue::priority_class_data::stage::sink, now - _ts);
+        _submitted = now;
+    }
+
     future<size_t> get_future() {
         return _pr.get_future();
     }
@@ -347,6 +536,20 @@ class queued_io_request : private internal::io_request {
         delete this;
     }
 
+    bool mergeable() const noexcept {
+        return !is_cancelled() && opcode() == operation::read;
+    }
+
+    const auto& read_op() const noexcept { return as<operation::read>(); }
+
+    // Like dispatch(), but the request is submitted by the caller as a
+    // part of a merged one, see io_merged_read
+    io_desc_read_write* dispatch_merged() noexcept {
+        _intent.maybe_dequeue();
+        _desc->dispatch();
+        return _desc.release();
+    }
+
     void cancel() noexcept {
         _ioq.cancel_request(*this);
         _desc.release()->cancel();
@@ -369,6 +572,92 @@ class queued_io_request : private internal::io_request {
     }
 };
 
+// A single read built from several queued reads of adjacent ranges of
+// the same file. The parts are read straight into their own buffers, and
+// reads fully contained in the merged range are copied from them.
+class io_merged_read final : public io_completion {
+    struct part {
+        io_desc_read_write* desc;
+        size_t offset;
+        size_t size;
+        char* copy_to; // nullptr for parts that are read in place
+    };
+    std::vector<part> _parts;
+    std::vector<::iovec> _iovs;
+    uint64_t _pos = 0;
+    size_t _size = 0;
+    bool _nowait_works = true;
+
+    void copy_out(char* to, size_t offset, size_t size) const noexcept {
+        for (const auto& iov : _iovs) {
+            if (size == 0) {
+                break;
+            }
+            if (offset >= iov.iov_len) {
+                offset -= iov.iov_len;
+                continue;
+            }
+            auto len = std::min(iov.iov_len - offset, size);
+            std::memcpy(to, static_cast<const char*>(iov.iov_base) + offset, len);
+            to += len;
+            size -= len;
+            offset = 0;
+        }
+    }
+
+public:
+    io_merged_read(uint64_t pos, unsigned max_parts) : _pos(pos) {
+        _parts.reserve(max_parts);
+        _iovs.reserve(max_parts);
+    }
+
+    uint64_t end() const noexcept { return _pos + _size; }
+
+    void add_part(io_desc_read_write* desc, const auto& op) noexcept {
+        _parts.push_back(part{desc, _size, op.size, nullptr});
+        _iovs.push_back(::iovec{op.addr, op.size});
+        _size += op.size;
+        _nowait_works &= op.nowait_works;
+    }
+
+    void add_copy(io_desc_read_write* desc, const auto& op) noexcept {
+        _parts.push_back(part{desc, op.pos - _pos, op.size, op.addr});
+    }
+
+    internal::io_request make_request(int fd) {
+        return internal::io_request::make_readv(fd, _pos, _iovs, _nowait_works);
+    }
+
+    virtual void on_submit() noexcept override {
+        for (const auto& p : _parts) {
+            p.desc->on_submit();
+        }
+    }
+
+    virtual void complete(size_t res) noexcept override {
+        auto part_result = [res] (const part& p) {
+            return res > p.offset ? std::min(res - p.offset, p.size) : 0;
+        };
+        // Copy before completing anything, the latter may release the buffers
+        for (const auto& p : _parts) {
+            if (p.copy_to != nullptr) {
+                copy_out(p.copy_to, p.offset, part_result(p));
+            }
+        }
+        for (const auto& p : _parts) {
+            p.desc->complete(part_result(p));
+        }
+        delete this;
+    }
+
+    virtual void set_exception(std::exception_ptr eptr) noexcept override {
+        for (const auto& p : _parts) {
+            p.desc->set_exception(eptr);
+        }
+        delete this;
+    }
+};
+
 namespace internal {
 
 priority_class::priority_class(const scheduling_group& sg) noexcept : _id(internal::scheduling_group_index(sg))
@@ -584,11 +873,62 @@ void io_queue::lower_stall_threshold() noexcept {
     _stall_threshold = std::max(_stall_threshold_min, new_threshold);
 }
 
+void io_queue::account_latency(std::chrono::duration<double> lat) noexcept {
+    if (_completion_latencies) {
+        _completion_latencies->add(std::chrono::duration_cast<std::chrono::microseconds>(lat).count());
+    }
+}
+
+void io_queue::report_rate_feedback() noexcept {
+    _group->_rate_controller->merge(*_completion_latencies, _throttled_polls);
+    _completion_latencies->clear();
+    _throttled_polls = 0;
+    if (this_shard_id() == _group->_allocated_on) {
+        _group->adjust_rate();
+    }
+}
+
+void io_group::adjust_rate() noexcept {
+    auto& rc = *_rate_controller;
+    auto throttled = rc.slide();
+    if (rc.total.count() < _config.adaptive_rate_min_samples) {
+        return;
+    }
+
+    rc.p99 = rc.total.quantile_upper_bound(0.99) * 1e-6;
+    auto goal = _latency_goal.count();
+    auto factor = rc.factor;
+    auto new_factor = factor;
+    if (rc.p99 > goal) {
+        new_factor = factor * std::max(goal / rc.p99, rate_controller::max_decrease_step);
+    } else if (rc.p99 < goal * rate_controller::increase_threshold && throttled > 0) {
+        new_factor = factor * rate_controller::increase_step;
+    }
+    new_factor = std::clamp(new_factor, _config.adaptive_rate_min_factor, _config.adaptive_rate_max_factor);
+    if (new_factor == factor) {
+        return;
+    }
+
+    if (new_factor > factor) {
+        rc.increases++;
+    } else {
+        rc.decreases++;
+    }
+    io_log.debug("{}: p99 latency {:.3f}ms (goal {:.3f}ms), rate factor {:.3f} -> {:.3f}", _config.mountpoint,
+            rc.p99 * 1000, goal * 1000, factor, new_factor);
+    rc.factor = new_factor;
+    for (auto& fg : _fgs) {
+        fg.set_rate_factor(new_factor);
+    }
+    rc.restart();
+}
+
 void
 io_queue::complete_request(io_desc_read_write& desc, std::chrono::duration<double> delay) noexcept {
     _requests_executing--;
     _requests_completed++;
     _streams[desc.stream()].fq.notify_request_finished(desc.capacity());
+    account_latency(delay);
 
     if (delay > _stall_threshold) {
         _stall_threshold *= 2;
@@ -616,6 +956,7 @@ io_queue::io_queue(io_group_ptr group, internal::io_sink& sink)
     })
     , _stall_threshold_min(std::max(get_config().stall_threshold, 1ms))
     , _stall_threshold(_stall_threshold_min)
+    , _rate_feedback_timer([this] { report_rate_feedback(); })
 {
     auto& cfg = get_config();
     if (cfg.duplex) {
@@ -637,6 +978,49 @@ io_queue::io_queue(io_group_ptr group, internal::io_sink& sink)
                 sm::description("Ratio of dispatch rate to completion rate. Is expected to be 1.0+ growing larger on reactor stalls or (!) disk problems"),
                 { owner_l, mnt_l, group_l }),
     });
+
+    if (cfg.merge_reads) {
+        _metric_groups.add_group("io_queue", {
+            sm::make_counter("merged_reads", [this] { return _merge_stats.merged_reads; },
+                    sm::description("Number of reads that were merged with adjacent ones"),
+                    { owner_l, mnt_l, group_l }),
+            sm::make_counter("merged_read_ios", [this] { return _merge_stats.ios; },
+                    sm::description("Number of IOs submitted in place of the merged reads"),
+                    { owner_l, mnt_l, group_l }),
+            sm::make_counter("merged_read_saved_bytes", [this] { return _merge_stats.saved_bytes; },
+                    sm::description("Bytes of merged reads served by copying from other reads' buffers instead of the disk"),
+                    { owner_l, mnt_l, group_l }),
+            sm::make_gauge("read_merge_ratio", [this] { return _merge_stats.ios ? double(_merge_stats.merged_reads) / _merge_stats.ios : 0.0; },
+                    sm::description("Average number of reads merged into one IO"),
+                    { owner_l, mnt_l, group_l }),
+        });
+    }
+
+    if (_group->_rate_controller) {
+        _completion_latencies = std::make_unique<internal::io_latency_histogram>();
+        _rate_feedback_timer.arm_periodic(cfg.adaptive_rate_period);
+
+        if (this_shard_id() == _group->_allocated_on) {
+            const auto& rc = *_group->_rate_controller;
+            _metric_groups.add_group("io_queue", {
+                sm::make_gauge("adaptive_rate_factor", [&rc] { return rc.factor; },
+                        sm::description("Throttler rate relative to the one derived from io-properties"),
+                        { owner_l, mnt_l, group_l }),
+                sm::make_gauge("adaptive_rate_p99_latency", [&rc] { return rc.p99; },
+                        sm::description("99th percentile of requests execution latency (seconds) the rate was last evaluated at"),
+                        { owner_l, mnt_l, group_l }),
+                sm::make_gauge("adaptive_rate_latency_goal", [this] { return _group->_latency_goal.count(); },
+                        sm::description("Latency goal (seconds) the rate is adjusted to meet"),
+                        { owner_l, mnt_l, group_l }),
+                sm::make_counter("adaptive_rate_increases", [&rc] { return rc.increases; },
+                        sm::description("Number of times the rate was increased because the disk is faster than the model"),
+                        { owner_l, mnt_l, group_l }),
+                sm::make_counter("adaptive_rate_decreases", [&rc] { return rc.decreases; },
+                        sm::description("Number of times the rate was decreased because latency exceeded the goal"),
+                        { owner_l, mnt_l, group_l }),
+            });
+        }
+    }
 }
 
 io_throttler::config io_group::configure_throttler(const io_queue::config& qcfg) noexcept {
@@ -653,7 +1037,7 @@ io_throttler::config io_group::configure_throttler(const io_queue::config& qcfg)
 }
 
 std::chrono::duration<double> io_group::io_latency_goal() const noexcept {
-    return _fgs.front().rate_limit_duration();
+    return _latency_goal;
 }
 
 io_group::io_group(io_queue::config io_cfg, unsigned nr_queues)
@@ -665,6 +1049,11 @@ io_group::io_group(io_queue::config io_cfg, unsigned nr_queues)
     if (_config.duplex) {
         _fgs.emplace_back(throttler_config, nr_queues);
     }
+    // Rate adjustments don't move the goal, so remember the initial one
+    _latency_goal = _fgs.front().rate_limit_duration();
+    if (_config.adaptive_rate) {
+        _rate_controller = std::make_unique<rate_controller>(_config.adaptive_rate_window);
+    }
 
     auto goal = io_latency_goal();
     auto lvl = goal > 1.1 * _config.rate_limit_duration ? log_level::warn : log_level::debug;
@@ -717,6 +1106,25 @@ io_queue::~io_queue() {
             }
         }
     }
+    for (unsigned id = 0; id < _priority_groups.size(); id++) {
+        if (_priority_groups[id]) {
+            unregister_group(id);
+        }
+    }
+}
+
+// Unregisters the group from the fair queues, nested groups go first
+void io_queue::unregister_group(unsigned id) {
+    for (unsigned nested = 0; nested < _priority_groups.size(); nested++) {
+        if (_priority_groups[nested] && _priority_groups[nested]->parent() == _priority_groups[id].get()) {
+            unregister_group(nested);
+        }
+    }
+    for (auto&& s : _streams) {
+        s.fq.unregister_priority_group(id);
+    }
+    _priority_groups[id].reset();
+    _group->release_group(id);
 }
 
 std::tuple<unsigned, sstring> get_class_info(io_priority_class_id pc) {
@@ -777,6 +1185,42 @@ std::vector<seastar::metrics::impl::metric_definition_impl> io_queue::priority_c
     });
 }
 
+std::vector<seastar::metrics::impl::metric_definition_impl> io_queue::priority_class_data::latency_metrics() {
+    namespace sm = seastar::metrics;
+    static constexpr std::array<const char*, nr_stages> stage_names = { "queue", "sink", "kernel" };
+    std::vector<sm::impl::metric_definition_impl> ret;
+    for (unsigned rw : { io_direction_read, io_direction_write }) {
+        for (unsigned st = 0; st < nr_stages; st++) {
+            ret.push_back(sm::make_histogram("stage_latency", sm::description("Histogram of the time (microseconds) requests spend "
+                            "queued in the scheduler (queue), dispatched but not yet submitted to the kernel (sink) and executing in the kernel (kernel)"),
+                    { sm::label("stage")(stage_names[st]), sm::label("direction")(rw == io_direction_read ? "read" : "write") },
+                    [this, rw, st] { return _stage_latency[rw][st].to_metrics_histogram(); }).aggregate({sm::shard_label}).set_skip_when_empty());
+        }
+    }
+    return ret;
+}
+
+std::vector<seastar::metrics::impl::metric_definition_impl> io_queue::priority_group_data::metrics() {
+    namespace sm = seastar::metrics;
+    return std::vector<sm::impl::metric_definition_impl>({
+            sm::make_counter("total_bytes", [this] {
+                    return _rwstat[io_direction_read].bytes + _rwstat[io_direction_write].bytes;
+                }, sm::description("Total bytes passed in the queue by the group's classes")),
+            sm::make_counter("total_operations", [this] {
+                    return _rwstat[io_direction_read].ops + _rwstat[io_direction_write].ops;
+                }, sm::description("Total operations passed in the queue by the group's classes")),
+            sm::make_counter("total_read_bytes", _rwstat[io_direction_read].bytes,
+                    sm::description("Total read bytes passed in the queue by the group's classes")),
+            sm::make_counter("total_read_ops", _rwstat[io_direction_read].ops,
+                    sm::description("Total read operations passed in the queue by the group's classes")),
+            sm::make_counter("total_write_bytes", _rwstat[io_direction_write].bytes,
+                    sm::description("Total write bytes passed in the queue by the group's classes")),
+            sm::make_counter("total_write_ops", _rwstat[io_direction_write].ops,
+                    sm::description("Total write operations passed in the queue by the group's classes")),
+            sm::make_gauge("shares", _shares, sm::description("current amount of shares"))
+    });
+}
+
 void io_queue::register_stats(sstring name, priority_class_data& pc) {
     namespace sm = seastar::metrics;
     seastar::metrics::metric_groups new_metrics;
@@ -792,6 +1236,11 @@ void io_queue::register_stats(sstring name, priority_class_data& pc) {
         metrics.emplace_back(std::move(m));
     }
 
+    for (auto&& m : pc.latency_metrics()) {
+        m(owner_l)(mnt_l)(class_l)(group_l);
+        metrics.emplace_back(std::move(m));
+    }
+
     for (auto&& s : _streams) {
         for (auto&& m : s.metrics(pc)) {
             m(owner_l)(mnt_l)(class_l)(group_l)(sm::label("stream")(s.fq.label()));
@@ -825,11 +1274,15 @@ io_queue::priority_class_data& io_queue::find_or_create_class(internal::priority
         //
         // This conveys all the information we need and allows one to easily group all classes from
         // the same I/O queue (by filtering by shard)
+        auto group = class_group(pc);
         for (auto&& s : _streams) {
-            s.fq.register_priority_class(id, shares);
+            s.fq.register_priority_class(id, shares, group);
         }
         auto& pg = _group->find_or_create_class(pc);
         auto pc_data = std::make_unique<priority_class_data>(pc, shares, *this, pg);
+        if (group) {
+            pc_data->set_parent(_priority_groups[*group].get());
+        }
         register_stats(name, *pc_data);
 
         _priority_classes[id] = std::move(pc_data);
@@ -837,6 +1290,34 @@ io_queue::priority_class_data& io_queue::find_or_create_class(internal::priority
     return *_priority_classes[id];
 }
 
+std::optional<unsigned> io_queue::class_group(internal::priority_class pc) const noexcept {
+    return pc.id() < _class_groups.size() ? _class_groups[pc.id()] : std::nullopt;
+}
+
+io_group::priority_class_data& io_group::find_or_create_group(unsigned id) {
+    std::lock_guard _(_lock);
+
+    if (id >= _priority_groups.size()) {
+        _priority_groups.resize(id + 1);
+    }
+    if (!_priority_groups[id]) {
+        _priority_groups[id] = std::make_unique<priority_class_data>();
+    }
+    _priority_groups[id]->group_users++;
+
+    return *_priority_groups[id];
+}
+
+// A group id can be reused by a new group, which must not inherit the
+// bandwidth limit of the destroyed one
+void io_group::release_group(unsigned id) noexcept {
+    std::lock_guard _(_lock);
+
+    if (--_priority_groups[id]->group_users == 0) {
+        _priority_groups[id].reset();
+    }
+}
+
 io_group::priority_class_data& io_group::find_or_create_class(internal::priority_class pc) {
     std::lock_guard _(_lock);
 
@@ -926,6 +1407,14 @@ future<size_t> io_queue::queue_request(internal::priority_class pc, io_direction
 
     std::vector<internal::io_request::part> parts;
     lw_shared_ptr<std::vector<future<size_t>>> p;
+    // The parts are dispatched independently and don't inherit the linked
+    // sync, so it has to be issued once they're all done
+    int sync_fd = -1;
+    if (req.linked_fdatasync()) {
+        sync_fd = req.opcode() == internal::io_request::operation::write
+                ? req.as<internal::io_request::operation::write>().fd
+                : req.as<internal::io_request::operation::writev>().fd;
+    }
 
     try {
         parts = req.split(max_length);
@@ -944,7 +1433,7 @@ future<size_t> io_queue::queue_request(internal::priority_class pc, io_direction
         p->push_back(std::move(f));
     }
 
-    return when_all(p->begin(), p->end()).then([p, max_length] (auto results) {
+    auto written = when_all(p->begin(), p->end()).then([p, max_length] (auto results) {
         bool prev_ok = true;
         size_t total = 0;
         std::exception_ptr ex;
@@ -974,6 +1463,15 @@ future<size_t> io_queue::queue_request(internal::priority_class pc, io_direction
             return make_ready_future<size_t>(0);
         }
     });
+
+    if (sync_fd == -1) {
+        return written;
+    }
+    return written.then([sync_fd] (size_t total) {
+        return engine().fdatasync(sync_fd).then([total] {
+            return total;
+        });
+    });
 }
 
 future<size_t> io_queue::submit_io_read(internal::priority_class pc, size_t len, internal::io_request req, io_intent* intent, iovec_keeper iovs) noexcept {
@@ -1023,6 +1521,7 @@ void io_queue::poll_io_queue() {
 
             auto result = st.grab_capacity(ent->capacity(), available);
             if (result == stream::grab_result::stop) {
+                _throttled_polls++;
                 break;
             }
             if (result == stream::grab_result::again) {
@@ -1030,7 +1529,16 @@ void io_queue::poll_io_queue() {
             }
 
             st.fq.pop_front();
-            queued_io_request::from_fq_entry(*ent).dispatch();
+            auto& req = queued_io_request::from_fq_entry(*ent);
+            if (get_config().merge_reads && req.mergeable()) {
+                try {
+                    _mergeable_reads.push_back(&req);
+                    continue;
+                } catch (...) {
+                    // Dispatch it alone
+                }
+            }
+            req.dispatch();
         }
 
         SEASTAR_ASSERT(available.ready_tokens == 0);
@@ -1042,6 +1550,72 @@ void io_queue::poll_io_queue() {
         // countermeasure for that), so we just discard the tokens. There's no harm in it, IO cancellation
         // can't have resource-saving guarantees anyway.
     }
+
+    if (!_mergeable_reads.empty()) {
+        dispatch_merged_reads();
+    }
+}
+
+// Reads popped from the fair queues at the same poll are submitted together
+// anyway, so the order between them doesn't matter. Sort them by position and
+// turn every run of adjacent ones into a single readv. Reads that fall into
+// the range of the run are served from its buffers without touching the disk.
+void io_queue::dispatch_merged_reads() noexcept {
+    std::sort(_mergeable_reads.begin(), _mergeable_reads.end(), [] (const queued_io_request* a, const queued_io_request* b) {
+        const auto& ao = a->read_op();
+        const auto& bo = b->read_op();
+        return std::tie(ao.fd, ao.pos, bo.size) < std::tie(bo.fd, bo.pos, ao.size);
+    });
+
+    const size_t max_length = _group->_max_request_length[io_direction_read];
+    auto it = _mergeable_reads.begin();
+    while (it != _mergeable_reads.end()) {
+        const int fd = (*it)->read_op().fd;
+        const uint64_t pos = (*it)->read_op().pos;
+        // Whether the read can join the merged range [pos, end)
+        auto joins = [fd, pos, max_length] (const queued_io_request* r, uint64_t end) {
+            const auto& o = r->read_op();
+            return o.fd == fd && (o.pos + o.size <= end || (o.pos == end && end + o.size <= pos + max_length));
+        };
+        auto next = std::next(it);
+        if (next == _mergeable_reads.end() || !joins(*next, pos + (*it)->read_op().size)) {
+            (*it)->dispatch();
+            it = next;
+            continue;
+        }
+
+        io_merged_read* merged;
+        try {
+            merged = new io_merged_read(pos, max_merged_reads);
+        } catch (...) {
+            // Just go the usual way
+            for (; it != next; ++it) {
+                (*it)->dispatch();
+            }
+            continue;
+        }
+
+        unsigned nr = 0;
+        for (; it != _mergeable_reads.end() && nr < max_merged_reads && joins(*it, merged->end()); ++it, ++nr) {
+            const auto& o = (*it)->read_op();
+            if (o.pos + o.size <= merged->end()) {
+                merged->add_copy((*it)->dispatch_merged(), o);
+                _merge_stats.saved_bytes += o.size;
+            } else {
+                merged->add_part((*it)->dispatch_merged(), o);
+            }
+            delete *it;
+        }
+
+        _merge_stats.merged_reads += nr;
+        _merge_stats.ios++;
+        _queued_requests -= nr;
+        _requests_executing += nr;
+        _requests_dispatched += nr;
+        _sink.submit(merged, merged->make_request(fd));
+    }
+
+    _mergeable_reads.clear();
 }
 
 void io_queue::submit_request(io_desc_read_write* desc, internal::io_request req) noexcept {
@@ -1106,6 +1680,89 @@ io_queue::rename_priority_class(internal::priority_class pc, sstring new_name) {
     }
 }
 
+void io_queue::create_priority_group(unsigned id, sstring name, uint32_t shares, std::optional<unsigned> parent) {
+    if (id >= _priority_groups.size()) {
+        _priority_groups.resize(id + 1);
+    }
+    if (_priority_groups[id]) {
+        // Several devices may share one queue
+        return;
+    }
+
+    for (auto&& s : _streams) {
+        s.fq.register_priority_group(id, shares, parent);
+    }
+    auto& pg = _group->find_or_create_group(id);
+    auto pg_data = std::make_unique<priority_group_data>(id, shares, parent ? _priority_groups[*parent].get() : nullptr, *this, pg);
+
+    namespace sm = seastar::metrics;
+    auto owner_l = sm::shard_label(this_shard_id());
+    auto mnt_l = sm::label("mountpoint")(mountpoint());
+    auto group_name_l = sm::label("group")(name);
+    auto group_l = sm::label("iogroup")(to_sstring(_group->_allocated_on));
+    std::vector<sm::metric_definition> metrics;
+    for (auto&& m : pg_data->metrics()) {
+        m(owner_l)(mnt_l)(group_name_l)(group_l);
+        metrics.emplace_back(std::move(m));
+    }
+    pg_data->metric_groups.add_group("io_queue_group", std::move(metrics));
+
+    _priority_groups[id] = std::move(pg_data);
+}
+
+void io_queue::destroy_priority_group(unsigned id) {
+    if (id < _priority_groups.size() && _priority_groups[id]) {
+        for (auto&& s : _streams) {
+            s.fq.unregister_priority_group(id);
+        }
+        _priority_groups[id].reset();
+        _group->release_group(id);
+    }
+}
+
+void io_queue::update_shares_for_group(unsigned id, uint32_t new_shares) {
+    auto& pg = *_priority_groups.at(id);
+    pg.update_shares(new_shares);
+    for (auto&& s : _streams) {
+        s.fq.update_shares_for_group(id, new_shares);
+    }
+}
+
+future<> io_queue::update_bandwidth_for_group(unsigned id, uint64_t new_bandwidth) {
+    return futurize_invoke([this, id, new_bandwidth] {
+        if (_group->_allocated_on == this_shard_id()) {
+            _priority_groups.at(id)->update_bandwidth(new_bandwidth);
+        }
+    });
+}
+
+void io_queue::set_class_group(internal::priority_class pc, std::optional<unsigned> group) {
+    auto id = pc.id();
+    if (id >= _class_groups.size()) {
+        _class_groups.resize(id + 1);
+    }
+    _class_groups[id] = group;
+
+    if (id < _priority_classes.size() && _priority_classes[id]) {
+        for (auto&& s : _streams) {
+            s.fq.set_class_group(id, group);
+        }
+        _priority_classes[id]->set_parent(group ? _priority_groups[*group].get() : nullptr);
+    }
+}
+
+void io_queue::throttle_priority_group(const priority_group_data& pg) noexcept {
+    for (auto&& s : _streams) {
+        s.fq.unplug_group(pg.id());
+    }
+}
+
+void io_queue::unthrottle_priority_group(const priority_group_data& pg) noexcept {
+    for (auto&& s : _streams) {
+        s.fq.plug_group(pg.id());
+    }
+}
+
 void io_queue::throttle_priority_class(const priority_class_data& pc) noexcept {
     for (auto&& s : _streams) {
         s.fq.unplug_class(pc.fq_class());
@@ -102,6 +102,7 @@ module;
 #include <boost/intrusive/list.hpp>
 #include <sys/mman.h>
 #include <sys/syscall.h>
+#include <sys/vfs.h>
 #include <linux/mempolicy.h>
 
 #endif // !defined(SEASTAR_DEFAULT_ALLOCATOR)
@@ -252,7 +253,8 @@ std::atomic<bool> use_transparent_hugepages = true;
 namespace alloc_stats {
 
 enum class types { allocs, frees, cross_cpu_frees, reclaims, large_allocs, failed_allocs,
-    foreign_mallocs, foreign_frees, foreign_cross_frees, enum_size };
+    foreign_mallocs, foreign_frees, foreign_cross_frees, cross_cpu_free_batches, cross_cpu_batched_frees,
+    relocations, compacted_bytes, enum_size };
 
 using stats_array = std::array<uint64_t, static_cast<std::size_t>(types::enum_size)>;
 using stats_atomic_array = std::array<std::atomic_uint64_t, static_cast<std::size_t>(types::enum_size)>;
@@ -452,6 +454,8 @@ class small_pool {
     ~small_pool();
     inline void* allocate();
     void deallocate(void* object);
+    // Return a chain of objects, linked through free_object::next, at once
+    void deallocate_batch(free_object* head, free_object* tail, unsigned count);
     unsigned object_size() const { return _object_size; }
     /// See _sampled_pool
     bool is_sampled_pool() const {
@@ -465,10 +469,19 @@ class small_pool {
     static constexpr unsigned size_to_idx(unsigned size);
     static constexpr unsigned idx_to_size(unsigned idx);
     allocation_site_ptr& alloc_site_holder(void* ptr);
+    unsigned pages_in_use() const { return _pages_in_use; }
+    // Moves live objects out of the sparsest spans into the free slots of
+    // the densest ones, for as long as those have room for them, and frees
+    // the emptied spans. Returns the number of objects moved.
+    size_t compact(const relocatable_class::relocate_fn& relocate, size_t max_relocations);
+    void trim_free_list(unsigned goal);
 private:
     inline void* pop_free();
     [[gnu::noinline]] void* add_more_objects();
     void trim_free_list();
+    unsigned objects_per_span(const page& span) const { return span.span_size * page_size / _object_size; }
+    size_t evacuate(page& span, const relocatable_class::relocate_fn& relocate,
+            std::vector<page*>::iterator& target, std::vector<page*>::iterator targets_end);
     friend seastar::internal::log_buf::inserter_iterator do_dump_memory_diagnostics(seastar::internal::log_buf::inserter_iterator);
 };
 
@@ -544,10 +557,39 @@ static_assert(object_size_with_alloc_site(max_small_allocation - sizeof(allocati
 static_assert(object_size_with_alloc_site(max_small_allocation - sizeof(allocation_site_ptr) - 2) == max_small_allocation - 2, "");
 #endif
 
+// Links objects queued on their owner's xcpu_freelist. The link has
+// cross_cpu_magazine_tag set when the item it points to is a magazine.
 struct cross_cpu_free_item {
     cross_cpu_free_item* next;
 };
 
+static constexpr uintptr_t cross_cpu_magazine_tag = 1;
+
+// A batch of small objects of one size class, freed on a shard other than
+// their owner, and handed back with a single push onto the owner's
+// xcpu_freelist. The header is laid over the first object freed, so only
+// pools with objects at least this large are batched.
+struct cross_cpu_magazine {
+    cross_cpu_free_item item;
+    free_object* objects; // the rest of the batch, chained through free_object::next
+    free_object* tail;
+    unsigned count; // including the object holding the header
+};
+
+// Magazines being filled by the current shard, a few per destination shard,
+// selected by size class.
+struct cross_cpu_magazines {
+    static constexpr unsigned slots_per_cpu = 4;
+    static constexpr unsigned capacity = 64;
+    struct slot {
+        small_pool* pool = nullptr;
+        cross_cpu_magazine* magazine = nullptr;
+    };
+    std::array<std::array<slot, slots_per_cpu>, max_cpus> slots;
+    std::array<bool, max_cpus> has_pending = {};
+    boost::container::static_vector<unsigned, max_cpus> pending_cpus;
+};
+
 struct cpu_pages {
     small_pool_array<false> small_pools;
     uint32_t min_free_pages = 20000000 / page_size;
@@ -560,9 +602,14 @@ struct cpu_pages {
     unsigned cpu_id = -1U;
     std::function<void (std::function<void ()>)> reclaim_hook;
     std::vector<reclaimer*> reclaimers;
+    std::vector<relocatable_class::impl*> relocatable_classes;
+    size_t next_class_to_compact = 0;
     static constexpr unsigned nr_span_lists = 32;
     page_list free_spans[nr_span_lists];  // contains aligned spans with span_size == 2^idx
+    size_t hugetlb_2m_bytes = 0; // bytes of the arena backed by explicit huge pages
+    size_t hugetlb_1g_bytes = 0;
     alignas(seastar::cache_line_size) std::atomic<cross_cpu_free_item*> xcpu_freelist;
+    cross_cpu_magazines* xcpu_magazines = nullptr; // set up by configure()
     static std::atomic<unsigned> cpu_id_gen;
     static cpu_pages* all_cpus[max_cpus];
     union asu {
@@ -573,6 +620,10 @@ struct cpu_pages {
         alloc_sites_type alloc_sites;
     } asu;
     allocation_site_ptr alloc_site_list_head = nullptr; // For easy traversal of asu.alloc_sites from scylla-gdb.py
+    // Sites without live objects are kept at the end of the list, in the
+    // order they lost their last object, starting at first_freed_alloc_site.
+    allocation_site_ptr alloc_site_list_tail = nullptr;
+    allocation_site_ptr first_freed_alloc_site = nullptr;
     sampler heap_prof_sampler;
     small_pool_array<true> sampled_small_pools;
 
@@ -602,6 +653,10 @@ struct cpu_pages {
     static void do_foreign_free(void* ptr);
     void shrink(void* ptr, size_t new_size);
     static void free_cross_cpu(unsigned cpu_id, void* ptr);
+    static void push_cross_cpu(unsigned cpu_id, cross_cpu_free_item* item, uintptr_t tag);
+    bool add_to_cross_cpu_magazine(unsigned cpu_id, void* ptr);
+    void flush_cross_cpu_magazine(unsigned cpu_id, cross_cpu_magazines::slot& slot);
+    bool flush_cross_cpu_magazines();
     bool drain_cross_cpu_freelist();
     size_t object_size(void* ptr);
 
@@ -623,6 +678,11 @@ struct cpu_pages {
     void warn_large_allocation(size_t size);
     allocation_site_ptr add_alloc_site(size_t allocated_size);
     void remove_alloc_site(allocation_site_ptr alloc_site, size_t deallocated_size);
+    void link_alloc_site_front(allocation_site_ptr alloc_site);
+    void link_alloc_site_back(allocation_site_ptr alloc_site);
+    void unlink_alloc_site(allocation_site_ptr alloc_site);
+    void erase_alloc_site(allocation_site_ptr alloc_site);
+    bool evict_freed_alloc_site();
     bool maybe_sample(size_t size);
     bool definitely_sample(size_t size);
     memory::memory_layout memory_layout();
@@ -853,8 +913,16 @@ allocation_site_ptr
 cpu_pages::add_alloc_site(size_t allocated_size) {
     allocation_site_ptr alloc_site = get_allocation_site();
     if (alloc_site) {
+        auto sample_size = heap_prof_sampler.sample_size(allocated_size);
+        if (alloc_site->count == 0) {
+            // Not a candidate for eviction any more
+            unlink_alloc_site(alloc_site);
+            link_alloc_site_front(alloc_site);
+        }
         ++alloc_site->count;
-        alloc_site->size += heap_prof_sampler.sample_size(allocated_size);
+        alloc_site->size += sample_size;
+        ++alloc_site->total_count;
+        alloc_site->total_size += sample_size;
     }
 
     return alloc_site;
@@ -867,22 +935,76 @@ cpu_pages::remove_alloc_site(allocation_site_ptr alloc_site, size_t deallocated_
         auto sample_size = heap_prof_sampler.sample_size(deallocated_size);
         // prevent underflow in case sample rate changed
         alloc_site->size -= alloc_site->size < sample_size ? alloc_site->size : sample_size;
+        // Sites without live objects are kept for their totals, until
+        // evict_freed_alloc_site() needs the room.
         if (alloc_site->count == 0) {
-            if (alloc_site->prev) {
-                alloc_site->prev->next = alloc_site->next;
-            }
-            if (alloc_site->next) {
-                alloc_site->next->prev = alloc_site->prev;
-            }
-            if (alloc_site_list_head == alloc_site) {
-                alloc_site_list_head = alloc_site->next;
-            }
-
-            asu.alloc_sites.erase(*alloc_site);
+            unlink_alloc_site(alloc_site);
+            link_alloc_site_back(alloc_site);
         }
     }
 }
 
+void
+cpu_pages::link_alloc_site_front(allocation_site_ptr alloc_site) {
+    alloc_site->prev = nullptr;
+    alloc_site->next = alloc_site_list_head;
+    if (alloc_site_list_head) {
+        alloc_site_list_head->prev = alloc_site;
+    } else {
+        alloc_site_list_tail = alloc_site;
+    }
+    alloc_site_list_head = alloc_site;
+}
+
+void
+cpu_pages::link_alloc_site_back(allocation_site_ptr alloc_site) {
+    alloc_site->next = nullptr;
+    alloc_site->prev = alloc_site_list_tail;
+    if (alloc_site_list_tail) {
+        alloc_site_list_tail->next = alloc_site;
+    } else {
+        alloc_site_list_head = alloc_site;
+    }
+    alloc_site_list_tail = alloc_site;
+    if (!first_freed_alloc_site) {
+        first_freed_alloc_site = alloc_site;
+    }
+}
+
+void
+cpu_pages::unlink_alloc_site(allocation_site_ptr alloc_site) {
+    if (first_freed_alloc_site == alloc_site) {
+        first_freed_alloc_site = alloc_site->next;
+    }
+    if (alloc_site->prev) {
+        alloc_site->prev->next = alloc_site->next;
+    } else {
+        alloc_site_list_head = alloc_site->next;
+    }
+    if (alloc_site->next) {
+        alloc_site->next->prev = alloc_site->prev;
+    } else {
+        alloc_site_list_tail = alloc_site->prev;
+    }
+    alloc_site->next = alloc_site->prev = nullptr;
+}
+
+void
+cpu_pages::erase_alloc_site(allocation_site_ptr alloc_site) {
+    unlink_alloc_site(alloc_site);
+    asu.alloc_sites.erase(*alloc_site);
+}
+
+bool
+cpu_pages::evict_freed_alloc_site() {
+    // The site that has gone without live objects the longest
+    if (!first_freed_alloc_site) {
+        return false;
+    }
+    erase_alloc_site(first_freed_alloc_site);
+    return true;
+}
+
 [[gnu::always_inline]]
 inline bool
 cpu_pages::maybe_sample(size_t size) {
@@ -945,7 +1067,8 @@ allocation_site_ptr get_allocation_site() {
     allocation_site new_alloc_site;
     new_alloc_site.backtrace = get_backtrace();
     if (cpu_mem.asu.alloc_sites.size() >= 1000
-        && cpu_mem.asu.alloc_sites.find(new_alloc_site) == cpu_mem.asu.alloc_sites.end()) {
+        && cpu_mem.asu.alloc_sites.find(new_alloc_site) == cpu_mem.asu.alloc_sites.end()
+        && !cpu_mem.evict_freed_alloc_site()) {
         // Drop sample for now. Could do something smarter like dropping a
         // current one at random but needs more work in remove_alloc_site as we
         // might then have allocations for which the allocsite is no longer
@@ -955,11 +1078,7 @@ allocation_site_ptr get_allocation_site() {
     auto insert_result = cpu_mem.asu.alloc_sites.insert(std::move(new_alloc_site));
     allocation_site_ptr alloc_site = &*insert_result.first;
     if (insert_result.second) {
-        alloc_site->next = cpu_mem.alloc_site_list_head;
-        if (cpu_mem.alloc_site_list_head) {
-            cpu_mem.alloc_site_list_head->prev = alloc_site;
-        }
-        cpu_mem.alloc_site_list_head = alloc_site;
+        cpu_mem.link_alloc_site_front(alloc_site);
     }
     return alloc_site;
 }
@@ -1029,13 +1148,83 @@ void cpu_pages::free_cross_cpu(unsigned cpu_id, void* ptr) {
         // should only happen for boost unit-tests.
         return;
     }
-    auto p = reinterpret_cast<cross_cpu_free_item*>(ptr);
+    if (is_reactor_thread && cpu_mem.xcpu_magazines && cpu_mem.add_to_cross_cpu_magazine(cpu_id, ptr)) {
+        alloc_stats::increment_local(alloc_stats::types::cross_cpu_frees);
+        return;
+    }
+    push_cross_cpu(cpu_id, reinterpret_cast<cross_cpu_free_item*>(ptr), 0);
+    alloc_stats::increment(alloc_stats::types::cross_cpu_frees);
+}
+
+void cpu_pages::push_cross_cpu(unsigned cpu_id, cross_cpu_free_item* item, uintptr_t tag) {
+    auto p = reinterpret_cast<cross_cpu_free_item*>(reinterpret_cast<uintptr_t>(item) | tag);
     auto& list = all_cpus[cpu_id]->xcpu_freelist;
     auto old = list.load(std::memory_order_relaxed);
     do {
-        p->next = old;
+        item->next = old;
     } while (!list.compare_exchange_weak(old, p, std::memory_order_release, std::memory_order_relaxed));
-    alloc_stats::increment(alloc_stats::types::cross_cpu_frees);
+}
+
+bool cpu_pages::add_to_cross_cpu_magazine(unsigned cpu_id, void* ptr) {
+    // The owner only replaces its page array while configuring itself,
+    // before any of its memory can reach other shards, and a span's pool
+    // doesn't change while it has live objects.
+    auto pool = all_cpus[cpu_id]->to_page(ptr)->pool;
+    if (!pool || pool->is_sampled_pool() || pool->object_size() < sizeof(cross_cpu_magazine)) {
+        return false;
+    }
+    auto& mags = *xcpu_magazines;
+    auto& slot = mags.slots[cpu_id][reinterpret_cast<uintptr_t>(pool) / sizeof(small_pool) % cross_cpu_magazines::slots_per_cpu];
+    if (slot.magazine && slot.pool != pool) {
+        flush_cross_cpu_magazine(cpu_id, slot);
+    }
+    if (!slot.magazine) {
+        slot.pool = pool;
+        slot.magazine = new (ptr) cross_cpu_magazine{{nullptr}, nullptr, nullptr, 1};
+        if (!mags.has_pending[cpu_id]) {
+            mags.has_pending[cpu_id] = true;
+            mags.pending_cpus.push_back(cpu_id);
+        }
+        return true;
+    }
+    auto mag = slot.magazine;
+    auto obj = reinterpret_cast<free_object*>(ptr);
+    obj->next = mag->objects;
+    mag->objects = obj;
+    if (!mag->tail) {
+        mag->tail = obj;
+    }
+    if (++mag->count == cross_cpu_magazines::capacity) {
+        flush_cross_cpu_magazine(cpu_id, slot);
+    }
+    return true;
+}
+
+void cpu_pages::flush_cross_cpu_magazine(unsigned cpu_id, cross_cpu_magazines::slot& slot) {
+    auto mag = std::exchange(slot.magazine, nullptr);
+    if (!live_cpus[cpu_id].load(std::memory_order_relaxed)) {
+        return;
+    }
+    alloc_stats::increment_local(alloc_stats::types::cross_cpu_free_batches);
+    alloc_stats::increment_local(alloc_stats::types::cross_cpu_batched_frees, mag->count);
+    push_cross_cpu(cpu_id, &mag->item, cross_cpu_magazine_tag);
+}
+
+bool cpu_pages::flush_cross_cpu_magazines() {
+    if (!xcpu_magazines || xcpu_magazines->pending_cpus.empty()) {
+        return false;
+    }
+    auto& mags = *xcpu_magazines;
+    for (auto cpu_id : mags.pending_cpus) {
+        for (auto& slot : mags.slots[cpu_id]) {
+            if (slot.magazine) {
+                flush_cross_cpu_magazine(cpu_id, slot);
+            }
+        }
+        mags.has_pending[cpu_id] = false;
+    }
+    mags.pending_cpus.clear();
+    return true;
 }
 
 bool cpu_pages::drain_cross_cpu_freelist() {
@@ -1044,9 +1233,21 @@ bool cpu_pages::drain_cross_cpu_freelist() {
     }
     auto p = xcpu_freelist.exchange(nullptr, std::memory_order_acquire);
     while (p) {
-        auto n = p->next;
-        alloc_stats::increment_local(alloc_stats::types::frees);
-        free(p);
+        auto tag = reinterpret_cast<uintptr_t>(p) & cross_cpu_magazine_tag;
+        auto item = reinterpret_cast<cross_cpu_free_item*>(reinterpret_cast<uintptr_t>(p) & ~cross_cpu_magazine_tag);
+        auto n = item->next;
+        if (tag) {
+            auto mag = reinterpret_cast<cross_cpu_magazine*>(item);
+            auto count = mag->count;
+            auto head = reinterpret_cast<free_object*>(mag);
+            auto tail = mag->tail ? mag->tail : head;
+            head->next = mag->objects;
+            alloc_stats::increment_local(alloc_stats::types::frees, count);
+            to_page(head)->pool->deallocate_batch(head, tail, count);
+        } else {
+            alloc_stats::increment_local(alloc_stats::types::frees);
+            free(item);
+        }
         p = n;
     }
     return true;
@@ -1454,6 +1655,16 @@ small_pool::deallocate(void* object) {
     }
 }
 
+void
+small_pool::deallocate_batch(free_object* head, free_object* tail, unsigned count) {
+    tail->next = _free;
+    _free = head;
+    _free_count += count;
+    if (_free_count >= _max_free) {
+        trim_free_list();
+    }
+}
+
 void*
 small_pool::add_more_objects() {
     auto goal = (_min_free + _max_free) / 2;
@@ -1502,7 +1713,11 @@ small_pool::add_more_objects() {
 
 void
 small_pool::trim_free_list() {
-    auto goal = (_min_free + _max_free) / 2;
+    trim_free_list((_min_free + _max_free) / 2);
+}
+
+void
+small_pool::trim_free_list(unsigned goal) {
     while (_free && _free_count > goal) {
         auto obj = _free;
         _free = _free->next;
@@ -1523,6 +1738,95 @@ small_pool::trim_free_list() {
     }
 }
 
+size_t
+small_pool::compact(const relocatable_class::relocate_fn& relocate, size_t max_relocations) {
+    auto& cm = get_cpu_mem();
+    // Return all free objects to their spans, so that a span's free list
+    // tells which of its objects are live.
+    trim_free_list(0);
+    // Full spans are not on the list; they stay where they are.
+    std::vector<page*> spans;
+    while (!_span_list.empty()) {
+        spans.push_back(&_span_list.front(cm.pages));
+        _span_list.pop_front(cm.pages);
+    }
+    std::sort(spans.begin(), spans.end(), [this] (page* a, page* b) {
+        return size_t(a->nr_small_alloc) * objects_per_span(*b) > size_t(b->nr_small_alloc) * objects_per_span(*a);
+    });
+    size_t in_spans = 0;
+    for (auto span : spans) {
+        in_spans += span->nr_small_alloc;
+    }
+    // Keep the densest spans whose free slots can take the objects of all
+    // the others. Relocation targets only come from those slots, so no new
+    // span is allocated and no object lands in a span being emptied.
+    size_t room = 0;
+    size_t moved = in_spans;
+    auto victims = spans.begin();
+    while (victims != spans.end() && room < moved) {
+        room += objects_per_span(**victims) - (*victims)->nr_small_alloc;
+        moved -= (*victims)->nr_small_alloc;
+        _span_list.push_front(cm.pages, **victims++);
+    }
+    size_t relocated = 0;
+    auto target = spans.begin();
+    for (auto it = spans.end(); it != victims; ) {
+        auto& span = **--it;
+        if (relocated < max_relocations) {
+            relocated += evacuate(span, relocate, target, victims);
+        } else {
+            _span_list.push_front(cm.pages, span);
+        }
+    }
+    alloc_stats::increment_local(alloc_stats::types::relocations, relocated);
+    return relocated;
+}
+
+size_t
+small_pool::evacuate(page& span, const relocatable_class::relocate_fn& relocate,
+        std::vector<page*>::iterator& target, std::vector<page*>::iterator targets_end) {
+    auto& cm = get_cpu_mem();
+    auto base = cm.mem() + (&span - cm.pages) * page_size;
+    auto nr_objects = objects_per_span(span);
+    std::vector<bool> is_free(nr_objects);
+    for (auto obj = span.freelist; obj; obj = obj->next) {
+        is_free[(reinterpret_cast<char*>(obj) - base) / _object_size] = true;
+    }
+    size_t relocated = 0;
+    for (unsigned i = 0; i < nr_objects; ++i) {
+        if (is_free[i]) {
+            continue;
+        }
+        while (target != targets_end && !(*target)->freelist) {
+            ++target;
+        }
+        if (target == targets_end) {
+            break;
+        }
+        auto& to_span = **target;
+        auto to = to_span.freelist;
+        to_span.freelist = to->next;
+        if (++to_span.nr_small_alloc == objects_per_span(to_span)) {
+            // Full spans are not on the list
+            _span_list.erase(cm.pages, to_span);
+        }
+        auto from = reinterpret_cast<free_object*>(base + i * _object_size);
+        relocate(from, to);
+        from->next = span.freelist;
+        span.freelist = from;
+        --span.nr_small_alloc;
+        ++relocated;
+    }
+    if (span.nr_small_alloc == 0) {
+        _pages_in_use -= span.span_size;
+        alloc_stats::increment_local(alloc_stats::types::compacted_bytes, span.span_size * page_size);
+        cm.free_span(&span - cm.pages, span.span_size);
+    } else {
+        _span_list.push_front(cm.pages, span);
+    }
+    return relocated;
+}
+
 void
 abort_on_underflow(size_t size) {
     if (std::make_signed_t<size_t>(size) < 0) {
@@ -1815,6 +2119,87 @@ reclaimer::~reclaimer() {
     r.erase(std::find(r.begin(), r.end(), this));
 }
 
+struct relocatable_class::impl {
+    small_pool pool;
+    relocate_fn relocate;
+    // Compaction passes to skip; doubles each time a pass frees nothing
+    unsigned skip = 0;
+    unsigned backoff = 0;
+    impl(unsigned object_size, relocate_fn relocate)
+        : pool(object_size, false), relocate(std::move(relocate)) {}
+};
+
+relocatable_class::relocatable_class(size_t object_size, relocate_fn relocate) {
+    if (object_size > max_small_allocation) {
+        throw std::invalid_argument(format("relocatable object size {} exceeds {}", object_size, max_small_allocation));
+    }
+    // match the rounding of the regular small pools
+    object_size = std::max(object_size, sizeof(free_object));
+    if (object_size > alignof(std::max_align_t)) {
+        object_size = align_up(object_size, alignof(std::max_align_t));
+    }
+    _impl = new impl(object_size, std::move(relocate));
+    get_cpu_mem().relocatable_classes.push_back(_impl);
+}
+
+relocatable_class::~relocatable_class() {
+    auto& r = get_cpu_mem().relocatable_classes;
+    r.erase(std::find(r.begin(), r.end(), _impl));
+    _impl->pool.trim_free_list(0);
+    // Spans still in use point at the pool; keep it for them
+    if (!_impl->pool.pages_in_use()) {
+        delete _impl;
+    }
+}
+
+void* relocatable_class::allocate() {
+    alloc_stats::increment_local(alloc_stats::types::allocs);
+    auto p = _impl->pool.allocate();
+    if (!p) {
+        on_allocation_failure(_impl->pool.object_size());
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void relocatable_class::free(void* obj) noexcept {
+    alloc_stats::increment_local(alloc_stats::types::frees);
+    _impl->pool.deallocate(obj);
+}
+
+size_t relocatable_class::object_size() const noexcept {
+    return _impl->pool.object_size();
+}
+
+bool compact_relocatable(size_t max_relocations) {
+    auto& cm = get_cpu_mem();
+    auto& classes = cm.relocatable_classes;
+    size_t relocated = 0;
+    bool freed = false;
+    // Round robin, so one busy class doesn't starve the others
+    for (size_t i = 0; i < classes.size() && relocated < max_relocations; ++i) {
+        auto& c = *classes[cm.next_class_to_compact++ % classes.size()];
+        if (c.skip) {
+            --c.skip;
+            continue;
+        }
+        auto pages_in_use = c.pool.pages_in_use();
+        relocated += c.pool.compact(c.relocate, max_relocations - relocated);
+        if (c.pool.pages_in_use() < pages_in_use) {
+            freed = true;
+            c.backoff = 0;
+        } else {
+            // Taking the free list apart and sorting the spans is not
+            // free; don't do it every period for a class that is as
+            // compact as it gets
+            c.backoff = std::min(std::max(2 * c.backoff, 1u), 64u);
+            c.skip = c.backoff;
+        }
+    }
+    // Only worth coming back right away if this pass made progress
+    return freed && relocated >= max_relocations;
+}
+
 void set_large_allocation_warning_threshold(size_t threshold) {
     get_cpu_mem().large_allocation_warning_threshold = threshold;
 }
@@ -1848,10 +2233,152 @@ static long mbind(void *addr,
     );
 }
 
+static void account_hugetlb_memory(size_t hp_size, size_t bytes) {
+    auto& cm = get_cpu_mem();
+    if (hp_size == size_t(1) << 30) {
+        cm.hugetlb_1g_bytes += bytes;
+    } else if (hp_size == size_t(2) << 20) {
+        cm.hugetlb_2m_bytes += bytes;
+    }
+}
+
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23
+#endif
+
+// Backs ranges of a shard's arena with anonymous hugetlb pages, largest page
+// size first, each piece bound to the NUMA node the shard's memory was
+// assigned on. The per-node huge page pools are finite, so a piece the node
+// cannot supply retries with the next smaller page size and finally with
+// normal pages; a page size is not tried again once it has failed.
+class hugetlb_backing {
+    struct node_range {
+        size_t end; // offset from the start of the arena
+        unsigned nodeid;
+    };
+    char* _arena;
+    std::vector<node_range> _nodes; // empty unless binding to nodes
+    std::vector<size_t> _page_sizes; // descending
+public:
+    hugetlb_backing(char* arena, const std::vector<resource::memory>& m, bool bind, size_t largest_page_size)
+            : _arena(arena) {
+        if (bind) {
+            size_t pos = 0;
+            for (auto&& x : m) {
+                pos += x.bytes;
+                _nodes.push_back({pos, x.nodeid});
+            }
+        }
+        for (size_t hp_size = largest_page_size; hp_size >= huge_page_size; hp_size /= 512) {
+            _page_sizes.push_back(hp_size);
+        }
+    }
+    mmap_area allocate(void* where, size_t how_much);
+    // Huge pages are bound to their node when mapped, and so are the normal
+    // pages filling in for them
+    bool binds_nodes() const noexcept {
+        return !_nodes.empty();
+    }
+private:
+    const node_range* node_of(char* p) const;
+    bool try_map(char* p, size_t len, size_t hp_size);
+    bool populate(char* p, size_t len);
+};
+
+auto hugetlb_backing::node_of(char* p) const -> const node_range* {
+    auto it = std::find_if(_nodes.begin(), _nodes.end(), [off = size_t(p - _arena)] (const node_range& n) {
+        return off < n.end;
+    });
+    return it != _nodes.end() ? &*it : nullptr;
+}
+
+bool hugetlb_backing::try_map(char* p, size_t len, size_t hp_size) {
+    auto r = ::mmap(p, len, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_HUGETLB | (log2ceil(hp_size) << MAP_HUGE_SHIFT),
+            -1, 0);
+    if (r == MAP_FAILED) {
+        return false;
+    }
+    if (auto node = node_of(p)) {
+        unsigned long nodemask = 1UL << node->nodeid;
+        seastar::memory::mbind(p, len, MPOL_BIND, &nodemask, std::numeric_limits<unsigned long>::digits, 0);
+    }
+    // Fault everything in now: touching a hugetlb page the node cannot
+    // supply later on would be a SIGBUS rather than an allocation failure.
+    if (!populate(p, len)) {
+        return false;
+    }
+    account_hugetlb_memory(hp_size, len);
+    return true;
+}
+
+bool hugetlb_backing::populate(char* p, size_t len) {
+    static bool have_populate_write = true;
+    if (have_populate_write) {
+        if (::madvise(p, len, MADV_POPULATE_WRITE) == 0) {
+            return true;
+        }
+        if (errno != EINVAL) {
+            return false;
+        }
+        // Older than Linux 5.14
+        have_populate_write = false;
+    }
+    if (_nodes.empty()) {
+        // A private hugetlb mapping reserves its pages when it is created,
+        // only a node binding can leave faults short of pages.
+        return true;
+    }
+    // mlock() faults the pages in and fails instead of raising a SIGBUS
+    if (::mlock(p, len) != 0) {
+        return false;
+    }
+    ::munlock(p, len);
+    return true;
+}
+
+mmap_area hugetlb_backing::allocate(void* where, size_t how_much) {
+    auto p = static_cast<char*>(where);
+    auto end = p + how_much;
+    while (p != end) {
+        auto piece_end = p;
+        for (auto it = _page_sizes.begin(); it != _page_sizes.end() && piece_end == p;) {
+            auto hp_size = *it;
+            auto limit = end;
+            if (auto node = node_of(p)) {
+                limit = std::min(limit, _arena + node->end);
+            }
+            limit = align_down(limit, hp_size);
+            if (p != align_down(p, hp_size) || limit <= p) {
+                ++it;
+            } else if (try_map(p, limit - p, hp_size)) {
+                piece_end = limit;
+            } else {
+                seastar_memory_logger.warn("unable to allocate {} bytes of {}MB huge pages, falling back to smaller pages",
+                        limit - p, hp_size >> 20);
+                it = _page_sizes.erase(it);
+            }
+        }
+        if (piece_end == p) {
+            // Normal pages up to where the smallest remaining huge page size could start again
+            piece_end = _page_sizes.empty() ? end : std::min(end, align_up(p + 1, _page_sizes.back()));
+            allocate_anonymous_memory(p, piece_end - p).release();
+            maybe_enable_transparent_hugepages(p, piece_end - p);
+            if (auto node = node_of(p)) {
+                unsigned long nodemask = 1UL << node->nodeid;
+                seastar::memory::mbind(p, piece_end - p, MPOL_PREFERRED, &nodemask, std::numeric_limits<unsigned long>::digits, 0);
+            }
+        }
+        p = piece_end;
+    }
+    return mmap_area(static_cast<char*>(where), mmap_deleter{how_much});
+}
+
 internal::numa_layout
 configure(std::vector<resource::memory> m, bool mbind,
         bool transparent_hugepages,
-        optional<std::string> hugetlbfs_path) {
+        optional<std::string> hugetlbfs_path,
+        size_t hugetlb_page_size) {
     // we need to make sure cpu_mem is initialize since configure calls cpu_mem.resize
     // and we might reach configure without ever allocating, hence without ever calling
     // cpu_pages::initialize.
@@ -1871,22 +2398,40 @@ configure(std::vector<resource::memory> m, bool mbind,
         total += x.bytes;
     }
     allocate_system_memory_fn sys_alloc = allocate_anonymous_memory;
+    bool bound_by_backing = false;
     if (hugetlbfs_path) {
         // std::function is copyable, but file_desc is not, so we must use
         // a shared_ptr to allow sys_alloc to be copied around
         auto fdp = make_lw_shared<file_desc>(file_desc::temporary(*hugetlbfs_path));
-        sys_alloc = [fdp] (void* where, size_t how_much) {
-            return allocate_hugetlbfs_memory(*fdp, where, how_much);
+        struct statfs sfs;
+        auto hp_size = ::fstatfs(fdp->get(), &sfs) == 0 ? size_t(sfs.f_bsize) : 0;
+        sys_alloc = [fdp, hp_size] (void* where, size_t how_much) {
+            auto ret = allocate_hugetlbfs_memory(*fdp, where, how_much);
+            account_hugetlb_memory(hp_size, how_much);
+            return ret;
+        };
+        get_cpu_mem().replace_memory_backing(sys_alloc);
+    } else if (hugetlb_page_size) {
+        auto backing = make_lw_shared<hugetlb_backing>(get_cpu_mem().mem(), m, mbind, hugetlb_page_size);
+        bound_by_backing = backing->binds_nodes();
+        sys_alloc = [backing] (void* where, size_t how_much) {
+            return backing->allocate(where, how_much);
         };
         get_cpu_mem().replace_memory_backing(sys_alloc);
     }
     get_cpu_mem().resize(total, sys_alloc);
+    if (!get_cpu_mem().xcpu_magazines) {
+        // Lives as long as the shard; objects may still be freed after it is gone
+        get_cpu_mem().xcpu_magazines = new cross_cpu_magazines;
+    }
     size_t pos = 0;
     for (auto&& x : m) {
         unsigned long nodemask = 1UL << x.nodeid;
         if (mbind) {
             auto start = get_cpu_mem().mem() + pos;
-            auto r = seastar::memory::mbind(
+            // A preferred policy here would replace the MPOL_BIND the huge
+            // pages were mapped with
+            auto r = bound_by_backing ? 0 : seastar::memory::mbind(
                             start, x.bytes,
                             MPOL_PREFERRED,
                             &nodemask, std::numeric_limits<unsigned long>::digits,
@@ -1913,7 +2458,10 @@ statistics stats() {
     return statistics{alloc_stats::get(alloc_stats::types::allocs), alloc_stats::get(alloc_stats::types::frees), alloc_stats::get(alloc_stats::types::cross_cpu_frees),
         cpu_mem.nr_pages * page_size, cpu_mem.nr_free_pages * page_size, alloc_stats::get(alloc_stats::types::reclaims), alloc_stats::get(alloc_stats::types::large_allocs),
         alloc_stats::get(alloc_stats::types::failed_allocs), alloc_stats::get(alloc_stats::types::foreign_mallocs), alloc_stats::get(alloc_stats::types::foreign_frees),
-        alloc_stats::get(alloc_stats::types::foreign_cross_frees)};
+        alloc_stats::get(alloc_stats::types::foreign_cross_frees),
+        alloc_stats::get(alloc_stats::types::cross_cpu_free_batches), alloc_stats::get(alloc_stats::types::cross_cpu_batched_frees),
+        alloc_stats::get(alloc_stats::types::relocations), alloc_stats::get(alloc_stats::types::compacted_bytes),
+        cpu_mem.hugetlb_2m_bytes, cpu_mem.hugetlb_1g_bytes};
 }
 
 size_t free_memory() {
@@ -1921,7 +2469,9 @@ size_t free_memory() {
 }
 
 bool drain_cross_cpu_freelist() {
-    return get_cpu_mem().drain_cross_cpu_freelist();
+    auto& cm = get_cpu_mem();
+    auto flushed = cm.flush_cross_cpu_magazines();
+    return cm.drain_cross_cpu_freelist() || flushed;
 }
 
 memory_layout get_memory_layout() {
@@ -2199,16 +2749,31 @@ static bool try_trigger_error_injector() {
     }
 }
 
+static bool has_live_objects(const allocation_site& site) {
+    return site.count != 0;
+}
+
 std::vector<allocation_site> sampled_memory_profile() {
     disable_backtrace_temporarily dbt;
-    std::vector<allocation_site> ret(get_cpu_mem().asu.alloc_sites.begin(), get_cpu_mem().asu.alloc_sites.end());
+    std::vector<allocation_site> ret;
+    std::copy_if(get_cpu_mem().asu.alloc_sites.begin(), get_cpu_mem().asu.alloc_sites.end(), std::back_inserter(ret), has_live_objects);
     return ret;
 }
 
 size_t sampled_memory_profile(allocation_site* output, size_t size) {
-    auto to_copy = std::min(size, get_cpu_mem().asu.alloc_sites.size());
-    std::copy_n(get_cpu_mem().asu.alloc_sites.begin(), to_copy, output);
-    return to_copy;
+    size_t copied = 0;
+    for (auto it = get_cpu_mem().asu.alloc_sites.begin(); it != get_cpu_mem().asu.alloc_sites.end() && copied < size; ++it) {
+        if (has_live_objects(*it)) {
+            output[copied++] = *it;
+        }
+    }
+    return copied;
+}
+
+std::vector<allocation_site> sampled_allocation_profile() {
+    disable_backtrace_temporarily dbt;
+    std::vector<allocation_site> ret(get_cpu_mem().asu.alloc_sites.begin(), get_cpu_mem().asu.alloc_sites.end());
+    return ret;
 }
 
 }
@@ -2620,6 +3185,10 @@ size_t sampled_memory_profile(allocation_site* output, size_t size) {
     return 0;
 }
 
+std::vector<allocation_site> sampled_allocation_profile() {
+    return {};
+}
+
 scoped_heap_profiling::scoped_heap_profiling(size_t sample_rate) noexcept {
     set_heap_profiling_sampling_rate(sample_rate); // let it print the warning
 }
@@ -2646,13 +3215,46 @@ reclaimer::reclaimer(std::function<reclaiming_result (request)> reclaim, reclaim
 reclaimer::~reclaimer() {
 }
 
+struct relocatable_class::impl {
+    size_t object_size;
+};
+
+relocatable_class::relocatable_class(size_t object_size, relocate_fn)
+    : _impl(new impl{object_size}) {
+}
+
+relocatable_class::~relocatable_class() {
+    delete _impl;
+}
+
+void* relocatable_class::allocate() {
+    auto p = ::malloc(_impl->object_size);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void relocatable_class::free(void* obj) noexcept {
+    ::free(obj);
+}
+
+size_t relocatable_class::object_size() const noexcept {
+    return _impl->object_size;
+}
+
+bool compact_relocatable(size_t) {
+    return false;
+}
+
 void set_reclaim_hook(std::function<void (std::function<void ()>)> hook) {
 }
 
 internal::numa_layout
 configure(std::vector<resource::memory> m, bool mbind,
         bool transparent_hugepages,
-        std::optional<std::string> hugepages_path) {
+        std::optional<std::string> hugepages_path,
+        size_t hugetlb_page_size) {
     return {};
 }
 
@@ -2660,7 +3262,7 @@ void configure_minimal()
 {}
 
 statistics stats() {
-    return statistics{0, 0, 0, 1 << 30, 1 << 30, 0, 0, 0, 0, 0, 0};
+    return statistics{0, 0, 0, 1 << 30, 1 << 30, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
 }
 
 size_t free_memory() {
@@ -0,0 +1,182 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*
+ * Copyright (C) 2025 ScyllaDB
+ */
+
+#include <seastar/core/pprof.hh>
+#include <google/protobuf/io/gzip_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include "proto/profile.pb.h"
+
+#include <seastar/core/coroutine.hh>
+#include <seastar/core/memory.hh>
+#include <seastar/core/smp.hh>
+#include <seastar/coroutine/maybe_yield.hh>
+#include <seastar/http/exception.hh>
+#include <seastar/util/backtrace.hh>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+
+namespace seastar {
+
+namespace pprof {
+namespace pp = perftools::profiles;
+
+namespace {
+
+class profile_builder {
+    pp::Profile _profile;
+    std::unordered_map<std::string, int64_t> _strings;
+    std::unordered_map<const shared_object*, uint64_t> _mappings;
+    std::unordered_map<uintptr_t, uint64_t> _locations; // by address
+public:
+    explicit profile_builder(size_t sample_rate);
+    void add(unsigned shard, const memory::allocation_site& site);
+    sstring serialize() const;
+private:
+    int64_t string_index(const std::string& s);
+    uint64_t mapping_id(const shared_object* so);
+    uint64_t location_id(const frame& f);
+};
+
+profile_builder::profile_builder(size_t sample_rate) {
+    string_index(""); // index 0 must be the empty string
+    for (auto [type, unit] : {std::pair{"alloc_objects", "count"}, {"alloc_space", "bytes"}, {"inuse_objects", "count"}, {"inuse_space", "bytes"}}) {
+        auto* st = _profile.add_sample_type();
+        st->set_type(string_index(type));
+        st->set_unit(string_index(unit));
+    }
+    _profile.set_default_sample_type(string_index("inuse_space"));
+    _profile.mutable_period_type()->set_type(string_index("space"));
+    _profile.mutable_period_type()->set_unit(string_index("bytes"));
+    _profile.set_period(sample_rate);
+    _profile.set_time_nanos(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+int64_t profile_builder::string_index(const std::string& s) {
+    auto [it, inserted] = _strings.try_emplace(s, _strings.size());
+    if (inserted) {
+        _profile.add_string_table(s);
+    }
+    return it->second;
+}
+
+uint64_t profile_builder::mapping_id(const shared_object* so) {
+    auto [it, inserted] = _mappings.try_emplace(so, _mappings.size() + 1);
+    if (inserted) {
+        auto* m = _profile.add_mapping();
+        m->set_id(it->second);
+        m->set_memory_start(so->begin);
+        m->set_memory_limit(so->end);
+        // The executable itself is reported without a name
+        std::error_code ec;
+        m->set_filename(string_index(so->name.empty() ? std::filesystem::read_symlink("/proc/self/exe", ec).string() : std::string(so->name)));
+    }
+    return it->second;
+}
+
+uint64_t profile_builder::location_id(const frame& f) {
+    auto address = f.so->begin + f.addr;
+    auto [it, inserted] = _locations.try_emplace(address, _locations.size() + 1);
+    if (inserted) {
+        auto* l = _profile.add_location();
+        l->set_id(it->second);
+        l->set_mapping_id(mapping_id(f.so));
+        l->set_address(address);
+    }
+    return it->second;
+}
+
+void profile_builder::add(unsigned shard, const memory::allocation_site& site) {
+    auto* s = _profile.add_sample();
+    for (auto& f : site.backtrace.frames()) {
+        s->add_location_id(location_id(f));
+    }
+    s->add_value(site.total_count);
+    s->add_value(site.total_size);
+    s->add_value(site.count);
+    s->add_value(site.size);
+    auto* l = s->add_label();
+    l->set_key(string_index("shard"));
+    l->set_num(shard);
+}
+
+sstring profile_builder::serialize() const {
+    std::string out;
+    google::protobuf::io::StringOutputStream os(&out);
+    google::protobuf::io::GzipOutputStream gz(&os);
+    if (!_profile.SerializeToZeroCopyStream(&gz) || !gz.Close()) {
+        throw std::runtime_error("failed to serialize heap profile");
+    }
+    return sstring(out);
+}
+
+class heap_profile_handler : public httpd::handler_base {
+public:
+    future<std::unique_ptr<http::reply>> handle(const sstring& path,
+            std::unique_ptr<http::request> req, std::unique_ptr<http::reply> rep) override {
+        std::optional<unsigned> shard;
+        if (auto s = req->get_query_param("shard"); !s.empty()) {
+            try {
+                shard = std::stoul(s);
+            } catch (...) {
+                throw httpd::bad_param_exception(fmt::format("Invalid shard {}", s));
+            }
+            if (*shard >= smp::count) {
+                throw httpd::bad_param_exception(fmt::format("Invalid shard {}, there are {} shards", s, smp::count));
+            }
+        }
+        rep->write_body("bin", co_await heap_profile(shard));
+        co_return std::move(rep);
+    }
+};
+
+}
+
+future<sstring> heap_profile(std::optional<unsigned> shard) {
+    profile_builder builder(memory::get_heap_profiling_sample_rate());
+    auto first = shard.value_or(0);
+    auto last = shard ? *shard + 1 : smp::count;
+    for (auto s = first; s < last; ++s) {
+        auto sites = co_await smp::submit_to(s, [] {
+            return memory::sampled_allocation_profile();
+        });
+        for (auto& site : sites) {
+            builder.add(s, site);
+        }
+        co_await coroutine::maybe_yield();
+    }
+    co_return builder.serialize();
+}
+
+future<> add_heap_profile_routes(httpd::http_server& server, config ctx) {
+    server._routes.put(httpd::GET, ctx.path, new heap_profile_handler());
+    return make_ready_future<>();
+}
+
+future<> add_heap_profile_routes(distributed<httpd::http_server>& server, config ctx) {
+    return server.invoke_on_all([ctx] (httpd::http_server& s) {
+        return add_heap_profile_routes(s, ctx);
+    });
+}
+
+}
+}
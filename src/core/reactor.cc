@@ -154,9 +154,11 @@ module seastar;
 #include <seastar/core/with_scheduling_group.hh>
 #include <seastar/core/internal/buffer_allocator.hh>
 #include <seastar/core/internal/io_desc.hh>
+#include <seastar/core/internal/busy_poll.hh>
 #include <seastar/core/internal/uname.hh>
 #include <seastar/core/internal/stall_detector.hh>
 #include <seastar/core/internal/run_in_background.hh>
+#include <seastar/core/work_stealing.hh>
 #include <seastar/net/native-stack.hh>
 #include <seastar/net/packet.hh>
 #include <seastar/net/posix-stack.hh>
@@ -265,6 +267,38 @@ void reactor::rename_queues(internal::priority_class pc, sstring new_name) {
     }
 }
 
+void reactor::create_io_priority_group(unsigned id, sstring name, uint32_t shares, std::optional<unsigned> parent) {
+    for (auto&& q : _io_queues) {
+        q.second->create_priority_group(id, name, shares, parent);
+    }
+}
+
+void reactor::destroy_io_priority_group(unsigned id) {
+    for (auto&& q : _io_queues) {
+        q.second->destroy_priority_group(id);
+    }
+}
+
+void reactor::update_shares_for_io_priority_group(unsigned id, uint32_t shares) {
+    for (auto&& q : _io_queues) {
+        q.second->update_shares_for_group(id, shares);
+    }
+}
+
+future<> reactor::update_bandwidth_for_io_priority_group(unsigned id, uint64_t bandwidth) {
+    return smp::invoke_on_all([id, bandwidth = bandwidth / _num_io_groups] {
+        return parallel_for_each(engine()._io_queues, [id, bandwidth] (auto& queue) {
+            return queue.second->update_bandwidth_for_group(id, bandwidth);
+        });
+    });
+}
+
+void reactor::set_io_priority_group(internal::priority_class pc, std::optional<unsigned> group) {
+    for (auto&& q : _io_queues) {
+        q.second->set_class_group(pc, group);
+    }
+}
+
 future<std::tuple<pollable_fd, socket_address>>
 reactor::do_accept(pollable_fd_state& listenfd) {
     return readable_or_writeable(listenfd).then([this, &listenfd] () mutable {
@@ -525,6 +559,37 @@ future<size_t> pollable_fd_state::sendmsg(struct msghdr* msg) {
     });
 }
 
+future<size_t> pollable_fd_state::recvmmsg(struct mmsghdr* msgs, unsigned vlen) {
+    maybe_no_more_recv();
+    return engine().readable(*this).then([this, msgs, vlen] {
+        auto r = fd.recvmmsg(msgs, vlen, 0);
+        if (!r) {
+            return recvmmsg(msgs, vlen);
+        }
+        // See the comment about speculation in recvmsg(). A full batch
+        // suggests there is more to read.
+        if (*r == vlen) {
+            speculate_epoll(EPOLLIN);
+        }
+        return make_ready_future<size_t>(*r);
+    });
+}
+
+future<size_t> pollable_fd_state::sendmmsg(struct mmsghdr* msgs, unsigned vlen) {
+    maybe_no_more_send();
+    return engine().writeable(*this).then([this, msgs, vlen] {
+        auto r = fd.sendmmsg(msgs, vlen, 0);
+        if (!r) {
+            return sendmmsg(msgs, vlen);
+        }
+        // See the comment about speculation in sendmsg().
+        if (*r == vlen) {
+            speculate_epoll(EPOLLOUT);
+        }
+        return make_ready_future<size_t>(*r);
+    });
+}
+
 future<size_t> pollable_fd_state::sendto(socket_address addr, const void* buf, size_t len) {
     maybe_no_more_send();
     return engine().writeable(*this).then([this, buf, len, addr] () mutable {
@@ -947,6 +1012,18 @@ reactor::task_queue::task_queue(unsigned id, sstring name, sstring shortname, fl
     rename(name, shortname);
 }
 
+void reactor::task_queue::maybe_sample_delay(task* t) noexcept {
+    if (_delay_sampled_task == nullptr && ++_tasks_queued % task_sample_period == 0) {
+        _delay_sampled_task = t;
+        _delay_sample_ts = now();
+    }
+}
+
+void reactor::task_queue::on_sampled_task_run() noexcept {
+    _task_sched_delay.add(std::chrono::duration_cast<std::chrono::microseconds>(now() - _delay_sample_ts).count());
+    _delay_sampled_task = nullptr;
+}
+
 void
 reactor::task_queue::register_stats() {
     seastar::metrics::metric_groups new_metrics;
@@ -979,6 +1056,10 @@ reactor::task_queue::register_stats() {
                 return _time_spent_on_task_quota_violations / 1ms;
         }, sm::description("Total amount in milliseconds we were in violation of the task quota"),
            {group_label}),
+        sm::make_histogram("task_runtime", sm::description("Histogram of the execution time of tasks (microseconds), sampled"),
+                {group_label}, [this] { return _task_runtime.to_metrics_histogram(); }).set_skip_when_empty(),
+        sm::make_histogram("task_schedule_delay", sm::description("Histogram of the time tasks wait in the queue before they run (microseconds), sampled"),
+                {group_label}, [this] { return _task_sched_delay.to_metrics_histogram(); }).set_skip_when_empty(),
     });
 
     register_net_metrics_for_scheduling_group(new_metrics, _id, group_label);
@@ -1035,6 +1116,118 @@ struct reactor::task_queue::indirect_compare {
     }
 };
 
+namespace internal {
+
+unsigned busy_poll_sockets::socket_napi_id(const pollable_fd_state& fd) noexcept {
+    unsigned napi_id = 0;
+    socklen_t len = sizeof(napi_id);
+    if (::getsockopt(fd.fd.get(), SOL_SOCKET, SO_INCOMING_NAPI_ID, &napi_id, &len) != 0) {
+        return 0;
+    }
+    return napi_id;
+}
+
+busy_poll_sockets::busy_poll_sockets(napi_id_func napi_id_of)
+    : _napi_id_of(std::move(napi_id_of)) {
+}
+
+void busy_poll_sockets::file(pollable_fd_state& fd, unsigned napi_id) {
+    auto q = std::ranges::find(_queues, napi_id, &napi_queue::napi_id);
+    if (q == _queues.end()) {
+        q = _queues.emplace(_queues.end(), napi_id);
+    }
+    q->fds.push_back(fd);
+}
+
+void busy_poll_sockets::assign() {
+    bool assigned = false;
+    for (unsigned i = 0; i < assign_batch && !_unassigned.empty(); i++) {
+        auto& fd = _unassigned.front();
+        _unassigned.pop_front();
+        auto napi_id = _napi_id_of(fd);
+        if (napi_id == 0) {
+            _unassigned.push_back(fd);
+            continue;
+        }
+        file(fd, napi_id);
+        assigned = true;
+    }
+    std::erase_if(_queues, [] (const napi_queue& q) { return q.fds.empty(); });
+    _assign_period = assigned ? min_assign_period : std::min<lowres_clock::duration>(_assign_period * 2, max_assign_period);
+}
+
+// Flows move between NIC queues, e.g. when RSS is rebalanced. Check the
+// socket each queue is polled through next; as they take turns, all of
+// them are checked over time.
+void busy_poll_sockets::recheck() {
+    fd_list moved;
+    for (auto& q : _queues) {
+        if (q.fds.empty()) {
+            continue;
+        }
+        auto& fd = q.fds.front();
+        if (_napi_id_of(fd) != q.napi_id) {
+            q.fds.pop_front();
+            moved.push_back(fd);
+        }
+    }
+    while (!moved.empty()) {
+        auto& fd = moved.front();
+        moved.pop_front();
+        if (auto napi_id = _napi_id_of(fd)) {
+            file(fd, napi_id);
+        } else {
+            _unassigned.push_back(fd);
+        }
+    }
+    std::erase_if(_queues, [] (const napi_queue& q) { return q.fds.empty(); });
+}
+
+void busy_poll_sockets::add(pollable_fd_state& fd) {
+    if (!fd.busy_poll_link.is_linked()) {
+        _unassigned.push_back(fd);
+        _assign_period = min_assign_period;
+    }
+}
+
+bool busy_poll_sockets::poll(lowres_clock::time_point now) {
+    if (!_unassigned.empty() && now >= _next_assign) {
+        assign();
+        _next_assign = now + _assign_period;
+    }
+    if (now >= _next_recheck) {
+        recheck();
+        _next_recheck = now + recheck_period;
+    }
+    for (auto& q : _queues) {
+        // With nothing queued on the socket, a non-blocking receive
+        // polls the NIC queue once. Packets it finds are delivered to
+        // their sockets, and the backend reports them as readable.
+        // A socket with unread data returns it without polling, so the
+        // sockets take turns and the next one is tried.
+        for (unsigned i = 0; i < max_peeks && !q.fds.empty(); i++) {
+            auto& fd = q.fds.front();
+            q.fds.splice(q.fds.end(), q.fds, q.fds.begin());
+            char c;
+            if (::recv(fd.fd.get(), &c, 1, MSG_PEEK | MSG_DONTWAIT) < 0) {
+                break;
+            }
+        }
+    }
+    return false;
+}
+
+size_t busy_poll_sockets::queued(unsigned napi_id) const {
+    auto q = std::ranges::find(_queues, napi_id, &napi_queue::napi_id);
+    return q == _queues.end() ? 0 : q->fds.size();
+}
+
+size_t busy_poll_sockets::unassigned() const {
+    return _unassigned.size();
+}
+
+}
+
 reactor::reactor(std::shared_ptr<seastar::smp> smp, alien::instance& alien, unsigned id, reactor_backend_selector rbs, reactor_config cfg)
     : _smp(std::move(smp))
     , _alien(alien)
@@ -1562,6 +1755,22 @@ reactor::posix_listen(socket_address sa, listen_options opts) {
         fd.setsockopt(SOL_SOCKET, SO_RCVBUF, *opts.so_rcvbuf);
     }
 
+    if (opts.busy_poll && !sa.is_af_unix()) {
+        // Inherited by the accepted sockets
+        fd.setsockopt(SOL_SOCKET, SO_BUSY_POLL, int(opts.busy_poll->count()));
+        fd.setsockopt(SOL_SOCKET, SO_PREFER_BUSY_POLL, 1);
+    }
+
+    if (opts.lba == server_socket::load_balancing_algorithm::incoming_cpu && !sa.is_af_unix()) {
+        auto cpus = smp().shard_to_cpu_mapping();
+        if (!cpus.empty()) {
+            // Join the other shards' sockets, and have the kernel prefer
+            // this one for connections processed on our cpu
+            fd.setsockopt(SOL_SOCKET, SO_REUSEPORT, 1);
+            fd.setsockopt(SOL_SOCKET, SO_INCOMING_CPU, int(cpus[this_shard_id()]));
+        }
+    }
+
     try {
         fd.bind(sa.u.sa, sa.length());
 
@@ -1597,9 +1806,21 @@ void pollable_fd_state::maybe_no_more_send() {
 }
 
 void pollable_fd_state::forget() {
+    busy_poll_link.unlink();
     engine()._backend->forget(*this);
 }
 
+void reactor::enable_busy_poll(pollable_fd_state& fd) {
+    if (!_busy_poll_sockets) {
+        _busy_poll_sockets = std::make_unique<internal::busy_poll_sockets>();
+    }
+    _busy_poll_sockets->add(fd);
+}
+
+void pollable_fd::enable_busy_poll() {
+    engine().enable_busy_poll(*_s);
+}
+
 void intrusive_ptr_release(pollable_fd_state* fd) {
     if (!--fd->_refs) {
         fd->forget();
@@ -1727,73 +1948,121 @@ size_t sanitize_iovecs(std::vector<iovec>& iov, size_t disk_alignment) noexcept
 
 }
 
+static bool is_tmpfs(int fd) {
+    struct ::statfs buf;
+    auto r = ::fstatfs(fd, &buf);
+    if (r == -1) {
+        return false;
+    }
+    return buf.f_type == internal::fs_magic::tmpfs;
+}
+
+static void set_extent_size_hint(int fd, const file_open_options& options) {
+    fsxattr attr = {};
+    int r = ::ioctl(fd, XFS_IOC_FSGETXATTR, &attr);
+    // xfs delayed allocation is disabled when extent size hints are present.
+    // This causes tons of xfs log fsyncs. Given that extent size hints are
+    // unneeded when delayed allocation is available (which is the case
+    // when not using O_DIRECT), disable them.
+    //
+    // Ignore error; may be !xfs, and just a hint anyway
+    if (r != -1) {
+        attr.fsx_xflags |= XFS_XFLAG_EXTSIZE;
+        attr.fsx_extsize = std::min(options.extent_allocation_size_hint,
+                            file_open_options::max_extent_allocation_size_hint);
+
+        attr.fsx_extsize = align_up<uint32_t>(attr.fsx_extsize, file_open_options::min_extent_size_hint_alignment);
+
+        // Ignore error; may be !xfs, and just a hint anyway
+        ::ioctl(fd, XFS_IOC_FSSETXATTR, &attr);
+    }
+}
+
+// Same as the thread pool version in reactor::open_file_dma(), with the
+// open() and fstat() issued by the reactor backend. fcntl() and fstatfs()
+// are cheap enough to call from the reactor thread; setting the extent size
+// hint is an XFS transaction, so that is still sent to the thread pool.
+static future<syscall_result_extra<struct stat>>
+open_file_via_backend(reactor_backend& backend, thread_pool& tp, const reactor_config& cfg, sstring name, int open_flags, const file_open_options& options) {
+    struct stat st = {};
+    auto mode = static_cast<mode_t>(options.create_permissions);
+    auto opened = co_await backend.openat(name, open_flags, mode);
+    if (opened.result == -1) {
+        co_return syscall_result_extra<struct stat>(-1, opened.error, st);
+    }
+    int fd = opened.result;
+    auto close_fd = defer([fd] () noexcept { ::close(fd); });
+    int o_direct_flag = cfg.kernel_page_cache ? 0 : O_DIRECT;
+    int r = ::fcntl(fd, F_SETFL, open_flags | o_direct_flag);
+    if (r == -1 && cfg.strict_o_direct) {
+        auto error = errno;
+        if (!is_tmpfs(fd)) {
+            co_return syscall_result_extra<struct stat>(-1, error, st);
+        }
+    }
+    if (options.extent_allocation_size_hint && !cfg.kernel_page_cache) {
+        co_await tp.submit<syscall_result<int>>(
+                internal::thread_pool_submit_reason::file_open, [fd, &options] {
+            set_extent_size_hint(fd, options);
+            return wrap_syscall<int>(0);
+        });
+    }
+    auto sr = co_await backend.statx(fd, "", AT_EMPTY_PATH);
+    if (sr.result == -1) {
+        co_return sr;
+    }
+    close_fd.cancel();
+    co_return syscall_result_extra<struct stat>(fd, 0, sr.extra);
+}
+
 future<file>
 reactor::open_file_dma(std::string_view nameref, open_flags flags, file_open_options options) noexcept {
     return do_with(static_cast<int>(flags), std::move(options), [this, nameref] (auto& open_flags, file_open_options& options) {
         sstring name(nameref);
-        return _thread_pool->submit<syscall_result_extra<struct stat>>(
-                internal::thread_pool_submit_reason::file_operation, [this, name, &open_flags, &options, strict_o_direct = _cfg.strict_o_direct, bypass_fsync = _cfg.bypass_fsync] () mutable {
-            // We want O_DIRECT, except in three cases:
-            //   - tmpfs (which doesn't support it, but works fine anyway)
-            //   - strict_o_direct == false (where we forgive it being not supported)
-            //   - kernel_page_cache == true (where we disable it for short-lived test processes)
-            // Because open() with O_DIRECT will fail, we open it without O_DIRECT, try
-            // to update it to O_DIRECT with fcntl(), and if that fails, see if we
-            // can forgive it.
-            auto is_tmpfs = [] (int fd) {
-                struct ::statfs buf;
-                auto r = ::fstatfs(fd, &buf);
-                if (r == -1) {
-                    return false;
+        open_flags |= O_CLOEXEC;
+        if (_cfg.bypass_fsync) {
+            open_flags &= ~O_DSYNC;
+        }
+        auto open_in_thread_pool = [&] {
+            return _thread_pool->submit<syscall_result_extra<struct stat>>(
+                    internal::thread_pool_submit_reason::file_open, [this, name, open_flags, &options, strict_o_direct = _cfg.strict_o_direct] () mutable {
+                // We want O_DIRECT, except in three cases:
+                //   - tmpfs (which doesn't support it, but works fine anyway)
+                //   - strict_o_direct == false (where we forgive it being not supported)
+                //   - kernel_page_cache == true (where we disable it for short-lived test processes)
+                // Because open() with O_DIRECT will fail, we open it without O_DIRECT, try
+                // to update it to O_DIRECT with fcntl(), and if that fails, see if we
+                // can forgive it.
+                struct stat st;
+                auto mode = static_cast<mode_t>(options.create_permissions);
+                int fd = ::open(name.c_str(), open_flags, mode);
+                if (fd == -1) {
+                    return wrap_syscall(fd, st);
                 }
-                return buf.f_type == internal::fs_magic::tmpfs;
-            };
-            open_flags |= O_CLOEXEC;
-            if (bypass_fsync) {
-                open_flags &= ~O_DSYNC;
-            }
-            struct stat st;
-            auto mode = static_cast<mode_t>(options.create_permissions);
-            int fd = ::open(name.c_str(), open_flags, mode);
-            if (fd == -1) {
-                return wrap_syscall(fd, st);
-            }
-            auto close_fd = defer([fd] () noexcept { ::close(fd); });
-            int o_direct_flag = _cfg.kernel_page_cache ? 0 : O_DIRECT;
-            int r = ::fcntl(fd, F_SETFL, open_flags | o_direct_flag);
-            if (r == -1  && strict_o_direct) {
-                auto maybe_ret = wrap_syscall(r, st);  // capture errno (should be EINVAL)
-                if (!is_tmpfs(fd)) {
-                    return maybe_ret;
+                auto close_fd = defer([fd] () noexcept { ::close(fd); });
+                int o_direct_flag = _cfg.kernel_page_cache ? 0 : O_DIRECT;
+                int r = ::fcntl(fd, F_SETFL, open_flags | o_direct_flag);
+                if (r == -1  && strict_o_direct) {
+                    auto maybe_ret = wrap_syscall(r, st);  // capture errno (should be EINVAL)
+                    if (!is_tmpfs(fd)) {
+                        return maybe_ret;
+                    }
                 }
-            }
-            if (fd != -1 && options.extent_allocation_size_hint && !_cfg.kernel_page_cache) {
-                fsxattr attr = {};
-                int r = ::ioctl(fd, XFS_IOC_FSGETXATTR, &attr);
-                // xfs delayed allocation is disabled when extent size hints are present.
-                // This causes tons of xfs log fsyncs. Given that extent size hints are
-                // unneeded when delayed allocation is available (which is the case
-                // when not using O_DIRECT), disable them.
-                //
-                // Ignore error; may be !xfs, and just a hint anyway
-                if (r != -1) {
-                    attr.fsx_xflags |= XFS_XFLAG_EXTSIZE;
-                    attr.fsx_extsize = std::min(options.extent_allocation_size_hint,
-                                        file_open_options::max_extent_allocation_size_hint);
-
-                    attr.fsx_extsize = align_up<uint32_t>(attr.fsx_extsize, file_open_options::min_extent_size_hint_alignment);
-
-                    // Ignore error; may be !xfs, and just a hint anyway
-                    ::ioctl(fd, XFS_IOC_FSSETXATTR, &attr);
+                if (fd != -1 && options.extent_allocation_size_hint && !_cfg.kernel_page_cache) {
+                    set_extent_size_hint(fd, options);
                 }
-            }
-            r = ::fstat(fd, &st);
-            if (r == -1) {
-                return wrap_syscall(r, st);
-            }
-            close_fd.cancel();
-            return wrap_syscall(fd, st);
-        }).then([&options, name = std::move(name), &open_flags] (syscall_result_extra<struct stat> sr) {
+                r = ::fstat(fd, &st);
+                if (r == -1) {
+                    return wrap_syscall(r, st);
+                }
+                close_fd.cancel();
+                return wrap_syscall(fd, st);
+            });
+        };
+        auto opened = _backend->can_offload_file_system_calls()
+                ? open_file_via_backend(*_backend, *_thread_pool, _cfg, name, open_flags, options)
+                : open_in_thread_pool();
+        return opened.then([&options, name = std::move(name), &open_flags] (syscall_result_extra<struct stat> sr) {
             sr.throw_fs_exception_if_error("open failed", name);
             return make_file_impl(sr.result, options, open_flags, sr.extra);
         }).then([] (shared_ptr<file_impl> impl) {
@@ -1802,14 +2071,43 @@ reactor::open_file_dma(std::string_view nameref, open_flags flags, file_open_opt
     });
 }
 
+// remove(3) over unlinkat(): a directory is only tried after unlinking it
+// as a file has failed, as the C library does.
+static future<syscall_result<int>>
+remove_via_backend(reactor_backend& backend, sstring pathname) {
+    auto sr = co_await backend.unlinkat(pathname, 0);
+    if (sr.result == -1 && sr.error == EISDIR) {
+        sr = co_await backend.unlinkat(pathname, AT_REMOVEDIR);
+    }
+    co_return sr;
+}
+
+// stat(2) or lstat(2), issued by the backend if it can
+static future<syscall_result_extra<struct stat>>
+stat_path(reactor_backend& backend, thread_pool& tp, sstring pathname, follow_symlink follow) {
+    if (backend.can_offload_file_system_calls()) {
+        return backend.statx(AT_FDCWD, std::move(pathname), follow ? 0 : AT_SYMLINK_NOFOLLOW);
+    }
+    return tp.submit<syscall_result_extra<struct stat>>(
+            internal::thread_pool_submit_reason::file_stat, [pathname = std::move(pathname), follow] {
+        struct stat st;
+        auto stat_syscall = follow ? stat : lstat;
+        auto ret = stat_syscall(pathname.c_str(), &st);
+        return wrap_syscall(ret, st);
+    });
+}
+
 future<>
 reactor::remove_file(std::string_view pathname) noexcept {
     // Allocating memory for a sstring can throw, hence the futurize_invoke
     return futurize_invoke([this, pathname] {
-        return _thread_pool->submit<syscall_result<int>>(
-                internal::thread_pool_submit_reason::file_operation, [pathname = sstring(pathname)] {
+        auto removed = _backend->can_offload_file_system_calls()
+                ? remove_via_backend(*_backend, sstring(pathname))
+                : _thread_pool->submit<syscall_result<int>>(
+                        internal::thread_pool_submit_reason::file_remove, [pathname = sstring(pathname)] {
             return wrap_syscall<int>(::remove(pathname.c_str()));
-        }).then([pathname = sstring(pathname)] (syscall_result<int> sr) {
+        });
+        return removed.then([pathname = sstring(pathname)] (syscall_result<int> sr) {
             sr.throw_fs_exception_if_error("remove failed", pathname);
             return make_ready_future<>();
         });
@@ -1820,10 +2118,13 @@ future<>
 reactor::rename_file(std::string_view old_pathname, std::string_view new_pathname) noexcept {
     // Allocating memory for a sstring can throw, hence the futurize_invoke
     return futurize_invoke([this, old_pathname, new_pathname] {
-        return _thread_pool->submit<syscall_result<int>>(
-                internal::thread_pool_submit_reason::file_operation, [old_pathname = sstring(old_pathname), new_pathname = sstring(new_pathname)] {
+        auto renamed = _backend->can_offload_file_system_calls()
+                ? _backend->renameat(sstring(old_pathname), sstring(new_pathname))
+                : _thread_pool->submit<syscall_result<int>>(
+                        internal::thread_pool_submit_reason::file_rename, [old_pathname = sstring(old_pathname), new_pathname = sstring(new_pathname)] {
             return wrap_syscall<int>(::rename(old_pathname.c_str(), new_pathname.c_str()));
-        }).then([old_pathname = sstring(old_pathname), new_pathname = sstring(new_pathname)] (syscall_result<int> sr) {
+        });
+        return renamed.then([old_pathname = sstring(old_pathname), new_pathname = sstring(new_pathname)] (syscall_result<int> sr) {
             sr.throw_fs_exception_if_error("rename failed",  old_pathname, new_pathname);
             return make_ready_future<>();
         });
@@ -1891,13 +2192,7 @@ future<std::optional<directory_entry_type>>
 reactor::file_type(std::string_view name, follow_symlink follow) noexcept {
     // Allocating memory for a sstring can throw, hence the futurize_invoke
     return futurize_invoke([name, follow, this] {
-        return _thread_pool->submit<syscall_result_extra<struct stat>>(
-                internal::thread_pool_submit_reason::file_operation, [name = sstring(name), follow] {
-            struct stat st;
-            auto stat_syscall = follow ? stat : lstat;
-            auto ret = stat_syscall(name.c_str(), &st);
-            return wrap_syscall(ret, st);
-        }).then([name = sstring(name)] (syscall_result_extra<struct stat> sr) {
+        return stat_path(*_backend, *_thread_pool, sstring(name), follow).then([name = sstring(name)] (syscall_result_extra<struct stat> sr) {
             if (long(sr.result) == -1) {
                 if (sr.error != ENOENT && sr.error != ENOTDIR) {
                     sr.throw_fs_exception_if_error("stat failed", name);
@@ -2176,13 +2471,7 @@ future<stat_data>
 reactor::file_stat(std::string_view pathname, follow_symlink follow) noexcept {
     // Allocating memory for a sstring can throw, hence the futurize_invoke
     return futurize_invoke([pathname, follow, this] {
-        return _thread_pool->submit<syscall_result_extra<struct stat>>(
-                internal::thread_pool_submit_reason::file_operation, [pathname = sstring(pathname), follow] {
-            struct stat st;
-            auto stat_syscall = follow ? stat : lstat;
-            auto ret = stat_syscall(pathname.c_str(), &st);
-            return wrap_syscall(ret, st);
-        }).then([pathname = sstring(pathname)] (syscall_result_extra<struct stat> sr) {
+        return stat_path(*_backend, *_thread_pool, sstring(pathname), follow).then([pathname = sstring(pathname)] (syscall_result_extra<struct stat> sr) {
             sr.throw_fs_exception_if_error("stat failed", pathname);
             struct stat& st = sr.extra;
             stat_data sd;
@@ -2308,13 +2597,30 @@ reactor::statvfs(std::string_view pathname) noexcept {
     });
 }
 
+static future<syscall_result_extra<struct stat>>
+open_directory_via_backend(reactor_backend& backend, sstring name, int oflags) {
+    struct stat st = {};
+    auto opened = co_await backend.openat(std::move(name), oflags, 0);
+    if (opened.result == -1) {
+        co_return syscall_result_extra<struct stat>(-1, opened.error, st);
+    }
+    auto sr = co_await backend.statx(opened.result, "", AT_EMPTY_PATH);
+    if (sr.result == -1) {
+        ::close(opened.result);
+        co_return sr;
+    }
+    co_return syscall_result_extra<struct stat>(opened.result, 0, sr.extra);
+}
+
 future<file>
 reactor::open_directory(std::string_view name) noexcept {
     // Allocating memory for a sstring can throw, hence the futurize_invoke
     return futurize_invoke([name, this] {
         auto oflags = O_DIRECTORY | O_CLOEXEC | O_RDONLY;
-        return _thread_pool->submit<syscall_result_extra<struct stat>>(
-                internal::thread_pool_submit_reason::file_operation, [name = sstring(name), oflags] {
+        auto opened = _backend->can_offload_file_system_calls()
+                ? open_directory_via_backend(*_backend, sstring(name), oflags)
+                : _thread_pool->submit<syscall_result_extra<struct stat>>(
+                        internal::thread_pool_submit_reason::file_open, [name = sstring(name), oflags] {
             struct stat st;
             int fd = ::open(name.c_str(), oflags);
             if (fd != -1) {
@@ -2325,7 +2631,8 @@ reactor::open_directory(std::string_view name) noexcept {
                 }
             }
             return wrap_syscall(fd, st);
-        }).then([name = sstring(name), oflags] (syscall_result_extra<struct stat> sr) {
+        });
+        return opened.then([name = sstring(name), oflags] (syscall_result_extra<struct stat> sr) {
             sr.throw_fs_exception_if_error("open failed", name);
             return make_file_impl(sr.result, file_open_options(), oflags, sr.extra);
         }).then([] (shared_ptr<file_impl> file_impl) {
@@ -2575,21 +2882,44 @@ void reactor::register_metrics() {
             // total_operations value:DERIVE:0:U
             io_fallback_counter("file_operation", internal::thread_pool_submit_reason::file_operation),
             // total_operations value:DERIVE:0:U
+            io_fallback_counter("file_open", internal::thread_pool_submit_reason::file_open),
+            // total_operations value:DERIVE:0:U
+            io_fallback_counter("file_stat", internal::thread_pool_submit_reason::file_stat),
+            // total_operations value:DERIVE:0:U
+            io_fallback_counter("file_rename", internal::thread_pool_submit_reason::file_rename),
+            // total_operations value:DERIVE:0:U
+            io_fallback_counter("file_remove", internal::thread_pool_submit_reason::file_remove),
+            // total_operations value:DERIVE:0:U
             io_fallback_counter("process_operation", internal::thread_pool_submit_reason::process_operation),
     });
 
+    _backend->register_metrics(_metric_groups);
+    internal::register_work_stealing_metrics(_metric_groups);
+
     _metric_groups.add_group("memory", {
             sm::make_counter("malloc_operations", [] { return memory::stats().mallocs(); },
                     sm::description("Total number of malloc operations")),
             sm::make_counter("free_operations", [] { return memory::stats().frees(); }, sm::description("Total number of free operations")),
             sm::make_counter("cross_cpu_free_operations", [] { return memory::stats().cross_cpu_frees(); }, sm::description("Total number of cross cpu free")),
+            sm::make_counter("cross_cpu_free_batches", [] { return memory::stats().cross_cpu_free_batches(); },
+                    sm::description("Total number of batches of cross cpu frees returned to their owner. Divide cross_cpu_batched_free_operations by this for the average batch size")),
+            sm::make_counter("cross_cpu_batched_free_operations", [] { return memory::stats().cross_cpu_batched_frees(); },
+                    sm::description("Total number of cross cpu frees returned to their owner in batches")),
             sm::make_gauge("malloc_live_objects", [] { return memory::stats().live_objects(); }, sm::description("Number of live objects")),
             sm::make_current_bytes("free_memory", [] { return memory::stats().free_memory(); }, sm::description("Free memory size in bytes")),
             sm::make_current_bytes("total_memory", [] { return memory::stats().total_memory(); }, sm::description("Total memory size in bytes")),
             sm::make_current_bytes("allocated_memory", [] { return memory::stats().allocated_memory(); }, sm::description("Allocated memory size in bytes")),
             sm::make_counter("reclaims_operations", [] { return memory::stats().reclaims(); }, sm::description("Total reclaims operations")),
             sm::make_counter("malloc_failed", [] { return memory::stats().failed_allocations(); }, sm::description("Total count of failed memory allocations")),
-            sm::make_counter("oversized_allocs", [] { return memory::stats().large_allocations(); }, sm::description("Total count of oversized memory allocations"))
+            sm::make_counter("oversized_allocs", [] { return memory::stats().large_allocations(); }, sm::description("Total count of oversized memory allocations")),
+            sm::make_counter("relocations", [] { return memory::stats().relocations(); }, sm::description("Total number of objects moved by memory compaction")),
+            sm::make_counter("compacted_bytes", [] { return memory::stats().compacted_memory(); }, sm::description("Total memory size in bytes freed by memory compaction")),
+            sm::make_current_bytes("page_backed_memory", [] { auto s = memory::stats(); return s.total_memory() - s.hugetlb_2m_memory() - s.hugetlb_1g_memory(); },
+                    sm::description("Memory size in bytes not backed by explicit huge pages; this includes transparent huge pages"), {sm::label("page_size")("default")}),
+            sm::make_current_bytes("page_backed_memory", [] { return memory::stats().hugetlb_2m_memory(); },
+                    sm::description("Memory size in bytes backed by pages of the given size"), {sm::label("page_size")("2M")}),
+            sm::make_current_bytes("page_backed_memory", [] { return memory::stats().hugetlb_1g_memory(); },
+                    sm::description("Memory size in bytes backed by pages of the given size"), {sm::label("page_size")("1G")}),
     });
 
     _metric_groups.add_group("reactor", {
@@ -2652,9 +2982,18 @@ void reactor::run_tasks(task_queue& tq) {
         tasks.pop_front();
         STAP_PROBE(seastar, reactor_run_tasks_single_start);
         internal::task_histogram_add_task(*tsk);
+        if (tsk == tq._delay_sampled_task) [[unlikely]] {
+            tq.on_sampled_task_run();
+        }
+        // Sampled, so that reading the clock doesn't cost every task
+        bool timed = tq.sample_runtime();
+        auto start = timed ? sched_clock::now() : sched_clock::time_point();
         _current_task = tsk;
         tsk->run_and_dispose();
         _current_task = nullptr;
+        if (timed) [[unlikely]] {
+            tq._task_runtime.add(std::chrono::duration_cast<std::chrono::microseconds>(sched_clock::now() - start).count());
+        }
         STAP_PROBE(seastar, reactor_run_tasks_single_end);
         ++tq._tasks_processed;
         ++_global_tasks_processed;
@@ -2789,6 +3128,16 @@ class reactor::signal_pollfn final : public reactor::pollfn {
     }
 };
 
+class reactor::busy_poll_pollfn final : public simple_pollfn<true> {
+    reactor& _r;
+public:
+    busy_poll_pollfn(reactor& r) : _r(r) {}
+    virtual bool poll() final override {
+        // Only spend syscalls on it when there is nothing else to do
+        return _r._busy_poll_sockets && !_r.have_more_tasks() && _r._busy_poll_sockets->poll(lowres_clock::now());
+    }
+};
+
 class reactor::batch_flush_pollfn final : public simple_pollfn<true> {
     reactor& _r;
 public:
@@ -3064,6 +3413,7 @@ void reactor::add_task(task* t) noexcept {
     auto sg = t->group();
     auto* q = _task_queues[sg._id].get();
     bool was_empty = q->_q.empty();
+    q->maybe_sample_delay(t);
     q->_q.push_back(std::move(t));
     shuffle(q->_q.back(), q->_q);
     if (was_empty) {
@@ -3076,6 +3426,7 @@ void reactor::add_urgent_task(task* t) noexcept {
     auto sg = t->group();
     auto* q = _task_queues[sg._id].get();
     bool was_empty = q->_q.empty();
+    q->maybe_sample_delay(t);
     q->_q.push_front(std::move(t));
     shuffle(q->_q.front(), q->_q);
     if (was_empty) {
@@ -3186,6 +3537,9 @@ int reactor::do_run() {
     auto signal_stack = install_signal_handler_stack();
 
     register_metrics();
+    if (_cfg.work_stealing) {
+        internal::start_work_stealing(*this);
+    }
 
     // The order in which we execute the pollers is very important for performance.
     //
@@ -3205,6 +3559,8 @@ int reactor::do_run() {
     // 6. reap kernel events completion: some of the submissions from last step may return immediately.
     //                                   For example if we are dealing with poll() on a fd that has events.
     poller smp_poller(std::make_unique<smp_pollfn>(*this));
+    // Before reaping, so that sockets that got packets are seen readable
+    poller busy_poll_poller(std::make_unique<busy_poll_pollfn>(*this));
 
     poller reap_kernel_completions_poller(std::make_unique<reap_kernel_completions_pollfn>(*this));
     poller io_queue_submission_poller(std::make_unique<io_queue_submission_pollfn>(*this));
@@ -3227,10 +3583,14 @@ int reactor::do_run() {
         // Start initialization in the background.
         // Wait for network stack to appear on all cpus.
         // Communicate when done using _start_promise
-        (void)smp::invoke_on_all([] {
+        (void)_smp->probe_submit_to_latencies().handle_exception([] (std::exception_ptr ex) {
+            seastar_logger.warn("Failed to measure cross-shard latencies: {}", ex);
+        }).then([] {
+          return smp::invoke_on_all([] {
             return engine()._network_stack_ready->then([] (std::unique_ptr<network_stack> stack) {
                 engine()._network_stack = std::move(stack);
             });
+          });
         }).then([] {
             return smp::invoke_on_all([] {
                 return engine()._network_stack->initialize().then([] {
@@ -3267,6 +3627,16 @@ int reactor::do_run() {
     });
     load_timer.arm_periodic(1s);
 
+    // Compacts a bounded amount at a time, coming back right away while
+    // there is more to do
+    timer<lowres_clock> memory_compaction_timer;
+    memory_compaction_timer.set_callback([this, &memory_compaction_timer] {
+        memory_compaction_timer.arm(memory::compact_relocatable() ? lowres_clock::duration(0) : _cfg.memory_compaction_period);
+    });
+    if (_cfg.memory_compaction_period.count()) {
+        memory_compaction_timer.arm(_cfg.memory_compaction_period);
+    }
+
     itimerspec its = seastar::posix::to_relative_itimerspec(_cfg.task_quota, _cfg.task_quota);
     _task_quota_timer.timerfd_settime(0, its);
     auto& task_quote_itimerspec = its;
@@ -3289,6 +3659,7 @@ int reactor::do_run() {
         run_some_tasks();
         if (_stopped) {
             load_timer.cancel();
+            memory_compaction_timer.cancel();
             // Final tasks may include sending the last response to cpu 0, so run them
             while (have_more_tasks()) {
                 run_some_tasks();
@@ -3324,8 +3695,12 @@ int reactor::do_run() {
                 // we can't run check_for_work(), because that can run tasks in the context
                 // of the idle handler which change its state, without the idle handler expecting
                 // it.  So run pure_check_for_work() instead.
-                auto handler_result = _idle_cpu_handler(pure_check_for_work);
-                go_to_sleep = handler_result == idle_cpu_handler_result::no_more_work;
+                if (_cfg.work_stealing && internal::steal_stealable_jobs(pure_check_for_work)) {
+                    go_to_sleep = false;
+                } else {
+                    auto handler_result = _idle_cpu_handler(pure_check_for_work);
+                    go_to_sleep = handler_result == idle_cpu_handler_result::no_more_work;
+                }
             } catch (...) {
                 report_exception("Exception while running idle cpu handler", std::current_exception());
             }
@@ -3558,10 +3933,21 @@ unsigned syscall_work_queue::complete() {
 }
 
 
-smp_message_queue::smp_message_queue(reactor* from, reactor* to)
+struct alignas(seastar::cache_line_size) smp_message_queue::batch_size_histogram
+        : metrics::internal::approximate_exponential_histogram<1, queue_length, 1> {};
+
+struct alignas(seastar::cache_line_size) smp_message_queue::queue_time_histogram
+        : metrics::internal::approximate_exponential_histogram<2, 65536, 2> {};
+
+smp_message_queue::smp_message_queue(reactor* from, reactor* to, bool adaptive_batching, bool histograms)
     : _pending(to)
     , _completed(from)
 {
+    _adaptive_batching = adaptive_batching;
+    if (histograms) {
+        _batch_sizes = new batch_size_histogram();
+        _queue_times = new queue_time_histogram();
+    }
 }
 
 smp_message_queue::~smp_message_queue()
@@ -3569,6 +3955,8 @@ smp_message_queue::~smp_message_queue()
     if (_pending.remote != _completed.remote) {
         _tx.a.~aa();
     }
+    delete _batch_sizes;
+    delete _queue_times;
 }
 
 void smp_message_queue::stop() {
@@ -3576,8 +3964,8 @@ void smp_message_queue::stop() {
 }
 
 void smp_message_queue::move_pending() {
-    auto begin = _tx.a.pending_fifo.cbegin();
-    auto end = _tx.a.pending_fifo.cend();
+    auto begin = _tx.a.pending_fifo.begin();
+    auto end = _tx.a.pending_fifo.end();
     end = _pending.push(begin, end);
     if (begin == end) {
         return;
@@ -3588,6 +3976,20 @@ void smp_message_queue::move_pending() {
     _current_queue_length += nr;
     _last_snt_batch = nr;
     _sent += nr;
+    if (_batch_sizes) {
+        _batch_sizes->add(nr);
+    }
+}
+
+// Sizes the batch after the number of messages expected to arrive until the
+// next poll, which flushes whatever is pending anyway. Waiting for a batch
+// larger than that only adds latency, while a smaller one sends more, and
+// less full, batches across the interconnect than needed. With sparse
+// traffic the target drops to 1 and messages are pushed as they come.
+void smp_message_queue::update_batch_target() noexcept {
+    _avg_arrivals += ((_arrivals << 4) >> 3) - (_avg_arrivals >> 3);
+    _arrivals = 0;
+    _batch_target = std::clamp<size_t>(_avg_arrivals >> 4, 1, max_batch_size);
 }
 
 bool smp_message_queue::pure_poll_tx() const {
@@ -3608,11 +4010,15 @@ void smp_message_queue::submit_item(shard_id t, smp_timeout_clock::time_point ti
         ++_last_cmpl_batch;
         return;
     }
+    if (_batch_sizes) {
+        item->queued_at = std::chrono::steady_clock::now();
+    }
     _tx.a.pending_fifo.push_back(item.get());
     // no exceptions from this point
     item.release();
     units_fut.get().release();
-    if (_tx.a.pending_fifo.size() >= batch_size) {
+    ++_arrivals;
+    if (_tx.a.pending_fifo.size() >= _batch_target) {
         move_pending();
     }
   });
@@ -3706,15 +4112,27 @@ size_t smp_message_queue::process_completions(shard_id t) {
 }
 
 void smp_message_queue::flush_request_batch() {
+    if (_adaptive_batching) {
+        update_batch_target();
+    }
     if (!_tx.a.pending_fifo.empty()) {
         move_pending();
     }
 }
 
 size_t smp_message_queue::process_incoming() {
-    auto nr = process_queue<prefetch_cnt>(_pending, [] (work_item* wi) {
-        wi->process();
-    });
+    size_t nr;
+    if (_queue_times) {
+        auto now = std::chrono::steady_clock::now();
+        nr = process_queue<prefetch_cnt>(_pending, [this, now] (work_item* wi) {
+            _queue_times->add(std::chrono::duration_cast<std::chrono::microseconds>(now - wi->queued_at).count());
+            wi->process();
+        });
+    } else {
+        nr = process_queue<prefetch_cnt>(_pending, [] (work_item* wi) {
+            wi->process();
+        });
+    }
     _received += nr;
     _last_rcv_batch = nr;
     return nr;
@@ -3737,8 +4155,17 @@ void smp_message_queue::start(unsigned cpuid) {
             // total_operations value:DERIVE:0:U
             sm::make_counter("total_sent_messages", _sent, sm::description("Total number of sent messages"), {sm::shard_label(instance)})(sm::metric_disabled),
             // total_operations value:DERIVE:0:U
-            sm::make_counter("total_completed_messages", _compl, sm::description("Total number of messages completed"), {sm::shard_label(instance)})(sm::metric_disabled)
+            sm::make_counter("total_completed_messages", _compl, sm::description("Total number of messages completed"), {sm::shard_label(instance)})(sm::metric_disabled),
+            sm::make_queue_length("overflow_queue_length", [this] { return _tx.a.pending_fifo.size(); }, sm::description("Number of messages waiting to be pushed to the queue, either to make a batch or for the queue to have room"), {sm::shard_label(instance)})(sm::metric_disabled),
+            sm::make_gauge("send_batch_target", _batch_target, sm::description("Number of messages batched before being pushed to the queue"), {sm::shard_label(instance)})(sm::metric_disabled),
+            sm::make_gauge("submit_to_cost", [from = this_shard_id(), cpuid] { return smp::submit_to_cost(from, cpuid); }, sm::description("Round-trip latency of a message in nanoseconds as measured at startup, or 1 within a NUMA node and 2 across nodes if not measured"), {sm::shard_label(instance)})(sm::metric_disabled)
     });
+    if (_batch_sizes) {
+        _metrics.add_group("smp", {
+            sm::make_histogram("send_batch_size", sm::description("Histogram of the number of messages pushed to the queue at once"), {sm::shard_label(instance)}, [this] { return _batch_sizes->to_metrics_histogram(); })(sm::metric_disabled),
+            sm::make_histogram("queue_time", sm::description("Histogram of the time in microseconds messages spend queued before being picked up by the remote shard"), {sm::shard_label(instance)}, [this] { return _queue_times->to_metrics_histogram(); })(sm::metric_disabled),
+        });
+    }
 }
 
 readable_eventfd writeable_eventfd::read_side() {
@@ -3871,6 +4298,8 @@ reactor_options::reactor_options(program_options::option_group* parent_group)
     , task_quota_ms(*this, "task-quota-ms", 0.5, "Max time (ms) between polls")
     , io_latency_goal_ms(*this, "io-latency-goal-ms", {}, "Max time (ms) io operations must take (1.5 * task-quota-ms if not set)")
     , io_flow_ratio_threshold(*this, "io-flow-rate-threshold", 1.1, "Dispatch rate to completion rate threshold")
+    , io_adaptive_rate(*this, "io-adaptive-rate", false, "Scale the disk model rate at runtime to keep the 99th percentile of IO latency within the latency goal")
+    , io_merge_reads(*this, "io-merge-reads", false, "Submit reads of adjacent ranges of a file dispatched at the same time as a single IO")
     , io_completion_notify_ms(*this, "io-completion-notify-ms", {}, "Threshold in milliseconds over which IO request completion is reported to logs")
     , max_task_backlog(*this, "max-task-backlog", 1000, "Maximum number of task backlog to allow; above this we ignore I/O")
     , blocked_reactor_notify_ms(*this, "blocked-reactor-notify-ms", 25, "threshold in miliseconds over which the reactor is considered blocked if no progress is made")
@@ -3903,11 +4332,50 @@ reactor_options::reactor_options(program_options::option_group* parent_group)
     , reserve_io_control_blocks(*this, "reserve-io-control-blocks", 0,
                 "Reserve this many IOCBs, so it is available to any side application that runs parallel to the seastar appliation."
                 " Takes precedence over --max-networking-io-control-blocks. Only valid for the linux-aio reactor backend (see --reactor-backend).")
+    , io_uring_registered_buffers(*this, "io-uring-registered-buffers", 0,
+                "Number of DMA buffers to register with io_uring per shard, used for fixed-buffer disk reads and writes (0 disables)."
+                " Only valid for the io_uring reactor backend (see --reactor-backend).")
+    , io_uring_registered_buffer_size(*this, "io-uring-registered-buffer-size", 128 << 10,
+                "Size in bytes of each buffer registered with io_uring (see --io-uring-registered-buffers)")
+    , io_uring_fixed_files(*this, "io-uring-fixed-files", 0,
+                "Number of file slots to register with io_uring per shard, used for fixed-file disk I/O (0 disables)."
+                " Only valid for the io_uring reactor backend (see --reactor-backend).")
+    , io_uring_multishot_accept(*this, "io-uring-multishot-accept", false,
+                "Keep a single multishot accept armed per listening socket; requires Linux 5.19 or later."
+                " Only valid for the io_uring reactor backend (see --reactor-backend).")
+    , io_uring_provided_buffers(*this, "io-uring-provided-buffers", 0,
+                "Number of buffers in the per-shard io_uring provided-buffer ring used by multishot socket receives (0 disables);"
+                " requires Linux 6.0 or later. Only valid for the io_uring reactor backend (see --reactor-backend).")
+    , io_uring_provided_buffer_size(*this, "io-uring-provided-buffer-size", 16 << 10,
+                "Size in bytes of each buffer in the io_uring provided-buffer ring (see --io-uring-provided-buffers)")
+    , io_uring_zero_copy_send_threshold(*this, "io-uring-zero-copy-send-threshold", 0,
+                "Send packets of at least this many bytes with zero-copy sendmsg (0 disables); requires Linux 6.1 or later."
+                " Only valid for the io_uring reactor backend (see --reactor-backend).")
+    , io_uring_sqpoll(*this, "io-uring-sqpoll", false,
+                "Let a kernel thread poll the io_uring submission queue, so that submitting needs no system call while it is awake."
+                " Only valid for the io_uring reactor backend (see --reactor-backend).")
+    , io_uring_sqpoll_idle_ms(*this, "io-uring-sqpoll-idle-ms", 10,
+                "Idle time in milliseconds after which the io_uring submission queue polling thread goes to sleep")
+    , io_uring_sqpoll_cpuset(*this, "io-uring-sqpoll-cpuset", {},
+                "CPUs to pin io_uring submission queue polling threads to (in cpuset(7) list format); shard N uses the N-th CPU of the set")
+    , io_uring_single_issuer(*this, "io-uring-single-issuer", false,
+                "Create the io_uring with IORING_SETUP_SINGLE_ISSUER; requires Linux 6.0 or later")
+    , io_uring_coop_taskrun(*this, "io-uring-coop-taskrun", false,
+                "Create the io_uring with IORING_SETUP_COOP_TASKRUN; requires Linux 5.19 or later. Ignored with --io-uring-sqpoll")
+    , io_uring_defer_taskrun(*this, "io-uring-defer-taskrun", false,
+                "Create the io_uring with IORING_SETUP_DEFER_TASKRUN (implies --io-uring-single-issuer); requires Linux 6.1 or later."
+                " Ignored with --io-uring-sqpoll")
+    , io_uring_linked_fdatasync(*this, "io-uring-linked-fdatasync", false,
+                "Submit the flush of an append-challenged file linked to the write queued before it, in a single round-trip."
+                " Only valid for the io_uring reactor backend (see --reactor-backend).")
 #ifdef SEASTAR_HEAPPROF
     , heapprof(*this, "heapprof", 0, "Enable seastar heap profiling. Sample every ARG bytes. 0 means off")
 #else
     , heapprof(*this, "heapprof", program_options::unused{})
 #endif
+    , memory_compaction_period_ms(*this, "memory-compaction-period-ms", 1000,
+                "Period of the background compaction of relocatable memory (memory::relocatable_class), in ms. 0 means off")
+    , work_stealing(*this, "work-stealing", true, "let idle shards run the jobs other shards submitted with submit_stealable()")
     , no_handle_interrupt(*this, "no-handle-interrupt", "ignore SIGINT (for gdb)")
 {
 }
@@ -3919,6 +4387,7 @@ smp_options::smp_options(program_options::option_group* parent_group)
     , memory(*this, "memory", std::nullopt, "memory to use, in bytes (ex: 4G) (default: all)")
     , reserve_memory(*this, "reserve-memory", {}, "memory reserved to OS (if --memory not specified)")
     , hugepages(*this, "hugepages", {}, "path to accessible hugetlbfs mount (typically /dev/hugepages/something)")
+    , hugetlb_page_size(*this, "hugetlb-page-size", {}, "back memory with anonymous huge pages of this size (2M or 1G), bound to each shard's NUMA node")
     , lock_memory(*this, "lock-memory", {}, "lock all memory (prevents swapping)")
     , thread_affinity(*this, "thread-affinity", true, "pin threads to their cpus (disable for overprovisioning)")
 #ifdef SEASTAR_HAVE_HWLOC
@@ -3929,6 +4398,9 @@ smp_options::smp_options(program_options::option_group* parent_group)
     , io_properties_file(*this, "io-properties-file", {}, "path to a YAML file describing the characteristics of the I/O Subsystem")
     , io_properties(*this, "io-properties", {}, "a YAML string describing the characteristics of the I/O Subsystem")
     , mbind(*this, "mbind", true, "enable mbind")
+    , smp_queue_adaptive_batching(*this, "smp-queue-adaptive-batching", false, "size cross-shard message batches after the observed rate of messages between polls, rather than a fixed 16")
+    , smp_queue_histograms(*this, "smp-queue-histograms", false, "collect histograms of cross-shard message batch sizes and queueing times")
+    , smp_latency_probes(*this, "smp-latency-probes", 8, "number of round trips with which the latency between each pair of shards is measured at startup (0 to estimate it from the NUMA topology)")
 #ifndef SEASTAR_NO_EXCEPTION_HACK
     , enable_glibc_exception_scaling_workaround(*this, "enable-glibc-exception-scaling-workaround", true, "enable workaround for glibc/gcc c++ exception scalablity problem")
 #else
@@ -4019,6 +4491,9 @@ void smp::cleanup() noexcept {
     smp::_threads = std::vector<posix_thread>();
     _thread_loops.clear();
     _shard_to_numa_node_mapping = decltype(_shard_to_numa_node_mapping)();
+    _shard_to_cpu_mapping = decltype(_shard_to_cpu_mapping)();
+    _node_shards = decltype(_node_shards)();
+    _submit_to_costs = decltype(_submit_to_costs)();
     reactor_holder.reset();
     local_engine = nullptr;
 }
@@ -4159,6 +4634,8 @@ class disk_config_params {
     std::chrono::duration<double> _latency_goal;
     std::chrono::milliseconds _stall_threshold;
     double _flow_ratio_backpressure_threshold;
+    bool _adaptive_rate = false;
+    bool _merge_reads = false;
 
 public:
     explicit disk_config_params(unsigned max_queues) noexcept
@@ -4191,6 +4668,8 @@ class disk_config_params {
         seastar_logger.debug("latency_goal: {}", latency_goal().count());
         _flow_ratio_backpressure_threshold = reactor_opts.io_flow_ratio_threshold.get_value();
         seastar_logger.debug("flow-ratio threshold: {}", _flow_ratio_backpressure_threshold);
+        _adaptive_rate = reactor_opts.io_adaptive_rate.get_value();
+        _merge_reads = reactor_opts.io_merge_reads.get_value();
         _stall_threshold = reactor_opts.io_completion_notify_ms.defaulted() ? std::chrono::milliseconds::max() : reactor_opts.io_completion_notify_ms.get_value() * 1ms;
 
         if (smp_opts.num_io_groups) {
@@ -4291,6 +4770,8 @@ class disk_config_params {
         cfg.duplex = p.duplex;
         cfg.rate_limit_duration = latency_goal();
         cfg.flow_ratio_backpressure_threshold = _flow_ratio_backpressure_threshold;
+        cfg.adaptive_rate = _adaptive_rate;
+        cfg.merge_reads = _merge_reads;
         // Block count limit should not be less than the minimal IO size on the device
         // On the other hand, even this is not good enough -- in the worst case the
         // scheduler will self-tune to allow for the single 64k request, while it would
@@ -4483,6 +4964,18 @@ void smp::configure(const smp_options& smp_opts, const reactor_options& reactor_
     if (smp_opts.hugepages) {
         hugepages_path = smp_opts.hugepages.get_value();
     }
+    size_t hugetlb_page_size = 0;
+    if (smp_opts.hugetlb_page_size) {
+        hugetlb_page_size = parse_memory_size(smp_opts.hugetlb_page_size.get_value());
+        if (hugetlb_page_size != size_t(2) << 20 && hugetlb_page_size != size_t(1) << 30) {
+            seastar_logger.error("Bad value for --hugetlb-page-size: {}, should be 2M or 1G. Shutting down.", smp_opts.hugetlb_page_size.get_value());
+            exit(1);
+        }
+        if (hugepages_path) {
+            seastar_logger.warn("--hugetlb-page-size is ignored when --hugepages is given");
+            hugetlb_page_size = 0;
+        }
+    }
     auto mlock = false;
     if (smp_opts.lock_memory) {
         mlock = smp_opts.lock_memory.get_value();
@@ -4529,7 +5022,7 @@ void smp::configure(const smp_options& smp_opts, const reactor_options& reactor_
     }
     std::optional<memory::internal::numa_layout> layout;
     if (smp_opts.memory_allocator == memory_allocator::seastar) {
-        layout = memory::configure(allocations[0].mem, mbind, use_transparent_hugepages, hugepages_path);
+        layout = memory::configure(allocations[0].mem, mbind, use_transparent_hugepages, hugepages_path, hugetlb_page_size);
     } else {
         // #2148 - if running seastar allocator but options that contradict this, we still need to
         // init memory at least minimally, otherwise a bunch of stuff breaks.
@@ -4537,10 +5030,32 @@ void smp::configure(const smp_options& smp_opts, const reactor_options& reactor_
         memory::configure_minimal();
     }
 
-    _shard_to_numa_node_mapping.resize(smp::count);
+    _shard_to_numa_node_mapping.reserve(smp::count);
     for (unsigned i = 0; i < smp::count; i++) {
         _shard_to_numa_node_mapping.push_back(allocations[i].mem.size() > 0 ? allocations[i].mem[0].nodeid : 0);
     }
+    if (thread_affinity) {
+        _shard_to_cpu_mapping.reserve(smp::count);
+        for (unsigned i = 0; i < smp::count; i++) {
+            _shard_to_cpu_mapping.push_back(allocations[i].cpu_id);
+        }
+    }
+    for (unsigned i = 0; i < smp::count; i++) {
+        auto node = _shard_to_numa_node_mapping[i];
+        if (node >= _node_shards.size()) {
+            _node_shards.resize(node + 1);
+        }
+        _node_shards[node].push_back(i);
+    }
+    // Estimates, until probe_submit_to_latencies() measures them
+    _submit_to_costs.resize(smp::count * smp::count);
+    for (unsigned i = 0; i < smp::count; i++) {
+        for (unsigned j = 0; j < smp::count; j++) {
+            _submit_to_costs[i * smp::count + j] = i == j ? 0 : _shard_to_numa_node_mapping[i] == _shard_to_numa_node_mapping[j] ? 1 : 2;
+        }
+    }
+    _latency_probes = smp_opts.smp_latency_probes.get_value();
+    internal::configure_work_stealing(smp::count);
 
     if (reactor_opts.abort_on_seastar_bad_alloc) {
         memory::set_abort_on_allocation_failure(true);
@@ -4578,6 +5093,29 @@ void smp::configure(const smp_options& smp_opts, const reactor_options& reactor_
         .strict_o_direct = !reactor_opts.relaxed_dma,
         .bypass_fsync = reactor_opts.unsafe_bypass_fsync.get_value(),
         .no_poll_aio = !reactor_opts.poll_aio.get_value() || (reactor_opts.poll_aio.defaulted() && reactor_opts.overprovisioned),
+        .uring_registered_buffers = reactor_opts.io_uring_registered_buffers.get_value(),
+        .uring_registered_buffer_size = align_up<size_t>(reactor_opts.io_uring_registered_buffer_size.get_value(), 4096),
+        .uring_fixed_files = reactor_opts.io_uring_fixed_files.get_value(),
+        .uring_multishot_accept = reactor_opts.io_uring_multishot_accept.get_value(),
+        .uring_provided_buffers = reactor_opts.io_uring_provided_buffers.get_value(),
+        .uring_provided_buffer_size = reactor_opts.io_uring_provided_buffer_size.get_value(),
+        .uring_zero_copy_send_threshold = reactor_opts.io_uring_zero_copy_send_threshold.get_value(),
+        .uring_sqpoll = reactor_opts.io_uring_sqpoll.get_value(),
+        .uring_sqpoll_idle_ms = reactor_opts.io_uring_sqpoll_idle_ms.get_value(),
+        .uring_sqpoll_cpus = [&reactor_opts] {
+            std::vector<unsigned> cpus;
+            if (reactor_opts.io_uring_sqpoll_cpuset) {
+                auto& set = reactor_opts.io_uring_sqpoll_cpuset.get_value();
+                cpus.assign(set.begin(), set.end());
+            }
+            return cpus;
+        }(),
+        .uring_single_issuer = reactor_opts.io_uring_single_issuer.get_value(),
+        .uring_coop_taskrun = reactor_opts.io_uring_coop_taskrun.get_value(),
+        .uring_defer_taskrun = reactor_opts.io_uring_defer_taskrun.get_value(),
+        .uring_linked_fdatasync = reactor_opts.io_uring_linked_fdatasync.get_value(),
+        .memory_compaction_period = std::chrono::milliseconds(reactor_opts.memory_compaction_period_ms.get_value()),
+        .work_stealing = reactor_opts.work_stealing.get_value(),
     };
 
     // Disable hot polling if sched wakeup granularity is too high
@@ -4685,7 +5223,7 @@ void smp::configure(const smp_options& smp_opts, const reactor_options& reactor_
     auto smp_tmain = smp::_tmain;
     for (i = 1; i < smp::count; i++) {
         auto allocation = allocations[i];
-        create_thread([this, smp_tmain, inited, &reactors_registered, &smp_queues_constructed, &smp_opts, &reactor_opts, &reactors, hugepages_path, i, allocation, assign_io_queues, alloc_io_queues, thread_affinity, heapprof_sampling_rate, mbind, backend_selector, reactor_cfg, &mtx, &layout, use_transparent_hugepages] {
+        create_thread([this, smp_tmain, inited, &reactors_registered, &smp_queues_constructed, &smp_opts, &reactor_opts, &reactors, hugepages_path, hugetlb_page_size, i, allocation, assign_io_queues, alloc_io_queues, thread_affinity, heapprof_sampling_rate, mbind, backend_selector, reactor_cfg, &mtx, &layout, use_transparent_hugepages] {
           try {
             // initialize thread_locals that are equal across all reacto threads of this smp instance
             smp::_tmain = smp_tmain;
@@ -4695,7 +5233,7 @@ void smp::configure(const smp_options& smp_opts, const reactor_options& reactor_
                 smp::pin(allocation.cpu_id);
             }
             if (smp_opts.memory_allocator == memory_allocator::seastar) {
-                auto another_layout = memory::configure(allocation.mem, mbind, use_transparent_hugepages, hugepages_path);
+                auto another_layout = memory::configure(allocation.mem, mbind, use_transparent_hugepages, hugepages_path, hugetlb_page_size);
                 auto guard = std::lock_guard(mtx);
                 *layout = memory::internal::merge(std::move(*layout), std::move(another_layout));
             } else {
@@ -4767,7 +5305,8 @@ void smp::configure(const smp_options& smp_opts, const reactor_options& reactor_
             , std::align_val_t(alignof(smp_message_queue))
         ));
         for (unsigned j = 0; j < smp::count; ++j) {
-            new (&smp::_qs_owner[i][j]) smp_message_queue(reactors[j], reactors[i]);
+            new (&smp::_qs_owner[i][j]) smp_message_queue(reactors[j], reactors[i], smp_opts.smp_queue_adaptive_batching.get_value(),
+                    smp_opts.smp_queue_histograms.get_value());
         }
     }
     _alien._qs = alien::instance::create_qs(reactors);
@@ -5144,6 +5683,10 @@ std::span<const unsigned> smp::shard_to_numa_node_mapping() const noexcept {
     return _shard_to_numa_node_mapping;
 }
 
+std::span<const unsigned> smp::shard_to_cpu_mapping() const noexcept {
+    return _shard_to_cpu_mapping;
+}
+
 const smp& reactor::smp() const noexcept {
     return *_smp;
 }
@@ -5244,8 +5787,11 @@ destroy_scheduling_group(scheduling_group sg) noexcept {
     if (sg == current_scheduling_group()) {
         return make_exception_future<>(make_backtraced_exception_ptr<std::runtime_error>("Attempt to destroy the current scheduling group"));
     }
-    return smp::invoke_on_all([sg] {
-        return engine().destroy_scheduling_group(sg);
+    // The id may be reused by another group, which shouldn't inherit the I/O priority group
+    return set_io_priority_group(sg, std::nullopt).then([sg] {
+        return smp::invoke_on_all([sg] {
+            return engine().destroy_scheduling_group(sg);
+        });
     }).then([sg] {
         deallocate_scheduling_group_id(sg._id);
     });
@@ -5268,6 +5814,136 @@ rename_scheduling_group(scheduling_group sg, sstring new_name, sstring new_short
     });
 }
 
+// I/O priority groups are created and destroyed from any shard, so the
+// hierarchy is kept here, while shards only see it through their io_queues
+namespace {
+
+struct io_priority_group_registry {
+    struct node {
+        std::optional<unsigned> parent;
+        unsigned members = 0;
+        // Being destroyed on the shards, can't get new members
+        bool dying = false;
+    };
+    std::mutex lock;
+    std::vector<std::optional<node>> groups;
+    std::array<std::optional<unsigned>, max_scheduling_groups()> class_groups;
+
+    bool valid(unsigned id) const noexcept {
+        return id < groups.size() && groups[id] && !groups[id]->dying;
+    }
+};
+
+io_priority_group_registry& io_priority_groups() {
+    static io_priority_group_registry registry;
+    return registry;
+}
+
+uint32_t io_group_shares(float shares) noexcept {
+    return std::clamp(shares, 1.0f, float(std::numeric_limits<uint32_t>::max()));
+}
+
+}
+
+future<io_priority_group>
+create_io_priority_group(sstring name, float shares, std::optional<io_priority_group> parent) noexcept {
+    auto& reg = io_priority_groups();
+    unsigned id;
+    std::optional<unsigned> parent_id;
+    try {
+        std::lock_guard _(reg.lock);
+        if (parent) {
+            if (!reg.valid(parent->id())) {
+                return make_exception_future<io_priority_group>(make_backtraced_exception_ptr<std::runtime_error>(fmt::format("Invalid parent I/O priority group while creating {}", name)));
+            }
+            parent_id = parent->id();
+        }
+        auto it = std::find_if(reg.groups.begin(), reg.groups.end(), [] (const auto& n) { return !n; });
+        id = it - reg.groups.begin();
+        if (it == reg.groups.end()) {
+            reg.groups.emplace_back();
+        }
+        reg.groups[id].emplace(io_priority_group_registry::node{ .parent = parent_id });
+        if (parent_id) {
+            reg.groups[*parent_id]->members++;
+        }
+    } catch (...) {
+        return current_exception_as_future<io_priority_group>();
+    }
+
+    return smp::invoke_on_all([id, name, shares = io_group_shares(shares), parent_id] {
+        engine().create_io_priority_group(id, name, shares, parent_id);
+    }).then([id] {
+        return make_ready_future<io_priority_group>(io_priority_group(id));
+    });
+}
+
+future<>
+destroy_io_priority_group(io_priority_group group) noexcept {
+    auto& reg = io_priority_groups();
+    {
+        std::lock_guard _(reg.lock);
+        if (!reg.valid(group.id())) {
+            return make_exception_future<>(make_backtraced_exception_ptr<std::runtime_error>("Attempt to destroy an invalid I/O priority group"));
+        }
+        if (reg.groups[group.id()]->members != 0) {
+            return make_exception_future<>(make_backtraced_exception_ptr<std::runtime_error>("Attempt to destroy a non-empty I/O priority group"));
+        }
+        reg.groups[group.id()]->dying = true;
+    }
+
+    return smp::invoke_on_all([id = group.id()] {
+        engine().destroy_io_priority_group(id);
+    }).then([id = group.id()] {
+        auto& reg = io_priority_groups();
+        std::lock_guard _(reg.lock);
+        if (auto parent = reg.groups[id]->parent) {
+            reg.groups[*parent]->members--;
+        }
+        reg.groups[id].reset();
+    });
+}
+
+future<>
+set_io_priority_group(scheduling_group sg, std::optional<io_priority_group> group) noexcept {
+    auto& reg = io_priority_groups();
+    std::optional<unsigned> group_id;
+    {
+        std::lock_guard _(reg.lock);
+        if (group) {
+            if (!reg.valid(group->id())) {
+                return make_exception_future<>(make_backtraced_exception_ptr<std::runtime_error>("Invalid I/O priority group"));
+            }
+            group_id = group->id();
+        }
+        auto& cur = reg.class_groups[internal::scheduling_group_index(sg)];
+        if (cur == group_id) {
+            return make_ready_future<>();
+        }
+        if (cur) {
+            reg.groups[*cur]->members--;
+        }
+        if (group_id) {
+            reg.groups[*group_id]->members++;
+        }
+        cur = group_id;
+    }
+
+    return smp::invoke_on_all([pc = internal::priority_class(sg), group_id] {
+        engine().set_io_priority_group(pc, group_id);
+    });
+}
+
+future<> io_priority_group::set_shares(float shares) const noexcept {
+    return smp::invoke_on_all([id = _id, shares = io_group_shares(shares)] {
+        engine().update_shares_for_io_priority_group(id, shares);
+    });
+}
+
+future<> io_priority_group::update_io_bandwidth(uint64_t bandwidth) const noexcept {
+    return engine().update_bandwidth_for_io_priority_group(_id, bandwidth);
+}
+
 namespace internal {
 
 void add_to_flush_poller(output_stream<char>& os) noexcept {
@@ -26,6 +26,7 @@ module;
 #include <chrono>
 #include <filesystem>
 #include <thread>
+#include <unordered_map>
 #include <utility>
 #include <fcntl.h>
 #include <signal.h>
@@ -33,6 +34,8 @@ module;
 #include <poll.h>
 #include <sys/syscall.h>
 #include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
 #include <boost/container/small_vector.hpp>
 #include <fmt/core.h>
 #include <seastar/util/assert.hh>
@@ -47,11 +50,17 @@ module seastar;
 #include "core/reactor_backend.hh"
 #include "core/thread_pool.hh"
 #include "core/syscall_result.hh"
+#include <seastar/core/aligned_buffer.hh>
+#include <seastar/core/bitops.hh>
+#include <seastar/core/circular_buffer.hh>
 #include <seastar/core/internal/buffer_allocator.hh>
+#include <seastar/core/internal/run_in_background.hh>
 #include <seastar/util/internal/iovec_utils.hh>
 #include <seastar/core/internal/uname.hh>
+#include <seastar/core/metrics.hh>
 #include <seastar/core/print.hh>
 #include <seastar/core/reactor.hh>
+#include <seastar/core/sharded.hh>
 #include <seastar/core/smp.hh>
 #include <seastar/util/defer.hh>
 #include <seastar/util/read_first_line.hh>
@@ -211,6 +220,7 @@ aio_storage_context::submit_work() {
 
         auto& io = _iocb_pool.get_one();
         prepare_iocb(req, desc, io);
+        desc->on_submit();
 
         if (_r._aio_eventfd) {
             set_eventfd_notification(io, _r._aio_eventfd->get_fd());
@@ -471,6 +481,23 @@ bool preempt_io_context::service_preempting_io() {
     return did_work;
 }
 
+future<syscall_result<int>> reactor_backend::openat(sstring path, int flags, mode_t mode) {
+    return make_ready_future<syscall_result<int>>(-1, ENOSYS);
+}
+
+future<syscall_result_extra<struct stat>> reactor_backend::statx(int dirfd, sstring path, int flags) {
+    struct stat st = {};
+    return make_ready_future<syscall_result_extra<struct stat>>(-1, ENOSYS, st);
+}
+
+future<syscall_result<int>> reactor_backend::renameat(sstring oldpath, sstring newpath) {
+    return make_ready_future<syscall_result<int>>(-1, ENOSYS);
+}
+
+future<syscall_result<int>> reactor_backend::unlinkat(sstring path, int flags) {
+    return make_ready_future<syscall_result<int>>(-1, ENOSYS);
+}
+
 file_desc reactor_backend_aio::make_timerfd() {
     return file_desc::timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC|TFD_NONBLOCK);
 }
@@ -1104,7 +1131,7 @@ void reactor_backend_epoll::reset_preemption_monitor() {
 
 static
 std::optional<::io_uring>
-try_create_uring(unsigned queue_len, bool throw_on_error) {
+try_create_uring(unsigned queue_len, bool throw_on_error, ::io_uring_params params = {}) {
     auto required_features =
             IORING_FEAT_SUBMIT_STABLE
             | IORING_FEAT_NODROP;
@@ -1128,7 +1155,6 @@ try_create_uring(unsigned queue_len, bool throw_on_error) {
         }
     };
 
-    auto params = ::io_uring_params{};
     ::io_uring ring;
     auto err = ::io_uring_queue_init_params(queue_len, &ring, &params);
     if (err != 0) {
@@ -1200,6 +1226,115 @@ detect_io_uring() {
     return bool(ring_opt);
 }
 
+// A pool of DMA-aligned buffers registered with the ring. Reads and writes
+// whose memory falls entirely into one of them can be submitted as
+// READ_FIXED/WRITE_FIXED, so the kernel doesn't need to pin and unpin the
+// pages for every request. Buffers handed out keep the pool alive, so they
+// may safely outlive the backend, and return their slot when released. Once
+// the pool runs dry, allocations fall back to plain aligned buffers.
+class uring_registered_buffers : public enable_lw_shared_from_this<uring_registered_buffers> {
+    const size_t _buffer_size;
+    const unsigned _nr;
+    std::unique_ptr<char[], free_deleter> _area;
+    std::vector<unsigned> _free;
+public:
+    uring_registered_buffers(unsigned nr, size_t buffer_size)
+            : _buffer_size(buffer_size)
+            , _nr(nr)
+            , _area(allocate_aligned_buffer<char>(size_t(nr) * buffer_size, 4096)) {
+        _free.reserve(nr);
+        for (unsigned i = nr; i != 0; --i) {
+            _free.push_back(i - 1);
+        }
+    }
+
+    std::vector<::iovec> iovecs() const {
+        std::vector<::iovec> ret;
+        ret.reserve(_nr);
+        for (unsigned i = 0; i != _nr; ++i) {
+            ret.push_back(::iovec{_area.get() + i * _buffer_size, _buffer_size});
+        }
+        return ret;
+    }
+
+    // Returns the index of the registered buffer [addr, addr + len) belongs
+    // to, or -1 if it doesn't fit into a single one.
+    int find(const void* addr, size_t len) const noexcept {
+        auto base = reinterpret_cast<uintptr_t>(_area.get());
+        auto a = reinterpret_cast<uintptr_t>(addr);
+        if (a < base || a - base >= _nr * _buffer_size) {
+            return -1;
+        }
+        auto idx = (a - base) / _buffer_size;
+        if (a + len > base + (idx + 1) * _buffer_size) {
+            return -1;
+        }
+        return idx;
+    }
+
+    // Returns an empty buffer if the request cannot be served from the pool.
+    temporary_buffer<char> allocate(size_t alignment, size_t size) {
+        if (size > _buffer_size || alignment > 4096 || _free.empty()) {
+            return temporary_buffer<char>();
+        }
+        auto idx = _free.back();
+        _free.pop_back();
+        return temporary_buffer<char>(_area.get() + idx * _buffer_size, size,
+                make_deleter([pool = make_foreign(shared_from_this()), idx] {
+                    // The free list may only be touched on the owning shard
+                    auto owner = pool.get_owner_shard();
+                    if (owner == this_shard_id()) {
+                        pool->_free.push_back(idx);
+                    } else {
+                        internal::run_in_background(smp::submit_to(owner, [p = pool.get(), idx] {
+                            p->_free.push_back(idx);
+                        }));
+                    }
+                }));
+    }
+};
+
+// A ring of buffers the kernel picks from when completing receives
+// submitted with IOSQE_BUFFER_SELECT. Buffers are returned to the ring as
+// soon as their contents are consumed, so memory is only tied up by data in
+// flight, not by connections that happen to have a receive pending.
+class uring_provided_buffers {
+    ::io_uring& _ring;
+    const unsigned _nr;
+    const size_t _buffer_size;
+    std::unique_ptr<char[], free_deleter> _area;
+    ::io_uring_buf_ring* _br;
+public:
+    static constexpr int group_id = 0;
+
+    // nr must be a power of two
+    uring_provided_buffers(::io_uring& ring, unsigned nr, size_t buffer_size)
+            : _ring(ring)
+            , _nr(nr)
+            , _buffer_size(buffer_size)
+            , _area(allocate_aligned_buffer<char>(size_t(nr) * buffer_size, 4096)) {
+        int ret = 0;
+        _br = ::io_uring_setup_buf_ring(&_ring, _nr, group_id, 0, &ret);
+        if (!_br) {
+            throw std::system_error(-ret, std::system_category(), "io_uring_setup_buf_ring");
+        }
+        for (unsigned i = 0; i != _nr; ++i) {
+            ::io_uring_buf_ring_add(_br, buffer(i), _buffer_size, i, ::io_uring_buf_ring_mask(_nr), i);
+        }
+        ::io_uring_buf_ring_advance(_br, _nr);
+    }
+    ~uring_provided_buffers() {
+        ::io_uring_free_buf_ring(&_ring, _br, _nr, group_id);
+    }
+    char* buffer(unsigned bid) noexcept {
+        return _area.get() + size_t(bid) * _buffer_size;
+    }
+    void recycle(unsigned bid) noexcept {
+        ::io_uring_buf_ring_add(_br, buffer(bid), _buffer_size, bid, ::io_uring_buf_ring_mask(_nr), 0);
+        ::io_uring_buf_ring_advance(_br, 1);
+    }
+};
+
 class reactor_backend_uring final : public reactor_backend {
     // s_queue_len is more or less arbitrary. Too low and we'll be
     // issuing too small batches, too high and we require too much locked
@@ -1207,19 +1342,506 @@ class reactor_backend_uring final : public reactor_backend {
     static constexpr unsigned s_queue_len = 200;
     reactor& _r;
     ::io_uring _uring;
+    struct {
+        uint64_t with_syscall = 0;
+        uint64_t without_syscall = 0;
+    } _submissions;
     bool _did_work_while_getting_sqe = false;
     bool _has_pending_submissions = false;
     file_desc _hrtimer_timerfd;
     preempt_io_context _preempt_io_context;
+    lw_shared_ptr<uring_registered_buffers> _registered_buffers;
+    struct fixed_file {
+        unsigned slot;
+        unsigned refs;
+    };
+    std::unordered_map<int, fixed_file> _fixed_files;
+    std::vector<unsigned> _free_fixed_file_slots;
+    // Slots of unregistered files. Sqes submitted before the file was
+    // unregistered may still refer to the slot until the kernel consumes
+    // them, which with SQPOLL happens asynchronously.
+    struct released_fixed_file {
+        unsigned slot;
+        unsigned sq_tail;
+    };
+    std::vector<released_fixed_file> _released_fixed_files;
+    bool _use_multishot_accept = false;
+    std::unique_ptr<uring_provided_buffers> _provided_buffers;
+    size_t _zero_copy_send_threshold = 0;
+    // Whether the kernel tells, in the notification, if the data of a
+    // zero-copy send had to be copied after all (Linux 6.2)
+    bool _zero_copy_send_report_usage = false;
+    struct {
+        uint64_t zero_copy = 0;
+        uint64_t copied = 0;
+        uint64_t unsupported = 0;
+    } _zero_copy_sends;
+    bool _file_system_calls = false;
+
+    // Completions that need the CQE flags (multishot requests) are told apart
+    // from plain kernel_completions by tagging the low bit of user_data.
+    class uring_completion {
+    public:
+        static constexpr uintptr_t tag = 1;
+        virtual ~uring_completion() = default;
+        virtual void complete_with(int res, uint32_t flags) = 0;
+        void* user_data() noexcept {
+            return reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(this) | tag);
+        }
+    };
+
+    // A request that stays armed in the kernel and posts a completion per
+    // event until it terminates (a CQE without IORING_CQE_F_MORE). It is owned
+    // by its pollable_fd_state; if that goes away while the request is armed,
+    // the request is cancelled and the object deletes itself on the final CQE.
+    class multishot_completion : public uring_completion {
+    protected:
+        reactor_backend_uring& _be;
+        bool _armed = false;
+        bool _orphaned = false;
+        bool _stopping = false;
+        virtual void prep(::io_uring_sqe* sqe) = 0;
+        virtual bool wants_more() const noexcept = 0;
+        // Called by subclasses at the end of complete_with(). Returns false
+        // if the object was deleted.
+        bool maybe_terminated(uint32_t flags) noexcept {
+            if (flags & IORING_CQE_F_MORE) {
+                return true;
+            }
+            _armed = false;
+            _stopping = false;
+            if (_orphaned) {
+                delete this;
+                return false;
+            }
+            if (wants_more()) {
+                // Can't get an sqe from within completion processing, so
+                // defer re-arming to the next submission.
+                _be._multishot_rearm.push_back(this);
+            }
+            return true;
+        }
+        // Asks the kernel to terminate the request, e.g. because the consumer
+        // fell behind. arm() starts it again once the final CQE is in.
+        void stop() {
+            if (_armed && !_stopping && !_orphaned) {
+                _stopping = true;
+                _be._multishot_stop.push_back(this);
+            }
+        }
+    public:
+        explicit multishot_completion(reactor_backend_uring& be) : _be(be) {}
+        void arm() {
+            if (_armed) {
+                return;
+            }
+            auto sqe = _be.get_sqe();
+            prep(sqe);
+            ::io_uring_sqe_set_data(sqe, user_data());
+            _be._has_pending_submissions = true;
+            _armed = true;
+        }
+        void cancel() noexcept {
+            auto sqe = _be.get_sqe();
+            ::io_uring_prep_cancel(sqe, user_data(), 0);
+            ::io_uring_sqe_set_data(sqe, nullptr);
+            _be._has_pending_submissions = true;
+        }
+        void cancel_if_stopping() noexcept {
+            // The request may have terminated by itself in the meantime
+            if (_stopping) {
+                cancel();
+            }
+        }
+        void orphan() noexcept {
+            std::erase(_be._multishot_rearm, this);
+            std::erase(_be._multishot_stop, this);
+            if (!_armed) {
+                delete this;
+                return;
+            }
+            _orphaned = true;
+            cancel();
+        }
+    };
+    std::vector<multishot_completion*> _multishot_rearm;
+    std::vector<multishot_completion*> _multishot_stop;
+
+    class multishot_accept final : public multishot_completion {
+        // Past this many unconsumed connections the request is stopped, and
+        // further ones wait in the listen backlog until get() arms it again.
+        static constexpr size_t max_ready = 256;
+        pollable_fd_state& _listenfd;
+        circular_buffer<int> _ready;
+        std::exception_ptr _ex;
+        std::optional<promise<int>> _waiter;
+
+        virtual void prep(::io_uring_sqe* sqe) override {
+            ::io_uring_prep_multishot_accept(sqe, _listenfd.fd.get(), nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        }
+        virtual bool wants_more() const noexcept override {
+            return bool(_waiter);
+        }
+        // Completions only pass the descriptor on, the peer address (which
+        // multishot accept doesn't report, every completion would overwrite
+        // the same sockaddr) is looked up by the consumer, outside of
+        // completion processing, and not at all for connections dropped
+        // unconsumed.
+        static future<std::tuple<pollable_fd, socket_address>> make_result(int fd) noexcept {
+            try {
+                pollable_fd pfd(file_desc::from_fd(fd), pollable_fd::speculation(EPOLLOUT));
+                auto sa = pfd.get_file_desc().get_remote_address();
+                return make_ready_future<std::tuple<pollable_fd, socket_address>>(std::move(pfd), std::move(sa));
+            } catch (...) {
+                return current_exception_as_future<std::tuple<pollable_fd, socket_address>>();
+            }
+        }
+    public:
+        multishot_accept(reactor_backend_uring& be, pollable_fd_state& listenfd)
+            : multishot_completion(be), _listenfd(listenfd) {}
+        ~multishot_accept() {
+            for (auto fd : _ready) {
+                ::close(fd);
+            }
+        }
+        future<std::tuple<pollable_fd, socket_address>> get() {
+            if (!_ready.empty()) {
+                auto fd = _ready.front();
+                _ready.pop_front();
+                return make_result(fd);
+            }
+            if (_ex) {
+                return make_exception_future<std::tuple<pollable_fd, socket_address>>(std::exchange(_ex, nullptr));
+            }
+            arm();
+            _waiter.emplace();
+            return _waiter->get_future().then(make_result);
+        }
+        virtual void complete_with(int res, uint32_t flags) override {
+            if (_orphaned) {
+                if (res >= 0) {
+                    ::close(res);
+                }
+            } else if (res >= 0) {
+                if (_waiter) {
+                    _waiter->set_value(res);
+                    _waiter.reset();
+                } else {
+                    _ready.push_back(res);
+                    if (_ready.size() >= max_ready) {
+                        stop();
+                    }
+                }
+            } else if (res != -ECANCELED) {
+                auto ex = std::make_exception_ptr(std::system_error(-res, std::system_category()));
+                if (res == -EINVAL) {
+                    try {
+                        // The chances are that we shutting down the connection.
+                        _listenfd.maybe_no_more_recv();
+                    } catch (...) {
+                        ex = std::current_exception();
+                    }
+                }
+                if (_waiter) {
+                    _waiter->set_exception(std::move(ex));
+                    _waiter.reset();
+                } else {
+                    _ex = std::move(ex);
+                }
+            }
+            maybe_terminated(flags);
+        }
+    };
+
+    class multishot_recv final : public multishot_completion {
+        // Past this much unconsumed data the request is stopped, so a slow
+        // reader can't make the socket's receive queue pile up in memory.
+        // get() arms it again once the consumer has drained it.
+        static constexpr size_t max_ready_bytes = 1 << 20;
+        static constexpr size_t max_ready_buffers = 256;
+        pollable_fd_state& _fd;
+        circular_buffer<temporary_buffer<char>> _ready;
+        size_t _ready_bytes = 0;
+        std::exception_ptr _ex;
+        bool _eof = false;
+        std::optional<promise<temporary_buffer<char>>> _waiter;
+        // The allocator of the reader waiting in get(). Only valid while
+        // _waiter is set; data that arrives with no one waiting is copied
+        // into plain buffers.
+        internal::buffer_allocator* _ba = nullptr;
+
+        virtual void prep(::io_uring_sqe* sqe) override {
+            ::io_uring_prep_recv_multishot(sqe, _fd.fd.get(), nullptr, 0, 0);
+            ::io_uring_sqe_set_flags(sqe, IOSQE_BUFFER_SELECT);
+            sqe->buf_group = uring_provided_buffers::group_id;
+        }
+        virtual bool wants_more() const noexcept override {
+            return bool(_waiter);
+        }
+        temporary_buffer<char> copy_out(const char* data, size_t len) {
+            if (_ba) {
+                auto buf = _ba->allocate_buffer();
+                if (buf.size() >= len) {
+                    std::copy_n(data, len, buf.get_write());
+                    buf.trim(len);
+                    return buf;
+                }
+            }
+            return temporary_buffer<char>(data, len);
+        }
+        void deliver(temporary_buffer<char> buf) {
+            if (_waiter) {
+                _waiter->set_value(std::move(buf));
+                _waiter.reset();
+                _ba = nullptr;
+            } else {
+                _ready_bytes += buf.size();
+                _ready.push_back(std::move(buf));
+                if (_ready_bytes >= max_ready_bytes || _ready.size() >= max_ready_buffers) {
+                    stop();
+                }
+            }
+        }
+    public:
+        multishot_recv(reactor_backend_uring& be, pollable_fd_state& fd)
+            : multishot_completion(be), _fd(fd) {}
+        future<temporary_buffer<char>> get(internal::buffer_allocator* ba) {
+            if (!_ready.empty()) {
+                auto buf = std::move(_ready.front());
+                _ready.pop_front();
+                _ready_bytes -= buf.size();
+                return make_ready_future<temporary_buffer<char>>(std::move(buf));
+            }
+            if (_ex) {
+                return make_exception_future<temporary_buffer<char>>(std::exchange(_ex, nullptr));
+            }
+            if (_eof) {
+                return make_ready_future<temporary_buffer<char>>();
+            }
+            arm();
+            _waiter.emplace();
+            _ba = ba;
+            return _waiter->get_future();
+        }
+        virtual void complete_with(int res, uint32_t flags) override {
+            if (flags & IORING_CQE_F_BUFFER) {
+                auto bid = flags >> IORING_CQE_BUFFER_SHIFT;
+                if (!_orphaned && res > 0) {
+                    try {
+                        // Copy out so that the ring buffer can go back to
+                        // the kernel right away.
+                        deliver(copy_out(_be._provided_buffers->buffer(bid), res));
+                    } catch (...) {
+                        _ex = std::current_exception();
+                    }
+                }
+                _be._provided_buffers->recycle(bid);
+            } else if (_orphaned) {
+                // nothing to report to
+            } else if (res == 0) {
+                _eof = true;
+                deliver(temporary_buffer<char>());
+            } else if (res < 0 && res != -ENOBUFS && res != -ECANCELED) {
+                auto ex = std::make_exception_ptr(std::system_error(-res, std::system_category()));
+                if (_waiter) {
+                    _waiter->set_exception(std::move(ex));
+                    _waiter.reset();
+                    _ba = nullptr;
+                } else {
+                    _ex = std::move(ex);
+                }
+            }
+            maybe_terminated(flags);
+        }
+    };
+
+    // A zero-copy send posts two completions: the result of the send, and
+    // later a notification (IORING_CQE_F_NOTIF) once the kernel is done with
+    // the memory. The packet data, and the fd state, are kept alive until
+    // the latter.
+    class zero_copy_send_completion final : public uring_completion {
+        reactor_backend_uring& _be;
+        pollable_fd_state_ptr _fd;
+        net::packet _p;
+        ::msghdr _mh = {};
+        promise<int> _result;
+    public:
+        zero_copy_send_completion(reactor_backend_uring& be, pollable_fd_state& fd, net::packet& p)
+                : _be(be), _fd(&fd), _p(p.share()) {
+            _mh.msg_iov = reinterpret_cast<iovec*>(_p.fragment_array());
+            _mh.msg_iovlen = std::min<size_t>(_p.nr_frags(), IOV_MAX);
+        }
+        ::msghdr* msghdr() {
+            return &_mh;
+        }
+        // Resolves with the raw result, so that the caller can tell sockets
+        // that don't support zero-copy sends from other errors
+        future<int> get_future() {
+            return _result.get_future();
+        }
+        virtual void complete_with(int res, uint32_t flags) override {
+            if (flags & IORING_CQE_F_NOTIF) {
+                // Without usage reports, res is always 0
+                if (uint32_t(res) & IORING_NOTIF_USAGE_ZC_COPIED) {
+                    _be._zero_copy_sends.copied++;
+                } else {
+                    _be._zero_copy_sends.zero_copy++;
+                }
+                delete this;
+                return;
+            }
+            if (res >= 0 && size_t(res) == _p.len()) {
+                _fd->speculate_epoll(EPOLLOUT);
+            }
+            _result.set_value(res);
+            if (!(flags & IORING_CQE_F_MORE)) {
+                // no notification will follow
+                delete this;
+            }
+        }
+    };
+
+    future<size_t> zero_copy_sendmsg(pollable_fd_state& fd, net::packet& p) {
+        auto desc = std::make_unique<zero_copy_send_completion>(*this, fd, p);
+        auto sqe = get_sqe();
+        ::io_uring_prep_sendmsg_zc(sqe, fd.fd.get(), desc->msghdr(), MSG_NOSIGNAL);
+        if (_zero_copy_send_report_usage) {
+            sqe->ioprio |= IORING_SEND_ZC_REPORT_USAGE;
+        }
+        ::io_uring_sqe_set_data(sqe, desc->user_data());
+        _has_pending_submissions = true;
+        return desc.release()->get_future().then([this, &fd, &p] (int res) {
+            if (res == -EOPNOTSUPP) {
+                // Not every socket type supports it (e.g. AF_UNIX); send
+                // this one, and everything after it, the regular way
+                _zero_copy_sends.unsupported++;
+                static_cast<uring_pollable_fd_state&>(fd)._zero_copy_send_unsupported = true;
+                return copying_sendmsg(fd, p);
+            }
+            if (res < 0) {
+                return make_exception_future<size_t>(std::system_error(-res, std::system_category()));
+            }
+            return make_ready_future<size_t>(res);
+        });
+    }
+
+    // A write submitted together with the fdatasync() that follows it, chained
+    // with IOSQE_IO_LINK so that both take a single trip to the kernel. Both
+    // sqes carry this object; linked requests complete in order, so the first
+    // cqe is the write's. A failed or short write breaks the chain and the
+    // sync comes back with -ECANCELED: after a short write, the sync is
+    // issued again on its own, so the caller still gets a synced partial write.
+    // Like re-arming multishot requests, that waits for the next submission,
+    // as no sqe can be taken while completions are being processed.
+    class linked_fdatasync_completion final : public uring_completion {
+        reactor_backend_uring& _be;
+        io_completion* _completion;
+        int _fd;
+        enum class stage { write, linked_sync, sync } _stage = stage::write;
+        ssize_t _written = 0;
+    public:
+        linked_fdatasync_completion(reactor_backend_uring& be, io_completion* completion, int fd) noexcept
+                : _be(be), _completion(completion), _fd(fd) {
+        }
+        void prep_sync(::io_uring_sqe* sqe) noexcept {
+            ::io_uring_prep_fsync(sqe, _fd, IORING_FSYNC_DATASYNC);
+            sqe->fd = _be.prep_file(sqe, _fd);
+            ::io_uring_sqe_set_data(sqe, user_data());
+        }
+        virtual void complete_with(int res, uint32_t flags) override {
+            switch (std::exchange(_stage, _stage == stage::write ? stage::linked_sync : stage::sync)) {
+            case stage::write:
+                _written = res;
+                return;
+            case stage::linked_sync:
+                if (res == -ECANCELED && _written > 0) {
+                    _be._deferred_syncs.push_back(this);
+                    return;
+                }
+                break;
+            case stage::sync:
+                break;
+            }
+            _completion->complete_with(_written < 0 || res >= 0 ? _written : res);
+            delete this;
+        }
+    };
+
+    std::vector<linked_fdatasync_completion*> _deferred_syncs;
+
+    // Completes a path-based file system call with the raw result
+    class file_system_call_completion final : public uring_completion {
+        promise<syscall_result<int>> _result;
+    public:
+        future<syscall_result<int>> get_future() {
+            return _result.get_future();
+        }
+        virtual void complete_with(int res, uint32_t flags) override {
+            _result.set_value(res < 0 ? -1 : res, res < 0 ? -res : 0);
+            delete this;
+        }
+    };
+
+    // The arguments prep() points the sqe to must live until the future resolves
+    template <typename Prep>
+    future<syscall_result<int>> file_system_call(Prep prep) {
+        auto desc = std::make_unique<file_system_call_completion>();
+        auto fut = desc->get_future();
+        auto sqe = get_sqe();
+        prep(sqe);
+        ::io_uring_sqe_set_data(sqe, desc.release()->user_data());
+        _has_pending_submissions = true;
+        return fut;
+    }
+
+    static struct stat statx_to_stat(const struct ::statx& stx) noexcept {
+        struct stat st = {};
+        st.st_dev = makedev(stx.stx_dev_major, stx.stx_dev_minor);
+        st.st_ino = stx.stx_ino;
+        st.st_mode = stx.stx_mode;
+        st.st_nlink = stx.stx_nlink;
+        st.st_uid = stx.stx_uid;
+        st.st_gid = stx.stx_gid;
+        st.st_rdev = makedev(stx.stx_rdev_major, stx.stx_rdev_minor);
+        st.st_size = stx.stx_size;
+        st.st_blksize = stx.stx_blksize;
+        st.st_blocks = stx.stx_blocks;
+        st.st_atim = {stx.stx_atime.tv_sec, stx.stx_atime.tv_nsec};
+        st.st_mtim = {stx.stx_mtime.tv_sec, stx.stx_mtime.tv_nsec};
+        st.st_ctim = {stx.stx_ctime.tv_sec, stx.stx_ctime.tv_nsec};
+        return st;
+    }
+
+    // Keeps the next n get_sqe() calls from flushing the ring in between, which
+    // would submit a linked chain in pieces
+    void reserve_sqes(unsigned n) {
+        while (::io_uring_sq_space_left(&_uring) < n) {
+            submit();
+            do_process_kernel_completions_step();
+            _did_work_while_getting_sqe = true;
+        }
+    }
 
     class uring_pollable_fd_state : public pollable_fd_state {
         pollable_fd_state_completion _completion_pollin;
         pollable_fd_state_completion _completion_pollout;
         pollable_fd_state_completion _completion_pollrdhup;
     public:
+        multishot_accept* _multishot_accept = nullptr;
+        multishot_recv* _multishot_recv = nullptr;
+        bool _zero_copy_send_unsupported = false;
+
         explicit uring_pollable_fd_state(file_desc desc, speculation speculate)
                 : pollable_fd_state(std::move(desc), std::move(speculate)) {
         }
+        ~uring_pollable_fd_state() {
+            if (_multishot_accept) {
+                _multishot_accept->orphan();
+            }
+            if (_multishot_recv) {
+                _multishot_recv->orphan();
+            }
+        }
         pollable_fd_state_completion* get_desc(int events) {
             if (events & POLLIN) {
                 return &_completion_pollin;
@@ -1288,11 +1910,82 @@ class reactor_backend_uring final : public reactor_backend {
         return ::io_uring_get_sqe(&_uring);
     }
 
+    static ::io_uring create_uring(const reactor_config& cfg, unsigned shard) {
+        auto params = ::io_uring_params{};
+        if (cfg.uring_sqpoll) {
+            params.flags |= IORING_SETUP_SQPOLL;
+            params.sq_thread_idle = cfg.uring_sqpoll_idle_ms;
+            if (!cfg.uring_sqpoll_cpus.empty()) {
+                params.flags |= IORING_SETUP_SQ_AFF;
+                params.sq_thread_cpu = cfg.uring_sqpoll_cpus[shard % cfg.uring_sqpoll_cpus.size()];
+            }
+            if (cfg.uring_coop_taskrun || cfg.uring_defer_taskrun) {
+                // The polling thread runs completions itself, the kernel
+                // refuses the task-run flags with it.
+                seastar_logger.warn("--io-uring-coop-taskrun and --io-uring-defer-taskrun are ignored with --io-uring-sqpoll");
+            }
+        } else if (cfg.uring_defer_taskrun) {
+            params.flags |= IORING_SETUP_DEFER_TASKRUN | IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_TASKRUN_FLAG;
+        } else if (cfg.uring_coop_taskrun) {
+            params.flags |= IORING_SETUP_COOP_TASKRUN | IORING_SETUP_TASKRUN_FLAG;
+        }
+        if (cfg.uring_single_issuer) {
+            params.flags |= IORING_SETUP_SINGLE_ISSUER;
+        }
+        if (params.flags) {
+            auto ring = try_create_uring(s_queue_len, false, params);
+            if (ring) {
+                return *ring;
+            }
+            seastar_logger.warn("Unable to create io_uring with setup flags 0x{:x}, falling back to defaults", params.flags);
+        }
+        return try_create_uring(s_queue_len, true).value();
+    }
+
+    bool sqpoll() const noexcept {
+        return _uring.flags & IORING_SETUP_SQPOLL;
+    }
+
+    // The mode the ring ended up in, which is not the requested one if the
+    // kernel refused the setup flags
+    const char* setup_mode() const noexcept {
+        if (sqpoll()) {
+            return "sqpoll";
+        } else if (_uring.flags & IORING_SETUP_DEFER_TASKRUN) {
+            return "defer_taskrun";
+        } else if (_uring.flags & IORING_SETUP_COOP_TASKRUN) {
+            return "coop_taskrun";
+        }
+        return "default";
+    }
+
+    // Pushes the prepared sqes to the kernel, entering it only if it has to:
+    // with a polling thread that is awake, publishing the new tail is enough.
+    int submit() {
+        if (_uring.sq.sqe_tail != _uring.sq.sqe_head) {
+            if (sqpoll() && !(__atomic_load_n(_uring.sq.kflags, __ATOMIC_ACQUIRE) & IORING_SQ_NEED_WAKEUP)) {
+                _submissions.without_syscall++;
+            } else {
+                _submissions.with_syscall++;
+            }
+        }
+        return ::io_uring_submit(&_uring);
+    }
+
+    // With COOP_TASKRUN and DEFER_TASKRUN, completions only show up in the
+    // ring once we enter the kernel; it tells us when there are any waiting.
+    void maybe_get_events() {
+        if ((_uring.flags & IORING_SETUP_TASKRUN_FLAG)
+                && (__atomic_load_n(_uring.sq.kflags, __ATOMIC_RELAXED) & IORING_SQ_TASKRUN)) {
+            ::io_uring_get_events(&_uring);
+        }
+    }
+
     bool do_flush_submission_ring() {
         if (_has_pending_submissions) {
             _has_pending_submissions = false;
             _did_work_while_getting_sqe = false;
-            io_uring_submit(&_uring);
+            submit();
             return true;
         } else {
             return std::exchange(_did_work_while_getting_sqe, false);
@@ -1318,33 +2011,140 @@ class reactor_backend_uring final : public reactor_backend {
         return ufd->get_completion_future(events);
     }
 
+    void setup_registered_resources(const reactor_config& cfg) {
+        if (cfg.uring_registered_buffers) {
+            auto pool = make_lw_shared<uring_registered_buffers>(cfg.uring_registered_buffers, cfg.uring_registered_buffer_size);
+            auto iov = pool->iovecs();
+            auto r = ::io_uring_register_buffers(&_uring, iov.data(), iov.size());
+            if (r < 0) {
+                seastar_logger.warn("Unable to register {} io_uring buffers, continuing without them: {}",
+                        iov.size(), std::system_error(-r, std::system_category()).what());
+            } else {
+                _registered_buffers = std::move(pool);
+            }
+        }
+        if (cfg.uring_fixed_files) {
+            // Start with an empty (all -1) table, files are put into it as they're opened
+            std::vector<int> fds(cfg.uring_fixed_files, -1);
+            auto r = ::io_uring_register_files(&_uring, fds.data(), fds.size());
+            if (r < 0) {
+                seastar_logger.warn("Unable to register {} io_uring file slots, continuing without them: {}",
+                        fds.size(), std::system_error(-r, std::system_category()).what());
+            } else {
+                _free_fixed_file_slots.reserve(fds.size());
+                _released_fixed_files.reserve(fds.size());
+                for (unsigned i = fds.size(); i != 0; --i) {
+                    _free_fixed_file_slots.push_back(i - 1);
+                }
+            }
+        }
+        if (cfg.uring_multishot_accept) {
+            if (kernel_uname().whitelisted({"5.19"})) {
+                _use_multishot_accept = true;
+            } else {
+                seastar_logger.warn("io_uring multishot accept requires Linux 5.19, continuing without it");
+            }
+        }
+        if (cfg.uring_provided_buffers) {
+            if (!kernel_uname().whitelisted({"6.0"})) {
+                seastar_logger.warn("io_uring multishot recv requires Linux 6.0, continuing without it");
+                return;
+            }
+            auto nr = std::min<unsigned>(1u << log2ceil(cfg.uring_provided_buffers), 1u << 15);
+            try {
+                _provided_buffers = std::make_unique<uring_provided_buffers>(_uring, nr, cfg.uring_provided_buffer_size);
+            } catch (const std::system_error& e) {
+                seastar_logger.warn("Unable to set up io_uring provided buffer ring, continuing without it: {}", e.what());
+            }
+        }
+    }
+
+    void setup_file_system_calls() {
+        auto probe = ::io_uring_get_probe_ring(&_uring);
+        if (!probe) {
+            return;
+        }
+        auto free_probe = defer([&] () noexcept { ::io_uring_free_probe(probe); });
+        _file_system_calls = true;
+        for (auto op : {IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_RENAMEAT, IORING_OP_UNLINKAT}) {
+            _file_system_calls &= bool(::io_uring_opcode_supported(probe, op));
+        }
+    }
+
+    void setup_zero_copy_send(const reactor_config& cfg) {
+        if (!cfg.uring_zero_copy_send_threshold) {
+            return;
+        }
+        if (!kernel_uname().whitelisted({"6.1"})) {
+            seastar_logger.warn("io_uring zero-copy send requires Linux 6.1, continuing without it");
+            return;
+        }
+        _zero_copy_send_threshold = cfg.uring_zero_copy_send_threshold;
+        _zero_copy_send_report_usage = kernel_uname().whitelisted({"6.2"});
+    }
+
+    // Translates the file descriptor to its registered slot, if it has one
+    int prep_file(::io_uring_sqe* sqe, int fd) noexcept {
+        if (_fixed_files.empty()) {
+            return fd;
+        }
+        auto it = _fixed_files.find(fd);
+        if (it == _fixed_files.end()) {
+            return fd;
+        }
+        ::io_uring_sqe_set_flags(sqe, IOSQE_FIXED_FILE);
+        return it->second.slot;
+    }
+
+    int registered_buffer_index(const void* addr, size_t len) const noexcept {
+        return _registered_buffers ? _registered_buffers->find(addr, len) : -1;
+    }
+
     void submit_io_request(const internal::io_request& req, io_completion* completion) {
+        if (req.linked_fdatasync()) {
+            reserve_sqes(2);
+        }
         auto sqe = get_sqe();
         using o = internal::io_request::operation;
         switch (req.opcode()) {
             case o::read: {
                 const auto& op = req.as<io_request::operation::read>();
-                ::io_uring_prep_read(sqe, op.fd, op.addr, op.size, op.pos);
+                auto buf_index = registered_buffer_index(op.addr, op.size);
+                if (buf_index >= 0) {
+                    ::io_uring_prep_read_fixed(sqe, op.fd, op.addr, op.size, op.pos, buf_index);
+                } else {
+                    ::io_uring_prep_read(sqe, op.fd, op.addr, op.size, op.pos);
+                }
+                sqe->fd = prep_file(sqe, op.fd);
                 break;
             }
             case o::write: {
                 const auto& op = req.as<io_request::operation::write>();
-                ::io_uring_prep_write(sqe, op.fd, op.addr, op.size, op.pos);
+                auto buf_index = registered_buffer_index(op.addr, op.size);
+                if (buf_index >= 0) {
+                    ::io_uring_prep_write_fixed(sqe, op.fd, op.addr, op.size, op.pos, buf_index);
+                } else {
+                    ::io_uring_prep_write(sqe, op.fd, op.addr, op.size, op.pos);
+                }
+                sqe->fd = prep_file(sqe, op.fd);
                 break;
             }
             case o::readv: {
                 const auto& op = req.as<io_request::operation::readv>();
                 ::io_uring_prep_readv(sqe, op.fd, op.iovec, op.iov_len, op.pos);
+                sqe->fd = prep_file(sqe, op.fd);
                 break;
             }
             case o::writev: {
                 const auto& op = req.as<io_request::operation::writev>();
                 ::io_uring_prep_writev(sqe, op.fd, op.iovec, op.iov_len, op.pos);
+                sqe->fd = prep_file(sqe, op.fd);
                 break;
             }
             case o::fdatasync: {
                 const auto& op = req.as<io_request::operation::fdatasync>();
                 ::io_uring_prep_fsync(sqe, op.fd, IORING_FSYNC_DATASYNC);
+                sqe->fd = prep_file(sqe, op.fd);
                 break;
             }
             case o::recv: {
@@ -1386,14 +2186,50 @@ class reactor_backend_uring final : public reactor_backend {
                 seastar_logger.error("Invalid operation for iocb: {}", req.opname());
                 abort();
         }
-        ::io_uring_sqe_set_data(sqe, completion);
+        if (req.linked_fdatasync()) {
+            auto fd = req.opcode() == o::write ? req.as<o::write>().fd : req.as<o::writev>().fd;
+            auto desc = new linked_fdatasync_completion(*this, completion, fd);
+            ::io_uring_sqe_set_flags(sqe, sqe->flags | IOSQE_IO_LINK);
+            ::io_uring_sqe_set_data(sqe, desc->user_data());
+            desc->prep_sync(get_sqe());
+        } else {
+            ::io_uring_sqe_set_data(sqe, completion);
+        }
+
+        _has_pending_submissions = true;
+    }
 
+    bool issue_deferred_syncs() {
+        if (_deferred_syncs.empty()) {
+            return false;
+        }
+        auto syncs = std::exchange(_deferred_syncs, {});
+        for (auto c : syncs) {
+            c->prep_sync(get_sqe());
+        }
         _has_pending_submissions = true;
+        return true;
+    }
+
+    bool rearm_multishot() {
+        if (_multishot_rearm.empty() && _multishot_stop.empty()) {
+            return false;
+        }
+        auto rearm = std::exchange(_multishot_rearm, {});
+        for (auto c : rearm) {
+            c->arm();
+        }
+        auto stop = std::exchange(_multishot_stop, {});
+        for (auto c : stop) {
+            c->cancel_if_stopping();
+        }
+        return true;
     }
 
     // Returns true if any work was done
     bool queue_pending_file_io() {
         return _r._io_sink.drain([&] (const internal::io_request& req, io_completion* completion) -> bool {
+            completion->on_submit();
             submit_io_request(req, completion);
             return true;
         });
@@ -1405,7 +2241,16 @@ class reactor_backend_uring final : public reactor_backend {
     void do_process_ready_kernel_completions(::io_uring_cqe** buf, size_t nr) {
         for (auto p = buf; p != buf + nr; ++p) {
             auto cqe = *p;
+            if (cqe->user_data & uring_completion::tag) {
+                auto completion = reinterpret_cast<uring_completion*>(cqe->user_data & ~uring_completion::tag);
+                completion->complete_with(cqe->res, cqe->flags);
+                continue;
+            }
             auto completion = reinterpret_cast<kernel_completion*>(cqe->user_data);
+            if (!completion) {
+                // cancellation requests
+                continue;
+            }
             completion->complete_with(cqe->res);
         }
     }
@@ -1421,6 +2266,7 @@ class reactor_backend_uring final : public reactor_backend {
 
     // Returns true if completions were processed
     bool do_process_kernel_completions() {
+        maybe_get_events();
         auto did_work = false;
         while (do_process_kernel_completions_step()) {
             did_work = true;
@@ -1437,7 +2283,7 @@ class reactor_backend_uring final : public reactor_backend {
 public:
     explicit reactor_backend_uring(reactor& r)
             : _r(r)
-            , _uring(try_create_uring(s_queue_len, true).value())
+            , _uring(create_uring(r._cfg, r._id))
             , _hrtimer_timerfd(make_timerfd())
             , _preempt_io_context(_r, _r._task_quota_timer, _hrtimer_timerfd)
             , _hrtimer_completion(_r, _hrtimer_timerfd)
@@ -1446,8 +2292,12 @@ class reactor_backend_uring final : public reactor_backend {
         // expired when it really hasn't, we don't want to block in read(tfd, ...).
         auto tfd = _r._task_quota_timer.get();
         ::fcntl(tfd, F_SETFL, ::fcntl(tfd, F_GETFL) | O_NONBLOCK);
+        setup_registered_resources(_r._cfg);
+        setup_zero_copy_send(_r._cfg);
+        setup_file_system_calls();
     }
     ~reactor_backend_uring() {
+        _provided_buffers.reset();
         ::io_uring_queue_exit(&_uring);
     }
     virtual bool reap_kernel_completions() override {
@@ -1457,7 +2307,10 @@ class reactor_backend_uring final : public reactor_backend {
         bool did_work = false;
         did_work |= _preempt_io_context.service_preempting_io();
         did_work |= queue_pending_file_io();
-        did_work |= ::io_uring_submit(&_uring);
+        did_work |= rearm_multishot();
+        did_work |= issue_deferred_syncs();
+        did_work |= submit();
+        free_released_fixed_files();
         return did_work;
     }
     virtual bool kernel_events_can_sleep() const override {
@@ -1467,7 +2320,9 @@ class reactor_backend_uring final : public reactor_backend {
     virtual void wait_and_process_events(const sigset_t* active_sigmask) override {
         _smp_wakeup_completion.maybe_rearm(*this);
         _hrtimer_completion.maybe_rearm(*this);
-        ::io_uring_submit(&_uring);
+        rearm_multishot();
+        issue_deferred_syncs();
+        submit();
         bool did_work = false;
         did_work |= _preempt_io_context.service_preempting_io();
         did_work |= std::exchange(_did_work_while_getting_sqe, false);
@@ -1507,6 +2362,13 @@ class reactor_backend_uring final : public reactor_backend {
         delete pfd;
     }
     virtual future<std::tuple<pollable_fd, socket_address>> accept(pollable_fd_state& listenfd) override {
+        if (_use_multishot_accept) {
+            auto ufd = static_cast<uring_pollable_fd_state*>(&listenfd);
+            if (!ufd->_multishot_accept) {
+                ufd->_multishot_accept = new multishot_accept(*this, listenfd);
+            }
+            return ufd->_multishot_accept->get();
+        }
         if (listenfd.take_speculation(POLLIN)) {
             try {
                 listenfd.maybe_no_more_recv();
@@ -1705,6 +2567,13 @@ class reactor_backend_uring final : public reactor_backend {
         });
     }
     virtual future<size_t> sendmsg(pollable_fd_state& fd, net::packet& p) final {
+        if (_zero_copy_send_threshold && p.len() >= _zero_copy_send_threshold
+                && !static_cast<uring_pollable_fd_state&>(fd)._zero_copy_send_unsupported) {
+            return zero_copy_sendmsg(fd, p);
+        }
+        return copying_sendmsg(fd, p);
+    }
+    future<size_t> copying_sendmsg(pollable_fd_state& fd, net::packet& p) {
         if (fd.take_speculation(EPOLLOUT)) {
             static_assert(offsetof(iovec, iov_base) == offsetof(net::fragment, base) &&
                 sizeof(iovec::iov_base) == sizeof(net::fragment::base) &&
@@ -1804,6 +2673,15 @@ class reactor_backend_uring final : public reactor_backend {
     }
 
     virtual future<temporary_buffer<char>> recv_some(pollable_fd_state& fd, internal::buffer_allocator* ba) override {
+        if (_provided_buffers) {
+            // Once armed, data arrives through the multishot request only;
+            // reading the socket directly could reorder it.
+            auto ufd = static_cast<uring_pollable_fd_state*>(&fd);
+            if (!ufd->_multishot_recv) {
+                ufd->_multishot_recv = new multishot_recv(*this, fd);
+            }
+            return ufd->_multishot_recv->get(ba);
+        }
         if (fd.take_speculation(POLLIN)) {
             auto buffer = ba->allocate_buffer();
             try {
@@ -1857,6 +2735,136 @@ class reactor_backend_uring final : public reactor_backend {
         return true;
     }
 
+    virtual void register_file(int fd) noexcept override {
+        auto it = _fixed_files.find(fd);
+        if (it != _fixed_files.end()) {
+            it->second.refs++;
+            return;
+        }
+        free_released_fixed_files();
+        if (_free_fixed_file_slots.empty()) {
+            return;
+        }
+        auto slot = _free_fixed_file_slots.back();
+        if (::io_uring_register_files_update(&_uring, slot, &fd, 1) != 1) {
+            return;
+        }
+        try {
+            _fixed_files.emplace(fd, fixed_file{slot, 1});
+            _free_fixed_file_slots.pop_back();
+        } catch (...) {
+            int none = -1;
+            ::io_uring_register_files_update(&_uring, slot, &none, 1);
+        }
+    }
+
+    virtual void unregister_file(int fd) noexcept override {
+        auto it = _fixed_files.find(fd);
+        if (it == _fixed_files.end() || --it->second.refs) {
+            return;
+        }
+        // Requests the kernel has picked up hold their own reference to the
+        // file, but sqes still sitting in the ring are only resolved when the
+        // kernel consumes them. The slot is released once it has consumed
+        // everything submitted so far. Requests for the fd from now on, which
+        // may already be a different file, use the fd itself.
+        submit();
+        _released_fixed_files.push_back({it->second.slot, _uring.sq.sqe_tail});
+        _fixed_files.erase(it);
+        free_released_fixed_files();
+    }
+
+    void free_released_fixed_files() noexcept {
+        if (_released_fixed_files.empty()) {
+            return;
+        }
+        auto head = __atomic_load_n(_uring.sq.khead, __ATOMIC_ACQUIRE);
+        std::erase_if(_released_fixed_files, [&] (const released_fixed_file& r) {
+            if (int(head - r.sq_tail) < 0) {
+                return false;
+            }
+            int none = -1;
+            ::io_uring_register_files_update(&_uring, r.slot, &none, 1);
+            _free_fixed_file_slots.push_back(r.slot);
+            return true;
+        });
+    }
+
+    virtual temporary_buffer<char> allocate_dma_buffer(size_t alignment, size_t size) override {
+        if (_registered_buffers) {
+            auto buf = _registered_buffers->allocate(alignment, size);
+            if (buf) {
+                return buf;
+            }
+        }
+        return temporary_buffer<char>::aligned(alignment, size);
+    }
+
+    virtual bool can_link_fdatasync() const noexcept override {
+        return _r._cfg.uring_linked_fdatasync && !_r._cfg.bypass_fsync;
+    }
+
+    virtual bool can_offload_file_system_calls() const noexcept override {
+        return _file_system_calls;
+    }
+
+    virtual future<syscall_result<int>> openat(sstring path, int flags, mode_t mode) override {
+        co_return co_await file_system_call([&] (::io_uring_sqe* sqe) {
+            ::io_uring_prep_openat(sqe, AT_FDCWD, path.c_str(), flags, mode);
+        });
+    }
+
+    virtual future<syscall_result_extra<struct stat>> statx(int dirfd, sstring path, int flags) override {
+        struct ::statx stx;
+        auto sr = co_await file_system_call([&] (::io_uring_sqe* sqe) {
+            ::io_uring_prep_statx(sqe, dirfd, path.c_str(), flags, STATX_BASIC_STATS, &stx);
+        });
+        struct stat st = {};
+        if (sr.result != -1) {
+            st = statx_to_stat(stx);
+        }
+        co_return syscall_result_extra<struct stat>(sr.result, sr.error, st);
+    }
+
+    virtual future<syscall_result<int>> renameat(sstring oldpath, sstring newpath) override {
+        co_return co_await file_system_call([&] (::io_uring_sqe* sqe) {
+            ::io_uring_prep_renameat(sqe, AT_FDCWD, oldpath.c_str(), AT_FDCWD, newpath.c_str(), 0);
+        });
+    }
+
+    virtual future<syscall_result<int>> unlinkat(sstring path, int flags) override {
+        co_return co_await file_system_call([&] (::io_uring_sqe* sqe) {
+            ::io_uring_prep_unlinkat(sqe, AT_FDCWD, path.c_str(), flags);
+        });
+    }
+
+    virtual void register_metrics(metrics::metric_groups& mg) override {
+        namespace sm = seastar::metrics;
+        auto path = sm::label("path");
+        auto mode = sm::label("mode");
+        mg.add_group("reactor", {
+            sm::make_gauge("io_uring_mode", [] { return 1; },
+                    sm::description("Set for the mode the io_uring was created in"), {mode(setup_mode())}),
+            sm::make_counter("io_uring_submissions", _submissions.with_syscall,
+                    sm::description("Number of times queued io_uring requests were submitted"), {path("syscall")}),
+            sm::make_counter("io_uring_submissions", _submissions.without_syscall,
+                    sm::description("Number of times queued io_uring requests were submitted"), {path("sqpoll")}),
+        });
+        if (_zero_copy_send_threshold) {
+            auto outcome = sm::label("outcome");
+            auto zc_description = sm::description("Number of sends made as zero-copy, by whether the data was sent without copying, "
+                    "copied by the kernel after all, or resent the regular way since the socket doesn't support zero-copy");
+            mg.add_group("reactor", {
+                sm::make_counter("io_uring_zero_copy_sends", _zero_copy_sends.zero_copy,
+                        zc_description, {outcome("zero_copy")}),
+                sm::make_counter("io_uring_zero_copy_sends", _zero_copy_sends.copied,
+                        zc_description, {outcome("copied")}),
+                sm::make_counter("io_uring_zero_copy_sends", _zero_copy_sends.unsupported,
+                        zc_description, {outcome("unsupported")}),
+            });
+        }
+    }
+
     virtual void signal_received(int signo, siginfo_t* siginfo, void* ignore) override {
         _r._signals.action(signo, siginfo, ignore);
     }
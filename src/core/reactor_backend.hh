@@ -28,10 +28,14 @@
 #include <seastar/core/internal/poll.hh>
 #include <seastar/core/linux-aio.hh>
 #include <seastar/core/cacheline.hh>
+#include <seastar/core/metrics_registration.hh>
+#include <seastar/core/temporary_buffer.hh>
 #include <seastar/util/modules.hh>
+#include "core/syscall_result.hh"
 
 #ifndef SEASTAR_MODULE
 #include <fmt/ostream.h>
+#include <sys/stat.h>
 #include <sys/time.h>
 #include <thread>
 #include <stack>
@@ -210,6 +214,38 @@ class reactor_backend {
     virtual bool do_blocking_io() const {
         return false;
     }
+
+    // Files and buffers that the kernel can be told about in advance, to
+    // save per-request lookups and page pinning. Only the io_uring backend
+    // makes use of them; for the others these are no-ops and
+    // allocate_dma_buffer() is a plain aligned allocation.
+    virtual void register_file(int fd) noexcept {}
+    virtual void unregister_file(int fd) noexcept {}
+    virtual temporary_buffer<char> allocate_dma_buffer(size_t alignment, size_t size) {
+        return temporary_buffer<char>::aligned(alignment, size);
+    }
+
+    // Whether writes may be submitted with io_request::linked_fdatasync() set
+    virtual bool can_link_fdatasync() const noexcept {
+        return false;
+    }
+
+    // Path-based file system calls, for backends that can issue them without
+    // the syscall thread pool. The reactor only calls them when
+    // can_offload_file_system_calls() is true; results are those of the
+    // corresponding system call.
+    virtual bool can_offload_file_system_calls() const noexcept {
+        return false;
+    }
+    virtual future<syscall_result<int>> openat(sstring path, int flags, mode_t mode);
+    // With AT_EMPTY_PATH in flags, stats dirfd itself
+    virtual future<syscall_result_extra<struct stat>> statx(int dirfd, sstring path, int flags);
+    virtual future<syscall_result<int>> renameat(sstring oldpath, sstring newpath);
+    virtual future<syscall_result<int>> unlinkat(sstring path, int flags);
+
+    // Backend-specific metrics, registered along with the reactor's own
+    virtual void register_metrics(metrics::metric_groups& mg) {}
+
     virtual void signal_received(int signo, siginfo_t* siginfo, void* ignore) = 0;
     virtual void start_tick() = 0;
     virtual void stop_tick() = 0;
@@ -24,6 +24,7 @@ module;
 
 #include <boost/range/algorithm/find_if.hpp>
 #include <atomic>
+#include <chrono>
 #include <vector>
 #include <regex>
 #include <sys/mman.h>
@@ -42,6 +43,8 @@ module seastar;
 #include <seastar/core/on_internal_error.hh>
 #include <seastar/core/posix.hh>
 #include <seastar/core/align.hh>
+#include <seastar/core/coroutine.hh>
+#include <seastar/core/reactor.hh>
 #include "prefault.hh"
 #endif
 
@@ -172,6 +175,112 @@ smp::smp(alien::instance& alien)
 
 smp::~smp() = default;
 
+unsigned smp::submit_to_cost(shard_id from, shard_id to) noexcept {
+    return engine().smp()._submit_to_costs[from * count + to];
+}
+
+shard_id smp::nearest_shard(std::span<const shard_id> shards) noexcept {
+    auto& costs = engine().smp()._submit_to_costs;
+    auto row = costs.begin() + this_shard_id() * count;
+    return *std::ranges::min_element(shards, std::less<>(), [row] (shard_id id) { return row[id]; });
+}
+
+std::span<const shard_id> smp::shards_on_node_of(shard_id id) noexcept {
+    auto& s = engine().smp();
+    return s._node_shards[s._shard_to_numa_node_mapping[id]];
+}
+
+std::vector<shard_id> smp::nearest_shard_per_node() {
+    std::vector<shard_id> ret;
+    for (auto& shards : engine().smp()._node_shards) {
+        if (!shards.empty()) {
+            ret.push_back(nearest_shard(shards));
+        }
+    }
+    return ret;
+}
+
+namespace internal {
+
+smp_tree::smp_tree(shard_id root, smp_tree_options opts)
+        : _arity(std::max(opts.arity, 1u)) {
+    _shards.reserve(smp::count);
+    _shards.push_back(root);
+    if (!opts.numa_aware) {
+        for (unsigned i = 1; i < smp::count; i++) {
+            _shards.push_back((root + i) % smp::count);
+        }
+        return;
+    }
+    auto add_node = [this] (shard_id first) {
+        _shards.push_back(first);
+        for (auto s : smp::shards_on_node_of(first)) {
+            if (s != first) {
+                _shards.push_back(s);
+            }
+        }
+        _node_ends.push_back(_shards.size());
+    };
+    _shards.pop_back();
+    add_node(root);
+    auto root_node = smp::shards_on_node_of(root).data();
+    for (auto leader : smp::nearest_shard_per_node()) {
+        if (smp::shards_on_node_of(leader).data() != root_node) {
+            add_node(leader);
+        }
+    }
+}
+
+static void split_evenly(size_t b, size_t e, size_t n, std::vector<std::pair<size_t, size_t>>& out) {
+    auto len = e - b;
+    n = std::min(n, len);
+    for (size_t i = 0; i < n; i++) {
+        out.emplace_back(b + len * i / n, b + len * (i + 1) / n);
+    }
+}
+
+std::vector<std::pair<size_t, size_t>> smp_tree::children(size_t b, size_t e) const {
+    std::vector<std::pair<size_t, size_t>> ret;
+    if (b == 0 && !_node_ends.empty()) {
+        auto remote_nodes = _node_ends.size() - 1;
+        ret.reserve(std::max<size_t>(_arity, remote_nodes + 1) + 1);
+        split_evenly(1, _node_ends[0], _arity > remote_nodes ? _arity - remote_nodes : 1, ret);
+        for (size_t i = 1; i < _node_ends.size(); i++) {
+            ret.emplace_back(_node_ends[i - 1], _node_ends[i]);
+        }
+        return ret;
+    }
+    ret.reserve(_arity + 1);
+    split_evenly(b + 1, e, _arity, ret);
+    return ret;
+}
+
+}
+
+future<> smp::probe_submit_to_latencies() {
+    if (!_latency_probes) {
+        co_return;
+    }
+    // In round r every shard pings the one r places after it, so each shard
+    // has exactly one peer pinging it while it pings another, and concurrent
+    // pairs don't skew each other's measurement.
+    for (unsigned r = 1; r < count; r++) {
+        co_await invoke_on_all([this, r] () -> future<> {
+            auto from = this_shard_id();
+            auto to = (from + r) % count;
+            auto best = std::chrono::steady_clock::duration::max();
+            for (unsigned i = 0; i < _latency_probes; i++) {
+                auto start = std::chrono::steady_clock::now();
+                co_await submit_to(to, [] {});
+                best = std::min(best, std::chrono::steady_clock::now() - start);
+            }
+            // the cost of a remote shard is never 0
+            _submit_to_costs[from * count + to] = std::max<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(best).count(), 1);
+        });
+    }
+    seastar_logger.debug("Measured cross-shard round-trip latencies with {} probes per shard pair", _latency_probes);
+}
+
 void
 smp::setup_prefaulter(const seastar::resource::resources& res, seastar::memory::internal::numa_layout layout) {
     // Stack guards mprotect() random pages, so the prefaulter will hard-fault.
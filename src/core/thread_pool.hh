@@ -34,6 +34,15 @@ enum class thread_pool_submit_reason : size_t {
     aio_fallback,
     // Used for file operations that don't have non-blocking alternatives.
     file_operation,
+    // Used for opening files and directories, and for the parts of it the
+    // reactor backend can't do asynchronously.
+    file_open,
+    // Used for stat() of files, when the reactor backend can't do it.
+    file_stat,
+    // Used for renaming files, when the reactor backend can't do it.
+    file_rename,
+    // Used for removing files, when the reactor backend can't do it.
+    file_remove,
     // Used for process operations that don't have non-blocking alternatives.
     process_operation,
 };
@@ -0,0 +1,210 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*
+ * Copyright (C) 2025 ScyllaDB
+ */
+
+#ifdef SEASTAR_MODULE
+module;
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#ifdef SEASTAR_MODULE
+module seastar;
+#else
+#include <seastar/core/work_stealing.hh>
+#include <seastar/core/cacheline.hh>
+#include <seastar/core/metrics.hh>
+#include <seastar/core/reactor.hh>
+#include <seastar/core/smp.hh>
+#include <seastar/core/with_scheduling_group.hh>
+#include <seastar/util/later.hh>
+#include <seastar/util/spinlock.hh>
+#endif
+
+namespace seastar {
+
+namespace internal {
+
+namespace {
+
+// Jobs submitted on a shard, shared with the shards that may steal them.
+// The owner takes jobs from the front, thieves from the back.
+struct alignas(cache_line_size) stealable_queue {
+    util::spinlock lock;
+    std::deque<stealable_job*> jobs; // guarded by lock
+    std::atomic<size_t> size = 0;
+    std::atomic<uint64_t> stolen = 0; // jobs taken by other shards
+    std::atomic<reactor*> r = nullptr; // once the shard runs
+    // accessed by the owner only
+    uint64_t submitted = 0;
+    uint64_t stole = 0; // jobs this shard took from others
+    std::vector<shard_id> victims; // other shards, nearest first, see nearest_shards()
+
+    stealable_job* pop_front() noexcept {
+        std::lock_guard g(lock);
+        if (jobs.empty()) {
+            return nullptr;
+        }
+        auto job = jobs.front();
+        jobs.pop_front();
+        size.fetch_sub(1, std::memory_order_relaxed);
+        return job;
+    }
+    stealable_job* pop_back() noexcept {
+        std::lock_guard g(lock);
+        if (jobs.empty()) {
+            return nullptr;
+        }
+        auto job = jobs.back();
+        jobs.pop_back();
+        size.fetch_sub(1, std::memory_order_relaxed);
+        return job;
+    }
+};
+
+std::vector<std::unique_ptr<stealable_queue>> queues;
+// Jobs queued on all shards, so that idle shards only look at the queues
+// when there is something to steal
+std::atomic<size_t> total_queued = 0;
+
+const std::vector<shard_id>& nearest_shards(stealable_queue& own, shard_id self) {
+    auto& victims = own.victims;
+    if (victims.empty()) {
+        // The costs are measured once the reactors start, so this is done
+        // lazily rather than at configuration
+        for (unsigned i = 0; i < smp::count; i++) {
+            if (i != self) {
+                victims.push_back(i);
+            }
+        }
+        std::ranges::stable_sort(victims, std::less<>(), [self] (shard_id id) { return smp::submit_to_cost(self, id); });
+    }
+    return victims;
+}
+
+}
+
+void start_work_stealing(reactor& r) {
+    queues[this_shard_id()]->r.store(&r, std::memory_order_release);
+}
+
+uint64_t stolen_stealable_jobs() noexcept {
+    return queues[this_shard_id()]->stolen.load(std::memory_order_relaxed);
+}
+
+void configure_work_stealing(unsigned nr_shards) {
+    queues.clear();
+    queues.reserve(nr_shards);
+    for (unsigned i = 0; i < nr_shards; i++) {
+        queues.push_back(std::make_unique<stealable_queue>());
+    }
+    total_queued.store(0, std::memory_order_relaxed);
+}
+
+void submit_stealable(std::unique_ptr<stealable_job> job) {
+    auto& q = *queues[this_shard_id()];
+    size_t queued;
+    {
+        std::lock_guard g(q.lock);
+        q.jobs.push_back(job.get());
+        queued = q.size.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+    job.release();
+    total_queued.fetch_add(1, std::memory_order_relaxed);
+    ++q.submitted;
+    // Idle shards stop polling after a while, so as the backlog builds up,
+    // wake them: the nearest one at 2 queued jobs, the next one at 4, ...
+    if (queued > 1 && !(queued & (queued - 1))) {
+        auto& nearest = nearest_shards(q, this_shard_id());
+        auto i = std::countr_zero(queued) - 1;
+        if (i < int(nearest.size())) {
+            if (auto r = queues[nearest[i]]->r.load(std::memory_order_acquire)) {
+                r->wakeup();
+            }
+        }
+    }
+    // One turn per job, in the submitter's scheduling group. A turn runs the
+    // oldest job still queued here, if idle shards didn't take them all.
+    (void)yield().then([&q] {
+        if (auto job = q.pop_front()) {
+            total_queued.fetch_sub(1, std::memory_order_relaxed);
+            job->run();
+            job->complete();
+        }
+    });
+}
+
+bool steal_stealable_jobs(const noncopyable_function<bool ()>& poll) {
+    if (!total_queued.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    auto self = this_shard_id();
+    auto& own = *queues[self];
+    bool did_work = false;
+    for (auto victim : nearest_shards(own, self)) {
+        auto& q = *queues[victim];
+        while (q.size.load(std::memory_order_relaxed)) {
+            auto job = q.pop_back();
+            if (!job) {
+                break;
+            }
+            total_queued.fetch_sub(1, std::memory_order_relaxed);
+            q.stolen.fetch_add(1, std::memory_order_relaxed);
+            ++own.stole;
+            // Runs right away unless the job is in another group than the
+            // current one, in which case it is queued there and poll()
+            // sees the task
+            // Future indirectly forwarded to the job's promise
+            (void)with_scheduling_group(job->group(), [job] {
+                job->run();
+                return smp::submit_to(job->origin(), [job] {
+                    job->complete();
+                });
+            });
+            did_work = true;
+            if (poll()) {
+                return true;
+            }
+        }
+    }
+    return did_work;
+}
+
+void register_work_stealing_metrics(metrics::metric_groups& mg) {
+    namespace sm = seastar::metrics;
+    auto& q = *queues[this_shard_id()];
+    mg.add_group("work_stealing", {
+        sm::make_counter("submitted_jobs", q.submitted, sm::description("Total number of stealable jobs submitted on this shard")),
+        sm::make_counter("stolen_jobs", [&q] { return q.stolen.load(std::memory_order_relaxed); },
+                sm::description("Total number of stealable jobs submitted on this shard and run by other shards")),
+        sm::make_counter("jobs_stolen_from_others", q.stole, sm::description("Total number of stealable jobs this shard ran for other shards while idle")),
+        sm::make_queue_length("queued_jobs", [&q] { return q.size.load(std::memory_order_relaxed); },
+                sm::description("Number of stealable jobs submitted on this shard and waiting to run")),
+    });
+}
+
+}
+
+}
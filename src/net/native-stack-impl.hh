@@ -281,12 +281,12 @@ keepalive_params native_connected_socket_impl<Protocol>::get_keepalive_parameter
 
 template<typename Protocol>
 void native_connected_socket_impl<Protocol>::set_sockopt(int level, int optname, const void* data, size_t len) {
-    throw std::runtime_error("Setting custom socket options is not supported for native stack");
+    _conn->set_sockopt(level, optname, data, len);
 }
 
 template<typename Protocol>
 int native_connected_socket_impl<Protocol>::get_sockopt(int level, int optname, void* data, size_t len) const {
-    throw std::runtime_error("Getting custom socket options is not supported for native stack");
+    return _conn->get_sockopt(level, optname, data, len);
 }
 
 template<typename Protocol>
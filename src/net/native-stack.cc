@@ -232,6 +232,8 @@ native_network_stack::native_network_stack(const native_stack_options& opts, std
     : _netif(std::move(dev))
     , _inet(&_netif) {
     _inet.get_udp().set_queue_size(opts.udpv4_queue_size.get_value());
+    _inet.get_tcp().set_default_congestion_control(opts.tcp_congestion_control.get_value());
+    _inet.get_tcp().enable_connection_metrics(opts.tcp_connection_metrics.get_value());
     _dhcp = opts.host_ipv4_addr.defaulted()
             && opts.gw_ipv4_addr.defaulted()
             && opts.netmask_ipv4_addr.defaulted() && opts.dhcp.get_value();
@@ -372,6 +374,12 @@ native_stack_options::native_stack_options()
     , lro(*this, "lro",
                 "on",
                 "Enable LRO")
+    , tcp_congestion_control(*this, "tcp-congestion-control",
+                "reno",
+                "TCP congestion control algorithm (reno, cubic, bbr, bbr2)")
+    , tcp_connection_metrics(*this, "tcp-connection-metrics",
+                false,
+                "Export congestion window, RTT and pacing rate metrics for every TCP connection")
     , virtio_opts(this)
     , dpdk_opts(this)
 {
@@ -36,6 +36,7 @@ module;
 #include <arpa/inet.h>
 #include <net/route.h>
 #include <netinet/tcp.h>
+#include <netinet/udp.h>
 #include <netinet/sctp.h>
 #include <sys/socket.h>
 #include <seastar/util/assert.hh>
@@ -43,6 +44,7 @@ module;
 #ifdef SEASTAR_MODULE
 module seastar;
 #else
+#include <seastar/core/circular_buffer.hh>
 #include <seastar/core/loop.hh>
 #include <seastar/core/reactor.hh>
 #include <seastar/net/posix-stack.hh>
@@ -511,6 +513,8 @@ posix_server_socket_impl::accept() {
         auto cth = [this, &sa] {
             switch(_lba) {
             case server_socket::load_balancing_algorithm::connection_distribution:
+            // Not steered by the kernel, see steer_by_incoming_cpu()
+            case server_socket::load_balancing_algorithm::incoming_cpu:
                 return _conntrack.get_handle();
             case server_socket::load_balancing_algorithm::port:
                 return _conntrack.get_handle(ntoh(sa.as_posix_sockaddr_in().sin_port) % smp::count);
@@ -521,14 +525,21 @@ posix_server_socket_impl::accept() {
         } ();
         auto cpu = cth.cpu();
         if (cpu == this_shard_id()) {
+            if (_busy_poll) {
+                fd.enable_busy_poll();
+            }
             std::unique_ptr<connected_socket_impl> csi(
                     new posix_connected_socket_impl(sa.family(), _protocol, std::move(fd), std::move(cth), _allocator));
             return make_ready_future<accept_result>(
                     accept_result{connected_socket(std::move(csi)), sa});
         } else {
             // FIXME: future is discarded
-            (void)smp::submit_to(cpu, [protocol = _protocol, ssa = _sa, fd = std::move(fd.get_file_desc()), sa, cth = std::move(cth), allocator = _allocator] () mutable {
-                posix_ap_server_socket_impl::move_connected_socket(protocol, ssa, pollable_fd(std::move(fd)), sa, std::move(cth), allocator);
+            (void)smp::submit_to(cpu, [protocol = _protocol, ssa = _sa, fd = std::move(fd.get_file_desc()), sa, cth = std::move(cth), busy_poll = _busy_poll, allocator = _allocator] () mutable {
+                pollable_fd pfd(std::move(fd));
+                if (busy_poll) {
+                    pfd.enable_busy_poll();
+                }
+                posix_ap_server_socket_impl::move_connected_socket(protocol, ssa, std::move(pfd), sa, std::move(cth), allocator);
             });
             return accept();
         }
@@ -594,9 +605,12 @@ posix_ap_server_socket_impl::abort_accept() {
 
 future<accept_result>
 posix_reuseport_server_socket_impl::accept() {
-    return _lfd.accept().then([allocator = _allocator, protocol = _protocol] (std::tuple<pollable_fd, socket_address> fd_sa) {
+    return _lfd.accept().then([allocator = _allocator, protocol = _protocol, busy_poll = _busy_poll] (std::tuple<pollable_fd, socket_address> fd_sa) {
         auto& fd = std::get<0>(fd_sa);
         auto& sa = std::get<1>(fd_sa);
+        if (busy_poll) {
+            fd.enable_busy_poll();
+        }
         std::unique_ptr<connected_socket_impl> csi(
                 new posix_connected_socket_impl(sa.family(), protocol, std::move(fd), allocator));
         return make_ready_future<accept_result>(
@@ -699,6 +713,14 @@ void posix_data_sink_impl::on_batch_flush_error() noexcept {
     shutdown_socket_fd(_fd, SHUT_RD);
 }
 
+// Whether every shard listens on its own socket, for the kernel to pick one
+// by the connection's incoming cpu, see reactor::posix_listen()
+static bool steer_by_incoming_cpu(const socket_address& sa, const listen_options& opt) {
+    return opt.lba == server_socket::load_balancing_algorithm::incoming_cpu
+        && !sa.is_af_unix()
+        && !engine().smp().shard_to_cpu_mapping().empty();
+}
+
 posix_network_stack::posix_network_stack(const program_options::option_group& opts, std::pmr::polymorphic_allocator<char>* allocator)
         : _reuseport(engine().posix_reuseport_available()), _allocator(allocator) {
 }
@@ -711,13 +733,13 @@ posix_network_stack::listen(socket_address sa, listen_options opt) {
         sa = inet_address(inet_address::family::INET);
     }
     if (sa.is_af_unix()) {
-        return server_socket(std::make_unique<posix_server_socket_impl>(0, sa, engine().posix_listen(sa, opt), opt.lba, opt.fixed_cpu, _allocator));
+        return server_socket(std::make_unique<posix_server_socket_impl>(0, sa, engine().posix_listen(sa, opt), opt.lba, opt.fixed_cpu, false, _allocator));
     }
     auto protocol = static_cast<int>(opt.proto);
-    return _reuseport ?
-        server_socket(std::make_unique<posix_reuseport_server_socket_impl>(protocol, sa, engine().posix_listen(sa, opt), _allocator))
+    return _reuseport || steer_by_incoming_cpu(sa, opt) ?
+        server_socket(std::make_unique<posix_reuseport_server_socket_impl>(protocol, sa, engine().posix_listen(sa, opt), bool(opt.busy_poll), _allocator))
         :
-        server_socket(std::make_unique<posix_server_socket_impl>(protocol, sa, engine().posix_listen(sa, opt), opt.lba, opt.fixed_cpu, _allocator));
+        server_socket(std::make_unique<posix_server_socket_impl>(protocol, sa, engine().posix_listen(sa, opt), opt.lba, opt.fixed_cpu, bool(opt.busy_poll), _allocator));
 }
 
 ::seastar::socket posix_network_stack::socket() {
@@ -739,23 +761,31 @@ posix_ap_network_stack::listen(socket_address sa, listen_options opt) {
         return server_socket(std::make_unique<posix_ap_server_socket_impl>(0, sa, _allocator));
     }
     auto protocol = static_cast<int>(opt.proto);
-    return _reuseport ?
-        server_socket(std::make_unique<posix_reuseport_server_socket_impl>(protocol, sa, engine().posix_listen(sa, opt), _allocator))
+    return _reuseport || steer_by_incoming_cpu(sa, opt) ?
+        server_socket(std::make_unique<posix_reuseport_server_socket_impl>(protocol, sa, engine().posix_listen(sa, opt), bool(opt.busy_poll), _allocator))
         :
         server_socket(std::make_unique<posix_ap_server_socket_impl>(protocol, sa, _allocator));
 }
 
+// Room for the destination address and the GRO segment size
 struct cmsg_with_pktinfo {
-    struct cmsghdrcmh;
-    union {
-        struct in_pktinfo pktinfo;
-        struct in6_pktinfo pkt6info;
-    };
+    alignas(struct cmsghdr) char buf[CMSG_SPACE(sizeof(struct in6_pktinfo)) + CMSG_SPACE(sizeof(int))];
+};
+
+struct cmsg_with_segment {
+    alignas(struct cmsghdr) char buf[CMSG_SPACE(sizeof(uint16_t))];
 };
 
 class posix_datagram_channel : public datagram_channel_impl {
 private:
     static constexpr int MAX_DATAGRAM_SIZE = 65507;
+    // A GRO-coalesced read carries up to 64k of payload
+    static constexpr int MAX_GRO_SIZE = 65536;
+    // The kernel rejects GSO segments that do not fit the path MTU, which is
+    // not known for an unconnected socket, so only coalesce datagrams that
+    // fit a standard ethernet frame over IPv6
+    static constexpr size_t MAX_GSO_SEGMENT_SIZE = 1452;
+    static constexpr size_t MAX_GSO_SEGMENTS = 64;
     struct recv_ctx {
         struct msghdr _hdr;
         struct iovec _iov;
@@ -783,10 +813,71 @@ class posix_datagram_channel : public datagram_channel_impl {
         recv_ctx(const recv_ctx&) = delete;
         recv_ctx(recv_ctx&&) = delete;
 
-        void prepare() {
-            _buffer = new char[MAX_DATAGRAM_SIZE];
+        void prepare(size_t size) {
+            _buffer = new char[size];
             _iov.iov_base = _buffer;
-            _iov.iov_len = MAX_DATAGRAM_SIZE;
+            _iov.iov_len = size;
+            // recvmsg() overwrites both with the actual lengths
+            _hdr.msg_namelen = sizeof(_src_addr.u.sas);
+            if (_hdr.msg_control) {
+                _hdr.msg_controllen = sizeof(_cmsg);
+            }
+        }
+    };
+    // Receives up to max_batch datagrams with one recvmmsg() into a set of
+    // buffers that are reused between calls. The datagrams are copied out
+    // of them, which costs less than a syscall for the small datagrams
+    // batching is for.
+    //
+    // Without GRO datagrams rarely exceed the MTU, so each gets a slot of
+    // that size, which keeps the memory small datagrams land in (and are
+    // copied out of) together, and an overflow region of its own for the
+    // rest of a larger one.
+    struct recv_batch_ctx {
+        static constexpr unsigned max_batch = 16;
+        static constexpr size_t mtu_slot_size = 2048;
+        static constexpr size_t overflow_size = MAX_DATAGRAM_SIZE - mtu_slot_size;
+        std::array<struct mmsghdr, max_batch> _hdrs;
+        std::array<std::array<struct iovec, 2>, max_batch> _iovs;
+        std::array<socket_address, max_batch> _src_addrs;
+        std::array<cmsg_with_pktinfo, max_batch> _cmsgs;
+        std::unique_ptr<char[]> _buffers;
+        std::unique_ptr<char[]> _overflow;
+        size_t _slot_size = 0;
+        bool _use_pktinfo;
+
+        recv_batch_ctx(bool use_pktinfo) : _use_pktinfo(use_pktinfo) {}
+
+        recv_batch_ctx(const recv_batch_ctx&) = delete;
+        recv_batch_ctx(recv_batch_ctx&&) = delete;
+
+        void prepare(unsigned n, bool gro) {
+            size_t slot_size = gro ? MAX_GRO_SIZE : mtu_slot_size;
+            if (_slot_size != slot_size) {
+                _buffers = std::make_unique<char[]>(max_batch * slot_size);
+                _slot_size = slot_size;
+            }
+            if (!gro && !_overflow) {
+                _overflow = std::make_unique<char[]>(max_batch * overflow_size);
+            }
+            for (unsigned i = 0; i < n; i++) {
+                auto& hdr = _hdrs[i].msg_hdr;
+                memset(&_hdrs[i], 0, sizeof(_hdrs[i]));
+                _iovs[i][0].iov_base = _buffers.get() + i * slot_size;
+                _iovs[i][0].iov_len = slot_size;
+                if (!gro) {
+                    _iovs[i][1].iov_base = _overflow.get() + i * overflow_size;
+                    _iovs[i][1].iov_len = overflow_size;
+                }
+                hdr.msg_iov = _iovs[i].data();
+                hdr.msg_iovlen = gro ? 1 : 2;
+                hdr.msg_name = &_src_addrs[i].u.sa;
+                hdr.msg_namelen = sizeof(_src_addrs[i].u.sas);
+                if (_use_pktinfo) {
+                    hdr.msg_control = &_cmsgs[i];
+                    hdr.msg_controllen = sizeof(_cmsgs[i]);
+                }
+            }
         }
     };
     struct send_ctx {
@@ -814,6 +905,27 @@ class posix_datagram_channel : public datagram_channel_impl {
             resolve_outgoing_address(_dst);
         }
     };
+    // One sendmmsg() message per run of datagrams to the same destination
+    // when GSO coalesces them, per datagram otherwise
+    struct send_batch_ctx {
+        std::vector<outgoing_datagram> _batch;
+        std::vector<struct mmsghdr> _hdrs;
+        std::vector<struct iovec> _iovecs;
+        std::vector<socket_address> _dsts;
+        std::vector<cmsg_with_segment> _cmsgs;
+        size_t _bytes = 0;
+
+        explicit send_batch_ctx(std::vector<outgoing_datagram> batch) : _batch(std::move(batch)) {}
+
+        send_batch_ctx(const send_batch_ctx&) = delete;
+        send_batch_ctx(send_batch_ctx&&) = delete;
+
+        void prepare(bool gso);
+    };
+    struct cmsg_info {
+        std::optional<socket_address> dst;
+        size_t segment_size = 0;
+    };
 
     static bool is_inet(sa_family_t family) {
         return family == AF_INET || family == AF_INET6;
@@ -836,7 +948,15 @@ class posix_datagram_channel : public datagram_channel_impl {
     socket_address _address;
     recv_ctx _recv;
     send_ctx _send;
+    std::unique_ptr<recv_batch_ctx> _recv_batch;
+    // Datagrams split off GRO-coalesced reads that were not returned yet
+    circular_buffer<datagram> _received;
+    bool _gso = false;
+    bool _gro = false;
     bool _closed;
+
+    cmsg_info parse_cmsg(struct msghdr& hdr) const;
+    void queue_segments(const char* data, size_t size, const cmsg_info& info, const socket_address& src);
 public:
     /// Creates a channel that is not bound to any socket address. The channel
     /// can be used to communicate with adressess that belong to the \param
@@ -864,6 +984,9 @@ class posix_datagram_channel : public datagram_channel_impl {
     virtual future<datagram> receive() override;
     virtual future<> send(const socket_address& dst, const char *msg) override;
     virtual future<> send(const socket_address& dst, packet p) override;
+    virtual future<std::vector<datagram>> receive_batch(size_t max) override;
+    virtual future<> send_batch(std::vector<outgoing_datagram> batch) override;
+    virtual bool set_segmentation_offload(bool enable) override;
     virtual void shutdown_input() override {
         _fd.shutdown(SHUT_RD, pollable_fd::shutdown_kernel_only::no);
     }
@@ -900,6 +1023,109 @@ future<> posix_datagram_channel::send(const socket_address& dst, packet p) {
             .then([len] (size_t size) { SEASTAR_ASSERT(size == len); });
 }
 
+void posix_datagram_channel::send_batch_ctx::prepare(bool gso) {
+    size_t nr_frags = 0;
+    for (auto& d : _batch) {
+        nr_frags += d.data.nr_frags();
+    }
+    // Messages point into these, so they must not reallocate
+    _iovecs.reserve(nr_frags);
+    _hdrs.reserve(_batch.size());
+    _dsts.reserve(_batch.size());
+    if (gso) {
+        _cmsgs.reserve(_batch.size());
+    }
+
+    for (size_t i = 0; i < _batch.size(); ) {
+        auto& dst = _dsts.emplace_back(_batch[i].dst);
+        resolve_outgoing_address(dst);
+        auto& hdr = _hdrs.emplace_back();
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.msg_hdr.msg_name = &dst.u.sa;
+        hdr.msg_hdr.msg_namelen = dst.addr_length;
+        hdr.msg_hdr.msg_iov = _iovecs.data() + _iovecs.size();
+
+        // All segments but the last one must be of the same size
+        size_t segment = _batch[i].data.len();
+        size_t end = i + 1;
+        if (gso && segment <= MAX_GSO_SEGMENT_SIZE) {
+            size_t total = segment;
+            while (end < _batch.size() && end - i < MAX_GSO_SEGMENTS
+                    && _batch[end].dst == _batch[i].dst
+                    && _batch[end].data.len() <= segment
+                    && total + _batch[end].data.len() <= MAX_DATAGRAM_SIZE) {
+                total += _batch[end].data.len();
+                if (_batch[end++].data.len() < segment) {
+                    break;
+                }
+            }
+        }
+
+        for (auto j = i; j < end; j++) {
+            for (auto& f : _batch[j].data.fragments()) {
+                _iovecs.push_back({f.base, f.size});
+            }
+            _bytes += _batch[j].data.len();
+        }
+        hdr.msg_hdr.msg_iovlen = _iovecs.data() + _iovecs.size() - hdr.msg_hdr.msg_iov;
+
+        if (end - i > 1) {
+            auto& cmsg_buf = _cmsgs.emplace_back();
+            memset(&cmsg_buf, 0, sizeof(cmsg_buf));
+            hdr.msg_hdr.msg_control = &cmsg_buf;
+            hdr.msg_hdr.msg_controllen = sizeof(cmsg_buf);
+            auto* cmsg = CMSG_FIRSTHDR(&hdr.msg_hdr);
+            cmsg->cmsg_level = SOL_UDP;
+            cmsg->cmsg_type = UDP_SEGMENT;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            uint16_t gso_size = segment;
+            memcpy(CMSG_DATA(cmsg), &gso_size, sizeof(gso_size));
+        }
+        i = end;
+    }
+}
+
+future<> posix_datagram_channel::send_batch(std::vector<outgoing_datagram> batch) {
+    if (batch.empty()) {
+        return make_ready_future<>();
+    }
+    auto ctx = std::make_unique<send_batch_ctx>(std::move(batch));
+    ctx->prepare(_gso);
+    auto sg_id = internal::scheduling_group_index(current_scheduling_group());
+    bytes_sent[sg_id] += ctx->_bytes;
+    return do_with(std::move(ctx), size_t(0), [this] (std::unique_ptr<send_batch_ctx>& ctx, size_t& done) {
+        return repeat([this, &ctx, &done] {
+            return _fd.sendmmsg(ctx->_hdrs.data() + done, ctx->_hdrs.size() - done).then([&ctx, &done] (size_t sent) {
+                done += sent;
+                return done == ctx->_hdrs.size() ? stop_iteration::yes : stop_iteration::no;
+            });
+        });
+    });
+}
+
+bool posix_datagram_channel::set_segmentation_offload(bool enable) {
+    if (!is_inet(_address.family())) {
+        return false;
+    }
+    auto& fd = _fd.get_file_desc();
+    if (!enable) {
+        if (_gro) {
+            fd.setsockopt(SOL_UDP, UDP_GRO, 0);
+        }
+        _gso = _gro = false;
+        return false;
+    }
+    try {
+        // Fails on kernels that cannot segment
+        fd.getsockopt<int>(SOL_UDP, UDP_SEGMENT);
+        fd.setsockopt(SOL_UDP, UDP_GRO, 1);
+    } catch (const std::system_error&) {
+        return false;
+    }
+    _gso = _gro = true;
+    return true;
+}
+
 udp_channel
 posix_network_stack::make_udp_channel(const socket_address& addr) {
     if (!addr.is_unspecified()) {
@@ -953,24 +1179,94 @@ class posix_datagram : public datagram_impl {
     virtual packet& get_data() override { return _p; }
 };
 
+posix_datagram_channel::cmsg_info
+posix_datagram_channel::parse_cmsg(struct msghdr& hdr) const {
+    cmsg_info info;
+    for (auto* cmsg = CMSG_FIRSTHDR(&hdr); cmsg != nullptr; cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+        if (cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_PKTINFO) {
+            info.dst = ipv4_addr(copy_reinterpret_cast<in_pktinfo>(CMSG_DATA(cmsg)).ipi_addr, _address.port());
+        } else if (cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_PKTINFO) {
+            info.dst = ipv6_addr(copy_reinterpret_cast<in6_pktinfo>(CMSG_DATA(cmsg)).ipi6_addr, _address.port());
+        } else if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+            info.segment_size = copy_reinterpret_cast<int>(CMSG_DATA(cmsg));
+        }
+    }
+    return info;
+}
+
+void posix_datagram_channel::queue_segments(const char* data, size_t size, const cmsg_info& info, const socket_address& src) {
+    auto sg_id = internal::scheduling_group_index(current_scheduling_group());
+    bytes_received[sg_id] += size;
+    auto segment = info.segment_size ? info.segment_size : size;
+    do {
+        auto len = std::min(segment, size);
+        _received.emplace_back(std::make_unique<posix_datagram>(
+            src, info.dst ? *info.dst : _address, packet(temporary_buffer<char>(data, len))));
+        data += len;
+        size -= len;
+    } while (size > 0);
+}
+
+future<std::vector<datagram>>
+posix_datagram_channel::receive_batch(size_t max) {
+    auto drain = [this, max] {
+        std::vector<datagram> ret;
+        ret.reserve(std::min(max, _received.size()));
+        while (!_received.empty() && ret.size() < max) {
+            ret.push_back(std::move(_received.front()));
+            _received.pop_front();
+        }
+        return ret;
+    };
+    if (!_received.empty()) {
+        return make_ready_future<std::vector<datagram>>(drain());
+    }
+    if (!_recv_batch) {
+        _recv_batch = std::make_unique<recv_batch_ctx>(is_inet(_address.family()));
+    }
+    auto n = unsigned(std::clamp<size_t>(max, 1, recv_batch_ctx::max_batch));
+    _recv_batch->prepare(n, _gro);
+    return _fd.recvmmsg(_recv_batch->_hdrs.data(), n).then([this, drain = std::move(drain)] (size_t nr) {
+        auto& ctx = *_recv_batch;
+        for (size_t i = 0; i < nr; i++) {
+            auto& hdr = ctx._hdrs[i];
+            auto slot = static_cast<const char*>(ctx._iovs[i][0].iov_base);
+            if (hdr.msg_len <= ctx._slot_size) {
+                queue_segments(slot, hdr.msg_len, parse_cmsg(hdr.msg_hdr), ctx._src_addrs[i]);
+            } else {
+                temporary_buffer<char> buf(hdr.msg_len);
+                std::copy_n(slot, ctx._slot_size, buf.get_write());
+                std::copy_n(static_cast<const char*>(ctx._iovs[i][1].iov_base), hdr.msg_len - ctx._slot_size,
+                        buf.get_write() + ctx._slot_size);
+                queue_segments(buf.get(), buf.size(), parse_cmsg(hdr.msg_hdr), ctx._src_addrs[i]);
+            }
+        }
+        return drain();
+    });
+}
+
 future<datagram>
 posix_datagram_channel::receive() {
-    _recv.prepare();
+    if (!_received.empty()) {
+        auto d = std::move(_received.front());
+        _received.pop_front();
+        return make_ready_future<datagram>(std::move(d));
+    }
+    _recv.prepare(_gro ? MAX_GRO_SIZE : MAX_DATAGRAM_SIZE);
     return _fd.recvmsg(&_recv._hdr).then([this] (size_t size) {
-        std::optional<socket_address> dst;
-        for (auto* cmsg = CMSG_FIRSTHDR(&_recv._hdr); cmsg != nullptr; cmsg = CMSG_NXTHDR(&_recv._hdr, cmsg)) {
-            if (cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_PKTINFO) {
-                dst = ipv4_addr(copy_reinterpret_cast<in_pktinfo>(CMSG_DATA(cmsg)).ipi_addr, _address.port());
-                break;
-            } else if (cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_PKTINFO) {
-                dst = ipv6_addr(copy_reinterpret_cast<in6_pktinfo>(CMSG_DATA(cmsg)).ipi6_addr, _address.port());
-                break;
-            }
+        auto info = parse_cmsg(_recv._hdr);
+        if (info.segment_size && size > info.segment_size) {
+            // Coalesced by GRO, split into the original datagrams
+            queue_segments(_recv._buffer, size, info, _recv._src_addr);
+            delete[] _recv._buffer;
+            auto d = std::move(_received.front());
+            _received.pop_front();
+            return make_ready_future<datagram>(std::move(d));
         }
         auto sg_id = internal::scheduling_group_index(current_scheduling_group());
         bytes_received[sg_id] += size;
         return make_ready_future<datagram>(datagram(std::make_unique<posix_datagram>(
-            _recv._src_addr, dst ? *dst : _address, packet(fragment{_recv._buffer, size}, make_deleter([buf = _recv._buffer] { delete[] buf; })))));
+            _recv._src_addr, info.dst ? *info.dst : _address, packet(fragment{_recv._buffer, size}, make_deleter([buf = _recv._buffer] { delete[] buf; })))));
     }).handle_exception([p = _recv._buffer](auto ep) {
         delete[] p;
         return make_exception_future<datagram>(std::move(ep));
@@ -0,0 +1,605 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*
+ * Copyright (C) 2026 ScyllaDB
+ */
+
+#ifdef SEASTAR_MODULE
+module;
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+module seastar;
+#else
+#include <seastar/net/tcp-congestion.hh>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#endif
+
+namespace seastar {
+
+namespace net {
+
+using namespace std::chrono_literals;
+
+namespace {
+
+// RFC 5681
+class reno final : public tcp_congestion_control {
+public:
+    std::string_view name() const noexcept override {
+        return "reno";
+    }
+    void on_ack(tcp_congestion_window& w, const tcp_rate_sample& rs) override {
+        if (rs.in_recovery) {
+            return;
+        }
+        uint32_t smss = w.mss;
+        if (w.cwnd < w.ssthresh) {
+            // In slow start phase
+            w.cwnd += std::min(rs.acked, rs.acked_segments * smss);
+        } else {
+            // In congestion avoidance phase
+            for (uint32_t i = 0; i < rs.acked_segments; i++) {
+                w.cwnd += std::max(1u, smss * smss / w.cwnd);
+            }
+        }
+    }
+    uint32_t ssthresh(const tcp_congestion_window& w, uint32_t flight_size) override {
+        return std::max(flight_size / 2, 2 * uint32_t(w.mss));
+    }
+};
+
+// RFC 9438, without HyStart
+class cubic final : public tcp_congestion_control {
+    static constexpr double c = 0.4;
+    static constexpr double beta = 0.7;
+    // Additive increase of the Reno-friendly estimate
+    static constexpr double alpha = 3 * (1 - beta) / (1 + beta);
+    using clock_type = std::chrono::steady_clock;
+
+    // Window before the last reduction, in segments
+    double _w_max = 0;
+    // The cubic function reaches _origin, in segments, _k seconds after
+    // the epoch started
+    double _origin = 0;
+    double _k = 0;
+    // Window Reno would have, in segments
+    double _w_est = 0;
+    // Fractions of a byte the window has grown by
+    double _growth = 0;
+    std::optional<clock_type::time_point> _epoch_start;
+    std::chrono::microseconds _min_rtt = std::chrono::microseconds::max();
+public:
+    std::string_view name() const noexcept override {
+        return "cubic";
+    }
+    void on_ack(tcp_congestion_window& w, const tcp_rate_sample& rs) override {
+        if (rs.rtt) {
+            _min_rtt = std::min(_min_rtt, *rs.rtt);
+        }
+        if (rs.in_recovery) {
+            return;
+        }
+        if (w.cwnd < w.ssthresh) {
+            w.cwnd += std::min(rs.acked, rs.acked_segments * uint32_t(w.mss));
+            return;
+        }
+
+        double mss = w.mss;
+        double cwnd = w.cwnd / mss;
+        if (!_epoch_start) {
+            _epoch_start = rs.now;
+            if (cwnd < _w_max) {
+                _k = std::cbrt((_w_max - cwnd) / c);
+                _origin = _w_max;
+            } else {
+                _k = 0;
+                _origin = cwnd;
+            }
+            _w_est = cwnd;
+            _growth = 0;
+        }
+
+        // The window one RTT from now
+        std::chrono::duration<double> rtt = _min_rtt == std::chrono::microseconds::max() ? 100ms : _min_rtt;
+        double t = std::chrono::duration<double>(rs.now - *_epoch_start).count() + rtt.count();
+        double target = std::clamp(_origin + c * std::pow(t - _k, 3), cwnd, 1.5 * cwnd);
+
+        double acked = rs.acked / mss;
+        _w_est += alpha * acked / cwnd;
+        if (_w_est > target) {
+            // Reno-friendly region
+            w.cwnd = std::max(w.cwnd, uint32_t(_w_est * mss));
+            return;
+        }
+        _growth += (target - cwnd) / cwnd * acked * mss;
+        auto inc = uint32_t(_growth);
+        w.cwnd += inc;
+        _growth -= inc;
+    }
+    uint32_t ssthresh(const tcp_congestion_window& w, uint32_t flight_size) override {
+        _epoch_start.reset();
+        double cwnd = double(w.cwnd) / w.mss;
+        // Fast convergence: give up some bandwidth to flows that joined
+        _w_max = cwnd < _w_max ? cwnd * (1 + beta) / 2 : cwnd;
+        return std::max(uint32_t(flight_size * beta), 2 * uint32_t(w.mss));
+    }
+    void on_rto(tcp_congestion_window& w) override {
+        _epoch_start.reset();
+    }
+};
+
+// BBR v1 as in draft-cardwell-iccrg-bbr-congestion-control-00, and v2,
+// which adds bounds on inflight data learned from loss.
+class bbr final : public tcp_congestion_control {
+    using clock_type = std::chrono::steady_clock;
+    enum class mode { startup, drain, probe_bw, probe_rtt };
+    // v2 cycles through these instead of the eight phase gain cycle
+    enum class probe_bw_phase { down, cruise, refill, up };
+
+    // 2/ln(2), the lowest gain that doubles the sending rate every round
+    static constexpr double high_gain = 2.885;
+    static constexpr double drain_gain = 1 / high_gain;
+    static constexpr double probe_bw_cwnd_gain = 2;
+    static constexpr std::array<double, 8> pacing_gain_cycle = {1.25, 0.75, 1, 1, 1, 1, 1, 1};
+    static constexpr unsigned bw_filter_rounds = 10;
+    static constexpr auto min_rtt_window = 10s;
+    static constexpr auto probe_rtt_duration = 200ms;
+    static constexpr uint32_t min_cwnd_segments = 4;
+    static constexpr unsigned full_bw_rounds = 3;
+    static constexpr double full_bw_growth = 1.25;
+    // Pace a little below the estimate so queues drain
+    static constexpr double pacing_margin = 0.99;
+    // v2: a round losing more than loss_thresh of its data hit the limit
+    // of the path, the bounds are then cut by beta
+    static constexpr double loss_thresh = 0.02;
+    static constexpr double beta = 0.7;
+    // v2: leave this much of inflight_hi free for other flows while cruising
+    static constexpr double headroom = 0.85;
+    static constexpr auto probe_bw_wait = 2s;
+    static constexpr uint32_t unbounded = std::numeric_limits<uint32_t>::max();
+
+    const bool _v2;
+    mode _mode = mode::startup;
+    double _pacing_gain = high_gain;
+    double _cwnd_gain = high_gain;
+    uint64_t _pacing_rate = 0;
+
+    // Maximum delivery rate of each of the last rounds
+    std::array<uint64_t, bw_filter_rounds> _bw{};
+    uint64_t _round_count = 0;
+    uint64_t _next_round_delivered = 0;
+    bool _round_start = false;
+
+    std::chrono::microseconds _min_rtt = std::chrono::microseconds::max();
+    clock_type::time_point _min_rtt_stamp;
+    std::optional<clock_type::time_point> _probe_rtt_done;
+    bool _probe_rtt_round_done = false;
+
+    uint64_t _full_bw = 0;
+    unsigned _full_bw_count = 0;
+    bool _full_bw_reached = false;
+
+    unsigned _cycle_idx = 0;
+    clock_type::time_point _cycle_stamp;
+    probe_bw_phase _phase = probe_bw_phase::down;
+    unsigned _probe_up_rounds = 0;
+
+    uint32_t _prior_cwnd = 0;
+    bool _recovery_pending = false;
+    bool _packet_conservation = false;
+
+    uint64_t _last_lost = 0;
+    uint64_t _round_delivered = 0;
+    uint64_t _round_lost = 0;
+    uint32_t _inflight_hi = unbounded;
+    uint32_t _inflight_lo = unbounded;
+    uint64_t _bw_lo = std::numeric_limits<uint64_t>::max();
+
+    bool min_rtt_known() const noexcept {
+        return _min_rtt != std::chrono::microseconds::max();
+    }
+    uint64_t max_bw() const noexcept {
+        return *std::max_element(_bw.begin(), _bw.end());
+    }
+    uint64_t bw() const noexcept {
+        return std::min(max_bw(), _bw_lo);
+    }
+    uint32_t bdp(const tcp_congestion_window& w, uint64_t bw, double gain) const noexcept {
+        if (!bw || !min_rtt_known()) {
+            return w.cwnd;
+        }
+        return uint32_t(std::min(bw * gain * _min_rtt.count() / 1000000, double(unbounded)));
+    }
+    // BDP plus room for the segments sitting in the sender and the receiver
+    uint32_t inflight(const tcp_congestion_window& w, uint64_t bw, double gain) const noexcept {
+        return bdp(w, bw, gain) + 3 * w.mss;
+    }
+    uint32_t min_cwnd(const tcp_congestion_window& w) const noexcept {
+        return min_cwnd_segments * w.mss;
+    }
+
+    void update_round(const tcp_rate_sample& rs) {
+        _round_start = false;
+        if (rs.prior_delivered >= _next_round_delivered) {
+            _next_round_delivered = rs.total_delivered;
+            _round_count++;
+            _round_start = true;
+            _packet_conservation = false;
+            _bw[_round_count % bw_filter_rounds] = 0;
+        }
+    }
+    void update_bw(const tcp_rate_sample& rs) {
+        auto rate = rs.delivery_rate();
+        // Application limited samples underestimate the path
+        if (rate && (!rs.app_limited || rate >= max_bw())) {
+            auto& slot = _bw[_round_count % bw_filter_rounds];
+            slot = std::max(slot, rate);
+        }
+    }
+    void update_loss_bounds(const tcp_congestion_window& w, const tcp_rate_sample& rs) {
+        if (!_round_start) {
+            return;
+        }
+        auto delivered = rs.total_delivered - _round_delivered;
+        auto lost = rs.total_lost - _round_lost;
+        _round_delivered = rs.total_delivered;
+        _round_lost = rs.total_lost;
+        if (!lost || lost <= loss_thresh * (delivered + lost)) {
+            if (_mode == mode::probe_bw && _phase == probe_bw_phase::up && _inflight_hi != unbounded) {
+                // No sign of the limit yet, probe further, faster every round
+                _inflight_hi += (1u << std::min(_probe_up_rounds++, 10u)) * w.mss;
+            }
+            return;
+        }
+        if (_mode == mode::startup) {
+            _full_bw_reached = true;
+        }
+        if (_mode == mode::startup || (_mode == mode::probe_bw && _phase == probe_bw_phase::up)) {
+            _inflight_hi = std::max(rs.in_flight, uint32_t(beta * inflight(w, bw(), 1)));
+            if (_mode == mode::probe_bw) {
+                enter_phase(probe_bw_phase::down, rs.now);
+            }
+        } else {
+            _bw_lo = uint64_t(beta * bw());
+            _inflight_lo = std::max(uint32_t(beta * std::min(_inflight_lo, w.cwnd)), min_cwnd(w));
+        }
+    }
+    void update_min_rtt(tcp_congestion_window& w, const tcp_rate_sample& rs) {
+        bool expired = min_rtt_known() && rs.now > _min_rtt_stamp + min_rtt_window;
+        if (rs.rtt && (*rs.rtt < _min_rtt || expired)) {
+            _min_rtt = *rs.rtt;
+            _min_rtt_stamp = rs.now;
+        }
+        if (expired && _mode != mode::probe_rtt) {
+            _mode = mode::probe_rtt;
+            _pacing_gain = 1;
+            _cwnd_gain = 1;
+            save_cwnd(w);
+            _probe_rtt_done.reset();
+        }
+        if (_mode != mode::probe_rtt) {
+            return;
+        }
+        if (!_probe_rtt_done) {
+            if (rs.in_flight <= min_cwnd(w)) {
+                _probe_rtt_done = rs.now + probe_rtt_duration;
+                _probe_rtt_round_done = false;
+                _next_round_delivered = rs.total_delivered;
+            }
+            return;
+        }
+        if (_round_start) {
+            _probe_rtt_round_done = true;
+        }
+        if (_probe_rtt_round_done && rs.now >= *_probe_rtt_done) {
+            _min_rtt_stamp = rs.now;
+            w.cwnd = std::max(w.cwnd, _prior_cwnd);
+            if (_full_bw_reached) {
+                enter_probe_bw(rs.now);
+            } else {
+                enter_startup();
+            }
+        }
+    }
+    void check_full_bw(const tcp_rate_sample& rs) {
+        if (_full_bw_reached || !_round_start || rs.app_limited) {
+            return;
+        }
+        if (max_bw() >= _full_bw * full_bw_growth) {
+            _full_bw = max_bw();
+            _full_bw_count = 0;
+            return;
+        }
+        _full_bw_reached = ++_full_bw_count >= full_bw_rounds;
+    }
+    void check_drain(const tcp_congestion_window& w, const tcp_rate_sample& rs) {
+        if (_mode == mode::startup && _full_bw_reached) {
+            _mode = mode::drain;
+            _pacing_gain = drain_gain;
+            _cwnd_gain = high_gain;
+        }
+        if (_mode == mode::drain && rs.in_flight <= inflight(w, bw(), 1)) {
+            enter_probe_bw(rs.now);
+        }
+    }
+    void enter_startup() {
+        _mode = mode::startup;
+        _pacing_gain = high_gain;
+        _cwnd_gain = high_gain;
+    }
+    void enter_probe_bw(clock_type::time_point now) {
+        _mode = mode::probe_bw;
+        _cwnd_gain = probe_bw_cwnd_gain;
+        if (_v2) {
+            enter_phase(probe_bw_phase::down, now);
+        } else {
+            // Start cruising rather than probing or draining
+            _cycle_idx = 2;
+            _cycle_stamp = now;
+            _pacing_gain = pacing_gain_cycle[_cycle_idx];
+        }
+    }
+    void enter_phase(probe_bw_phase phase, clock_type::time_point now) {
+        _phase = phase;
+        _cycle_stamp = now;
+        switch (phase) {
+        case probe_bw_phase::down:
+            _pacing_gain = 0.75;
+            break;
+        case probe_bw_phase::cruise:
+            _pacing_gain = 1;
+            break;
+        case probe_bw_phase::refill:
+            // Forget the short term bounds before probing
+            _pacing_gain = 1;
+            _bw_lo = std::numeric_limits<uint64_t>::max();
+            _inflight_lo = unbounded;
+            break;
+        case probe_bw_phase::up:
+            _pacing_gain = 1.25;
+            _probe_up_rounds = 0;
+            break;
+        }
+    }
+    void update_probe_bw(const tcp_congestion_window& w, const tcp_rate_sample& rs, uint64_t lost) {
+        bool full_length = min_rtt_known() && rs.now - _cycle_stamp > _min_rtt;
+        if (_v2) {
+            switch (_phase) {
+            case probe_bw_phase::down:
+                if (rs.in_flight <= std::min(inflight(w, bw(), 1), uint32_t(headroom * _inflight_hi))) {
+                    enter_phase(probe_bw_phase::cruise, _cycle_stamp);
+                }
+                break;
+            case probe_bw_phase::cruise:
+                if (rs.now - _cycle_stamp > probe_bw_wait) {
+                    enter_phase(probe_bw_phase::refill, rs.now);
+                }
+                break;
+            case probe_bw_phase::refill:
+                if (_round_start) {
+                    enter_phase(probe_bw_phase::up, rs.now);
+                }
+                break;
+            case probe_bw_phase::up:
+                if (full_length && rs.in_flight >= inflight(w, bw(), 1.25)) {
+                    enter_phase(probe_bw_phase::down, rs.now);
+                }
+                break;
+            }
+            return;
+        }
+        auto gain = pacing_gain_cycle[_cycle_idx];
+        bool advance;
+        if (gain > 1) {
+            advance = full_length && (lost || rs.in_flight >= inflight(w, bw(), gain));
+        } else if (gain < 1) {
+            advance = full_length || rs.in_flight <= inflight(w, bw(), 1);
+        } else {
+            advance = full_length;
+        }
+        if (advance) {
+            _cycle_idx = (_cycle_idx + 1) % pacing_gain_cycle.size();
+            _cycle_stamp = rs.now;
+            _pacing_gain = pacing_gain_cycle[_cycle_idx];
+        }
+    }
+    void set_pacing_rate(const tcp_congestion_window& w) {
+        uint64_t rate;
+        if (auto bw = this->bw()) {
+            rate = _pacing_gain * bw * pacing_margin;
+        } else if (min_rtt_known() && _min_rtt.count()) {
+            rate = high_gain * w.cwnd * 1000000 / _min_rtt.count();
+        } else {
+            return;
+        }
+        // Until the pipe is full a lower estimate only means there was not
+        // enough data in flight to measure it
+        if (_full_bw_reached || rate > _pacing_rate) {
+            _pacing_rate = rate;
+        }
+    }
+    void set_cwnd(tcp_congestion_window& w, const tcp_rate_sample& rs) {
+        if (_recovery_pending) {
+            // Packet conservation for the first round of recovery: send one
+            // segment for every segment delivered
+            _recovery_pending = false;
+            _packet_conservation = true;
+            _next_round_delivered = rs.total_delivered;
+            w.cwnd = rs.in_flight + std::max(rs.acked, uint32_t(w.mss));
+        }
+        auto target = inflight(w, bw(), _cwnd_gain);
+        if (_packet_conservation) {
+            w.cwnd = std::max(w.cwnd, rs.in_flight + rs.acked);
+        } else if (_full_bw_reached) {
+            w.cwnd = std::min(w.cwnd + rs.acked, target);
+        } else if (w.cwnd < target) {
+            w.cwnd += rs.acked;
+        }
+        if (_v2) {
+            auto hi = _inflight_hi;
+            if (_mode == mode::probe_bw && _phase != probe_bw_phase::up && hi != unbounded) {
+                hi = headroom * hi;
+            }
+            w.cwnd = std::min({w.cwnd, hi, _inflight_lo});
+        }
+        w.cwnd = std::max(w.cwnd, min_cwnd(w));
+        if (_mode == mode::probe_rtt) {
+            w.cwnd = std::min(w.cwnd, min_cwnd(w));
+        }
+    }
+    void save_cwnd(const tcp_congestion_window& w) {
+        if (_mode != mode::probe_rtt && !_packet_conservation && !_recovery_pending) {
+            _prior_cwnd = w.cwnd;
+        } else {
+            _prior_cwnd = std::max(_prior_cwnd, w.cwnd);
+        }
+    }
+public:
+    explicit bbr(bool v2) noexcept : _v2(v2) {}
+    std::string_view name() const noexcept override {
+        return _v2 ? "bbr2" : "bbr";
+    }
+    void on_ack(tcp_congestion_window& w, const tcp_rate_sample& rs) override {
+        auto lost = rs.total_lost - _last_lost;
+        _last_lost = rs.total_lost;
+        update_round(rs);
+        update_bw(rs);
+        if (_v2) {
+            update_loss_bounds(w, rs);
+        }
+        update_min_rtt(w, rs);
+        check_full_bw(rs);
+        check_drain(w, rs);
+        if (_mode == mode::probe_bw) {
+            update_probe_bw(w, rs, lost);
+        }
+        set_pacing_rate(w);
+        set_cwnd(w, rs);
+    }
+    uint32_t ssthresh(const tcp_congestion_window& w, uint32_t flight_size) override {
+        // BBR keeps sending at the estimated bandwidth, losses only make it
+        // conserve packets for a round trip
+        save_cwnd(w);
+        _recovery_pending = true;
+        return w.cwnd;
+    }
+    void on_rto(tcp_congestion_window& w) override {
+        _recovery_pending = false;
+        _packet_conservation = false;
+        _full_bw = 0;
+        _full_bw_count = 0;
+    }
+    void on_recovery_exit(tcp_congestion_window& w) override {
+        _recovery_pending = false;
+        _packet_conservation = false;
+        w.cwnd = std::max(w.cwnd, _prior_cwnd);
+    }
+    uint64_t pacing_rate() const noexcept override {
+        return _pacing_rate;
+    }
+};
+
+}
+
+std::unique_ptr<tcp_congestion_control> make_tcp_congestion_control(std::string_view name) {
+    if (name == "reno") {
+        return std::make_unique<reno>();
+    } else if (name == "cubic") {
+        return std::make_unique<cubic>();
+    } else if (name == "bbr") {
+        return std::make_unique<bbr>(false);
+    } else if (name == "bbr2") {
+        return std::make_unique<bbr>(true);
+    }
+    throw std::invalid_argument("Unknown TCP congestion control algorithm: " + std::string(name));
+}
+
+auto tcp_delivery_rate::on_send(clock_type::time_point now, uint32_t in_flight) noexcept -> snapshot {
+    if (!in_flight) {
+        // Nothing was in flight, the next rate sample starts now
+        _first_tx_time = now;
+        _delivered_time = now;
+    }
+    return snapshot{now, _delivered, _delivered_time, _first_tx_time, _app_limited != 0};
+}
+
+void tcp_delivery_rate::on_delivered(const snapshot& s, uint32_t bytes, bool retransmitted, clock_type::time_point now) noexcept {
+    _delivered += bytes;
+    _delivered_time = now;
+    _rs.acked += bytes;
+    _rs.acked_segments++;
+    // The most recently sent of the delivered segments makes the sample
+    if (!_has_segment || s.delivered >= _rs.prior_delivered) {
+        _has_segment = true;
+        _rs.prior_delivered = s.delivered;
+        _rs.app_limited = s.app_limited;
+        _rs.rtt.reset();
+        if (!retransmitted) {
+            _rs.rtt = std::chrono::duration_cast<std::chrono::microseconds>(now - s.sent);
+        }
+        _send_elapsed = s.sent - s.first_tx_time;
+        _ack_elapsed = now - s.delivered_time;
+        _first_tx_time = s.sent;
+    }
+}
+
+bool tcp_delivery_rate::sample(tcp_rate_sample& rs) noexcept {
+    rs = std::exchange(_rs, {});
+    bool has_segment = std::exchange(_has_segment, false);
+    if (!rs.acked) {
+        return false;
+    }
+    if (_app_limited && _delivered > _app_limited) {
+        _app_limited = 0;
+    }
+    if (rs.rtt) {
+        _min_rtt = std::min(*rs.rtt, _min_rtt.value_or(*rs.rtt));
+    }
+    rs.now = _delivered_time;
+    rs.total_delivered = _delivered;
+    rs.total_lost = _lost;
+    if (has_segment) {
+        rs.delivered = _delivered - rs.prior_delivered;
+        // A sample shorter than the minimum RTT would overestimate the rate
+        auto interval = std::chrono::duration_cast<std::chrono::microseconds>(std::max(_send_elapsed, _ack_elapsed));
+        if (_min_rtt && interval >= *_min_rtt) {
+            rs.interval = interval;
+        }
+    }
+    return true;
+}
+
+}
+
+}
@@ -88,6 +88,34 @@ void tcp_option::parse(uint8_t* beg1, uint8_t* end1) {
     }
 }
 
+void tcp_option::parse_sack_blocks(uint8_t* beg1, uint8_t* end1) {
+    const char* beg = reinterpret_cast<const char*>(beg1);
+    const char* end = reinterpret_cast<const char*>(end1);
+    _remote_sack_blocks.nr = 0;
+    while (beg < end) {
+        auto kind = option_kind(*beg);
+        if (kind == option_kind::eol) {
+            return;
+        }
+        if (kind == option_kind::nop) {
+            beg += option_len::nop;
+            continue;
+        }
+        if (end - beg < 2) {
+            return;
+        }
+        auto len = uint8_t(beg[1]);
+        // Prevent infinite loop and reading past the header
+        if (len < 2 || beg + len > end) {
+            return;
+        }
+        if (kind == option_kind::sack_blocks) {
+            _remote_sack_blocks = sack_blocks::read(beg);
+        }
+        beg += len;
+    }
+}
+
 uint8_t tcp_option::fill(void* h, const tcp_hdr* th, uint8_t options_size) {
     auto hdr = reinterpret_cast<char*>(h);
     auto off = hdr + tcp_hdr::len;
@@ -110,6 +138,12 @@ uint8_t tcp_option::fill(void* h, const tcp_hdr* th, uint8_t options_size) {
             off += win_scale.len;
             size += win_scale.len;
         }
+        if (_sack_received || !ack_on) {
+            auto sack = tcp_option::sack();
+            sack.write(off);
+            off += sack.len;
+            size += sack.len;
+        }
     }
     if (size > 0) {
         // Insert NOP option
@@ -124,6 +158,17 @@ uint8_t tcp_option::fill(void* h, const tcp_hdr* th, uint8_t options_size) {
         eol.write(off);
         size += option_len::eol;
     }
+    if (!syn_on && _local_sack_blocks.nr) {
+        // Two NOPs keep the blocks 32-bit aligned
+        for (int i = 0; i < 2; i++) {
+            auto nop = tcp_option::nop();
+            nop.write(off);
+            off += option_len::nop;
+            size += option_len::nop;
+        }
+        _local_sack_blocks.write(off);
+        size += _local_sack_blocks.len();
+    }
     SEASTAR_ASSERT(size == options_size);
 
     return size;
@@ -138,15 +183,39 @@ uint8_t tcp_option::get_size(bool syn_on, bool ack_on) {
         if (_win_scale_received || !ack_on) {
             size += option_len::win_scale;
         }
+        if (_sack_received || !ack_on) {
+            size += option_len::sack;
+        }
     }
     if (size > 0) {
         size += option_len::eol;
         // Insert NOP option to align on 32-bit
         size = align_up(size, tcp_option::align);
     }
+    if (!syn_on && _local_sack_blocks.nr) {
+        size += 2 * uint8_t(option_len::nop) + _local_sack_blocks.len();
+    }
     return size;
 }
 
+void make_sack_blocks(tcp_option::sack_blocks& sb, const tcp_packet_merger& ooo, tcp_seq latest) {
+    sb.nr = 0;
+    auto add = [&] (const std::pair<const tcp_seq, packet>& seg) {
+        sb.blocks[sb.nr++] = {seg.first.raw, (seg.first + seg.second.len()).raw};
+    };
+    auto first = std::find_if(ooo.map.begin(), ooo.map.end(), [&] (const std::pair<const tcp_seq, packet>& seg) {
+        return seg.first <= latest && latest < seg.first + seg.second.len();
+    });
+    if (first != ooo.map.end()) {
+        add(*first);
+    }
+    for (auto it = ooo.map.begin(); it != ooo.map.end() && sb.nr < sb.max_blocks; ++it) {
+        if (it != first) {
+            add(*it);
+        }
+    }
+}
+
 ipv4_tcp::ipv4_tcp(ipv4& inet)
 	: _inet_l4(inet), _tcp(std::make_unique<tcp<ipv4_traits>>(_inet_l4)) {
 }
@@ -130,6 +130,8 @@ module;
 #include <linux/fs.h>
 #include <linux/perf_event.h>
 #include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <sys/epoll.h>
 #include <sys/eventfd.h>
 #include <sys/inotify.h>
@@ -197,6 +199,7 @@ export module seastar;
 #include <seastar/core/io_intent.hh>
 #include <seastar/core/io_queue.hh>
 #include <seastar/core/io_priority_class.hh>
+#include <seastar/core/io_priority_group.hh>
 #include <seastar/core/layered_file.hh>
 #include <seastar/core/loop.hh>
 #include <seastar/core/lowres_clock.hh>
@@ -258,6 +261,7 @@ export module seastar;
 #include <seastar/core/when_all.hh>
 #include <seastar/core/when_any.hh>
 #include <seastar/core/with_scheduling_group.hh>
+#include <seastar/core/work_stealing.hh>
 #include <seastar/core/with_timeout.hh>
 
 #include <seastar/util/alloc_failure_injector.hh>
@@ -284,6 +288,7 @@ export module seastar;
 #include <seastar/net/native-stack.hh>
 #include <seastar/net/posix-stack.hh>
 #include <seastar/net/socket_defs.hh>
+#include <seastar/net/tcp-congestion.hh>
 #include <seastar/net/tcp.hh>
 #include <seastar/net/udp.hh>
 #include <seastar/net/tls.hh>
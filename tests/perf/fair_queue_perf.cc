@@ -131,3 +131,69 @@ PERF_TEST_F(perf_fair_queue, contended_shared)
 {
     return test(false);
 }
+
+
+// Dispatch throughput with many priority classes, each with a few requests
+// queued. Classes get different shares, so that they spread over the queue.
+struct perf_fair_queue_classes {
+    static constexpr unsigned requests_per_class = 16;
+
+    size_t test(unsigned nr_classes, fair_queue::capacity_t quantum = 0);
+};
+
+size_t perf_fair_queue_classes::test(unsigned nr_classes, fair_queue::capacity_t quantum) {
+    seastar::fair_queue::config cfg;
+    cfg.dispatch_quantum = quantum;
+    seastar::fair_queue fq(cfg);
+
+    std::vector<seastar::fair_queue_entry> entries;
+    entries.reserve(nr_classes * requests_per_class);
+    for (unsigned c = 0; c < nr_classes; c++) {
+        fq.register_priority_class(c, 100 + (c % 10) * 100);
+    }
+    for (unsigned r = 0; r < requests_per_class; r++) {
+        for (unsigned c = 0; c < nr_classes; c++) {
+            entries.emplace_back(fair_queue_entry::capacity_t(100000));
+            fq.queue(c, entries.back());
+        }
+    }
+
+    size_t dispatched = 0;
+    perf_tests::start_measuring_time();
+    while (auto* req = fq.top()) {
+        perf_tests::do_not_optimize(req);
+        fq.pop_front();
+        dispatched++;
+    }
+    perf_tests::stop_measuring_time();
+
+    for (unsigned c = 0; c < nr_classes; c++) {
+        fq.unregister_priority_class(c);
+    }
+    return dispatched;
+}
+
+PERF_TEST_F(perf_fair_queue_classes, dispatch_10_classes)
+{
+    return test(10);
+}
+
+PERF_TEST_F(perf_fair_queue_classes, dispatch_100_classes)
+{
+    return test(100);
+}
+
+PERF_TEST_F(perf_fair_queue_classes, dispatch_1000_classes)
+{
+    return test(1000);
+}
+
+PERF_TEST_F(perf_fair_queue_classes, dispatch_4000_classes)
+{
+    return test(4000);
+}
+
+PERF_TEST_F(perf_fair_queue_classes, dispatch_1000_classes_batched)
+{
+    return test(1000, 4096);
+}
@@ -29,6 +29,7 @@
 #include <seastar/util/log.hh>
 #include <seastar/util/memory_diagnostics.hh>
 
+#include <algorithm>
 #include <memory>
 #include <new>
 #include <vector>
@@ -100,6 +101,64 @@ SEASTAR_TEST_CASE(test_live_objects_counter_with_cross_cpu_free) {
     });
 }
 
+SEASTAR_TEST_CASE(test_cross_cpu_free_batches) {
+#ifndef SEASTAR_DEFAULT_ALLOCATOR
+    using object = std::array<char, 64>;
+    co_await smp::submit_to(1, [] {
+        auto ret = std::vector<std::unique_ptr<object>>(10000);
+        for (auto& o : ret) {
+            o = std::make_unique<object>();
+        }
+        return ret;
+    }).then([] (auto&& vec) {
+        auto before = memory::stats();
+        vec.clear(); // cause cross-cpu free
+        memory::drain_cross_cpu_freelist(); // hands partially filled batches back
+        auto after = memory::stats();
+        BOOST_REQUIRE_EQUAL(after.cross_cpu_frees() - before.cross_cpu_frees(), 10000);
+        BOOST_REQUIRE_EQUAL(after.cross_cpu_batched_frees() - before.cross_cpu_batched_frees(), 10000);
+        BOOST_REQUIRE_LT(after.cross_cpu_free_batches() - before.cross_cpu_free_batches(), 10000);
+    });
+#endif
+    co_return;
+}
+
+SEASTAR_TEST_CASE(test_relocatable_class_compaction) {
+#ifndef SEASTAR_DEFAULT_ALLOCATOR
+    constexpr size_t object_size = 128;
+    std::vector<void*> objects(10000);
+    memory::relocatable_class c(object_size, [&objects] (void* from, void* to) {
+        std::memcpy(to, from, object_size);
+        objects[*static_cast<size_t*>(to)] = to;
+    });
+    for (size_t i = 0; i < objects.size(); ++i) {
+        objects[i] = c.allocate();
+        *static_cast<size_t*>(objects[i]) = i;
+    }
+    // keep every 16th object, leaving all spans sparsely used
+    for (size_t i = 0; i < objects.size(); ++i) {
+        if (i % 16) {
+            c.free(std::exchange(objects[i], nullptr));
+        }
+    }
+    auto before = memory::stats();
+    while (memory::compact_relocatable()) {
+    }
+    auto after = memory::stats();
+    BOOST_REQUIRE_GT(after.relocations(), before.relocations());
+    BOOST_REQUIRE_GT(after.compacted_memory(), before.compacted_memory());
+    // Objects only move into spans already in use
+    BOOST_REQUIRE_GE(after.free_memory(), before.free_memory() + after.compacted_memory() - before.compacted_memory());
+    for (size_t i = 0; i < objects.size(); ++i) {
+        if (objects[i]) {
+            BOOST_REQUIRE_EQUAL(*static_cast<size_t*>(objects[i]), i);
+            c.free(objects[i]);
+        }
+    }
+#endif
+    return make_ready_future<>();
+}
+
 SEASTAR_TEST_CASE(test_aligned_alloc) {
     for (size_t align = sizeof(void*); align <= 65536; align <<= 1) {
         for (size_t size = align; size <= align * 2; size <<= 1) {
@@ -548,6 +607,14 @@ SEASTAR_TEST_CASE(test_sampled_profile_collection_large)
         BOOST_REQUIRE_EQUAL(stats.size(), 0);
     }
 
+    {
+        // the sites are still there, for their allocation totals
+        auto stats = seastar::memory::sampled_allocation_profile();
+        BOOST_REQUIRE_GE(stats.size(), 2);
+        BOOST_REQUIRE(std::ranges::all_of(stats, [] (const auto& site) { return site.count == 0 && site.size == 0; }));
+        BOOST_REQUIRE(std::ranges::any_of(stats, [] (const auto& site) { return site.total_count > 0 && site.total_size == site.total_count * 1000000; }));
+    }
+
     return seastar::make_ready_future();
 }
 
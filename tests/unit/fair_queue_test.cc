@@ -63,11 +63,13 @@ class test_env {
     std::vector<int> _results;
     std::vector<std::vector<std::exception_ptr>> _exceptions;
     fair_queue::class_id _nr_classes = 0;
+    fair_queue::group_id _nr_groups = 0;
     std::vector<request> _inflight;
 
-    static fair_queue::config fq_config() {
+    static fair_queue::config fq_config(uint64_t dispatch_quantum) {
         fair_queue::config cfg;
         cfg.forgiving_factor = 50 * test_weight_scale;
+        cfg.dispatch_quantum = dispatch_quantum;
         return cfg;
     }
 
@@ -75,8 +77,8 @@ class test_env {
         do {} while (tick() != 0);
     }
 public:
-    test_env(unsigned capacity)
-        : _fq(fq_config())
+    test_env(unsigned capacity, uint64_t dispatch_quantum = 0)
+        : _fq(fq_config(dispatch_quantum))
     {
     }
 
@@ -130,18 +132,41 @@ class test_env {
         for (fair_queue::class_id id = 0; id < _nr_classes; id++) {
             _fq.unregister_priority_class(id);
         }
+        for (fair_queue::group_id id = _nr_groups; id > 0; id--) {
+            _fq.unregister_priority_group(id - 1);
+        }
     }
 
-    size_t register_priority_class(uint32_t shares) {
+    size_t register_priority_class(uint32_t shares, std::optional<fair_queue::group_id> group = std::nullopt) {
         _results.push_back(0);
         _exceptions.push_back(std::vector<std::exception_ptr>());
-        _fq.register_priority_class(_nr_classes, shares);
+        _fq.register_priority_class(_nr_classes, shares, group);
         return _nr_classes++;
     }
 
+    fair_queue::group_id register_priority_group(uint32_t shares, std::optional<fair_queue::group_id> parent = std::nullopt) {
+        _fq.register_priority_group(_nr_groups, shares, parent);
+        return _nr_groups++;
+    }
+
+    void plug_group(fair_queue::group_id id) {
+        _fq.plug_group(id);
+    }
+
+    void unplug_group(fair_queue::group_id id) {
+        _fq.unplug_group(id);
+    }
+
+    void set_class_group(fair_queue::class_id id, std::optional<fair_queue::group_id> group) {
+        _fq.set_class_group(id, group);
+    }
+
     void do_op(fair_queue::class_id id, unsigned weight) {
+        do_op_capacity(id, fair_queue_entry::capacity_t(test_weight_scale * weight));
+    }
+
+    void do_op_capacity(fair_queue::class_id id, fair_queue_entry::capacity_t cap) {
         unsigned index = id;
-        auto cap = fair_queue_entry::capacity_t(test_weight_scale * weight);
         auto req = std::make_unique<request>(cap, index, [this, index] (request& req) mutable noexcept {
             try {
                 _inflight.push_back(std::move(req));
@@ -456,3 +481,209 @@ SEASTAR_THREAD_TEST_CASE(test_fair_queue_random_run) {
     auto expected_error = std::max(1, int(round(reqs * 0.05)));
     env.verify(format("random_run ({:d} requests)", reqs), {1, 1}, expected_error);
 }
+
+// Groups with equal shares get equal capacity, regardless of how many classes
+// each of them has.
+SEASTAR_THREAD_TEST_CASE(test_fair_queue_groups) {
+    test_env env(1);
+
+    auto ga = env.register_priority_group(10);
+    auto gb = env.register_priority_group(10);
+
+    auto b1 = env.register_priority_class(10, gb);
+    auto b2 = env.register_priority_class(10, gb);
+    auto b3 = env.register_priority_class(10, gb);
+    auto a = env.register_priority_class(10, ga);
+
+    for (int i = 0; i < 200; ++i) {
+        env.do_op(b1, 1);
+        env.do_op(b2, 1);
+        env.do_op(b3, 1);
+        env.do_op(a, 1);
+    }
+    yield().get();
+    env.tick(200);
+    env.verify("groups", {1, 1, 1, 3});
+}
+
+// Shares are distributed recursively through nested groups.
+SEASTAR_THREAD_TEST_CASE(test_fair_queue_nested_groups) {
+    test_env env(1);
+
+    auto tenant = env.register_priority_group(10);
+    auto workload = env.register_priority_group(10, tenant);
+
+    auto y = env.register_priority_class(10, tenant);
+    auto z = env.register_priority_class(10, workload);
+    auto x = env.register_priority_class(10);
+
+    for (int i = 0; i < 200; ++i) {
+        env.do_op(y, 1);
+        env.do_op(z, 1);
+        env.do_op(x, 1);
+    }
+    yield().get();
+    env.tick(200);
+    env.verify("nested_groups", {1, 1, 2});
+}
+
+// Unplugged group doesn't dispatch anything from its classes until plugged back.
+SEASTAR_THREAD_TEST_CASE(test_fair_queue_unplugged_group) {
+    test_env env(1);
+
+    auto g = env.register_priority_group(10);
+    auto a = env.register_priority_class(10);
+    auto b = env.register_priority_class(10, g);
+
+    env.unplug_group(g);
+    for (int i = 0; i < 100; ++i) {
+        env.do_op(a, 1);
+        env.do_op(b, 1);
+    }
+    yield().get();
+    env.tick(50);
+    env.verify("unplugged_group", {1, 0});
+
+    // Once plugged back, the group is forgiven for up to 50 requests like
+    // any other re-activated class, then the rest is shared 1:1
+    env.plug_group(g);
+    env.reset_results(a);
+    env.tick(100);
+    env.verify("plugged_group", {1, 3}, 2);
+}
+
+// A small quantum makes the classes go around the calendar many times, their
+// shares must be kept across the wraps.
+SEASTAR_THREAD_TEST_CASE(test_fair_queue_calendar_wraparound) {
+    test_env env(1, 64);
+
+    auto a = env.register_priority_class(10);
+    auto b = env.register_priority_class(20);
+
+    for (int i = 0; i < 20000; ++i) {
+        env.do_op(a, 1);
+        env.do_op(b, 1);
+    }
+    yield().get();
+    // Each request of a moves it 1.5 slots ahead, so it wraps the 256 slots
+    // of the calendar several times
+    env.tick(3000);
+    env.verify("calendar_wraparound", {1, 2}, 2);
+}
+
+// Classes further ahead than the calendar covers are parked at its end and
+// re-filed once it is reached.
+SEASTAR_THREAD_TEST_CASE(test_fair_queue_parked_classes) {
+    test_env env(1, 1);
+
+    // Every request of a moves it 1000 slots ahead, of b 10 slots
+    auto a = env.register_priority_class(1);
+    auto b = env.register_priority_class(100);
+
+    for (int i = 0; i < 200; ++i) {
+        env.do_op(a, 1);
+    }
+    for (int i = 0; i < 20000; ++i) {
+        env.do_op(b, 1);
+    }
+    yield().get();
+    env.tick(5050);
+    env.verify("parked_classes", {1, 100});
+}
+
+// When all classes are parked, dispatching jumps straight to the nearest.
+SEASTAR_THREAD_TEST_CASE(test_fair_queue_all_parked) {
+    test_env env(1, 1);
+
+    auto a = env.register_priority_class(1);
+    auto b = env.register_priority_class(2);
+
+    for (int i = 0; i < 300; ++i) {
+        env.do_op(a, 1);
+        env.do_op(b, 1);
+    }
+    yield().get();
+    env.tick(300);
+    env.verify("all_parked", {1, 2});
+}
+
+// The quantum follows the average request cost, the calendar is rebuilt when
+// it changes without upsetting the balance.
+SEASTAR_THREAD_TEST_CASE(test_fair_queue_quantum_retune) {
+    test_env env(1);
+
+    auto a = env.register_priority_class(10);
+    auto b = env.register_priority_class(20);
+
+    for (int i = 0; i < 1000; ++i) {
+        env.do_op(a, 1);
+        env.do_op(b, 1);
+        env.do_op(b, 1);
+    }
+    yield().get();
+    env.tick(3000);
+    env.verify("quantum_retune_small", {1, 2});
+
+    // 64 times more expensive requests, the quantum is retuned mid-way
+    env.reset_results(a);
+    env.reset_results(b);
+    for (int i = 0; i < 1000; ++i) {
+        env.do_op(a, 64);
+        env.do_op(b, 64);
+    }
+    yield().get();
+    env.tick(1500);
+    env.verify("quantum_retune_large", {1, 2}, 2);
+}
+
+// Moving the class being dispatched from to another group takes it out of
+// its old one.
+SEASTAR_THREAD_TEST_CASE(test_fair_queue_move_current_class) {
+    // The quantum is large enough for a class to dispatch all its requests
+    // in one go
+    test_env env(1, 1 << 20);
+
+    auto g = env.register_priority_group(10);
+    auto a = env.register_priority_class(10);
+    auto b = env.register_priority_class(10);
+
+    for (int i = 0; i < 100; ++i) {
+        env.do_op(a, 1);
+        env.do_op(b, 1);
+    }
+    yield().get();
+    env.tick(10);
+    env.verify("move_current_class_before", {1, 0});
+
+    env.set_class_group(a, g);
+    env.tick(190);
+    env.verify("move_current_class_after", {1, 1});
+    BOOST_REQUIRE_EQUAL(env.tick(), 0);
+}
+
+// Accumulated costs about to overflow are rebased, the classes keep their
+// shares past that.
+SEASTAR_THREAD_TEST_CASE(test_fair_queue_accumulated_overflow) {
+    test_env env(1);
+
+    auto a = env.register_priority_class(1);
+    auto b = env.register_priority_class(1);
+
+    // Each class overflows after 512 requests. Not queueing all of them at
+    // once keeps the total queued capacity in range.
+    auto cap = fair_queue_entry::capacity_t(1) << 54;
+    for (int i = 0; i < 400; ++i) {
+        env.do_op_capacity(a, cap);
+        env.do_op_capacity(b, cap);
+    }
+    yield().get();
+    env.tick(800);
+
+    for (int i = 0; i < 400; ++i) {
+        env.do_op_capacity(a, cap);
+        env.do_op_capacity(b, cap);
+    }
+    yield().get();
+    env.tick(400);
+    env.verify("accumulated_overflow", {1, 1});
+}
@@ -31,10 +31,12 @@
 #include <seastar/core/file.hh>
 #include <seastar/core/io_queue.hh>
 #include <seastar/core/io_intent.hh>
+#include <seastar/core/metrics_api.hh>
 #include <seastar/core/internal/io_request.hh>
 #include <seastar/core/internal/io_sink.hh>
 #include <seastar/util/assert.hh>
 #include <seastar/util/internal/iovec_utils.hh>
+#include <map>
 
 using namespace seastar;
 
@@ -77,7 +79,11 @@ struct io_queue_for_tests {
     timer<> kicker;
 
     io_queue_for_tests()
-        : group(std::make_shared<io_group>(io_queue::config{0}, 1))
+        : io_queue_for_tests(io_queue::config{0})
+    {}
+
+    explicit io_queue_for_tests(io_queue::config cfg)
+        : group(std::make_shared<io_group>(std::move(cfg), 1))
         , sink()
         , queue(group, sink)
         , kicker([this] { kick(); })
@@ -94,6 +100,23 @@ struct io_queue_for_tests {
     future<size_t> queue_request(internal::priority_class pc, internal::io_direction_and_length dnl, internal::io_request req, io_intent* intent, iovec_keeper iovs) noexcept {
         return queue.queue_request(pc, dnl, std::move(req), intent, std::move(iovs));
     }
+
+    // Feeds the rate controller with nr requests that took lat to execute
+    void report_latency(std::chrono::duration<double> lat, unsigned nr, bool throttled) {
+        for (unsigned i = 0; i < nr; i++) {
+            queue.account_latency(lat);
+        }
+        queue._throttled_polls += throttled ? 1 : 0;
+        queue.report_rate_feedback();
+    }
+
+    double rate_factor() const {
+        return group->_fgs.front().rate_factor();
+    }
+
+    const auto& merge_stats() const {
+        return queue._merge_stats;
+    }
 };
 
 internal::priority_class get_default_pc() {
@@ -173,6 +196,165 @@ static void do_test_large_request_flow(part_flaw flaw) {
     f.get();
 }
 
+// Every request is accounted in each stage of its direction's latency histograms
+SEASTAR_THREAD_TEST_CASE(test_stage_latency) {
+    io_queue::config cfg{0};
+    cfg.mountpoint = "stage_latency";
+    io_queue_for_tests tio(std::move(cfg));
+    fake_file file;
+
+    auto val = std::make_unique<int>(42);
+    auto f = tio.queue_request(get_default_pc(), internal::io_direction_and_length(internal::io_direction_and_length::write_idx, 0), file.make_write_req(0, val.get()), nullptr, {});
+
+    seastar::sleep(std::chrono::milliseconds(500)).get();
+    tio.queue.poll_io_queue();
+    tio.sink.drain([&file] (const internal::io_request& rq, io_completion* desc) -> bool {
+        // As the reactor backends do when taking requests for the kernel
+        desc->on_submit();
+        file.execute_write_req(rq, desc);
+        return true;
+    });
+    f.get();
+
+    std::map<std::pair<sstring, sstring>, uint64_t> samples;
+    auto values = seastar::metrics::impl::get_values();
+    for (size_t i = 0; i < values->metadata->size(); i++) {
+        const auto& md = (*values->metadata)[i];
+        if (md.mf.name != "io_queue_stage_latency") {
+            continue;
+        }
+        for (size_t j = 0; j < md.metrics.size(); j++) {
+            const auto& labels = md.metrics[j].labels();
+            if (labels.at("mountpoint") == "stage_latency") {
+                samples[{labels.at("stage"), labels.at("direction")}] = values->values[i][j].get_histogram().sample_count;
+            }
+        }
+    }
+    for (auto stage : {"queue", "sink", "kernel"}) {
+        BOOST_REQUIRE_EQUAL(samples[std::make_pair(sstring(stage), sstring("write"))], 1);
+        BOOST_REQUIRE_EQUAL(samples[std::make_pair(sstring(stage), sstring("read"))], 0);
+    }
+}
+
+SEASTAR_THREAD_TEST_CASE(test_adaptive_rate) {
+    io_queue::config cfg{0};
+    cfg.adaptive_rate = true;
+    // Timer-driven reports would interfere with the ones below
+    cfg.adaptive_rate_period = std::chrono::hours(1);
+    io_queue_for_tests tio(std::move(cfg));
+    auto goal = tio.group->io_latency_goal();
+    auto samples = tio.queue.get_config().adaptive_rate_min_samples;
+
+    // Not enough samples to judge
+    tio.report_latency(goal * 10, samples / 2, false);
+    BOOST_REQUIRE_EQUAL(tio.rate_factor(), 1.0);
+
+    // Disk is slower than the model, rate goes down, but not below the minimum
+    tio.report_latency(goal * 10, samples, false);
+    auto factor = tio.rate_factor();
+    BOOST_REQUIRE_LT(factor, 1.0);
+    for (unsigned i = 0; i < 100; i++) {
+        tio.report_latency(goal * 10, samples, false);
+    }
+    BOOST_REQUIRE_CLOSE(tio.rate_factor(), tio.queue.get_config().adaptive_rate_min_factor, 0.1);
+    BOOST_REQUIRE_CLOSE(tio.group->io_latency_goal().count(), goal.count(), 0.1);
+
+    // Disk is fast, but nobody waits for tokens, so there's no reason to raise.
+    // Make sure the slow samples leave the window
+    factor = tio.rate_factor();
+    for (unsigned i = 0; i < tio.queue.get_config().adaptive_rate_window; i++) {
+        tio.report_latency(goal / 10, samples, false);
+    }
+    BOOST_REQUIRE_EQUAL(tio.rate_factor(), factor);
+
+    // Disk is fast and queues are throttled, rate goes up to the maximum
+    tio.report_latency(goal / 10, samples, true);
+    BOOST_REQUIRE_GT(tio.rate_factor(), factor);
+    for (unsigned i = 0; i < 100; i++) {
+        tio.report_latency(goal / 10, samples, true);
+    }
+    BOOST_REQUIRE_CLOSE(tio.rate_factor(), tio.queue.get_config().adaptive_rate_max_factor, 0.1);
+}
+
+SEASTAR_THREAD_TEST_CASE(test_read_merging) {
+    io_queue::config cfg{0};
+    cfg.merge_reads = true;
+    io_queue_for_tests tio(std::move(cfg));
+
+    std::unordered_map<int, uint64_t> file_size = { {1, 2048}, {2, 4096} };
+    auto content = [] (uint64_t pos) { return char(pos % 251); };
+    auto available = [&file_size] (int fd, uint64_t pos, size_t len) -> size_t {
+        auto size = file_size.at(fd);
+        return pos < size ? std::min<uint64_t>(len, size - pos) : 0;
+    };
+
+    struct read {
+        int fd;
+        uint64_t pos;
+        size_t len;
+        size_t expected;
+    };
+    std::vector<read> reads = {
+        { 1, 1024, 512, 512 },
+        { 1, 0, 512, 512 },
+        { 1, 512, 512, 512 },
+        { 1, 256, 256, 256 },   // inside the merged range
+        { 1, 1536, 1024, 512 }, // adjacent, crosses the EOF
+        { 1, 8192, 512, 0 },    // too far
+        { 2, 1536, 512, 512 },  // another file
+    };
+
+    std::vector<std::vector<char>> bufs;
+    std::vector<future<size_t>> results;
+    for (auto& r : reads) {
+        bufs.emplace_back(r.len, 0);
+        results.push_back(tio.queue_request(get_default_pc(), internal::io_direction_and_length(internal::io_direction_and_length::read_idx, r.len),
+                internal::io_request::make_read(r.fd, r.pos, bufs.back().data(), r.len, false), nullptr, {}));
+    }
+
+    seastar::sleep(std::chrono::milliseconds(500)).get();
+    tio.queue.poll_io_queue();
+
+    unsigned nr_read = 0, nr_readv = 0;
+    tio.sink.drain([&] (const internal::io_request& rq, io_completion* desc) -> bool {
+        if (rq.opcode() == internal::io_request::operation::read) {
+            nr_read++;
+            const auto& op = rq.as<internal::io_request::operation::read>();
+            auto len = available(op.fd, op.pos, op.size);
+            for (size_t i = 0; i < len; i++) {
+                op.addr[i] = content(op.pos + i);
+            }
+            desc->complete_with(len);
+        } else {
+            BOOST_REQUIRE(rq.opcode() == internal::io_request::operation::readv);
+            nr_readv++;
+            const auto& op = rq.as<internal::io_request::operation::readv>();
+            size_t len = 0;
+            for (size_t v = 0; v < op.iov_len; v++) {
+                auto n = available(op.fd, op.pos + len, op.iovec[v].iov_len);
+                for (size_t i = 0; i < n; i++) {
+                    static_cast<char*>(op.iovec[v].iov_base)[i] = content(op.pos + len + i);
+                }
+                len += n;
+            }
+            desc->complete_with(len);
+        }
+        return true;
+    });
+
+    BOOST_REQUIRE_EQUAL(nr_readv, 1);
+    BOOST_REQUIRE_EQUAL(nr_read, 2);
+    for (unsigned i = 0; i < reads.size(); i++) {
+        BOOST_REQUIRE_EQUAL(results[i].get(), reads[i].expected);
+        for (size_t b = 0; b < reads[i].expected; b++) {
+            BOOST_REQUIRE_EQUAL(bufs[i][b], content(reads[i].pos + b));
+        }
+    }
+    BOOST_REQUIRE_EQUAL(tio.merge_stats().merged_reads, 5);
+    BOOST_REQUIRE_EQUAL(tio.merge_stats().ios, 1);
+    BOOST_REQUIRE_EQUAL(tio.merge_stats().saved_bytes, 256);
+}
+
 SEASTAR_THREAD_TEST_CASE(test_large_request_flow) {
     do_test_large_request_flow(part_flaw::none);
 }
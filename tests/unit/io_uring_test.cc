@@ -0,0 +1,190 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*
+ * Copyright (C) 2026 ScyllaDB
+ */
+
+// Runs with --reactor-backend io_uring, once per ring setup mode (see
+// CMakeLists.txt); the expected mode is worked out from the options.
+
+#include <seastar/testing/test_case.hh>
+#include <seastar/testing/thread_test_case.hh>
+#include <seastar/core/aligned_buffer.hh>
+#include <seastar/core/file.hh>
+#include <seastar/core/metrics_api.hh>
+#include <seastar/core/seastar.hh>
+#include <seastar/core/internal/uname.hh>
+#include <seastar/util/closeable.hh>
+#include <seastar/util/tmp_file.hh>
+#include <boost/test/unit_test.hpp>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+
+using namespace seastar;
+
+namespace {
+
+std::optional<std::string_view> option(std::string_view name) {
+    auto& suite = boost::unit_test::framework::master_test_suite();
+    for (int i = 1; i < suite.argc; i++) {
+        std::string_view arg = suite.argv[i];
+        if (arg == name) {
+            return i + 1 < suite.argc ? suite.argv[i + 1] : "";
+        }
+        if (arg.starts_with(name) && arg.substr(name.size()).starts_with("=")) {
+            return arg.substr(name.size() + 1);
+        }
+    }
+    return std::nullopt;
+}
+
+bool enabled(std::string_view name) {
+    auto v = option(name);
+    return v && (*v == "1" || *v == "true");
+}
+
+// The mode the ring should be in, given the options and the kernel. A
+// request the kernel refuses has to leave a working ring in default mode.
+sstring expected_mode() {
+    auto uname = internal::kernel_uname();
+    if (enabled("--io-uring-sqpoll")) {
+        // The fallback run pins the polling thread to a CPU that doesn't exist
+        auto cpus = option("--io-uring-sqpoll-cpuset");
+        if (cpus && std::stol(std::string(*cpus)) >= ::sysconf(_SC_NPROCESSORS_CONF)) {
+            return "default";
+        }
+        return uname.whitelisted({"5.11"}) ? "sqpoll" : "default";
+    }
+    if (enabled("--io-uring-defer-taskrun")) {
+        return uname.whitelisted({"6.1"}) ? "defer_taskrun" : "default";
+    }
+    if (enabled("--io-uring-coop-taskrun")) {
+        return uname.whitelisted({"5.19"}) ? "coop_taskrun" : "default";
+    }
+    return "default";
+}
+
+// Values of a reactor metric on this shard, by the value of its label
+std::map<sstring, uint64_t> metric_values(sstring name, sstring label) {
+    std::map<sstring, uint64_t> ret;
+    auto values = metrics::impl::get_values();
+    for (size_t i = 0; i < values->metadata->size(); i++) {
+        const auto& md = (*values->metadata)[i];
+        if (md.mf.name != "reactor_" + name) {
+            continue;
+        }
+        for (size_t j = 0; j < md.metrics.size(); j++) {
+            ret[md.metrics[j].labels().at(label)] = values->values[i][j].ui();
+        }
+    }
+    return ret;
+}
+
+}
+
+SEASTAR_THREAD_TEST_CASE(test_setup_mode) {
+    auto modes = metric_values("io_uring_mode", "mode");
+    BOOST_REQUIRE_EQUAL(modes.size(), 1);
+    BOOST_REQUIRE_EQUAL(modes.begin()->first, expected_mode());
+    BOOST_REQUIRE_EQUAL(modes.begin()->second, 1);
+}
+
+// Every submission is counted on the path it took: a system call, or
+// picked up by the polling thread without one
+SEASTAR_THREAD_TEST_CASE(test_submission_path_metric) {
+    tmp_dir::do_with_thread([] (tmp_dir& t) {
+        auto before = metric_values("io_uring_submissions", "path");
+        BOOST_REQUIRE(before.contains("syscall"));
+        BOOST_REQUIRE(before.contains("sqpoll"));
+
+        auto f = open_file_dma((t.get_path() / "f").native(), open_flags::rw | open_flags::create).get();
+        auto close_f = deferred_close(f);
+        auto buf = allocate_aligned_buffer<char>(4096, 4096);
+        std::fill_n(buf.get(), 4096, 'x');
+        for (int i = 0; i < 100; i++) {
+            BOOST_REQUIRE_EQUAL(f.dma_write(0, buf.get(), 4096).get(), 4096);
+        }
+
+        auto after = metric_values("io_uring_submissions", "path");
+        auto with_syscall = after["syscall"] - before["syscall"];
+        auto without_syscall = after["sqpoll"] - before["sqpoll"];
+        BOOST_REQUIRE_GE(with_syscall + without_syscall, 100);
+        if (expected_mode() == "sqpoll") {
+            // Back to back writes find the polling thread awake
+            BOOST_REQUIRE_GT(without_syscall, 0);
+        } else {
+            BOOST_REQUIRE_EQUAL(without_syscall, 0);
+        }
+    }).get();
+}
+
+// Opening, stat()ing, renaming and removing files and directories all go
+// through the ring, none through the syscall thread pool, and fail the way
+// the system calls would
+SEASTAR_THREAD_TEST_CASE(test_file_system_calls) {
+    tmp_dir::do_with_thread([] (tmp_dir& t) {
+        auto path = [&] (const char* name) {
+            return (t.get_path() / name).native();
+        };
+        make_directory(path("dir")).get();
+        auto before = metric_values("io_threaded_fallbacks", "reason");
+
+        auto f = open_file_dma(path("f"), open_flags::rw | open_flags::create | open_flags::exclusive).get();
+        auto buf = allocate_aligned_buffer<char>(4096, 4096);
+        std::fill_n(buf.get(), 4096, 'x');
+        BOOST_REQUIRE_EQUAL(f.dma_write(0, buf.get(), 4096).get(), 4096);
+        BOOST_REQUIRE_EQUAL(f.stat().get().st_size, 4096);
+        f.close().get();
+        BOOST_REQUIRE_THROW(open_file_dma(path("f"), open_flags::rw | open_flags::create | open_flags::exclusive).get(), std::system_error);
+        BOOST_REQUIRE_THROW(open_file_dma(path("none"), open_flags::ro).get(), std::system_error);
+
+        auto st = file_stat(path("f")).get();
+        BOOST_REQUIRE(st.type == directory_entry_type::regular);
+        BOOST_REQUIRE_EQUAL(st.size, 4096);
+        BOOST_REQUIRE(file_type(path("dir")).get() == directory_entry_type::directory);
+        BOOST_REQUIRE(!file_type(path("none")).get());
+        BOOST_REQUIRE_THROW(file_stat(path("none")).get(), std::system_error);
+
+        rename_file(path("f"), path("dir/g")).get();
+        BOOST_REQUIRE(!file_exists(path("f")).get());
+        BOOST_REQUIRE_EQUAL(file_stat(path("dir/g")).get().size, 4096);
+        BOOST_REQUIRE_THROW(rename_file(path("f"), path("h")).get(), std::system_error);
+        rename_file(path("dir"), path("dir2")).get();
+        auto d = open_directory(path("dir2")).get();
+        d.close().get();
+
+        // A non-empty directory can't be removed; an empty one is, after
+        // unlinking it as a file failed with EISDIR
+        BOOST_REQUIRE_THROW(remove_file(path("dir2")).get(), std::system_error);
+        remove_file(path("dir2/g")).get();
+        remove_file(path("dir2")).get();
+        BOOST_REQUIRE(!file_exists(path("dir2")).get());
+        BOOST_REQUIRE_THROW(remove_file(path("dir2")).get(), std::system_error);
+
+        if (internal::kernel_uname().whitelisted({"5.11"})) {
+            auto after = metric_values("io_threaded_fallbacks", "reason");
+            for (auto reason : {"file_open", "file_stat", "file_rename", "file_remove"}) {
+                BOOST_TEST_INFO(reason);
+                BOOST_REQUIRE_EQUAL(after[reason], before[reason]);
+            }
+        }
+    }).get();
+}
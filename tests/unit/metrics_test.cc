@@ -31,6 +31,8 @@
 #include <seastar/core/io_queue.hh>
 #include <seastar/core/loop.hh>
 #include <seastar/core/internal/estimated_histogram.hh>
+#include <seastar/core/with_scheduling_group.hh>
+#include <seastar/util/later.hh>
 #include <seastar/testing/random.hh>
 #include <seastar/testing/test_case.hh>
 #include <seastar/testing/thread_test_case.hh>
@@ -121,6 +123,45 @@ SEASTAR_THREAD_TEST_CASE(test_renaming_scheuling_groups) {
     BOOST_REQUIRE((name1_found && !name2_found) || (name2_found && !name1_found));
 }
 
+// Every so many tasks of a group are timed into its runtime and scheduling
+// delay histograms
+SEASTAR_THREAD_TEST_CASE(test_task_time_histograms) {
+    using namespace seastar;
+    namespace smi = seastar::metrics::impl;
+
+    scheduling_group sg = create_scheduling_group("sampled", 100).get();
+    auto sample_counts = [] {
+        std::map<sstring, uint64_t> ret;
+        auto values = smi::get_values();
+        for (size_t i = 0; i < values->metadata->size(); i++) {
+            const auto& md = (*values->metadata)[i];
+            if (md.mf.name != "scheduler_task_runtime" && md.mf.name != "scheduler_task_schedule_delay") {
+                continue;
+            }
+            for (size_t j = 0; j < md.metrics.size(); j++) {
+                if (md.metrics[j].labels().at("group") == "sampled") {
+                    ret[md.mf.name] = values->values[i][j].get_histogram().sample_count;
+                }
+            }
+        }
+        return ret;
+    };
+
+    auto before = sample_counts();
+    with_scheduling_group(sg, [] {
+        return do_with(boost::irange<int>(0, 1000), [] (boost::integer_range<int>& rng) {
+            return do_for_each(rng, [] (int) {
+                return yield();
+            });
+        });
+    }).get();
+    auto after = sample_counts();
+    BOOST_REQUIRE_GT(after["scheduler_task_runtime"], before["scheduler_task_runtime"]);
+    BOOST_REQUIRE_GT(after["scheduler_task_schedule_delay"], before["scheduler_task_schedule_delay"]);
+
+    destroy_scheduling_group(sg).get();
+}
+
 int count_by_label(const std::string& label) {
     seastar::foreign_ptr<seastar::metrics::impl::values_reference> values = seastar::metrics::impl::get_values();
     int count = 0;
@@ -389,3 +430,26 @@ SEASTAR_THREAD_TEST_CASE(test_estimated_histogram) {
         BOOST_CHECK_EQUAL(mh.buckets[i].count, 33 + i);
     }
 }
+
+SEASTAR_THREAD_TEST_CASE(test_estimated_histogram_quantile_upper_bound) {
+    using namespace seastar::metrics;
+    // Buckets of 2 between 8 and 16, of 4 between 16 and 32, ...
+    internal::approximate_exponential_histogram<8, 1024, 4> h;
+    BOOST_CHECK_EQUAL(h.quantile_upper_bound(0.99), 0);
+
+    for (int i = 0; i < 98; i++) {
+        h.add(9);
+    }
+    h.add(100);
+    h.add(100);
+    // 98% of the values are below 10, 99% below the limit of the bucket holding 100
+    BOOST_CHECK_EQUAL(h.quantile_upper_bound(0.5), 10);
+    BOOST_CHECK_EQUAL(h.quantile_upper_bound(0.98), 10);
+    BOOST_CHECK_EQUAL(h.quantile_upper_bound(0.99), 112);
+    BOOST_CHECK_EQUAL(h.quantile_upper_bound(1.0), 112);
+
+    // Values past Max are reported as Max
+    h.add(5000);
+    BOOST_CHECK_EQUAL(h.quantile_upper_bound(1.0), 1024);
+    BOOST_CHECK_EQUAL(h.quantile_upper_bound(0.0), 10);
+}
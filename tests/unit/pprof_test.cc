@@ -0,0 +1,136 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*
+ * Copyright (C) 2025 ScyllaDB
+ */
+
+#include <seastar/core/memory.hh>
+#include <seastar/core/pprof.hh>
+#include <seastar/core/smp.hh>
+#include <seastar/testing/test_case.hh>
+#include <google/protobuf/io/gzip_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include "proto/profile.pb.h"
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using namespace seastar;
+namespace pp = perftools::profiles;
+
+static pp::Profile decode(const sstring& data) {
+    google::protobuf::io::ArrayInputStream is(data.data(), data.size());
+    google::protobuf::io::GzipInputStream gz(&is);
+    pp::Profile profile;
+    BOOST_REQUIRE(profile.ParseFromZeroCopyStream(&gz));
+    return profile;
+}
+
+static const std::string& str(const pp::Profile& p, int64_t idx) {
+    BOOST_REQUIRE_GE(idx, 0);
+    BOOST_REQUIRE_LT(idx, p.string_table_size());
+    return p.string_table(idx);
+}
+
+SEASTAR_TEST_CASE(test_heap_profile_format) {
+    auto p = decode(co_await pprof::heap_profile());
+
+    BOOST_REQUIRE_GE(p.string_table_size(), 1);
+    BOOST_REQUIRE_EQUAL(p.string_table(0), "");
+    std::vector<std::string> types;
+    for (auto& st : p.sample_type()) {
+        types.push_back(str(p, st.type()));
+    }
+    BOOST_REQUIRE((types == std::vector<std::string>{"alloc_objects", "alloc_space", "inuse_objects", "inuse_space"}));
+    BOOST_REQUIRE_EQUAL(str(p, p.default_sample_type()), "inuse_space");
+    BOOST_REQUIRE_EQUAL(str(p, p.period_type().type()), "space");
+    BOOST_REQUIRE_EQUAL(p.period(), memory::get_heap_profiling_sample_rate());
+    BOOST_REQUIRE_GT(p.time_nanos(), 0);
+}
+
+#ifdef SEASTAR_HEAPPROF
+
+[[gnu::noinline]]
+static char* malloc_wrapper(size_t size) {
+    auto ret = static_cast<char*>(malloc(size));
+    *ret = 'c';
+    return ret;
+}
+
+SEASTAR_TEST_CASE(test_heap_profile_samples) {
+    constexpr size_t sample_rate = 100;
+    std::vector<char*> ptrs(1000);
+    memory::set_heap_profiling_sampling_rate(sample_rate);
+    for (auto& p : ptrs) {
+        p = malloc_wrapper(10);
+    }
+    // Half of them freed: counted as allocated but no longer in use
+    for (size_t i = 0; i < ptrs.size() / 2; ++i) {
+        free(ptrs[i]);
+    }
+    memory::set_heap_profiling_sampling_rate(0);
+    auto expected = memory::sampled_allocation_profile();
+
+    auto p = decode(co_await pprof::heap_profile(this_shard_id()));
+
+    for (auto ptr : ptrs) {
+        free(ptr);
+    }
+
+    BOOST_REQUIRE_EQUAL(size_t(p.sample_size()), expected.size());
+    BOOST_REQUIRE_GE(p.sample_size(), 1);
+    std::unordered_map<uint64_t, const pp::Location*> locations;
+    for (auto& l : p.location()) {
+        BOOST_REQUIRE(locations.emplace(l.id(), &l).second);
+    }
+    std::unordered_set<uint64_t> mappings;
+    for (auto& m : p.mapping()) {
+        BOOST_REQUIRE(mappings.insert(m.id()).second);
+        BOOST_REQUIRE(!str(p, m.filename()).empty());
+        BOOST_REQUIRE_LT(m.memory_start(), m.memory_limit());
+    }
+    uint64_t alloc_objects = 0, inuse_objects = 0;
+    for (auto& s : p.sample()) {
+        BOOST_REQUIRE_EQUAL(s.value_size(), 4);
+        BOOST_REQUIRE_GE(s.value(0), s.value(2));
+        BOOST_REQUIRE_GE(s.value(1), s.value(3));
+        alloc_objects += s.value(0);
+        inuse_objects += s.value(2);
+        BOOST_REQUIRE_GE(s.location_id_size(), 1);
+        for (auto id : s.location_id()) {
+            auto it = locations.find(id);
+            BOOST_REQUIRE(it != locations.end());
+            BOOST_REQUIRE(mappings.contains(it->second->mapping_id()));
+        }
+        BOOST_REQUIRE_EQUAL(s.label_size(), 1);
+        BOOST_REQUIRE_EQUAL(str(p, s.label(0).key()), "shard");
+        BOOST_REQUIRE_EQUAL(s.label(0).num(), this_shard_id());
+    }
+    // Objects sampled before the profile was taken may have been freed
+    // since, so only the cumulative counts are exact
+    size_t expected_alloc_objects = 0;
+    for (auto& site : expected) {
+        expected_alloc_objects += site.total_count;
+    }
+    BOOST_REQUIRE_EQUAL(alloc_objects, expected_alloc_objects);
+    BOOST_REQUIRE_GT(alloc_objects, inuse_objects);
+}
+
+#endif // SEASTAR_HEAPPROF
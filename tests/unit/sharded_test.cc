@@ -26,6 +26,8 @@
 #include <seastar/core/smp.hh>
 #include <seastar/util/assert.hh>
 
+#include <algorithm>
+#include <numeric>
 #include <ranges>
 
 using namespace seastar;
@@ -303,3 +305,58 @@ SEASTAR_THREAD_TEST_CASE(invoke_on_range_fragmented) {
 
     s.stop().get();
 }
+
+SEASTAR_THREAD_TEST_CASE(invoke_on_others_by_node) {
+    sharded<coordinator_synced_shard_map> s;
+    auto coordinator_id = this_shard_id();
+    s.start(coordinator_id).get();
+
+    unsigned value = 7;
+    s.invoke_on_others_by_node([value] (coordinator_synced_shard_map& s) { return s.sync(value); }).get();
+
+    s.invoke_on(coordinator_id, [coordinator_id, value] (coordinator_synced_shard_map& s) {
+        for (unsigned i = 0; i < smp::count; i++) {
+            BOOST_REQUIRE_EQUAL(i == coordinator_id ? 0u : value, s.get_synced(i));
+        }
+    }).get();
+
+    s.stop().get();
+}
+
+SEASTAR_THREAD_TEST_CASE(nearest_shard) {
+    std::vector<shard_id> all(smp::count);
+    std::iota(all.begin(), all.end(), 0);
+    BOOST_REQUIRE_EQUAL(smp::nearest_shard(all), this_shard_id());
+    BOOST_REQUIRE_EQUAL(smp::submit_to_cost(this_shard_id(), this_shard_id()), 0u);
+    auto leaders = smp::nearest_shard_per_node();
+    BOOST_REQUIRE(std::ranges::find(leaders, this_shard_id()) != leaders.end());
+    size_t shards = 0;
+    for (auto leader : leaders) {
+        shards += smp::shards_on_node_of(leader).size();
+        if (leader != this_shard_id()) {
+            BOOST_REQUIRE_GT(smp::submit_to_cost(this_shard_id(), leader), 0u);
+        }
+    }
+    BOOST_REQUIRE_EQUAL(shards, smp::count);
+}
+
+SEASTAR_THREAD_TEST_CASE(tree_broadcast_and_reduce) {
+    sharded<coordinator_synced_shard_map> s;
+    auto coordinator_id = this_shard_id();
+    s.start(coordinator_id).get();
+
+    for (auto tree_options : {smp_tree_options{.arity = 1, .numa_aware = false}, smp_tree_options{.arity = 2}, smp_tree_options{}}) {
+        unsigned value = tree_options.arity;
+        s.invoke_on_all_tree(tree_options, [] (coordinator_synced_shard_map& s, unsigned value) { return s.sync(value); }, value).get();
+        s.invoke_on(coordinator_id, [value] (coordinator_synced_shard_map& s) {
+            for (unsigned i = 0; i < smp::count; i++) {
+                BOOST_REQUIRE_EQUAL(value, s.get_synced(i));
+            }
+        }).get();
+
+        auto sum = s.map_reduce0_tree([] (coordinator_synced_shard_map&) { return this_shard_id(); }, 1000u, std::plus<unsigned>(), tree_options).get();
+        BOOST_REQUIRE_EQUAL(sum, 1000 + smp::count * (smp::count - 1) / 2);
+    }
+
+    s.stop().get();
+}
@@ -23,6 +23,8 @@
 #include <seastar/core/smp.hh>
 #include <seastar/core/app-template.hh>
 #include <seastar/core/print.hh>
+#include <seastar/core/work_stealing.hh>
+#include <seastar/core/loop.hh>
 
 using namespace seastar;
 
@@ -58,6 +60,37 @@ future<bool> test_smp_exception() {
     });
 }
 
+future<bool> test_stealable_jobs() {
+    // Enough busy jobs for idle shards to take some of them
+    auto stolen = internal::stolen_stealable_jobs();
+    return do_with(0ul, [stolen] (unsigned long& sum) {
+        return parallel_for_each(std::views::iota(0u, 1000u), [&sum] (unsigned i) {
+            return submit_stealable([i] {
+                volatile unsigned long x = 0;
+                for (unsigned j = 0; j < 10000; j++) {
+                    x = x + j;
+                }
+                return i;
+            }).then([&sum] (unsigned i) {
+                sum += i;
+            });
+        }).then([&sum, stolen] {
+            return submit_stealable([] () -> int {
+                throw nasty_exception();
+            }).then_wrapped([&sum, stolen] (future<int> f) {
+                try {
+                    f.get();
+                    return false;
+                } catch (nasty_exception&) {
+                    return sum == 1000 * 999 / 2 && (smp::count == 1 || internal::stolen_stealable_jobs() > stolen);
+                } catch (...) {
+                    return false;
+                }
+            });
+        });
+    });
+}
+
 int tests, fails;
 
 future<>
@@ -73,6 +106,8 @@ int main(int ac, char** av) {
     return app_template().run_deprecated(ac, av, [] {
        return report("smp call", test_smp_call()).then([] {
            return report("smp exception", test_smp_exception());
+       }).then([] {
+           return report("stealable jobs", test_stealable_jobs());
        }).then([] {
            fmt::print("\n{:d} tests / {:d} failures\n", tests, fails);
            engine().exit(fails ? 1 : 0);
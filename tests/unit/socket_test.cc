@@ -33,11 +33,18 @@
 #include <seastar/core/sleep.hh>
 #include <seastar/core/thread.hh>
 #include <seastar/core/when_all.hh>
+#include <seastar/core/sharded.hh>
+#include <seastar/core/with_timeout.hh>
+#include <seastar/core/internal/busy_poll.hh>
+#include <seastar/core/internal/uname.hh>
 #include <seastar/net/api.hh>
 #include <seastar/net/posix-stack.hh>
 
+#include <map>
 #include <optional>
 #include <tuple>
+#include <vector>
+#include <sys/socket.h>
 
 using namespace seastar;
 
@@ -337,3 +344,209 @@ SEASTAR_THREAD_TEST_CASE(socket_bufsize) {
     BOOST_CHECK_LT(recv_default, 20'000'000);
 }
 
+
+SEASTAR_THREAD_TEST_CASE(socket_incoming_cpu) {
+    listen_options lo{
+        .reuse_address = true,
+        .lba = server_socket::load_balancing_algorithm::incoming_cpu,
+    };
+    ipv4_addr addr("127.0.0.1", 1235);
+    server_socket ss = seastar::listen(addr, lo);
+
+    auto cpus = engine().smp().shard_to_cpu_mapping();
+    // Older kernels hash connections over the listeners
+    bool steered = !cpus.empty() && internal::kernel_uname().whitelisted({"6.2"});
+
+    // Another shard joins the same port and keeps accepting
+    foreign_ptr<std::unique_ptr<server_socket>> other;
+    auto other_accepted = make_ready_future<bool>(false);
+    if (steered && smp::count > 1) {
+        other = smp::submit_to(1, [addr, lo] {
+            return make_foreign(std::make_unique<server_socket>(seastar::listen(addr, lo)));
+        }).get();
+        other_accepted = smp::submit_to(1, [s = other.get()] {
+            return s->accept().then([] (accept_result) {
+                return true;
+            }).handle_exception([] (std::exception_ptr) {
+                return false;
+            });
+        });
+    }
+
+    auto accepted = ss.accept();
+    connected_socket client = connect(addr).get();
+    // Loopback packets are processed on the sender's cpu, which is ours, so
+    // the connection goes to our listener rather than to the other shard's
+    connected_socket server = with_timeout(lowres_clock::now() + std::chrono::seconds(10), std::move(accepted)).get().connection;
+
+    if (!cpus.empty()) {
+        int cpu = -1;
+        BOOST_REQUIRE_EQUAL(server.get_sockopt(SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu)), 0);
+        BOOST_REQUIRE_EQUAL(cpu, int(cpus[this_shard_id()]));
+    }
+
+    if (other) {
+        smp::submit_to(1, [s = other.get()] {
+            s->abort_accept();
+        }).get();
+        BOOST_REQUIRE(!other_accepted.get());
+    }
+
+    ss.abort_accept();
+    client.shutdown_output();
+    server.shutdown_output();
+}
+
+SEASTAR_THREAD_TEST_CASE(socket_busy_poll) {
+    listen_options lo{
+        .reuse_address = true,
+        .busy_poll = std::chrono::microseconds(50),
+    };
+    ipv4_addr addr("127.0.0.1", 1236);
+    server_socket ss;
+    try {
+        ss = seastar::listen(addr, lo);
+    } catch (const std::system_error& e) {
+        if (e.code().value() == EPERM) {
+            fmt::print("Busy polling needs CAP_NET_ADMIN, skipping\n");
+            return;
+        }
+        throw;
+    }
+
+    connected_socket client = connect(addr).get();
+    connected_socket server = ss.accept().get().connection;
+
+    // Accepted sockets inherit the listener's busy polling
+    int usec = 0;
+    BOOST_REQUIRE_EQUAL(server.get_sockopt(SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec)), 0);
+    BOOST_REQUIRE_EQUAL(usec, 50);
+
+    auto out = client.output();
+    auto in = server.input();
+    out.write("ping").get();
+    out.flush().get();
+    auto buf = in.read_exactly(4).get();
+    BOOST_REQUIRE_EQUAL(std::string_view(buf.get(), buf.size()), "ping");
+
+    out.close().get();
+    in.close().get();
+    ss.abort_accept();
+}
+
+// Busy-polled sockets are grouped by the NAPI id of their NIC queue, move
+// when it changes, and are dropped when closed, after which the poller
+// doesn't look at them again. Loopback sockets have no NAPI id, so the
+// test makes them up.
+SEASTAR_THREAD_TEST_CASE(socket_busy_poll_queues) {
+    constexpr int nr = 8;
+    std::vector<pollable_fd> fds;
+    std::vector<file_desc> peers;
+    // By fd; erased when the socket is closed
+    std::map<int, unsigned> napi_ids;
+    internal::busy_poll_sockets sockets([&napi_ids] (const pollable_fd_state& fd) {
+        auto i = napi_ids.find(fd.fd.get());
+        BOOST_REQUIRE(i != napi_ids.end());
+        return i->second;
+    });
+    for (int i = 0; i < nr; i++) {
+        int sv[2];
+        BOOST_REQUIRE_EQUAL(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sv), 0);
+        napi_ids[sv[0]] = i < 4 ? 1 : i < 6 ? 2 : 0;
+        fds.emplace_back(file_desc::from_fd(sv[0]));
+        peers.push_back(file_desc::from_fd(sv[1]));
+        sockets.add(fds.back());
+        sockets.add(fds.back());
+    }
+    auto close = [&] (int i) {
+        napi_ids.erase(fds[i].get_file_desc().get());
+        fds[i].close();
+    };
+    auto set_napi_id = [&] (int i, unsigned napi_id) {
+        if (fds[i]) {
+            napi_ids[fds[i].get_file_desc().get()] = napi_id;
+        }
+    };
+
+    BOOST_REQUIRE_EQUAL(sockets.unassigned(), nr);
+    auto now = lowres_clock::now();
+    sockets.poll(now);
+    BOOST_REQUIRE_EQUAL(sockets.queued(1), 4);
+    BOOST_REQUIRE_EQUAL(sockets.queued(2), 2);
+    BOOST_REQUIRE_EQUAL(sockets.unassigned(), 2);
+
+    // Sockets with unread data are passed over for the next one in the queue
+    peers[0].write("x", 1);
+    peers[1].write("x", 1);
+    for (int i = 0; i < 10; i++) {
+        sockets.poll(now);
+    }
+
+    // Closing unlinks a socket from its queue or from the unassigned ones,
+    // even when that leaves a queue empty
+    close(1);
+    close(4);
+    close(5);
+    close(6);
+    BOOST_REQUIRE_EQUAL(sockets.queued(1), 3);
+    BOOST_REQUIRE_EQUAL(sockets.queued(2), 0);
+    BOOST_REQUIRE_EQUAL(sockets.unassigned(), 1);
+    sockets.poll(now);
+
+    // An unassigned socket is filed once it has an id
+    set_napi_id(7, 2);
+    now += std::chrono::seconds(1);
+    sockets.poll(now);
+    BOOST_REQUIRE_EQUAL(sockets.queued(2), 1);
+    BOOST_REQUIRE_EQUAL(sockets.unassigned(), 0);
+
+    // Every recheck moves the socket a queue is polled through next, if its
+    // id changed; the sockets take turns, so all of them are moved
+    for (int i : {0, 2, 3}) {
+        set_napi_id(i, 3);
+    }
+    for (int i = 0; i < 3; i++) {
+        now += std::chrono::milliseconds(100);
+        sockets.poll(now);
+    }
+    BOOST_REQUIRE_EQUAL(sockets.queued(1), 0);
+    BOOST_REQUIRE_EQUAL(sockets.queued(3), 3);
+
+    // A socket that lost its id goes back to the unassigned ones
+    close(2);
+    set_napi_id(0, 0);
+    set_napi_id(3, 0);
+    for (int i = 0; i < 2; i++) {
+        now += std::chrono::milliseconds(100);
+        sockets.poll(now);
+    }
+    BOOST_REQUIRE_EQUAL(sockets.queued(3), 0);
+    BOOST_REQUIRE_EQUAL(sockets.unassigned(), 2);
+
+    close(0);
+    close(7);
+    now += std::chrono::seconds(1);
+    sockets.poll(now);
+    BOOST_REQUIRE_EQUAL(sockets.queued(2), 0);
+    BOOST_REQUIRE_EQUAL(sockets.unassigned(), 1);
+    close(3);
+    BOOST_REQUIRE_EQUAL(sockets.unassigned(), 0);
+    sockets.poll(now + std::chrono::seconds(1));
+
+    // The reactor keeps polling its own set while sockets in it are closed
+    std::vector<pollable_fd> polled;
+    for (int i = 0; i < nr; i++) {
+        int sv[2];
+        BOOST_REQUIRE_EQUAL(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sv), 0);
+        polled.emplace_back(file_desc::from_fd(sv[0]));
+        peers.push_back(file_desc::from_fd(sv[1]));
+        polled.back().enable_busy_poll();
+    }
+    sleep(std::chrono::milliseconds(20)).get();
+    for (int i = 0; i < nr; i += 2) {
+        polled[i].close();
+    }
+    sleep(std::chrono::milliseconds(20)).get();
+    polled.clear();
+    sleep(std::chrono::milliseconds(20)).get();
+}
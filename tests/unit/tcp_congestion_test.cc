@@ -0,0 +1,259 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*
+ * Copyright (C) 2026 ScyllaDB
+ */
+
+#define BOOST_TEST_MODULE tcp_congestion
+
+#include <seastar/net/tcp-congestion.hh>
+#include <boost/test/unit_test.hpp>
+#include <stdexcept>
+#include <vector>
+
+using namespace seastar::net;
+using namespace std::chrono_literals;
+
+static constexpr uint16_t mss = 1000;
+
+// Feeds an algorithm ACKs of a connection that delivers `bytes` every round
+// trip, each ACK closing a round
+struct path {
+    std::unique_ptr<tcp_congestion_control> cc;
+    tcp_congestion_window w;
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    uint64_t delivered = 0;
+    uint64_t lost = 0;
+
+    path(std::string_view name, uint32_t cwnd, uint32_t ssthresh)
+        : cc(make_tcp_congestion_control(name))
+        , w{cwnd, ssthresh, mss} {
+        cc->init(w);
+    }
+
+    void ack(uint32_t bytes, std::chrono::microseconds rtt, uint32_t in_flight, bool in_recovery = false) {
+        now += rtt;
+        tcp_rate_sample rs;
+        rs.now = now;
+        rs.acked = bytes;
+        rs.acked_segments = (bytes + mss - 1) / mss;
+        rs.in_flight = in_flight;
+        rs.prior_delivered = delivered;
+        delivered += bytes;
+        rs.total_delivered = delivered;
+        rs.total_lost = lost;
+        rs.delivered = bytes;
+        rs.interval = rtt;
+        rs.rtt = rtt;
+        rs.in_recovery = in_recovery;
+        cc->on_ack(w, rs);
+    }
+};
+
+BOOST_AUTO_TEST_CASE(test_unknown_algorithm) {
+    for (auto name : {"reno", "cubic", "bbr", "bbr2"}) {
+        BOOST_REQUIRE_EQUAL(make_tcp_congestion_control(name)->name(), name);
+    }
+    BOOST_REQUIRE_THROW(make_tcp_congestion_control("vegas"), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(test_reno) {
+    path p("reno", 4 * mss, 8 * mss);
+
+    // Slow start grows by a segment for every segment acknowledged
+    p.ack(2 * mss, 10ms, 0);
+    BOOST_REQUIRE_EQUAL(p.w.cwnd, 6 * mss);
+    p.ack(4 * mss, 10ms, 0);
+    BOOST_REQUIRE_EQUAL(p.w.cwnd, 10 * mss);
+
+    // Congestion avoidance grows by about a segment a round trip
+    p.ack(10 * mss, 10ms, 0);
+    BOOST_REQUIRE_GE(p.w.cwnd, 10 * mss + 900);
+    BOOST_REQUIRE_LE(p.w.cwnd, 11 * mss);
+
+    auto cwnd = p.w.cwnd;
+    p.ack(mss, 10ms, 0, true);
+    BOOST_REQUIRE_EQUAL(p.w.cwnd, cwnd);
+
+    BOOST_REQUIRE_EQUAL(p.cc->ssthresh(p.w, 20 * mss), 10 * mss);
+    BOOST_REQUIRE_EQUAL(p.cc->ssthresh(p.w, mss), 2 * mss);
+    BOOST_REQUIRE_EQUAL(p.cc->pacing_rate(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_cubic) {
+    path p("cubic", 100 * mss, 50 * mss);
+
+    // Multiplicative decrease by beta
+    p.w.ssthresh = p.cc->ssthresh(p.w, 100 * mss);
+    BOOST_REQUIRE_EQUAL(p.w.ssthresh, 70 * mss);
+    p.w.cwnd = p.w.ssthresh;
+
+    // The window stays below the one at the loss for K = cbrt(75) = 4.2
+    // seconds and grows past it afterwards
+    auto rtt = 100ms;
+    for (auto t = 0ms; t < 4000ms; t += rtt) {
+        auto cwnd = p.w.cwnd;
+        p.ack(p.w.cwnd, rtt, p.w.cwnd);
+        BOOST_REQUIRE_GE(p.w.cwnd, cwnd);
+        BOOST_REQUIRE_LT(p.w.cwnd, 100 * mss);
+    }
+    BOOST_REQUIRE_GT(p.w.cwnd, 95 * mss);
+    for (auto t = 0ms; t < 2000ms; t += rtt) {
+        p.ack(p.w.cwnd, rtt, p.w.cwnd);
+    }
+    BOOST_REQUIRE_GT(p.w.cwnd, 100 * mss);
+}
+
+BOOST_AUTO_TEST_CASE(test_bbr) {
+    path p("bbr", 4 * mss, 1000 * mss);
+
+    // 100KB every 10ms is 10MB/s, the BDP is 100KB
+    for (int i = 0; i < 20; i++) {
+        p.ack(100 * mss, 10ms, 50 * mss);
+    }
+    // Past startup and drain, pacing around the bottleneck rate and keeping
+    // twice the BDP in flight
+    BOOST_REQUIRE_GE(p.cc->pacing_rate(), 7'500'000);
+    BOOST_REQUIRE_LE(p.cc->pacing_rate(), 12'500'000);
+    BOOST_REQUIRE_EQUAL(p.w.cwnd, 2 * 100 * mss + 3 * mss);
+
+    // Losses do not reduce the window, packet conservation keeps what is in
+    // flight and the window is back once recovery is over
+    auto cwnd = p.w.cwnd;
+    BOOST_REQUIRE_EQUAL(p.cc->ssthresh(p.w, cwnd), cwnd);
+    p.ack(mss, 10ms, 20 * mss, true);
+    BOOST_REQUIRE_EQUAL(p.w.cwnd, 21 * mss);
+    p.cc->on_recovery_exit(p.w);
+    BOOST_REQUIRE_EQUAL(p.w.cwnd, cwnd);
+
+    // The window never drops below four segments
+    p.w.cwnd = mss;
+    p.cc->on_rto(p.w);
+    p.ack(100, 10ms, 0);
+    BOOST_REQUIRE_GE(p.w.cwnd, 4 * mss);
+}
+
+BOOST_AUTO_TEST_CASE(test_bbr2_loss) {
+    path p("bbr2", 4 * mss, 1000 * mss);
+
+    for (int i = 0; i < 20; i++) {
+        p.ack(100 * mss, 10ms, 50 * mss);
+    }
+    auto cwnd = p.w.cwnd;
+    BOOST_REQUIRE_GT(cwnd, 100 * mss);
+
+    // A round losing more than 2% of its data cuts the window by beta
+    p.lost += 10 * mss;
+    p.ack(100 * mss, 10ms, 50 * mss);
+    BOOST_REQUIRE_LE(p.w.cwnd, cwnd * 7 / 10);
+    BOOST_REQUIRE_LT(p.cc->pacing_rate(), 9'000'000);
+}
+
+BOOST_AUTO_TEST_CASE(test_delivery_rate) {
+    tcp_delivery_rate r;
+    tcp_rate_sample rs;
+    BOOST_REQUIRE(!r.sample(rs));
+
+    // A segment goes out every millisecond and is acknowledged 10ms later,
+    // 1MB/s with ten segments in flight
+    auto t0 = tcp_delivery_rate::clock_type::now();
+    std::vector<tcp_delivery_rate::snapshot> sent;
+    uint32_t in_flight = 0;
+    for (int t = 0; t < 40; t++) {
+        auto now = t0 + std::chrono::milliseconds(t);
+        if (t >= 10) {
+            auto s = t - 10;
+            r.on_delivered(sent[s], mss, false, now);
+            in_flight -= mss;
+            BOOST_REQUIRE(r.sample(rs));
+            BOOST_REQUIRE(rs.now == now);
+            BOOST_REQUIRE_EQUAL(rs.acked, mss);
+            BOOST_REQUIRE_EQUAL(rs.acked_segments, 1);
+            BOOST_REQUIRE_EQUAL(rs.total_delivered, (s + 1) * mss);
+            BOOST_REQUIRE(rs.rtt == 10ms);
+            BOOST_REQUIRE(!rs.app_limited);
+            if (s >= 10) {
+                // Sent once the ACK clock was running
+                BOOST_REQUIRE_EQUAL(rs.prior_delivered, (s - 9) * mss);
+                BOOST_REQUIRE_EQUAL(rs.delivered, 10 * mss);
+                BOOST_REQUIRE(rs.interval == 10ms);
+                BOOST_REQUIRE_EQUAL(rs.delivery_rate(), 1'000'000);
+            }
+        }
+        if (t < 30) {
+            sent.push_back(r.on_send(now, in_flight));
+            in_flight += mss;
+        }
+    }
+    BOOST_REQUIRE(!r.sample(rs));
+
+    // A retransmission gives no RTT, losses are counted
+    auto now = t0 + 100ms;
+    auto s = r.on_send(now, 0);
+    r.on_lost(mss);
+    r.on_delivered(s, mss, true, now + 10ms);
+    BOOST_REQUIRE(r.sample(rs));
+    BOOST_REQUIRE(!rs.rtt);
+    BOOST_REQUIRE_EQUAL(rs.total_lost, mss);
+    BOOST_REQUIRE_EQUAL(r.lost(), mss);
+    BOOST_REQUIRE_EQUAL(r.delivered(), 31 * mss);
+
+    // The ACK of a retransmission may be for the original, so an interval
+    // shorter than the minimum RTT makes no rate sample
+    now += 1s;
+    s = r.on_send(now, 0);
+    r.on_delivered(s, mss, true, now + 1ms);
+    BOOST_REQUIRE(r.sample(rs));
+    BOOST_REQUIRE(rs.interval.count() == 0);
+    BOOST_REQUIRE_EQUAL(rs.delivery_rate(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_delivery_rate_app_limited) {
+    tcp_delivery_rate r;
+    tcp_rate_sample rs;
+    auto now = tcp_delivery_rate::clock_type::now();
+
+    // The application runs out of data after three segments
+    auto s0 = r.on_send(now, 0);
+    auto s1 = r.on_send(now, mss);
+    r.on_app_limited(3 * mss);
+    auto s2 = r.on_send(now, 2 * mss);
+    BOOST_REQUIRE(!s0.app_limited);
+    BOOST_REQUIRE(!s1.app_limited);
+    BOOST_REQUIRE(s2.app_limited);
+
+    now += 10ms;
+    r.on_delivered(s0, mss, false, now);
+    BOOST_REQUIRE(r.sample(rs));
+    BOOST_REQUIRE(!rs.app_limited);
+    r.on_delivered(s1, mss, false, now);
+    r.on_delivered(s2, mss, false, now);
+    BOOST_REQUIRE(r.sample(rs));
+    BOOST_REQUIRE(rs.app_limited);
+    BOOST_REQUIRE_EQUAL(rs.acked, 2 * mss);
+    BOOST_REQUIRE_EQUAL(rs.acked_segments, 2);
+
+    // The bubble lasts until the data in flight when it started is delivered
+    auto s3 = r.on_send(now, 0);
+    BOOST_REQUIRE(s3.app_limited);
+    now += 10ms;
+    r.on_delivered(s3, mss, false, now);
+    BOOST_REQUIRE(r.sample(rs));
+    BOOST_REQUIRE(rs.app_limited);
+    BOOST_REQUIRE(!r.on_send(now, 0).app_limited);
+}
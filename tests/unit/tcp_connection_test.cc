@@ -0,0 +1,356 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*
+ * Copyright (C) 2026 ScyllaDB
+ */
+
+#include <seastar/testing/test_case.hh>
+#include <seastar/testing/thread_test_case.hh>
+#include <seastar/core/loop.hh>
+#include <seastar/core/sleep.hh>
+#include <seastar/net/tcp.hh>
+#include <seastar/util/later.hh>
+#include <boost/range/irange.hpp>
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace seastar;
+using namespace seastar::net;
+using namespace std::chrono_literals;
+
+namespace {
+
+// Stands for the IP layer under the native TCP, handing every segment the
+// tcp instance sends back to it, so both ends of a connection live in it
+struct loopback_l4 {
+    struct netif_type {
+        unsigned hash2cpu(uint32_t) {
+            return this_shard_id();
+        }
+        rss_key_type rss_key() const {
+            return default_rsskey_40bytes;
+        }
+    };
+    struct ip {
+        net::hw_features hw;
+        loopback_l4::netif_type iface;
+        const net::hw_features& hw_features() const {
+            return hw;
+        }
+        ipv4_address host_address() const {
+            return ipv4_address(0x7f000001);
+        }
+        loopback_l4::netif_type* netif() {
+            return &iface;
+        }
+    } _inet;
+    ipv4_traits::packet_provider_type provider;
+
+    void register_packet_provider(ipv4_traits::packet_provider_type func) {
+        provider = std::move(func);
+    }
+    future<ethernet_address> get_l2_dst_address(ipv4_address) {
+        return make_ready_future<ethernet_address>();
+    }
+};
+
+struct loopback_traits : ipv4_traits {
+    using inet_type = loopback_l4;
+};
+
+using loopback_tcp = tcp<loopback_traits>;
+
+class loopback {
+    loopback_l4 _l4;
+    loopback_tcp _tcp{_l4};
+    bool _stopped = false;
+    future<> _done;
+public:
+    // Segments it returns true for, given their header and data length,
+    // are dropped
+    std::function<bool (const tcp_hdr&, size_t)> drop;
+
+    loopback() : _done(run()) {}
+    loopback_tcp& tcp() {
+        return _tcp;
+    }
+    socket_address address(uint16_t port) const {
+        return socket_address(ipv4_addr(_l4._inet.host_address().ip, port));
+    }
+    future<> stop() {
+        _stopped = true;
+        return std::move(_done);
+    }
+private:
+    future<> run() {
+        return do_until([this] { return _stopped; }, [this] {
+            while (auto l4p = _l4.provider()) {
+                if (drop) {
+                    auto th = tcp_hdr::read(l4p->p.get_header(0, tcp_hdr::len));
+                    if (drop(th, l4p->p.len() - th.data_offset * 4)) {
+                        continue;
+                    }
+                }
+                _tcp.received(std::move(l4p->p), _l4._inet.host_address(), l4p->to);
+            }
+            return yield();
+        });
+    }
+};
+
+struct connected_pair {
+    loopback_tcp::listener listener;
+    loopback_tcp::connection client;
+    loopback_tcp::connection server;
+
+    connected_pair(loopback& lo, uint16_t port)
+        : listener(lo.tcp().listen(port))
+        , client(lo.tcp().connect(lo.address(port)))
+        , server(listener.accept().get()) {
+        client.connected().get();
+    }
+};
+
+// Closes both ends and lets the FIN exchange finish, so that no
+// connection outlives the loopback
+void shutdown(loopback& lo, std::optional<connected_pair>& c) {
+    c->client.close_write();
+    c->server.wait_input_shutdown().get();
+    c.reset();
+    sleep(100ms).get();
+    lo.stop().get();
+}
+
+// Drops chosen transmissions of the data segments sent to a port, and counts
+// how often each was sent. Segments are told apart by the offset of their
+// data in the stream, as the native stack retransmits them unchanged.
+class segment_dropper {
+    struct drop_rule {
+        uint32_t offset;
+        unsigned transmission;
+    };
+    uint16_t _port;
+    std::vector<drop_rule> _rules;
+    uint32_t _isn = 0;
+    // By offset of their first byte
+    std::map<uint32_t, std::pair<uint32_t, unsigned>> _segments;
+
+    bool drop(const tcp_hdr& th, size_t data_len) {
+        if (th.dst_port != _port) {
+            return false;
+        }
+        if (th.f_syn) {
+            _isn = th.seq.raw;
+            return false;
+        }
+        if (!data_len) {
+            return false;
+        }
+        auto start = th.seq.raw - _isn - 1;
+        auto& [end, transmissions] = _segments[start];
+        end = start + data_len;
+        transmissions++;
+        return std::ranges::any_of(_rules, [&] (const drop_rule& r) {
+            return start <= r.offset && r.offset < end && r.transmission == transmissions;
+        });
+    }
+public:
+    segment_dropper(loopback& lo, uint16_t port) : _port(port) {
+        lo.drop = [this] (const tcp_hdr& th, size_t data_len) {
+            return drop(th, data_len);
+        };
+    }
+    // Drops the given transmission, counting from 1, of the segment holding
+    // the byte at offset
+    void drop(uint32_t offset, unsigned transmission) {
+        _rules.push_back(drop_rule{offset, transmission});
+    }
+    // Of the segment holding the byte at offset
+    unsigned transmissions(uint32_t offset) const {
+        auto it = _segments.upper_bound(offset);
+        if (it == _segments.begin() || offset >= std::prev(it)->second.first) {
+            return 0;
+        }
+        return std::prev(it)->second.second;
+    }
+    unsigned retransmissions() const {
+        unsigned ret = 0;
+        for (auto& [start, seg] : _segments) {
+            ret += seg.second - 1;
+        }
+        return ret;
+    }
+};
+
+// Sends len bytes from the client and reads them on the server, returning
+// how long that took
+steady_clock_type::duration transfer(connected_pair& c, size_t len) {
+    auto start = steady_clock_type::now();
+    std::string data(len, 0);
+    for (size_t i = 0; i < len; i++) {
+        data[i] = char(i % 251);
+    }
+    auto sent = c.client.send(packet(data.data(), len));
+    size_t received = 0;
+    while (received < len) {
+        c.server.wait_for_data().get();
+        auto p = c.server.read();
+        for (auto& f : p.fragments()) {
+            for (size_t i = 0; i < f.size; i++, received++) {
+                BOOST_REQUIRE_EQUAL(f.base[i], char(received % 251));
+            }
+        }
+    }
+    sent.get();
+    BOOST_REQUIRE_EQUAL(received, len);
+    return steady_clock_type::now() - start;
+}
+
+// Below the minimum retransmission timeout, so a loss repaired within it was
+// not repaired by the timeout
+constexpr auto rto_min = 1s;
+
+}
+
+SEASTAR_THREAD_TEST_CASE(test_congestion_control_sockopt) {
+    loopback lo;
+    lo.tcp().set_default_congestion_control("cubic");
+    BOOST_REQUIRE_THROW(lo.tcp().set_default_congestion_control("vegas"), std::invalid_argument);
+    std::optional<connected_pair> c;
+    c.emplace(lo, 10000);
+    auto& client = c->client;
+    BOOST_REQUIRE_EQUAL(client.congestion_control(), "cubic");
+    BOOST_REQUIRE_EQUAL(c->server.congestion_control(), "cubic");
+
+    char name[16];
+    client.set_sockopt(IPPROTO_TCP, TCP_CONGESTION, "bbr", 3);
+    BOOST_REQUIRE_EQUAL(client.congestion_control(), "bbr");
+    BOOST_REQUIRE_EQUAL(client.get_sockopt(IPPROTO_TCP, TCP_CONGESTION, name, sizeof(name)), 0);
+    BOOST_REQUIRE_EQUAL(std::string(name, sizeof(name)), std::string("bbr") + std::string(sizeof(name) - 3, '\0'));
+
+    // The value may include the terminating NUL, and is truncated to the
+    // buffer on the way back, as with Linux
+    client.set_sockopt(IPPROTO_TCP, TCP_CONGESTION, "reno\0", 5);
+    BOOST_REQUIRE_EQUAL(client.congestion_control(), "reno");
+    BOOST_REQUIRE_EQUAL(client.get_sockopt(IPPROTO_TCP, TCP_CONGESTION, name, 2), 0);
+    BOOST_REQUIRE_EQUAL(std::string(name, 2), "re");
+
+    BOOST_REQUIRE_THROW(client.set_sockopt(IPPROTO_TCP, TCP_CONGESTION, "vegas", 5), std::invalid_argument);
+    BOOST_REQUIRE_EQUAL(client.congestion_control(), "reno");
+    int one = 1;
+    BOOST_REQUIRE_THROW(client.set_sockopt(IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)), std::runtime_error);
+    BOOST_REQUIRE_THROW(client.get_sockopt(IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)), std::runtime_error);
+
+    shutdown(lo, c);
+}
+
+// Every algorithm, with its pacing and the in-flight bound of can_send(),
+// moves data through the connection intact
+SEASTAR_THREAD_TEST_CASE(test_congestion_control_transfer) {
+    for (auto algorithm : {"reno", "cubic", "bbr", "bbr2"}) {
+        loopback lo;
+        std::optional<connected_pair> c;
+        c.emplace(lo, 10000);
+        c->client.set_congestion_control(algorithm);
+
+        constexpr size_t chunk = 16 * 1024;
+        constexpr size_t total = 64 * chunk;
+        auto chunks = boost::irange<size_t>(0, total / chunk);
+        auto sent = do_for_each(chunks, [&] (size_t i) {
+            return c->client.send(packet(std::string(chunk, char('a' + i % 26)).data(), chunk));
+        });
+        size_t received = 0;
+        while (received < total) {
+            c->server.wait_for_data().get();
+            auto p = c->server.read();
+            BOOST_REQUIRE(p.len());
+            for (auto& f : p.fragments()) {
+                for (size_t i = 0; i < f.size; i++, received++) {
+                    BOOST_REQUIRE_EQUAL(f.base[i], char('a' + received / chunk % 26));
+                }
+            }
+        }
+        sent.get();
+        BOOST_REQUIRE_EQUAL(received, total);
+        BOOST_REQUIRE_EQUAL(c->client.congestion_control(), algorithm);
+
+        shutdown(lo, c);
+    }
+}
+
+// A hole in the middle of a flight is SACKed around, and RACK marks it lost
+// and retransmits it without waiting for the retransmission timeout
+SEASTAR_THREAD_TEST_CASE(test_sack_recovery) {
+    loopback lo;
+    segment_dropper dropper(lo, 10000);
+    dropper.drop(2000, 1);
+    std::optional<connected_pair> c;
+    c.emplace(lo, 10000);
+
+    auto elapsed = transfer(*c, 64 * 1024);
+    BOOST_REQUIRE_EQUAL(dropper.transmissions(2000), 2);
+    BOOST_REQUIRE_EQUAL(dropper.retransmissions(), 1);
+    BOOST_REQUIRE_LT(elapsed, rto_min);
+
+    shutdown(lo, c);
+}
+
+// Losing the last segment leaves nothing to SACK; the tail loss probe
+// resends it before the retransmission timeout
+SEASTAR_THREAD_TEST_CASE(test_tail_loss_probe) {
+    loopback lo;
+    segment_dropper dropper(lo, 10000);
+    constexpr size_t len = 6000;
+    dropper.drop(len - 1, 1);
+    std::optional<connected_pair> c;
+    c.emplace(lo, 10000);
+
+    auto elapsed = transfer(*c, len);
+    BOOST_REQUIRE_EQUAL(dropper.transmissions(len - 1), 2);
+    BOOST_REQUIRE_EQUAL(dropper.retransmissions(), 1);
+    BOOST_REQUIRE_LT(elapsed, rto_min);
+
+    shutdown(lo, c);
+}
+
+// The fast retransmission of a hole is lost too, and with nothing sent after
+// it RACK cannot tell, so the retransmission timeout fires. It resends the
+// hole, but not the SACKed segment after it.
+SEASTAR_THREAD_TEST_CASE(test_timeout_with_sack) {
+    loopback lo;
+    segment_dropper dropper(lo, 10000);
+    constexpr size_t len = 12000;
+    dropper.drop(len - 2000, 1);
+    dropper.drop(len - 2000, 2);
+    std::optional<connected_pair> c;
+    c.emplace(lo, 10000);
+
+    auto elapsed = transfer(*c, len);
+    BOOST_REQUIRE_EQUAL(dropper.transmissions(len - 2000), 3);
+    BOOST_REQUIRE_EQUAL(dropper.transmissions(len - 1), 1);
+    BOOST_REQUIRE_EQUAL(dropper.retransmissions(), 2);
+    BOOST_REQUIRE_GE(elapsed, rto_min);
+
+    shutdown(lo, c);
+}
@@ -0,0 +1,153 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*
+ * Copyright (C) 2026 ScyllaDB
+ */
+
+#define BOOST_TEST_MODULE tcp_sack
+
+#include <seastar/net/tcp.hh>
+#include <boost/test/unit_test.hpp>
+#include <string>
+#include <vector>
+
+using namespace seastar;
+using namespace seastar::net;
+
+using block = tcp_option::sack_blocks::block;
+
+static void check_blocks(const tcp_option::sack_blocks& sb, std::vector<std::pair<uint32_t, uint32_t>> expected) {
+    BOOST_REQUIRE_EQUAL(sb.nr, expected.size());
+    for (uint8_t i = 0; i < sb.nr; i++) {
+        BOOST_REQUIRE_EQUAL(sb.blocks[i].left, expected[i].first);
+        BOOST_REQUIRE_EQUAL(sb.blocks[i].right, expected[i].second);
+    }
+}
+
+// Writes the options of a segment after a zeroed header and returns them
+static std::vector<uint8_t> fill_options(tcp_option& opt, bool syn_on, bool ack_on) {
+    auto size = opt.get_size(syn_on, ack_on);
+    std::vector<uint8_t> buf(tcp_hdr::len + size);
+    tcp_hdr th{};
+    th.f_syn = syn_on;
+    th.f_ack = ack_on;
+    BOOST_REQUIRE_EQUAL(opt.fill(buf.data(), &th, size), size);
+    buf.erase(buf.begin(), buf.begin() + tcp_hdr::len);
+    return buf;
+}
+
+BOOST_AUTO_TEST_CASE(test_sack_blocks_read_write) {
+    tcp_option::sack_blocks sb;
+    sb.blocks[0] = block{100, 200};
+    sb.blocks[1] = block{0xfffffff0, 0x10};
+    sb.nr = 2;
+    BOOST_REQUIRE_EQUAL(sb.len(), 18);
+
+    char buf[64] = {};
+    sb.write(buf);
+    BOOST_REQUIRE_EQUAL(buf[0], char(tcp_option::option_kind::sack_blocks));
+    BOOST_REQUIRE_EQUAL(buf[1], 18);
+    check_blocks(tcp_option::sack_blocks::read(buf), {{100, 200}, {0xfffffff0, 0x10}});
+
+    // A length claiming more blocks than fit the option space is capped
+    buf[1] = 2 + 8 * 5;
+    BOOST_REQUIRE_EQUAL(tcp_option::sack_blocks::read(buf).nr, tcp_option::sack_blocks::max_blocks);
+}
+
+BOOST_AUTO_TEST_CASE(test_syn_options) {
+    tcp_option opt;
+    opt._local_mss = 1460;
+    auto buf = fill_options(opt, true, false);
+    BOOST_REQUIRE_EQUAL(buf.size() % tcp_option::align, 0);
+
+    tcp_option peer;
+    peer.parse(buf.data(), buf.data() + buf.size());
+    BOOST_REQUIRE(peer._mss_received);
+    BOOST_REQUIRE_EQUAL(peer._remote_mss, 1460);
+    BOOST_REQUIRE(peer._win_scale_received);
+    BOOST_REQUIRE(peer._sack_received);
+
+    // The SYN-ACK only echoes what the peer offered
+    tcp_option reply;
+    reply._local_mss = 1460;
+    reply._mss_received = true;
+    buf = fill_options(reply, true, true);
+    peer = tcp_option();
+    peer.parse(buf.data(), buf.data() + buf.size());
+    BOOST_REQUIRE(peer._mss_received);
+    BOOST_REQUIRE(!peer._win_scale_received);
+    BOOST_REQUIRE(!peer._sack_received);
+}
+
+BOOST_AUTO_TEST_CASE(test_sack_options) {
+    tcp_option opt;
+    // No blocks, no options past the handshake
+    BOOST_REQUIRE_EQUAL(opt.get_size(false, true), 0);
+
+    opt._local_sack_blocks.blocks[0] = block{3000, 4000};
+    opt._local_sack_blocks.blocks[1] = block{1000, 2000};
+    opt._local_sack_blocks.nr = 2;
+    auto buf = fill_options(opt, false, true);
+    // Two NOPs and the blocks
+    BOOST_REQUIRE_EQUAL(buf.size(), 2 + 2 + 16);
+    BOOST_REQUIRE_EQUAL(buf[0], uint8_t(tcp_option::option_kind::nop));
+    BOOST_REQUIRE_EQUAL(buf[1], uint8_t(tcp_option::option_kind::nop));
+
+    tcp_option peer;
+    peer.parse_sack_blocks(buf.data(), buf.data() + buf.size());
+    check_blocks(peer._remote_sack_blocks, {{3000, 4000}, {1000, 2000}});
+
+    // The blocks of an earlier segment do not stick
+    uint8_t nops[] = {1, 1, 0};
+    peer.parse_sack_blocks(nops, nops + sizeof(nops));
+    BOOST_REQUIRE_EQUAL(peer._remote_sack_blocks.nr, 0);
+
+    // A truncated option is ignored
+    peer.parse_sack_blocks(buf.data(), buf.data() + buf.size() - 1);
+    BOOST_REQUIRE_EQUAL(peer._remote_sack_blocks.nr, 0);
+
+    // So is one with a length too short to make progress
+    buf[3] = 0;
+    peer.parse_sack_blocks(buf.data(), buf.data() + buf.size());
+    BOOST_REQUIRE_EQUAL(peer._remote_sack_blocks.nr, 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_make_sack_blocks) {
+    tcp_packet_merger ooo;
+    std::string data(100, 'x');
+    for (uint32_t seq : {900, 100, 500, 300, 700}) {
+        ooo.merge(make_seq(seq), packet(data.data(), data.size()));
+    }
+
+    // The block holding the most recent segment goes first, then the
+    // others in sequence order while they fit
+    tcp_option::sack_blocks sb;
+    make_sack_blocks(sb, ooo, make_seq(550));
+    check_blocks(sb, {{500, 600}, {100, 200}, {300, 400}, {700, 800}});
+
+    make_sack_blocks(sb, ooo, make_seq(100));
+    check_blocks(sb, {{100, 200}, {300, 400}, {500, 600}, {700, 800}});
+
+    // Adjacent segments merge into a single block
+    ooo.merge(make_seq(200), packet(data.data(), data.size()));
+    make_sack_blocks(sb, ooo, make_seq(250));
+    check_blocks(sb, {{100, 400}, {500, 600}, {700, 800}, {900, 1000}});
+
+    make_sack_blocks(sb, tcp_packet_merger(), make_seq(0));
+    BOOST_REQUIRE_EQUAL(sb.nr, 0);
+}
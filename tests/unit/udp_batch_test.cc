@@ -0,0 +1,127 @@
+/*
+ * This file is open source software, licensed to you under the terms
+ * of the Apache License, Version 2.0 (the "License").  See the NOTICE file
+ * distributed with this work for additional information regarding copyright
+ * ownership.  You may not use this file except in compliance with the License.
+ *
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*
+ * Copyright (C) 2025 ScyllaDB
+ */
+
+#include <seastar/testing/test_case.hh>
+#include <seastar/testing/thread_test_case.hh>
+#include <seastar/core/seastar.hh>
+#include <seastar/net/api.hh>
+#include <seastar/net/inet_address.hh>
+#include <seastar/core/thread.hh>
+#include <seastar/util/log.hh>
+
+using namespace seastar;
+
+static logger udplog("udp_batch");
+
+static std::string to_string(net::packet& p) {
+    p.linearize();
+    const auto& f = p.frag(0);
+    return std::string(f.base, f.size);
+}
+
+static std::vector<std::string> make_messages(size_t nr, size_t size) {
+    std::vector<std::string> ret;
+    for (size_t i = 0; i < nr; i++) {
+        auto msg = fmt::format("{:0{}}", i, size);
+        ret.push_back(std::move(msg));
+    }
+    // A shorter tail can still be coalesced with the rest
+    ret.push_back("tail");
+    return ret;
+}
+
+static void send_and_receive(net::datagram_channel& sender, net::datagram_channel& receiver, const std::vector<std::string>& msgs) {
+    std::vector<net::outgoing_datagram> batch;
+    for (auto& m : msgs) {
+        batch.push_back({receiver.local_address(), net::packet(m.data(), m.size())});
+    }
+    sender.send_batch(std::move(batch)).get();
+
+    std::vector<std::string> received;
+    while (received.size() < msgs.size()) {
+        auto dgrams = receiver.receive_batch(msgs.size() - received.size()).get();
+        BOOST_REQUIRE(!dgrams.empty());
+        BOOST_REQUIRE_LE(received.size() + dgrams.size(), msgs.size());
+        for (auto& d : dgrams) {
+            BOOST_REQUIRE_EQUAL(d.get_src(), sender.local_address());
+            received.push_back(to_string(d.get_data()));
+        }
+    }
+    BOOST_REQUIRE(received == msgs);
+}
+
+SEASTAR_THREAD_TEST_CASE(udp_batch_test) {
+    auto receiver = make_bound_datagram_channel(ipv4_addr{"127.0.0.1", 0});
+    auto sender = make_bound_datagram_channel(ipv4_addr{"127.0.0.1", 0});
+
+    // More than fits into one kernel batch
+    send_and_receive(sender, receiver, make_messages(40, 100));
+
+    receiver.close();
+    sender.close();
+}
+
+SEASTAR_THREAD_TEST_CASE(udp_batch_large_datagrams_test) {
+    auto receiver = make_bound_datagram_channel(ipv4_addr{"127.0.0.1", 0});
+    auto sender = make_bound_datagram_channel(ipv4_addr{"127.0.0.1", 0});
+
+    // Larger than the MTU, they spill over their buffer slots, several of
+    // them, between smaller ones, in one kernel batch. Small enough for
+    // all of them to fit the socket's receive buffer.
+    std::vector<std::string> msgs;
+    for (size_t size : {4000, 100, 4001, 9000, 2048, 2049, 10, 16000}) {
+        msgs.push_back(std::string(size, char('a' + msgs.size())));
+    }
+    send_and_receive(sender, receiver, msgs);
+    send_and_receive(sender, receiver, make_messages(8, 4000));
+    // The largest possible datagram
+    send_and_receive(sender, receiver, {std::string(65507, 'x')});
+
+    receiver.close();
+    sender.close();
+}
+
+SEASTAR_THREAD_TEST_CASE(udp_batch_segmentation_offload_test) {
+    auto receiver = make_bound_datagram_channel(ipv4_addr{"127.0.0.1", 0});
+    auto sender = make_bound_datagram_channel(ipv4_addr{"127.0.0.1", 0});
+
+    if (!receiver.set_segmentation_offload(true) || !sender.set_segmentation_offload(true)) {
+        udplog.info("No UDP segmentation offload support detected. Skipping...");
+        return;
+    }
+
+    send_and_receive(sender, receiver, make_messages(40, 1000));
+
+    // Mixing the batched and single-datagram calls keeps the order
+    auto msgs = make_messages(10, 200);
+    std::vector<net::outgoing_datagram> batch;
+    for (auto& m : msgs) {
+        batch.push_back({receiver.local_address(), net::packet(m.data(), m.size())});
+    }
+    sender.send_batch(std::move(batch)).get();
+    for (auto& m : msgs) {
+        auto d = receiver.receive().get();
+        BOOST_REQUIRE_EQUAL(to_string(d.get_data()), m);
+    }
+
+    receiver.close();
+    sender.close();
+}